@@ -0,0 +1,65 @@
+#!/usr/bin/env bash
+source $CEPH_ROOT/qa/standalone/ceph-helpers.sh
+
+function run() {
+    local dir=$1
+    shift
+
+    export CEPH_MON="127.0.0.1:7148" # git grep '\<7148\>' : there must be only one
+    export CEPH_ARGS
+    CEPH_ARGS+="--fsid=$(uuidgen) --auth-supported=none "
+    CEPH_ARGS+="--mon-host=$CEPH_MON "
+
+    local funcs=${@:-$(set | sed -n -e 's/^\(TEST_[0-9a-z_]*\) .*/\1/p')}
+    for func in $funcs ; do
+        setup $dir || return 1
+        $func $dir || return 1
+        teardown $dir || return 1
+    done
+}
+
+#
+# A single PG keeps one shard backlogged while the other shards' threads are
+# idle, so they steal its items.  Stolen items must still run one at a time
+# and in order for the PG: osd_debug_op_order aborts the OSD on an out of
+# order client op, and ceph_test_rados verifies every object it reads back.
+#
+function TEST_work_stealing_pg_order() {
+    local dir=$1
+    local poolname=test
+
+    run_mon $dir a --osd_pool_default_size=1 \
+        --osd_pool_default_pg_autoscale_mode=off || return 1
+    run_mgr $dir x || return 1
+    run_osd $dir 0 \
+        --osd_op_queue=wpq \
+        --osd_op_num_shards=8 \
+        --osd_op_num_threads_per_shard=1 \
+        --osd_op_queue_work_stealing=true \
+        --osd_op_queue_work_stealing_idle_ms=1 \
+        --osd_debug_op_order=true || return 1
+
+    create_pool $poolname 1 1 || return 1
+    wait_for_clean || return 1
+
+    # few objects and many ops in flight: the queue of the PG stays deep and
+    # several ops of the same object are queued at once
+    timeout 300 ceph_test_rados --pool $poolname \
+        --max-ops 4000 --objects 8 --max-in-flight 64 \
+        --size 65536 --min-stride-size 4096 --max-stride-size 16384 \
+        --op read 100 --op write 100 --op append 50 \
+        --op delete 10 --op write_excl 20 || return 1
+
+    # the osd survived the debug op order checks
+    ceph osd dump | grep -q "^osd.0 up" || return 1
+
+    local stolen=$(ceph daemon osd.0 perf dump | jq '.osd.op_wq_steal')
+    echo "op_wq_steal: $stolen"
+    test "$stolen" -gt 0 || return 1
+}
+
+main osd-op-queue-work-stealing "$@"
+
+# Local Variables:
+# compile-command: "cd ../.. ; make -j4 && test/osd/osd-op-queue-work-stealing.sh"
+# End:
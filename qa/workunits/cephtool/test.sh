@@ -2228,7 +2228,7 @@ function test_mon_osd_pool_set()
   ceph osd pool get pool_erasure erasure_code_profile
   ceph osd pool rm pool_erasure pool_erasure --yes-i-really-really-mean-it
 
-  for flag in nodelete nopgchange nosizechange write_fadvise_dontneed noscrub nodeep-scrub bulk; do
+  for flag in nodelete nopgchange nosizechange write_fadvise_dontneed noscrub nodeep-scrub bulk replica_reads; do
       ceph osd pool set $TEST_POOL_GETSET $flag false
       ceph osd pool get $TEST_POOL_GETSET $flag | grep "$flag: false"
       ceph osd pool set $TEST_POOL_GETSET $flag true
@@ -2378,6 +2378,8 @@ function test_mon_osd_tiered_pool_set()
   ceph osd pool get real-tier hit_set_type | grep "hit_set_type: explicit_hash"
   ceph osd pool set real-tier hit_set_type explicit_object
   ceph osd pool get real-tier hit_set_type | grep "hit_set_type: explicit_object"
+  ceph osd pool set real-tier hit_set_type cuckoo
+  ceph osd pool get real-tier hit_set_type | grep "hit_set_type: cuckoo"
   ceph osd pool set real-tier hit_set_type bloom
   ceph osd pool get real-tier hit_set_type | grep "hit_set_type: bloom"
   expect_false ceph osd pool set real-tier hit_set_type i_dont_exist
@@ -211,6 +211,14 @@ public:
     CephContext* cct, const std::string& path, aio_callback_t cb, void *cbpriv, aio_callback_t d_cb, void *d_cbpriv);
   virtual bool supported_bdev_label() { return true; }
   virtual bool is_rotational() { return rotational; }
+  /// true if writes are persistent on return at byte granularity (pmem);
+  /// such devices implement write_persistent()
+  virtual bool is_byte_addressable() const { return false; }
+  /// persist bl at off on a byte addressable device; unlike write(), off
+  /// and the length need not be multiples of the block size
+  virtual int write_persistent(uint64_t off, ceph::buffer::list& bl) {
+    return -EOPNOTSUPP;
+  }
 
   // HM-SMR-specific calls
   virtual bool is_smr() const { return false; }
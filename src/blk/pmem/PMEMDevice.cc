@@ -197,10 +197,16 @@ void PMEMDevice::aio_submit(IOContext *ioc)
 }
 
 int PMEMDevice::write(uint64_t off, bufferlist& bl, bool buffered, int write_hint)
+{
+  ceph_assert(is_valid_io(off, bl.length()));
+  return write_persistent(off, bl);
+}
+
+int PMEMDevice::write_persistent(uint64_t off, bufferlist& bl)
 {
   uint64_t len = bl.length();
   dout(20) << __func__ << " " << off << "~" << len  << dendl;
-  ceph_assert(is_valid_io(off, len));
+  ceph_assert(len > 0 && off < size && len <= size - off);
 
   dout(40) << "data:\n";
   bl.hexdump(*_dout);
@@ -214,15 +220,17 @@ int PMEMDevice::write(uint64_t off, bufferlist& bl, bool buffered, int write_hin
     return 0;
   }
 
+  // flush each fragment's cache lines as it is copied, but fence only once
   bufferlist::iterator p = bl.begin();
   uint64_t off1 = off;
   while (len) {
     const char *data;
     uint32_t l = p.get_ptr_and_advance(len, &data);
-    pmem_memcpy_persist(addr + off1, data, l);
+    pmem_memcpy_nodrain(addr + off1, data, l);
     len -= l;
     off1 += l;
   }
+  pmem_drain();
   return 0;
 }
 
@@ -47,6 +47,8 @@ public:
 
   static bool support(const std::string& path);
 
+  bool is_byte_addressable() const override { return true; }
+
   int read(uint64_t off, uint64_t len, bufferlist *pbl,
 	   IOContext *ioc,
 	   bool buffered) override;
@@ -55,6 +57,7 @@ public:
 
   int read_random(uint64_t off, uint64_t len, char *buf, bool buffered) override;
   int write(uint64_t off, bufferlist& bl, bool buffered, int write_hint = WRITE_LIFE_NOT_SET) override;
+  int write_persistent(uint64_t off, bufferlist& bl) override;
   int aio_write(uint64_t off, bufferlist& bl,
 		IOContext *ioc,
 		bool buffered,
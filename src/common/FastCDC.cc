@@ -46,9 +46,9 @@ void FastCDC::_setup(int target, int size_window_bits)
 
   std::mt19937_64 engine;
 
-  // prefill table
+  // prefill table (see the comment in FastCDC.h about the low bit)
   for (unsigned i = 0; i < 256; ++i) {
-    table[i] = engine();
+    table[i] = engine() ^ 1;
   }
 
   // set mask
@@ -71,106 +71,193 @@ void FastCDC::_setup(int target, int size_window_bits)
   }
 }
 
-static inline bool _scan(
-  // these are our cursor/postion...
-  bufferlist::buffers_t::const_iterator *p,
-  const char **pp, const char **pe,
-  size_t& pos,
-  size_t max,   // how much to read
-  uint64_t& fp, // fingerprint
-  uint64_t mask, const uint64_t *table)
+// Below this many bytes a scan is not worth splitting into lanes.  It
+// must leave every lane but the first at least a window of history.
+#define MIN_LANE_SCAN            2048
+
+// Longest lane.  When a lane finds a cut point, the lanes before it are
+// finished one at a time, so long lanes waste time on big chunks.
+#define LANE_STRIDE              16384
+
+/// (complemented) fingerprint of the 64 bytes starting at p
+static inline uint64_t _warm(const unsigned char *p, const uint64_t *table)
 {
-  while (pos < max) {
-    if (*pp == *pe) {
-      ++(*p);
-      *pp = (*p)->c_str();
-      *pe = *pp + (*p)->length();
-    }
-    const char *te = std::min(*pe, *pp + max - pos);
-    for (; *pp < te; ++(*pp), ++pos) {
-      if ((fp & mask) == mask) {
-	return false;
-      }
-      fp = (fp << 1) ^ table[*(unsigned char*)*pp];
-    }
-    if (pos >= max) {
-      return true;
+  uint64_t fp = ~0ull;
+  for (unsigned i = 0; i < 64; ++i) {
+    fp = (fp << 1) ^ table[p[i]];
+  }
+  return fp;
+}
+
+/// returns the offset of the first cut point in [p, p+n), or n
+static inline size_t _scan(
+  const unsigned char *p, size_t n,
+  uint64_t& fpr, uint64_t mask, const uint64_t *table)
+{
+  uint64_t fp = fpr;
+  size_t i = 0;
+  for (; i < n; ++i) {
+    if (!(fp & mask)) {
+      break;
     }
+    fp = (fp << 1) ^ table[p[i]];
   }
-  return true;
+  fpr = fp;
+  return i;
 }
 
-void FastCDC::calc_chunks(
-  const bufferlist& bl,
-  std::vector<std::pair<uint64_t, uint64_t>> *chunks) const
+// Each step of the rolling hash depends on the previous one, so a
+// single scan is bound by the latency of the shift and xor.  Split the
+// range in four and run the lanes in lockstep instead; lanes 1..3 seed
+// their fingerprint from the window just before them.  The first cut
+// point overall is the first one in the lowest lane that has one, so
+// once a later lane finds one we only need to finish the lanes before
+// it.  Returns the offset of the first cut point, or 4 * seg.
+static size_t _scan_lanes(
+  const unsigned char *p, size_t seg,
+  uint64_t& fp, uint64_t mask, const uint64_t *table)
 {
-  if (bl.length() == 0) {
-    return;
+  const unsigned char *p1 = p + seg, *p2 = p1 + seg, *p3 = p2 + seg;
+  uint64_t h[4] = {
+    fp, _warm(p1 - 64, table), _warm(p2 - 64, table), _warm(p3 - 64, table)
+  };
+  uint64_t h0 = h[0], h1 = h[1], h2 = h[2], h3 = h[3];
+  unsigned lane;
+  size_t i = 0;
+  for (; i < seg; ++i) {
+    if (!(h0 & mask)) {
+      fp = h0;
+      return i;
+    }
+    if (!(h1 & mask)) {
+      lane = 1;
+      goto found;
+    }
+    if (!(h2 & mask)) {
+      lane = 2;
+      goto found;
+    }
+    if (!(h3 & mask)) {
+      lane = 3;
+      goto found;
+    }
+    h0 = (h0 << 1) ^ table[p[i]];
+    h1 = (h1 << 1) ^ table[p1[i]];
+    h2 = (h2 << 1) ^ table[p2[i]];
+    h3 = (h3 << 1) ^ table[p3[i]];
   }
-  auto p = bl.buffers().begin();
-  const char *pp = p->c_str();
-  const char *pe = pp + p->length();
-
-  size_t pos = 0;
-  size_t len = bl.length();
-  while (pos < len) {
-    size_t cstart = pos;
-    uint64_t fp = 0;
-
-    // are we left with a min-sized (or smaller) chunk?
-    if (len - pos <= (1ul << min_bits)) {
-      chunks->push_back(std::pair<uint64_t,uint64_t>(pos, len - pos));
-      break;
+  fp = h3;
+  return seg * 4;
+
+ found:
+  h[0] = h0;
+  h[1] = h1;
+  h[2] = h2;
+  for (unsigned l = 0; l < lane; ++l) {
+    size_t r = i + _scan(p + l * seg + i, seg - i, h[l], mask, table);
+    if (r < seg) {
+      fp = h[l];
+      return l * seg + r;
     }
+  }
+  // fp is reset at a cut point, so there is no need to update it
+  return lane * seg + i;
+}
 
-    // skip forward to the min chunk size cut point (minus the window, so
-    // we can initialize the rolling fingerprint).
-    size_t skip = (1 << min_bits) - window;
-    pos += skip;
-    while (skip) {
-      size_t s = std::min<size_t>(pe - pp, skip);
-      skip -= s;
-      pp += s;
-      if (pp == pe) {
-	++p;
-	pp = p->c_str();
-	pe = pp + p->length();
-      }
+/// returns the offset of the first cut point in [p, p+n), or n
+static size_t _scan_all(
+  const unsigned char *p, size_t n,
+  uint64_t& fp, uint64_t mask, const uint64_t *table)
+{
+  size_t done = 0;
+  while (n - done >= MIN_LANE_SCAN) {
+    size_t seg = std::min<size_t>((n - done) / 4, LANE_STRIDE);
+    size_t r = _scan_lanes(p + done, seg, fp, mask, table);
+    done += r;
+    if (r < seg * 4) {
+      return done;
     }
+  }
+  return done + _scan(p + done, n - done, fp, mask, table);
+}
 
-    // first fill the window
-    size_t max = pos + window;
-    while (pos < max) {
-      if (pp == pe) {
-	++p;
-	pp = p->c_str();
-	pe = pp + p->length();
-      }
-      const char *te = std::min(pe, pp + (max - pos));
-      for (; pp < te; ++pp, ++pos) {
-	fp = (fp << 1) ^ table[*(unsigned char*)pp];
+void FastCDC::Stream::append(
+  const char *data, size_t len,
+  std::vector<std::pair<uint64_t, uint64_t>> *chunks)
+{
+  auto p = reinterpret_cast<const unsigned char*>(data);
+  auto end = p + len;
+  const uint64_t min_size = 1ull << cdc.min_bits;
+  // we only need the last window before the min chunk size cut point to
+  // initialize the rolling fingerprint
+  const uint64_t fill_start = min_size > cdc.window ? min_size - cdc.window : 0;
+  const uint64_t small_end = 1ull << (cdc.target_bits - TARGET_WINDOW_BITS);
+  const uint64_t target_end = 1ull << (cdc.target_bits + TARGET_WINDOW_BITS);
+  const uint64_t max_size = 1ull << cdc.max_bits;
+
+  while (p < end) {
+    uint64_t off = pos - cstart;
+    size_t avail = end - p;
+    if (off < fill_start) {
+      size_t n = std::min<uint64_t>(avail, fill_start - off);
+      p += n;
+      pos += n;
+      continue;
+    }
+    if (off < min_size) {
+      size_t n = std::min<uint64_t>(avail, min_size - off);
+      for (size_t i = 0; i < n; ++i) {
+	fp = (fp << 1) ^ cdc.table[p[i]];
       }
+      p += n;
+      pos += n;
+      continue;
     }
-    ceph_assert(pos < len);
 
     // find an end marker
-    if (
+    uint64_t mask, region_end;
+    if (off < small_end) {
       // for the first "small" region
-      _scan(&p, &pp, &pe, pos,
-	    std::min(len, cstart + (1 << (target_bits - TARGET_WINDOW_BITS))),
-	    fp, small_mask, table) &&
+      mask = cdc.small_mask;
+      region_end = small_end;
+    } else if (off < target_end) {
       // for the middle range (close to our target)
-      (TARGET_WINDOW_BITS == 0 ||
-       _scan(&p, &pp, &pe, pos,
-	     std::min(len, cstart + (1 << (target_bits + TARGET_WINDOW_BITS))),
-	     fp, target_mask, table)) &&
+      mask = cdc.target_mask;
+      region_end = target_end;
+    } else if (off < max_size) {
       // we're past target, use large_mask!
-      _scan(&p, &pp, &pe, pos,
-	    std::min(len,
-		     cstart + (1 << max_bits)),
-	    fp, large_mask, table))
-      ;
+      mask = cdc.large_mask;
+      region_end = max_size;
+    } else {
+      _cut(chunks);
+      continue;
+    }
+    size_t n = std::min<uint64_t>(avail, region_end - off);
+    size_t r = _scan_all(p, n, fp, mask, cdc.table);
+    p += r;
+    pos += r;
+    if (r < n) {
+      _cut(chunks);
+    }
+  }
+}
 
-    chunks->push_back(std::pair<uint64_t,uint64_t>(cstart, pos - cstart));
+void FastCDC::Stream::finish(
+  std::vector<std::pair<uint64_t, uint64_t>> *chunks)
+{
+  if (pos > cstart) {
+    chunks->emplace_back(cstart, pos - cstart);
   }
+  pos = 0;
+  cstart = 0;
+  fp = ~0ull;
+}
+
+void FastCDC::calc_chunks(
+  const bufferlist& bl,
+  std::vector<std::pair<uint64_t, uint64_t>> *chunks) const
+{
+  Stream s(*this);
+  s.append(bl, chunks);
+  s.finish(chunks);
 }
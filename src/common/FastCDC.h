@@ -20,6 +20,10 @@
 // Note about the target_bits: The goal is an average chunk size of 1
 // << target_bits.  However, in reality the average is ~1.25x that
 // because of the hard mininum chunk size.
+//
+// The fingerprint only depends on the last 64 bytes, so a long scan can
+// be split into independent lanes that are hashed in lockstep and still
+// find exactly the cut points a byte-at-a-time scan would.
 
 class FastCDC : public CDC {
 private:
@@ -32,6 +36,10 @@ private:
   uint64_t large_mask;   ///< maskL in the paper (fewer bits set)
 
   /// lookup table with pseudorandom values for each byte
+  ///
+  /// We roll the complement of the fingerprint, ~fp, so that checking
+  /// for a cut point is a single AND.  Since ~((fp << 1) ^ t) ==
+  /// (~fp << 1) ^ t ^ 1, the entries are stored with the low bit flipped.
   uint64_t table[256];
 
   /// window size in bytes
@@ -51,4 +59,45 @@ public:
   void calc_chunks(
     const bufferlist& bl,
     std::vector<std::pair<uint64_t, uint64_t>> *chunks) const override;
+
+  /**
+   * incremental chunker
+   *
+   * Takes the data in pieces as it arrives (e.g., the buffers of a
+   * bufferlist, or successive reads of an object) without making it
+   * contiguous first, and reports each chunk as soon as its end is
+   * known.  The chunks are the same calc_chunks() would find over the
+   * concatenation of everything appended, with offsets relative to the
+   * start of the stream.
+   */
+  class Stream {
+    const FastCDC& cdc;
+    uint64_t pos = 0;      ///< bytes appended so far
+    uint64_t cstart = 0;   ///< offset of the current (open) chunk
+    uint64_t fp = ~0ull;   ///< complemented fingerprint
+
+    void _cut(std::vector<std::pair<uint64_t, uint64_t>> *chunks) {
+      chunks->emplace_back(cstart, pos - cstart);
+      cstart = pos;
+      fp = ~0ull;
+    }
+
+  public:
+    explicit Stream(const FastCDC& cdc) : cdc(cdc) {}
+
+    void append(const char *data, size_t len,
+		std::vector<std::pair<uint64_t, uint64_t>> *chunks);
+    void append(const bufferlist& bl,
+		std::vector<std::pair<uint64_t, uint64_t>> *chunks) {
+      for (auto& p : bl.buffers()) {
+	append(p.c_str(), p.length(), chunks);
+      }
+    }
+    /// emit the last (possibly short) chunk and start over
+    void finish(std::vector<std::pair<uint64_t, uint64_t>> *chunks);
+
+    uint64_t get_pos() const {
+      return pos;
+    }
+  };
 };
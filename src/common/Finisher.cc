@@ -94,3 +94,140 @@ void *Finisher::finisher_thread_entry()
   return 0;
 }
 
+
+#undef dout_prefix
+#define dout_prefix *_dout << "sharded_finisher(" << this << ") "
+
+ShardedFinisher::ShardedFinisher(CephContext *cct_, const std::string& name,
+				 std::string tn, unsigned num_shards)
+  : cct(cct_), thread_name(std::move(tn))
+{
+  ceph_assert(num_shards > 0);
+  for (unsigned i = 0; i < num_shards; ++i) {
+    shards.emplace_back(std::make_unique<Shard>(
+      this, "ShardedFinisher::" + name + "::" + std::to_string(i)));
+  }
+  if (name.empty()) {
+    return;
+  }
+  PerfCountersBuilder b(cct, std::string("finisher-") + name,
+			l_sharded_finisher_first, l_sharded_finisher_last);
+  b.add_u64(l_sharded_finisher_queue_len, "queue_len");
+  b.add_time_avg(l_sharded_finisher_complete_lat, "complete_latency");
+  PerfHistogramCommon::axis_config_d batch_axis{
+    "Batch size",
+    PerfHistogramCommon::SCALE_LOG2,
+    0,
+    1,
+    16,
+  };
+  PerfHistogramCommon::axis_config_d lat_axis{
+    "Queueing latency (usec)",
+    PerfHistogramCommon::SCALE_LOG2,
+    0,
+    1000,    ///< 1usec
+    24,
+  };
+  b.add_u64_counter_histogram(
+    l_sharded_finisher_batch_hist, "batch_histogram",
+    batch_axis, lat_axis,
+    "Histogram of batch size vs time the oldest context in it was queued");
+  logger = b.create_perf_counters();
+  cct->get_perfcounters_collection()->add(logger);
+}
+
+ShardedFinisher::~ShardedFinisher()
+{
+  if (logger && cct) {
+    cct->get_perfcounters_collection()->remove(logger);
+    delete logger;
+  }
+}
+
+void ShardedFinisher::start()
+{
+  ldout(cct, 10) << __func__ << " " << shards.size() << " shards" << dendl;
+  for (size_t i = 0; i < shards.size(); ++i) {
+    shards[i]->thread.create((thread_name + std::to_string(i)).c_str());
+  }
+}
+
+void ShardedFinisher::stop()
+{
+  ldout(cct, 10) << __func__ << dendl;
+  for (auto& s : shards) {
+    std::lock_guard l(s->lock);
+    s->stop = true;
+    s->cond.notify_all();
+  }
+  for (auto& s : shards) {
+    s->thread.join();
+  }
+  ldout(cct, 10) << __func__ << " finish" << dendl;
+}
+
+void ShardedFinisher::wait_for_empty()
+{
+  for (auto& s : shards) {
+    std::unique_lock l(s->lock);
+    while (!s->queue.empty() || s->running) {
+      ldout(cct, 10) << "wait_for_empty waiting" << dendl;
+      s->empty_wait = true;
+      s->empty_cond.wait(l);
+    }
+    s->empty_wait = false;
+  }
+  ldout(cct, 10) << "wait_for_empty empty" << dendl;
+}
+
+void *ShardedFinisher::Shard::entry()
+{
+  CephContext *cct = parent->cct;
+  PerfCounters *logger = parent->logger;
+  std::vector<std::pair<Context*,int>> in_progress;
+  std::unique_lock l(lock);
+  ldout(cct, 10) << "finisher_thread start" << dendl;
+
+  while (!stop) {
+    while (!queue.empty()) {
+      in_progress.swap(queue);
+      auto since = queued_since;
+      running = true;
+      l.unlock();
+      ldout(cct, 10) << "finisher_thread doing " << in_progress << dendl;
+
+      ceph::mono_clock::time_point start;
+      if (logger) {
+	start = ceph::mono_clock::now();
+	logger->hinc(l_sharded_finisher_batch_hist, in_progress.size(),
+		     std::chrono::nanoseconds(start - since).count());
+      }
+      for (auto p : in_progress) {
+	p.first->complete(p.second);
+      }
+      if (logger) {
+	logger->dec(l_sharded_finisher_queue_len, in_progress.size());
+	logger->tinc(l_sharded_finisher_complete_lat,
+		     ceph::mono_clock::now() - start);
+      }
+      in_progress.clear();
+
+      l.lock();
+      running = false;
+    }
+    if (unlikely(empty_wait))
+      empty_cond.notify_all();
+    if (stop)
+      break;
+
+    ldout(cct, 20) << "finisher_thread sleeping" << dendl;
+    sleeping = true;
+    cond.wait(l);
+    sleeping = false;
+  }
+  empty_cond.notify_all();
+
+  ldout(cct, 10) << "finisher_thread stop" << dendl;
+  stop = false;
+  return 0;
+}
@@ -167,6 +167,137 @@ class Finisher {
   }
 };
 
+enum {
+  l_sharded_finisher_first = 997100,
+  l_sharded_finisher_queue_len,
+  l_sharded_finisher_complete_lat,
+  l_sharded_finisher_batch_hist,
+  l_sharded_finisher_last
+};
+
+/** @brief Finisher with several worker threads.
+ * Contexts are routed to a shard by a caller supplied key, such as a PG or
+ * an OpSequencer, so completions for one key run in the order they were
+ * queued while different keys complete in parallel.  A shard wakes its
+ * thread only if it is asleep; a busy thread picks up everything queued
+ * meanwhile as a single batch.
+ */
+class ShardedFinisher {
+  struct Shard {
+    ShardedFinisher *parent;
+    ceph::mutex lock; ///< Protects the queue and the flags below.
+    ceph::condition_variable cond; ///< Signaled when there is something to process.
+    ceph::condition_variable empty_cond; ///< Signaled when the shard has nothing more to process.
+    bool stop = false;
+    bool running = false;  ///< True when the thread is executing contexts.
+    bool sleeping = false; ///< True when the thread waits for cond.
+    bool empty_wait = false;
+    std::vector<std::pair<Context*,int>> queue;
+    ceph::mono_clock::time_point queued_since; ///< When queue became non-empty.
+
+    void *entry();
+    struct ShardThread : public Thread {
+      Shard *shard;
+      explicit ShardThread(Shard *s) : shard(s) {}
+      void* entry() override { return shard->entry(); }
+    } thread;
+
+    Shard(ShardedFinisher *p, const std::string& name)
+      : parent(p), lock(ceph::make_mutex(name)), thread(this) {}
+
+    /// returns true if the thread needs a wakeup
+    bool _enqueue(size_t n) {
+      if (queue.size() == n) {
+	queued_since = ceph::mono_clock::now();
+	return sleeping;
+      }
+      return false;
+    }
+  };
+
+  CephContext *cct;
+  std::string thread_name;
+  std::vector<std::unique_ptr<Shard>> shards;
+  PerfCounters *logger = nullptr;
+
+  Shard& get_shard(uint64_t key) {
+    // keys are often pointers; mix the bits before picking a shard
+    return *shards[((key * 0x9e3779b97f4a7c15ull) >> 32) % shards.size()];
+  }
+
+  template <typename C>
+  void _queue_all(uint64_t key, C& ls) {
+    if (ls.empty()) {
+      return;
+    }
+    auto& s = get_shard(key);
+    bool wake;
+    {
+      std::lock_guard l(s.lock);
+      for (auto i : ls) {
+	s.queue.push_back(std::make_pair(i, 0));
+      }
+      wake = s._enqueue(ls.size());
+    }
+    if (wake) {
+      s.cond.notify_one();
+    }
+    if (logger)
+      logger->inc(l_sharded_finisher_queue_len, ls.size());
+    ls.clear();
+  }
+
+ public:
+  /// Add a context to complete after the earlier ones queued with the same key.
+  void queue(uint64_t key, Context *c, int r = 0) {
+    auto& s = get_shard(key);
+    bool wake;
+    {
+      std::lock_guard l(s.lock);
+      s.queue.push_back(std::make_pair(c, r));
+      wake = s._enqueue(1);
+    }
+    if (wake) {
+      s.cond.notify_one();
+    }
+    if (logger)
+      logger->inc(l_sharded_finisher_queue_len);
+  }
+  void queue(uint64_t key, std::list<Context*>& ls) {
+    _queue_all(key, ls);
+  }
+  void queue(uint64_t key, std::deque<Context*>& ls) {
+    _queue_all(key, ls);
+  }
+  void queue(uint64_t key, std::vector<Context*>& ls) {
+    _queue_all(key, ls);
+  }
+
+  unsigned get_num_shards() const {
+    return shards.size();
+  }
+
+  /// Start the worker threads.
+  void start();
+
+  /** @brief Stop the worker threads.
+   * Like Finisher::stop(), this does not wait for outstanding contexts;
+   * call wait_for_empty() first. */
+  void stop();
+
+  /// Blocks until every shard has nothing left to process.
+  void wait_for_empty();
+
+  /** @brief Construct a ShardedFinisher.
+   * If name is non-empty, queue length, completion latency and a
+   * histogram of batch size against queueing latency are logged under
+   * "finisher-<name>", like Finisher. Thread names get the shard number
+   * appended. */
+  ShardedFinisher(CephContext *cct_, const std::string& name,
+		  std::string tn, unsigned num_shards);
+  ~ShardedFinisher();
+};
+
 /// Context that is completed asynchronously on the supplied finisher.
 class C_OnFinisher : public Context {
   Context *con;
@@ -13,6 +13,7 @@
  */
 
 #define LARGE_SIZE 1024
+#define LARGE_BUFFER_SIZE (1 << 20)
 
 #include "HTMLFormatter.h"
 #include "common/escape.h"
@@ -21,6 +22,7 @@
 
 #include <fmt/format.h>
 #include <algorithm>
+#include <charconv>
 #include <set>
 #include <limits>
 
@@ -158,44 +160,67 @@ JSONFormatter::JSONFormatter(bool p)
 void JSONFormatter::flush(std::ostream& os)
 {
   finish_pending_string();
-  os << m_ss.str();
+  os.write(m_buf.data(), m_buf.size());
   if (m_line_break_enabled)
     os << "\n";
-  m_ss.clear();
-  m_ss.str("");
+  release_buffer();
+}
+
+void JSONFormatter::flush(bufferlist &bl)
+{
+  finish_pending_string();
+  bl.append(m_buf);
+  if (m_line_break_enabled)
+    bl.append('\n');
+  release_buffer();
+}
+
+void JSONFormatter::release_buffer()
+{
+  // keep the buffer around for reuse unless it grew unusually large
+  if (m_buf.capacity() > LARGE_BUFFER_SIZE) {
+    std::string().swap(m_buf);
+  } else {
+    m_buf.clear();
+  }
 }
 
 void JSONFormatter::reset()
 {
   m_stack.clear();
-  m_ss.clear();
-  m_ss.str("");
+  release_buffer();
   m_pending_string.clear();
   m_pending_string.str("");
 }
 
+void JSONFormatter::print_indent(size_t depth)
+{
+  for (size_t i = 0; i < depth; i++)
+    m_buf.append("    ", 4);
+}
+
 void JSONFormatter::print_comma(json_formatter_stack_entry_d& entry)
 {
   if (entry.size) {
     if (m_pretty) {
-      m_ss << ",\n";
-      for (unsigned i = 1; i < m_stack.size(); i++)
-        m_ss << "    ";
+      m_buf.append(",\n", 2);
+      print_indent(m_stack.size() - 1);
     } else {
-      m_ss << ",";
+      m_buf.push_back(',');
     }
   } else if (m_pretty) {
-    m_ss << "\n";
-    for (unsigned i = 1; i < m_stack.size(); i++)
-      m_ss << "    ";
+    m_buf.push_back('\n');
+    print_indent(m_stack.size() - 1);
   }
   if (m_pretty && entry.is_array)
-    m_ss << "    ";
+    m_buf.append("    ", 4);
 }
 
 void JSONFormatter::print_quoted_string(std::string_view s)
 {
-  m_ss << '\"' << json_stream_escaper(s) << '\"';
+  m_buf.push_back('\"');
+  append_json_escaped(m_buf, s);
+  m_buf.push_back('\"');
 }
 
 void JSONFormatter::print_name(std::string_view name)
@@ -207,13 +232,14 @@ void JSONFormatter::print_name(std::string_view name)
   print_comma(entry);
   if (!entry.is_array) {
     if (m_pretty) {
-      m_ss << "    ";
+      m_buf.append("    ", 4);
     }
-    m_ss << "\"" << name << "\"";
+    m_buf.push_back('\"');
+    m_buf.append(name);
     if (m_pretty)
-      m_ss << ": ";
+      m_buf.append("\": ", 3);
     else
-      m_ss << ':';
+      m_buf.append("\":", 2);
   }
   ++entry.size;
 }
@@ -231,9 +257,9 @@ void JSONFormatter::open_section(std::string_view name, const char *ns, bool is_
     print_name(name);
   }
   if (is_array)
-    m_ss << '[';
+    m_buf.push_back('[');
   else
-    m_ss << '{';
+    m_buf.push_back('{');
 
   json_formatter_stack_entry_d n;
   n.is_array = is_array;
@@ -271,14 +297,13 @@ void JSONFormatter::close_section()
 
   struct json_formatter_stack_entry_d& entry = m_stack.back();
   if (m_pretty && entry.size) {
-    m_ss << "\n";
-    for (unsigned i = 1; i < m_stack.size(); i++)
-      m_ss << "    ";
+    m_buf.push_back('\n');
+    print_indent(m_stack.size() - 1);
   }
-  m_ss << (entry.is_array ? ']' : '}');
+  m_buf.push_back(entry.is_array ? ']' : '}');
   m_stack.pop_back();
   if (m_pretty && m_stack.empty())
-    m_ss << "\n";
+    m_buf.push_back('\n');
 }
 
 void JSONFormatter::finish_pending_string()
@@ -291,23 +316,23 @@ void JSONFormatter::finish_pending_string()
 }
 
 void JSONFormatter::add_value(std::string_view name, double val) {
-  CachedStackStringStream css;
   if (!std::isfinite(val) || std::isnan(val)) {
-    *css << "null";
-  } else {
-    css->precision(std::numeric_limits<double>::max_digits10);
-    *css << val;
+    add_value(name, "null", false);
+    return;
   }
-  add_value(name, css->strv(), false);
+  // what an ostream prints with precision max_digits10
+  char buf[32];
+  int n = snprintf(buf, sizeof(buf), "%.*g",
+		   std::numeric_limits<double>::max_digits10, val);
+  add_value(name, std::string_view(buf, n), false);
 }
 
 template <class T>
 void JSONFormatter::add_value(std::string_view name, T val)
 {
-  std::stringstream ss;
-  ss.precision(std::numeric_limits<T>::max_digits10);
-  ss << val;
-  add_value(name, ss.str(), false);
+  char buf[24];
+  auto r = std::to_chars(buf, buf + sizeof(buf), val);
+  add_value(name, std::string_view(buf, r.ptr - buf), false);
 }
 
 void JSONFormatter::add_value(std::string_view name, std::string_view val, bool quoted)
@@ -317,7 +342,7 @@ void JSONFormatter::add_value(std::string_view name, std::string_view val, bool
   }
   print_name(name);
   if (!quoted) {
-    m_ss << val;
+    m_buf.append(val);
   } else {
     print_quoted_string(val);
   }
@@ -325,7 +350,7 @@ void JSONFormatter::add_value(std::string_view name, std::string_view val, bool
 
 void JSONFormatter::dump_null(std::string_view name)
 {
-  add_value(name, "null");
+  add_value(name, "null", false);
 }
 
 void JSONFormatter::dump_unsigned(std::string_view name, uint64_t u)
@@ -366,12 +391,12 @@ void JSONFormatter::dump_format_va(std::string_view name, const char *ns, bool q
 
 int JSONFormatter::get_len() const
 {
-  return m_ss.str().size();
+  return m_buf.size();
 }
 
 void JSONFormatter::write_raw_data(const char *data)
 {
-  m_ss << data;
+  m_buf.append(data);
 }
 
 const char *XMLFormatter::XML_1_DTD =
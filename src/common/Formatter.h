@@ -68,7 +68,7 @@ namespace ceph {
 
     virtual void enable_line_break() = 0;
     virtual void flush(std::ostream& os) = 0;
-    void flush(bufferlist &bl);
+    virtual void flush(bufferlist &bl);
     virtual void reset() = 0;
 
     virtual void set_status(int status, const char* status_name) = 0;
@@ -143,7 +143,7 @@ namespace ceph {
     void output_footer() override {};
     void enable_line_break() override { m_line_break_enabled = true; }
     void flush(std::ostream& os) override;
-    using Formatter::flush; // don't hide Formatter::flush(bufferlist &bl)
+    void flush(bufferlist &bl) override;
     void reset() override;
     void open_array_section(std::string_view name) override;
     void open_array_section_in_ns(std::string_view name, const char *ns) override;
@@ -187,18 +187,22 @@ namespace ceph {
     void open_section(std::string_view name, const char *ns, bool is_array);
     void print_quoted_string(std::string_view s);
     void print_name(std::string_view name);
+    void print_indent(size_t depth);
     void print_comma(json_formatter_stack_entry_d& entry);
     void finish_pending_string();
+    void release_buffer();
     void add_value(std::string_view name, double val);
 
     template <class T>
     void add_value(std::string_view name, T val);
     void add_value(std::string_view name, std::string_view val, bool quoted);
 
-    copyable_sstream m_ss;
+    // output is appended straight to a string; dumps of large maps run
+    // to many megabytes and a stringstream costs several times as much
+    std::string m_buf;
     copyable_sstream m_pending_string;
     std::string m_pending_name;
-    std::list<json_formatter_stack_entry_d> m_stack;
+    std::vector<json_formatter_stack_entry_d> m_stack;
     bool m_is_pending_string;
     bool m_line_break_enabled = false;
   };
@@ -14,6 +14,7 @@
 
 #include "PriorityCache.h"
 #include "common/dout.h"
+#include "include/buffer.h"
 #include "perfglue/heap_profiler.h"
 #define dout_context cct
 #define dout_subsys ceph_subsys_prioritycache
@@ -114,6 +115,9 @@ namespace PriorityCache
     size_t unmapped = 0;
     uint64_t mapped = 0;
 
+    // hand buffer blocks cached but idle since the last tick to the heap
+    // before it releases its free memory
+    size_t buffer_trimmed = ceph::buffer::trim_raw_cache();
     ceph_heap_release_free_memory();
     ceph_heap_get_numeric_property("generic.heap_size", &heap_size);
     ceph_heap_get_numeric_property("tcmalloc.pageheap_unmapped_bytes", &unmapped);
@@ -137,6 +141,7 @@ namespace PriorityCache
                   << " mapped: " << mapped  
                   << " unmapped: " << unmapped
                   << " heap: " << heap_size
+                  << " buffer cache trimmed: " << buffer_trimmed
                   << " old mem: " << tuned_mem
                   << " new mem: " << new_size << dendl;
 
@@ -81,18 +81,11 @@ void CommonSafeTimer<Mutex>::timer_thread()
   std::unique_lock l{lock};
   ldout(cct,10) << "timer_thread starting" << dendl;
   while (!stopping) {
-    auto now = clock_t::now();
+    schedule.advance(clock_t::now());
 
-    while (!schedule.empty()) {
-      auto p = schedule.begin();
-
-      // is the future now?
-      if (p->first > now)
-	break;
-
-      Context *callback = p->second;
+    while (auto e = schedule.pop_expired()) {
+      Context *callback = static_cast<event_t*>(e)->callback;
       events.erase(callback);
-      schedule.erase(p);
       ldout(cct,10) << "timer_thread executing " << callback << dendl;
       
       if (!safe_callbacks) {
@@ -109,12 +102,13 @@ void CommonSafeTimer<Mutex>::timer_thread()
       break;
 
     ldout(cct,20) << "timer_thread going to sleep" << dendl;
-    if (schedule.empty()) {
+    sleep_until = schedule.next_wakeup();
+    if (sleep_until == clock_t::time_point::max()) {
       cond.wait(l);
     } else {
-      auto when = schedule.begin()->first;
-      cond.wait_until(l, when);
+      cond.wait_until(l, sleep_until);
     }
+    sleep_until = clock_t::time_point::min();
     ldout(cct,20) << "timer_thread awake" << dendl;
   }
   ldout(cct,10) << "timer_thread exiting" << dendl;
@@ -145,18 +139,17 @@ Context* CommonSafeTimer<Mutex>::add_event_at(CommonSafeTimer<Mutex>::clock_t::t
     delete callback;
     return nullptr;
   }
-  scheduled_map_t::value_type s_val(when, callback);
-  scheduled_map_t::iterator i = schedule.insert(s_val);
-
-  event_lookup_map_t::value_type e_val(callback, i);
-  pair < event_lookup_map_t::iterator, bool > rval(events.insert(e_val));
+  auto [p, inserted] = events.try_emplace(callback);
 
   /* If you hit this, you tried to insert the same Context* twice. */
-  ceph_assert(rval.second);
+  ceph_assert(inserted);
+
+  p->second.callback = callback;
+  schedule.insert(&p->second, when);
 
-  /* If the event we have just inserted comes before everything else, we need to
-   * adjust our timeout. */
-  if (i == schedule.begin())
+  /* If the event we have just inserted comes before the timer thread
+   * would wake up, we need to adjust its timeout. */
+  if (when < sleep_until)
     cond.notify_all();
   return callback;
 }
@@ -185,10 +178,10 @@ bool CommonSafeTimer<Mutex>::cancel_event(Context *callback)
     return false;
   }
 
-  ldout(cct,10) << "cancel_event " << p->second->first << " -> " << callback << dendl;
+  ldout(cct,10) << "cancel_event " << p->second.when << " -> " << callback << dendl;
   delete p->first;
 
-  schedule.erase(p->second);
+  schedule.remove(&p->second);
   events.erase(p);
   return true;
 }
@@ -201,9 +194,9 @@ void CommonSafeTimer<Mutex>::cancel_all_events()
 
   while (!events.empty()) {
     auto p = events.begin();
-    ldout(cct,10) << " cancelled " << p->second->first << " -> " << p->first << dendl;
+    ldout(cct,10) << " cancelled " << p->second.when << " -> " << p->first << dendl;
     delete p->first;
-    schedule.erase(p->second);
+    schedule.remove(&p->second);
     events.erase(p);
   }
 }
@@ -215,10 +208,8 @@ void CommonSafeTimer<Mutex>::dump(const char *caller) const
     caller = "";
   ldout(cct,10) << "dump " << caller << dendl;
 
-  for (scheduled_map_t::const_iterator s = schedule.begin();
-       s != schedule.end();
-       ++s)
-    ldout(cct,10) << " " << s->first << "->" << s->second << dendl;
+  for (auto& [callback, event] : events)
+    ldout(cct,10) << " " << event.when << "->" << callback << dendl;
 }
 
 template class CommonSafeTimer<ceph::mutex>;
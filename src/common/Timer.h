@@ -16,10 +16,12 @@
 #define CEPH_TIMER_H
 
 #include <map>
+#include <unordered_map>
 #include "include/common_fwd.h"
 #include "ceph_time.h"
 #include "ceph_mutex.h"
 #include "fair_mutex.h"
+#include "timer_wheel.h"
 #include <condition_variable>
 
 class Context;
@@ -41,11 +43,18 @@ class CommonSafeTimer
   void _shutdown();
 
   using clock_t = ceph::mono_clock;
-  using scheduled_map_t = std::multimap<clock_t::time_point, Context*>;
-  scheduled_map_t schedule;
-  using event_lookup_map_t = std::map<Context*, scheduled_map_t::iterator>;
+  // timeouts are added and cancelled by the hundred thousand; the wheel
+  // keeps both O(1) however many are pending
+  using schedule_t = ceph::timer_wheel<clock_t>;
+  struct event_t : schedule_t::entry {
+    Context *callback = nullptr;
+  };
+  schedule_t schedule;
+  using event_lookup_map_t = std::unordered_map<Context*, event_t>;
   event_lookup_map_t events;
   bool stopping;
+  /// when the timer thread will wake up on its own
+  clock_t::time_point sleep_until = clock_t::time_point::min();
 
   void dump(const char *caller = 0) const;
 
@@ -93,6 +93,17 @@ void OpHistory::_insert_delayed(const utime_t& now, TrackedOpRef op)
   cleanup(now);
 }
 
+bool OpHistory::want(const TrackedOp& op) const
+{
+  auto rate = history_sample_rate.load();
+  if (rate <= 1) {
+    return true;
+  }
+  // op seqs are handed out in order, which makes for an even sample
+  return op.seq % rate == 0 ||
+    op.get_duration() >= history_slow_op_threshold.load();
+}
+
 void OpHistory::cleanup(utime_t now)
 {
   while (arrived.size() &&
@@ -469,9 +480,27 @@ void TrackedOp::mark_event(std::string_view event, utime_t stamp)
   if (!state)
     return;
 
+  const char *name;
+  {
+    std::lock_guard l(lock);
+    name = dynamic_events.emplace_back(event).c_str();
+  }
+  _mark_event(name, stamp);
+}
+
+void TrackedOp::mark_event(static_event_t event, utime_t stamp)
+{
+  if (!state)
+    return;
+
+  _mark_event(event.c_str(), stamp);
+}
+
+void TrackedOp::_mark_event(const char *event, utime_t stamp)
+{
   {
     std::lock_guard l(lock);
-    events.emplace_back(stamp, event);
+    events.push_back(Event(stamp, event));
   }
   dout(6) << " seq: " << seq
 	  << ", time: " << stamp
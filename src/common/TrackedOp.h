@@ -14,7 +14,9 @@
 #ifndef TRACKEDREQUEST_H_
 #define TRACKEDREQUEST_H_
 
+#include <array>
 #include <atomic>
+#include <list>
 #include "common/StackStringStream.h"
 #include "common/ceph_mutex.h"
 #include "common/histogram.h"
@@ -23,7 +25,8 @@
 #include "include/spinlock.h"
 #include "msg/Message.h"
 
-#define OPTRACKER_PREALLOC_EVENTS 20
+/// events kept per op; older ones are dropped
+#define OPTRACKER_MAX_EVENTS 32
 
 class TrackedOp;
 class OpHistory;
@@ -63,6 +66,7 @@ class OpHistory {
   std::atomic_uint32_t history_duration{0};
   std::atomic_size_t history_slow_op_size{0};
   std::atomic_uint32_t history_slow_op_threshold{0};
+  std::atomic_uint32_t history_sample_rate{1};
   std::atomic_bool shutdown{false};
   OpHistoryServiceThread opsvc;
   friend class OpHistoryServiceThread;
@@ -96,6 +100,11 @@ public:
     history_slow_op_size = new_size;
     history_slow_op_threshold = new_threshold;
   }
+  void set_sample_rate(uint32_t rate) {
+    history_sample_rate = std::max(rate, 1u);
+  }
+  /// should this completed op be kept?  slow ops always are
+  bool want(const TrackedOp& op) const;
 };
 
 struct ShardedTrackingData;
@@ -126,6 +135,13 @@ public:
   void set_history_slow_op_size_and_threshold(uint32_t new_size, uint32_t new_threshold) {
     history.set_slow_op_size_and_threshold(new_size, new_threshold);
   }
+  /// keep one in every `rate` completed ops in the history
+  void set_history_sample_rate(uint32_t rate) {
+    history.set_sample_rate(rate);
+  }
+  bool want_history(const TrackedOp& op) const {
+    return history.want(op);
+  }
   bool is_tracking() const {
     return tracking_enabled;
   }
@@ -232,16 +248,17 @@ protected:
 
   struct Event {
     utime_t stamp;
-    std::string str;
+    const char *str = nullptr;  ///< static, or one of dynamic_events
 
-    Event(utime_t t, std::string_view s) : stamp(t), str(s) {}
+    Event() = default;
+    Event(utime_t t, const char *s) : stamp(t), str(s) {}
 
     int compare(const char *s) const {
-      return str.compare(s);
+      return strcmp(str, s);
     }
 
     const char *c_str() const {
-      return str.c_str();
+      return str;
     }
 
     void dump(ceph::Formatter *f) const {
@@ -250,7 +267,34 @@ protected:
     }
   };
 
-  std::vector<Event> events;    ///< std::list of events and their times
+  /// the last OPTRACKER_MAX_EVENTS events, oldest first, kept in the op
+  class event_ring_t {
+    std::array<Event, OPTRACKER_MAX_EVENTS> ring;
+    uint32_t num = 0;  ///< events marked so far
+  public:
+    bool empty() const {
+      return num == 0;
+    }
+    size_t size() const {
+      return std::min<size_t>(num, ring.size());
+    }
+    /// events that were pushed out of the ring
+    size_t dropped() const {
+      return num - size();
+    }
+    const Event& operator[](size_t i) const {
+      return ring[(num - size() + i) % ring.size()];
+    }
+    const Event& back() const {
+      return ring[(num - 1) % ring.size()];
+    }
+    void push_back(const Event& e) {
+      ring[num++ % ring.size()] = e;
+    }
+  };
+
+  event_ring_t events;    ///< events and their times
+  std::list<std::string> dynamic_events;  ///< names that are not static
   mutable ceph::mutex lock = ceph::make_mutex("TrackedOp::lock"); ///< to protect the events list
   uint64_t seq = 0;        ///< a unique value std::set by the OpTracker
 
@@ -266,9 +310,7 @@ protected:
   TrackedOp(OpTracker *_tracker, const utime_t& initiated) :
     tracker(_tracker),
     initiated_at(initiated)
-  {
-    events.reserve(OPTRACKER_PREALLOC_EVENTS);
-  }
+  {}
 
   /// output any type-specific data you want to get when dump() is called
   virtual void _dump(ceph::Formatter *f) const {}
@@ -306,7 +348,7 @@ public:
 	mark_event("done");
 	tracker->unregister_inflight_op(this);
 	_unregistered();
-	if (!tracker->is_tracking()) {
+	if (!tracker->is_tracking() || !tracker->want_history(*this)) {
 	  delete this;
 	} else {
 	  state = TrackedOp::STATE_HISTORY;
@@ -349,6 +391,8 @@ public:
   }
 
 private:
+  void _mark_event(const char *event, utime_t stamp);
+
   mutable ceph::mutex desc_lock = ceph::make_mutex("OpTracker::desc_lock");
   mutable std::string desc;   ///< protected by desc_lock
   mutable std::atomic<bool> want_new_desc = {false};
@@ -368,13 +412,37 @@ public:
 
   double get_duration() const {
     std::lock_guard l(lock);
-    if (!events.empty() && events.rbegin()->compare("done") == 0)
-      return events.rbegin()->stamp - get_initiated();
+    if (!events.empty() && events.back().compare("done") == 0)
+      return events.back().stamp - get_initiated();
     else
       return ceph_clock_now() - get_initiated();
   }
 
+  /// an event name that outlives any op, i.e. a string literal
+  class static_event_t {
+    const char *name;
+  public:
+    template <std::size_t N>
+    constexpr static_event_t(const char (&literal)[N]) : name(literal) {}
+    template <std::size_t N>
+    static_event_t(char (&)[N]) = delete;
+    constexpr const char *c_str() const {
+      return name;
+    }
+  };
+
+  /// mark an event, copying its name
   void mark_event(std::string_view event, utime_t stamp=ceph_clock_now());
+  /// mark an event, keeping a pointer to its name
+  void mark_event(static_event_t event, utime_t stamp=ceph_clock_now());
+  template <std::size_t N>
+  void mark_event(const char (&event)[N], utime_t stamp=ceph_clock_now()) {
+    mark_event(static_event_t(event), stamp);
+  }
+  template <std::size_t N>
+  void mark_event(char (&event)[N], utime_t stamp=ceph_clock_now()) {
+    mark_event(std::string_view(event), stamp);
+  }
 
   void mark_nowarn() {
     warn_interval_multiplier = 0;
@@ -389,7 +457,7 @@ public:
 
   void tracking_start() {
     if (tracker->register_inflight_op(this)) {
-      events.emplace_back(initiated_at, "initiated");
+      events.push_back(Event(initiated_at, "initiated"));
       state = STATE_LIVE;
     }
   }
@@ -405,7 +473,7 @@ public:
 
 protected:
   virtual std::string _get_state_string() const {
-    return events.empty() ? std::string() : std::string(events.rbegin()->str);
+    return events.empty() ? std::string() : std::string(events.back().str);
   }
 };
 
@@ -24,18 +24,23 @@ double bloom_filter::density() const
 
 void bloom_filter::encode(bufferlist& bl) const
 {
-  ENCODE_START(2, 2, bl);
+  // a classic filter stays at v2, so older peers can still decode it
+  const uint8_t v = blocked_ ? 3 : 2;
+  ENCODE_START(v, v, bl);
   encode((uint64_t)salt_count_, bl);
   encode((uint64_t)insert_count_, bl);
   encode((uint64_t)target_element_count_, bl);
   encode((uint64_t)random_seed_, bl);
   encode(bit_table_, bl);
+  if (blocked_) {
+    encode(blocked_, bl);
+  }
   ENCODE_FINISH(bl);
 }
 
 void bloom_filter::decode(bufferlist::const_iterator& p)
 {
-  DECODE_START(2, p);
+  DECODE_START(3, p);
   uint64_t v;
   decode(v, p);
   salt_count_ = v;
@@ -49,6 +54,11 @@ void bloom_filter::decode(bufferlist::const_iterator& p)
   generate_unique_salt();
   decode(bit_table_, p);
   table_size_ = bit_table_.size();
+  if (struct_v >= 3) {
+    decode(blocked_, p);
+  } else {
+    blocked_ = false;
+  }
   DECODE_FINISH(p);
 }
 
@@ -59,6 +69,7 @@ void bloom_filter::dump(Formatter *f) const
   f->dump_unsigned("insert_count", insert_count_);
   f->dump_unsigned("target_element_count", target_element_count_);
   f->dump_unsigned("random_seed", random_seed_);
+  f->dump_bool("blocked", blocked_);
 
   f->open_array_section("salt_table");
   for (std::vector<bloom_type>::const_iterator i = salt_.begin(); i != salt_.end(); ++i)
@@ -84,6 +95,9 @@ void bloom_filter::generate_test_instances(std::list<bloom_filter*>& ls)
   ls.back()->insert("baz");
   ls.back()->insert("boof");
   ls.back()->insert("boogggg");
+  ls.push_back(new bloom_filter(50, .5, 1, true));
+  ls.back()->insert("foo");
+  ls.back()->insert("bar");
 }
 
 
@@ -142,4 +156,9 @@ void compressible_bloom_filter::generate_test_instances(std::list<compressible_b
   ls.back()->insert("boof");
   ls.back()->compress(20);
   ls.back()->insert("boogggg");
+  ls.push_back(new compressible_bloom_filter(2000, .1, 1, true));
+  ls.back()->insert("foo");
+  ls.back()->insert("bar");
+  ls.back()->compress(.5);
+  ls.back()->insert("baz");
 }
@@ -23,6 +23,7 @@
 #define COMMON_BLOOM_FILTER_HPP
 
 #include <cmath>
+#include <cstring>
 
 #include "include/encoding.h"
 #include "include/mempool.h"
@@ -40,6 +41,10 @@ static const unsigned char bit_mask[CHAR_BIT] = {
 
 class bloom_filter
 {
+public:
+  /// bytes per block of a blocked filter, one cache line
+  static constexpr std::size_t block_bytes = 64;
+
 protected:
 
   using bloom_type = unsigned int;
@@ -53,6 +58,7 @@ protected:
   std::size_t         insert_count_;  ///< insertion count
   std::size_t         target_element_count_;  ///< target number of unique insertions
   std::size_t         random_seed_;  ///< random seed
+  bool                blocked_;      ///< all bits of a key in one block
 
 public:
 
@@ -61,15 +67,23 @@ public:
       table_size_(0),
       insert_count_(0),
       target_element_count_(0),
-      random_seed_(0)
+      random_seed_(0),
+      blocked_(false)
   {}
 
+  /**
+   * @param blocked put all the bits of a key in one cache line sized
+   *        block, so that a lookup costs a single cache miss however many
+   *        salts there are, for a slightly higher false positive rate
+   */
   bloom_filter(const std::size_t& predicted_inserted_element_count,
 	       const double& false_positive_probability,
-	       const std::size_t& random_seed)
+	       const std::size_t& random_seed,
+	       bool blocked = false)
     : insert_count_(0),
       target_element_count_(predicted_inserted_element_count),
-      random_seed_((random_seed) ? random_seed : 0xA5A5A5A5)
+      random_seed_((random_seed) ? random_seed : 0xA5A5A5A5),
+      blocked_(blocked)
   {
     ceph_assert(false_positive_probability > 0.0);
     std::tie(salt_count_, table_size_) =
@@ -81,17 +95,23 @@ public:
   bloom_filter(const std::size_t& salt_count,
 	       std::size_t table_size,
 	       const std::size_t& random_seed,
-	       std::size_t target_element_count)
+	       std::size_t target_element_count,
+	       bool blocked = false)
     : salt_count_(salt_count),
       table_size_(table_size),
       insert_count_(0),
       target_element_count_(target_element_count),
-      random_seed_((random_seed) ? random_seed : 0xA5A5A5A5)
+      random_seed_((random_seed) ? random_seed : 0xA5A5A5A5),
+      blocked_(blocked)
   {
     init();
   }
 
   void init() {
+    if (blocked_) {
+      table_size_ = std::max<std::size_t>(
+	(table_size_ + block_bytes - 1) / block_bytes * block_bytes, block_bytes);
+    }
     generate_unique_salt();
     bit_table_.resize(table_size_, static_cast<unsigned char>(0x00));
   }
@@ -109,6 +129,7 @@ public:
       insert_count_ = filter.insert_count_;
       target_element_count_ = filter.target_element_count_;
       random_seed_ = filter.random_seed_;
+      blocked_ = filter.blocked_;
       bit_table_ = filter.bit_table_;
       salt_ = filter.salt_;
     }
@@ -139,6 +160,13 @@ public:
    * @param val integer value to insert
    */
   inline void insert(uint32_t val) {
+    if (blocked_) {
+      block_probe p;
+      make_probe(hash_ap(val, salt_[0]), hash_ap(val, second_salt()), p);
+      block_insert(p);
+      ++insert_count_;
+      return;
+    }
     for (auto salt : salt_) {
       auto [bit_index, bit] = compute_indices(hash_ap(val, salt));
       bit_table_[bit_index >> 3] |= bit_mask[bit];
@@ -148,6 +176,14 @@ public:
 
   inline void insert(const unsigned char* key_begin, const std::size_t& length)
   {
+    if (blocked_) {
+      block_probe p;
+      make_probe(hash_ap(key_begin, length, salt_[0]),
+		 hash_ap(key_begin, length, second_salt()), p);
+      block_insert(p);
+      ++insert_count_;
+      return;
+    }
     for (auto salt : salt_) {
       auto [bit_index, bit] = compute_indices(hash_ap(key_begin, length, salt));
       bit_table_[bit_index >> 3] |= bit_mask[bit];
@@ -190,6 +226,11 @@ public:
     if (table_size_ == 0) {
       return false;
     }
+    if (blocked_) {
+      block_probe p;
+      make_probe(hash_ap(val, salt_[0]), hash_ap(val, second_salt()), p);
+      return block_contains(p);
+    }
     for (auto salt : salt_) {
       auto [bit_index, bit] = compute_indices(hash_ap(val, salt));
       if ((bit_table_[bit_index >> 3] & bit_mask[bit]) != bit_mask[bit]) {
@@ -204,6 +245,12 @@ public:
     if (table_size_ == 0) {
       return false;
     }
+    if (blocked_) {
+      block_probe p;
+      make_probe(hash_ap(key_begin, length, salt_[0]),
+		 hash_ap(key_begin, length, second_salt()), p);
+      return block_contains(p);
+    }
     for (auto salt : salt_) {
       auto [bit_index, bit] = compute_indices(hash_ap(key_begin, length, salt));
       if ((bit_table_[bit_index >> 3] & bit_mask[bit]) != bit_mask[bit]) {
@@ -263,6 +310,11 @@ public:
     return insert_count_;
   }
 
+  inline bool is_blocked() const
+  {
+    return blocked_;
+  }
+
   inline bool is_full() const
   {
     return insert_count_ >= target_element_count_;
@@ -311,6 +363,70 @@ protected:
     return {bit_index, bit};
   }
 
+  virtual std::size_t compute_block(const bloom_type& hash) const
+  {
+    return hash % (table_size_ / block_bytes);
+  }
+
+  /// where a key goes in a blocked filter
+  struct block_probe {
+    std::size_t offset;             ///< of the block in the table
+    uint64_t mask[block_bytes / 8];  ///< its bits, as the table words
+  };
+
+  inline bloom_type second_salt() const
+  {
+    return salt_.size() > 1 ? salt_[1] : ~salt_[0];
+  }
+
+  /*
+   * The first hash picks the block; both, mixed again for every salt,
+   * give the bits in it.  A fixed stride over the 512 bits of a block
+   * would make keys that share a block share too many bits.  The mask
+   * is kept in words laid out like the table bytes, so a probe is a few
+   * word (or vector) operations on one cache line whatever the salt
+   * count, and the table is the same on any endianness.
+   */
+  inline void make_probe(bloom_type block_hash, bloom_type bit_hash,
+			 block_probe& p) const
+  {
+    static_assert(block_bytes * CHAR_BIT == 1 << 9);
+#ifdef CEPH_BIG_ENDIAN
+    constexpr unsigned byte_swizzle = 56;
+#else
+    constexpr unsigned byte_swizzle = 0;
+#endif
+    std::fill(std::begin(p.mask), std::end(p.mask), 0);
+    uint64_t h = (uint64_t)bit_hash << 32 | block_hash;
+    for (std::size_t i = 0; i < salt_.size(); ++i) {
+      h = (h ^ (h >> 29)) * 0x9e3779b97f4a7c15ull;
+      const unsigned pos = h >> (64 - 9);
+      p.mask[pos >> 6] |= uint64_t(1) << ((pos & 63) ^ byte_swizzle);
+    }
+    p.offset = compute_block(block_hash) * block_bytes;
+  }
+
+  inline bool block_contains(const block_probe& p) const
+  {
+    uint64_t w[block_bytes / 8];
+    std::memcpy(w, bit_table_.data() + p.offset, sizeof(w));
+    uint64_t missing = 0;
+    for (unsigned i = 0; i < block_bytes / 8; ++i) {
+      missing |= p.mask[i] & ~w[i];
+    }
+    return !missing;
+  }
+
+  inline void block_insert(const block_probe& p)
+  {
+    uint64_t w[block_bytes / 8];
+    std::memcpy(w, bit_table_.data() + p.offset, sizeof(w));
+    for (unsigned i = 0; i < block_bytes / 8; ++i) {
+      w[i] |= p.mask[i];
+    }
+    std::memcpy(bit_table_.data() + p.offset, w, sizeof(w));
+  }
+
   void generate_unique_salt()
   {
     /*
@@ -481,8 +597,10 @@ public:
 
   compressible_bloom_filter(const std::size_t& predicted_element_count,
 			    const double& false_positive_probability,
-			    const std::size_t& random_seed)
-    : bloom_filter(predicted_element_count, false_positive_probability, random_seed)
+			    const std::size_t& random_seed,
+			    bool blocked = false)
+    : bloom_filter(predicted_element_count, false_positive_probability,
+		   random_seed, blocked)
   {
     size_list.push_back(table_size_);
   }
@@ -490,8 +608,9 @@ public:
   compressible_bloom_filter(const std::size_t& salt_count,
 			    std::size_t table_size,
 			    const std::size_t& random_seed,
-			    std::size_t target_count)
-    : bloom_filter(salt_count, table_size, random_seed, target_count)
+			    std::size_t target_count,
+			    bool blocked = false)
+    : bloom_filter(salt_count, table_size, random_seed, target_count, blocked)
   {
     size_list.push_back(table_size_);
   }
@@ -513,6 +632,10 @@ public:
 
     std::size_t original_table_size = size_list.back();
     std::size_t new_table_size = static_cast<std::size_t>(size_list.back() * target_ratio);
+    if (blocked_) {
+      // fold whole blocks onto each other
+      new_table_size -= new_table_size % block_bytes;
+    }
 
     if ((!new_table_size) || (new_table_size >= original_table_size))
     {
@@ -560,6 +683,15 @@ private:
     return {bit_index, bit};
   }
 
+  std::size_t compute_block(const bloom_type& hash) const final
+  {
+    std::size_t block = hash;
+    for (auto size : size_list) {
+      block %= size / block_bytes;
+    }
+    return block;
+  }
+
   std::vector<std::size_t> size_list;
 public:
   void encode(ceph::bufferlist& bl) const;
@@ -12,9 +12,11 @@
  *
  */
 
+#include <algorithm>
 #include <atomic>
 #include <cstring>
 #include <errno.h>
+#include <iterator>
 #include <limits.h>
 
 #include <sys/uio.h>
@@ -48,6 +50,9 @@ using namespace ceph;
 #define CEPH_BUFFER_ALLOC_UNIT  4096u
 #define CEPH_BUFFER_APPEND_SIZE (CEPH_BUFFER_ALLOC_UNIT - sizeof(raw_combined))
 
+// fragments shorter than this skip the per-raw crc cache
+#define CEPH_BUFFER_CRC_CACHE_MIN 512u
+
 // 256K is the maximum "small" object size in tcmalloc above which allocations come from
 // the central heap.  For now let's keep this below that threshold.
 #define CEPH_BUFFER_ALLOC_UNIT_MAX std::size_t { 256*1024 }
@@ -81,6 +86,260 @@ static ceph::spinlock debug_lock;
     return buffer_missed_crc;
   }
 
+#ifndef WITH_SEASTAR
+  /*
+   * size-classed cache of raw buffer memory
+   *
+   * The messenger and the object stores create and release raw buffers at
+   * a high rate, mostly in a few sizes: the append buffers carved out by
+   * refill_append_space() are whole pages up to 256K, and O_DIRECT reads
+   * are page multiples.  Memory for those is handed out in size classes.
+   * A freed block goes into a small magazine owned by the freeing thread
+   * and is reused by that thread's next allocation in the class, without a
+   * trip through posix_memalign().  A thread that frees more than it
+   * allocates (one thread reads off the wire, another one releases the
+   * message) hands full magazines to a shared depot for others to pick
+   * up.  Both are bounded; anything beyond goes back to the heap.
+   *
+   * Blocks are aligned to their size, or to a page for classes of a page
+   * and up, so the same classes serve O_DIRECT and pmem buffers.
+   *
+   * A buffer is charged to its mempool for the whole block it occupies,
+   * so rounding up to the class size is visible to the memory autotuners.
+   * Classes step by at most 1.5x to keep that rounding small.
+   *
+   * A thread keeps up to ~1.7M across its magazines until it exits.  The
+   * depot keeps up to 16 magazines per class; trim_raw_cache() returns
+   * the ones nobody has taken since the previous call to the heap.
+   *
+   * Set CEPH_BUFFER_NO_SLAB to bypass the cache (and the ptr_node cache
+   * below), e.g. to let valgrind or asan see every allocation.
+   */
+  namespace {
+
+  constexpr size_t slab_class_size[] = {
+    256, 512, 1024, 2048, 4096, 8192, 12288, 16384, 24576, 32768,
+    49152, 65536, 98304, 131072, 196608, 262144
+  };
+  constexpr unsigned num_slab_classes = std::size(slab_class_size);
+
+  /// bytes a magazine may hold, but at least one block
+  constexpr size_t slab_magazine_bytes = 128 * 1024;
+  constexpr unsigned slab_magazine_max = 32;
+  /// full magazines kept in the depot, per class
+  constexpr unsigned slab_depot_max = 16;
+
+  const bool slab_enabled = !get_env_bool("CEPH_BUFFER_NO_SLAB");
+
+  struct slab_magazine_t {
+    unsigned num = 0;
+    void *slot[slab_magazine_max];
+  };
+
+  struct slab_depot_t {
+    ceph::spinlock lock;
+    unsigned num = 0;
+    /// lowest num since the last trim; that many magazines went unused
+    unsigned low = 0;
+    slab_magazine_t *full[slab_depot_max];
+  };
+  slab_depot_t slab_depot[num_slab_classes];
+
+  struct slab_thread_cache_t {
+    slab_magazine_t *mag[num_slab_classes] = {};
+    bool dead = false;
+    ~slab_thread_cache_t();
+  };
+  thread_local slab_thread_cache_t slab_cache;
+
+  size_t slab_size(unsigned c) {
+    return slab_class_size[c];
+  }
+
+  unsigned slab_capacity(unsigned c) {
+    return std::clamp<size_t>(slab_magazine_bytes / slab_class_size[c],
+			      1, slab_magazine_max);
+  }
+
+  size_t slab_align(unsigned c) {
+    return std::min<size_t>(slab_class_size[c], CEPH_PAGE_SIZE);
+  }
+
+  /// size class to serve size bytes aligned to align, or -1
+  int slab_class(size_t size, unsigned align) {
+    if (!slab_enabled || size > slab_class_size[num_slab_classes - 1]) {
+      return -1;
+    }
+    unsigned c = 0;
+    while (slab_class_size[c] < size) {
+      ++c;
+    }
+    if (align > slab_align(c)) {
+      return -1;
+    }
+    return c;
+  }
+
+  void *slab_alloc(unsigned c) {
+    auto& tc = slab_cache;
+    if (likely(!tc.dead)) {
+      auto m = tc.mag[c];
+      if (likely(m && m->num)) {
+	return m->slot[--m->num];
+      }
+      slab_magazine_t *full = nullptr;
+      {
+	auto& d = slab_depot[c];
+	std::lock_guard l(d.lock);
+	if (d.num) {
+	  full = d.full[--d.num];
+	  d.low = std::min(d.low, d.num);
+	}
+      }
+      if (full) {
+	delete m;
+	tc.mag[c] = full;
+	return full->slot[--full->num];
+      }
+    }
+    void *p = nullptr;
+    if (::posix_memalign(&p, slab_align(c), slab_class_size[c]) || !p) {
+      throw buffer::bad_alloc();
+    }
+    return p;
+  }
+
+  void slab_free(unsigned c, void *p) {
+    auto& tc = slab_cache;
+    if (likely(!tc.dead)) {
+      auto m = tc.mag[c];
+      if (unlikely(!m)) {
+	m = tc.mag[c] = new slab_magazine_t;
+      }
+      if (likely(m->num < slab_capacity(c))) {
+	m->slot[m->num++] = p;
+	return;
+      }
+      bool stored = false;
+      {
+	auto& d = slab_depot[c];
+	std::lock_guard l(d.lock);
+	if (d.num < slab_depot_max) {
+	  d.full[d.num++] = m;
+	  stored = true;
+	}
+      }
+      if (stored) {
+	m = tc.mag[c] = new slab_magazine_t;
+	m->slot[m->num++] = p;
+	return;
+      }
+    }
+    aligned_free(p);
+  }
+
+  slab_thread_cache_t::~slab_thread_cache_t() {
+    for (unsigned c = 0; c < num_slab_classes; ++c) {
+      auto m = mag[c];
+      if (!m) {
+	continue;
+      }
+      mag[c] = nullptr;
+      if (m->num == slab_capacity(c)) {
+	auto& d = slab_depot[c];
+	std::lock_guard l(d.lock);
+	if (d.num < slab_depot_max) {
+	  d.full[d.num++] = m;
+	  continue;
+	}
+      }
+      while (m->num) {
+	aligned_free(m->slot[--m->num]);
+      }
+      delete m;
+    }
+    // buffers released by other thread_local dtors go straight to the heap
+    dead = true;
+  }
+
+  size_t slab_trim_depot() {
+    size_t freed = 0;
+    for (unsigned c = 0; c < num_slab_classes; ++c) {
+      slab_magazine_t *idle[slab_depot_max];
+      unsigned n;
+      {
+	auto& d = slab_depot[c];
+	std::lock_guard l(d.lock);
+	n = d.low;
+	d.num -= n;
+	std::copy_n(d.full + d.num, n, idle);
+	d.low = d.num;
+      }
+      for (unsigned i = 0; i < n; ++i) {
+	auto m = idle[i];
+	freed += m->num * slab_class_size[c];
+	while (m->num) {
+	  aligned_free(m->slot[--m->num]);
+	}
+	delete m;
+      }
+    }
+    return freed;
+  }
+
+  /*
+   * ptr_node cache
+   *
+   * Each fragment of a list is a separately allocated ptr_node, and most
+   * lists only have a few.  Keep some freed nodes per thread, linked
+   * through their first word.  The cache only ever holds memory from the
+   * global operator new, so nodes that code built against older headers
+   * allocated or frees directly mix in safely.
+   */
+  constexpr unsigned ptr_node_cache_max = 128;
+
+  struct ptr_node_cache_t {
+    void *head = nullptr;
+    unsigned num = 0;
+    bool dead = false;
+
+    ~ptr_node_cache_t() {
+      while (head) {
+	void *p = head;
+	head = *static_cast<void**>(p);
+	::operator delete(p);
+      }
+      num = 0;
+      dead = true;
+    }
+  };
+  thread_local ptr_node_cache_t ptr_node_cache;
+
+  } // anonymous namespace
+#else
+  namespace {
+  int slab_class(size_t, unsigned) {
+    return -1;
+  }
+  size_t slab_size(unsigned) {
+    ceph_abort();
+  }
+  size_t slab_trim_depot() {
+    return 0;
+  }
+  void *slab_alloc(unsigned) {
+    ceph_abort();
+  }
+  void slab_free(unsigned, void *) {
+    ceph_abort();
+  }
+  }
+#endif // !WITH_SEASTAR
+
+  size_t buffer::trim_raw_cache() {
+    return slab_trim_depot();
+  }
+
   /*
    * raw_combined is always placed within a single allocation along
    * with the data buffer.  the data goes at the beginning, and
@@ -88,11 +347,16 @@ static ceph::spinlock debug_lock;
    */
   class buffer::raw_combined : public buffer::raw {
     size_t alignment;
+    int slab;  ///< size class of the allocation, or -1
   public:
     raw_combined(char *dataptr, unsigned l, unsigned align,
-		 int mempool)
+		 int mempool, int slab)
       : raw(dataptr, l, mempool),
-	alignment(align) {
+	alignment(align),
+	slab(slab) {
+      if (slab >= 0) {
+	_set_slack(slab_size(slab) - len);
+      }
     }
     raw* clone_empty() override {
       return create(len, alignment).release();
@@ -109,26 +373,35 @@ static ceph::spinlock debug_lock;
 				  alignof(buffer::raw_combined));
       size_t datalen = round_up_to(len, alignof(buffer::raw_combined));
 
+      char *ptr = 0;
+      int slab = slab_class(rawlen + datalen, align);
+      if (slab >= 0) {
+	ptr = (char *)slab_alloc(slab);
+      } else {
 #ifdef DARWIN
-      char *ptr = (char *) valloc(rawlen + datalen);
+	ptr = (char *) valloc(rawlen + datalen);
 #else
-      char *ptr = 0;
-      int r = ::posix_memalign((void**)(void*)&ptr, align, rawlen + datalen);
-      if (r)
-	throw bad_alloc();
+	int r = ::posix_memalign((void**)(void*)&ptr, align, rawlen + datalen);
+	if (r)
+	  throw bad_alloc();
 #endif /* DARWIN */
-      if (!ptr)
-	throw bad_alloc();
+	if (!ptr)
+	  throw bad_alloc();
+      }
 
       // actual data first, since it has presumably larger alignment restriction
       // then put the raw_combined at the end
       return ceph::unique_leakable_ptr<buffer::raw>(
-	new (ptr + datalen) raw_combined(ptr, len, align, mempool));
+	new (ptr + datalen) raw_combined(ptr, len, align, mempool, slab));
     }
 
     static void operator delete(void *ptr) {
       raw_combined *raw = (raw_combined *)ptr;
-      aligned_free((void *)raw->data);
+      if (raw->slab >= 0) {
+	slab_free(raw->slab, raw->data);
+      } else {
+	aligned_free((void *)raw->data);
+      }
     }
   };
 
@@ -161,30 +434,43 @@ static ceph::spinlock debug_lock;
 #ifndef __CYGWIN__
   class buffer::raw_posix_aligned : public buffer::raw {
     unsigned align;
+    int slab;  ///< size class of data, or -1
   public:
     MEMPOOL_CLASS_HELPERS();
 
-    raw_posix_aligned(unsigned l, unsigned _align) : raw(l) {
+    raw_posix_aligned(unsigned l, unsigned _align,
+		      int mempool = mempool::mempool_buffer_anon)
+      : raw(l, mempool) {
       // posix_memalign() requires a multiple of sizeof(void *)
       align = std::max<unsigned>(_align, sizeof(void *));
+      slab = len ? slab_class(len, align) : -1;
+      if (slab >= 0) {
+	data = (char *)slab_alloc(slab);
+	_set_slack(slab_size(slab) - len);
+      } else {
 #ifdef DARWIN
-      data = (char *) valloc(len);
+	data = (char *) valloc(len);
 #else
-      int r = ::posix_memalign((void**)(void*)&data, align, len);
-      if (r)
-	throw bad_alloc();
+	int r = ::posix_memalign((void**)(void*)&data, align, len);
+	if (r)
+	  throw bad_alloc();
 #endif /* DARWIN */
-      if (!data)
-	throw bad_alloc();
+	if (!data)
+	  throw bad_alloc();
+      }
       bdout << "raw_posix_aligned " << this << " alloc " << (void *)data
 	    << " l=" << l << ", align=" << align << bendl;
     }
     ~raw_posix_aligned() override {
-      aligned_free(data);
+      if (slab >= 0) {
+	slab_free(slab, data);
+      } else {
+	aligned_free(data);
+      }
       bdout << "raw_posix_aligned " << this << " free " << (void *)data << bendl;
     }
     raw* clone_empty() override {
-      return new raw_posix_aligned(len, align);
+      return new raw_posix_aligned(len, align, mempool);
     }
   };
 #endif
@@ -333,10 +619,15 @@ static ceph::spinlock debug_lock;
     //
     // I also see better performance from a separate buffer::raw once the
     // size passes 8KB.
+    //
+    // A page multiple is a slab class of its own, which the raw_combined
+    // header would push into the next class up.
     if ((align & ~CEPH_PAGE_MASK) == 0 ||
-	len >= CEPH_PAGE_SIZE * 2) {
+	len >= CEPH_PAGE_SIZE * 2 ||
+	(len && (len & ~CEPH_PAGE_MASK) == 0)) {
 #ifndef __CYGWIN__
-      return ceph::unique_leakable_ptr<buffer::raw>(new raw_posix_aligned(len, align));
+      return ceph::unique_leakable_ptr<buffer::raw>(
+	new raw_posix_aligned(len, align, mempool));
 #else
       return ceph::unique_leakable_ptr<buffer::raw>(new raw_hack_aligned(len, align));
 #endif
@@ -1556,6 +1847,15 @@ static ceph::spinlock debug_lock;
 
     clear();
 
+    // most slices lie within the first fragment (or the only one)
+    if (len && off + len <= other._buffers.front().length()) {
+      _buffers.push_back(
+	*ptr_node::create(other._buffers.front(), off, len).release());
+      _len = len;
+      _num = 1;
+      return;
+    }
+
     // skip off
     auto curbuf = std::cbegin(other._buffers);
     while (off > 0 && off >= curbuf->length()) {
@@ -2064,7 +2364,12 @@ __u32 buffer::list::crc32c(__u32 crc) const
   int cache_adjusts = 0;
 
   for (const auto& node : _buffers) {
-    if (node.length()) {
+    if (node.length() == 0) {
+      continue;
+    } else if (node.length() < CEPH_BUFFER_CRC_CACHE_MIN) {
+      // cheaper to recompute than to take the crc cache spinlock twice
+      crc = ceph_crc32c(crc, (unsigned char*)node.c_str(), node.length());
+    } else {
       raw* const r = node._raw;
       pair<size_t, size_t> ofs(node.offset(), node.offset() + node.length());
       pair<uint32_t, uint32_t> ccrc;
@@ -2252,6 +2557,34 @@ bool buffer::ptr_node::dispose_if_hypercombined(
   }
 }
 
+void* buffer::ptr_node::operator new(size_t size)
+{
+#ifndef WITH_SEASTAR
+  auto& c = ptr_node_cache;
+  if (likely(c.head != nullptr && size == sizeof(ptr_node))) {
+    void *p = c.head;
+    c.head = *static_cast<void**>(p);
+    --c.num;
+    return p;
+  }
+#endif
+  return ::operator new(size);
+}
+
+void buffer::ptr_node::operator delete(void *p)
+{
+#ifndef WITH_SEASTAR
+  auto& c = ptr_node_cache;
+  if (likely(slab_enabled && !c.dead && c.num < ptr_node_cache_max)) {
+    *static_cast<void**>(p) = c.head;
+    c.head = p;
+    ++c.num;
+    return;
+  }
+#endif
+  ::operator delete(p);
+}
+
 std::unique_ptr<buffer::ptr_node, buffer::ptr_node::disposer>
 buffer::ptr_node::create_hypercombined(ceph::unique_leakable_ptr<buffer::raw> r)
 {
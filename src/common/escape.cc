@@ -16,6 +16,8 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <array>
+#include <cstdint>
 #include <iomanip>
 #include <boost/optional.hpp>
 
@@ -284,3 +286,70 @@ std::ostream& operator<<(std::ostream& out, const json_stream_escaper& e)
   }
   return out;
 }
+
+/* For each byte, the character to put after the backslash when escaping
+ * it for JSON, 'u' for a \u00XX escape, or 0 if it goes out as is. */
+static constexpr std::array<char, 256> json_escape_table = [] {
+  std::array<char, 256> t{};
+  for (unsigned c = 0; c < 0x20; ++c) {
+    t[c] = 'u';
+  }
+  t[0x7f] = 'u';
+  t['"'] = '"';
+  t['\\'] = '\\';
+  t['\t'] = 't';
+  t['\n'] = 'n';
+  return t;
+}();
+
+/* Whether any of the eight bytes in v needs escaping: a control
+ * character, a double quote, a backslash or DEL. */
+static inline bool json_word_needs_escape(uint64_t v)
+{
+  constexpr uint64_t ones = ~0ull / 255;
+  constexpr uint64_t highs = ones * 0x80;
+  auto has_zero = [](uint64_t x) {
+    return (x - ones) & ~x & highs;
+  };
+  return ((v - ones * 0x20) & ~v & highs) ||
+    has_zero(v ^ (ones * '"')) ||
+    has_zero(v ^ (ones * '\\')) ||
+    has_zero(v ^ (ones * 0x7f));
+}
+
+void append_json_escaped(std::string& out, std::string_view str)
+{
+  static const char hex[] = "0123456789abcdef";
+  const char *p = str.data();
+  const char *end = p + str.size();
+  const char *run = p;
+  while (p < end) {
+    while (end - p >= 8) {
+      uint64_t v;
+      memcpy(&v, p, sizeof(v));
+      if (json_word_needs_escape(v)) {
+	break;
+      }
+      p += 8;
+    }
+    if (p == end) {
+      break;
+    }
+    unsigned char c = *p;
+    char e = json_escape_table[c];
+    if (!e) {
+      ++p;
+      continue;
+    }
+    out.append(run, p - run);
+    if (e == 'u') {
+      const char u[] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+      out.append(u, sizeof(u));
+    } else {
+      const char esc[] = {'\\', e};
+      out.append(esc, sizeof(esc));
+    }
+    run = ++p;
+  }
+  out.append(run, p - run);
+}
@@ -16,6 +16,7 @@
 #define CEPH_RGW_ESCAPE_H
 
 #include <ostream>
+#include <string>
 #include <string_view>
 
 /* Returns the length of a buffer that would be needed to escape 'buf'
@@ -61,4 +62,10 @@ struct json_stream_escaper {
 };
 std::ostream& operator<<(std::ostream& out, const json_stream_escaper& e);
 
+/* Appends 'str' to 'out', escaped exactly as json_stream_escaper would
+ * print it. Runs of characters that need no escaping are copied in bulk,
+ * so this is much cheaper than going through a stream.
+ */
+void append_json_escaped(std::string& out, std::string_view str);
+
 #endif
@@ -61,11 +61,74 @@ void mempool::set_debug_mode(bool d)
   debug_mode = d;
 }
 
+// --------------------------------------------------------------
+// batched counts
+
+namespace {
+
+// flush a pool's buffered counts once they are off by this much
+constexpr ssize_t BATCH_MAX_ITEMS = 64;
+constexpr ssize_t BATCH_MAX_BYTES = 256 * 1024;
+
+struct batched_counts_t {
+  ssize_t items[mempool::num_pools] = {};
+  ssize_t bytes[mempool::num_pools] = {};
+  bool dead = false;
+
+  ~batched_counts_t() {
+    flush();
+    dead = true;  // later updates from other thread_local dtors go direct
+  }
+
+  void flush(size_t ix) {
+    if (items[ix] || bytes[ix]) {
+      mempool::get_pool((mempool::pool_index_t)ix).adjust_count(
+	items[ix], bytes[ix]);
+      items[ix] = 0;
+      bytes[ix] = 0;
+    }
+  }
+  void flush() {
+    for (size_t i = 0; i < mempool::num_pools; ++i) {
+      flush(i);
+    }
+  }
+};
+
+thread_local batched_counts_t batched_counts;
+
+}
+
+void mempool::adjust_count_batched(
+  pool_index_t ix, ssize_t items, ssize_t bytes)
+{
+  auto& b = batched_counts;
+  if (b.dead) {
+    get_pool(ix).adjust_count(items, bytes);
+    return;
+  }
+  b.items[ix] += items;
+  b.bytes[ix] += bytes;
+  if (b.items[ix] > BATCH_MAX_ITEMS || b.items[ix] < -BATCH_MAX_ITEMS ||
+      b.bytes[ix] > BATCH_MAX_BYTES || b.bytes[ix] < -BATCH_MAX_BYTES) {
+    b.flush(ix);
+  }
+}
+
+void mempool::flush_batched_counts()
+{
+  auto& b = batched_counts;
+  if (!b.dead) {
+    b.flush();
+  }
+}
+
 // --------------------------------------------------------------
 // pool_t
 
 size_t mempool::pool_t::allocated_bytes() const
 {
+  flush_batched_counts();
   ssize_t result = 0;
   for (size_t i = 0; i < num_shards; ++i) {
     result += shard[i].bytes;
@@ -79,6 +142,7 @@ size_t mempool::pool_t::allocated_bytes() const
 
 size_t mempool::pool_t::allocated_items() const
 {
+  flush_batched_counts();
   ssize_t result = 0;
   for (size_t i = 0; i < num_shards; ++i) {
     result += shard[i].items;
@@ -101,6 +165,7 @@ void mempool::pool_t::get_stats(
   stats_t *total,
   std::map<std::string, stats_t> *by_type) const
 {
+  flush_batched_counts();
   for (size_t i = 0; i < num_shards; ++i) {
     total->items += shard[i].items;
     total->bytes += shard[i].bytes;
@@ -224,6 +224,15 @@ int set_cpu_affinity_all_threads(size_t cpu_set_size, cpu_set_t *cpu_set)
   return 0;
 }
 
+int set_cpu_affinity_this_thread(size_t cpu_set_size, cpu_set_t *cpu_set)
+{
+  int r = sched_setaffinity(0, cpu_set_size, cpu_set);
+  if (r < 0) {
+    return -errno;
+  }
+  return 0;
+}
+
 #else
 int parse_cpu_set_list(const char *s,
 		       size_t *cpu_set_size,
@@ -257,4 +266,10 @@ int set_cpu_affinity_all_threads(size_t cpu_set_size,
   return -ENOTSUP;
 }
 
+int set_cpu_affinity_this_thread(size_t cpu_set_size,
+				 cpu_set_t *cpu_set)
+{
+  return -ENOTSUP;
+}
+
 #endif
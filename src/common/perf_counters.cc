@@ -17,11 +17,62 @@
 #include "common/dout.h"
 #include "common/valgrind.h"
 #include "include/common_fwd.h"
+#include "include/intarith.h"
+
+#include <thread>
 
 using std::ostringstream;
 using std::make_pair;
 using std::pair;
 
+namespace {
+/// handed out round robin, so the first threads to update sharded
+/// counters land in different shards
+std::atomic<unsigned> next_thread_shard = { 0 };
+thread_local unsigned thread_shard = next_thread_shard++;
+
+using perf_counter_data_any_d = TOPNSPC::common::PerfCounters::perf_counter_data_any_d;
+
+bool is_sharded_type(int type)
+{
+  // gauges are set as often as they are bumped, and summing up shards
+  // of histograms costs more than it saves
+  return (type & (PERFCOUNTER_COUNTER | PERFCOUNTER_LONGRUNAVG)) &&
+    !(type & PERFCOUNTER_HISTOGRAM);
+}
+
+// T is either the counter itself or its slot in a shard
+template <typename T>
+void add_to(T& d, bool avg, uint64_t amt)
+{
+  if (avg) {
+    d.avgcount++;
+    d.u64 += amt;
+    d.avgcount2++;
+  } else {
+    d.u64 += amt;
+  }
+}
+
+void add(perf_counter_data_any_d& data, uint64_t amt)
+{
+  bool avg = data.type & PERFCOUNTER_LONGRUNAVG;
+  if (data.shard_blocks) {
+    add_to(data.get_shard(thread_shard & (data.num_shards - 1)), avg, amt);
+  } else {
+    add_to(data, avg, amt);
+  }
+}
+
+// the value set lives in the counter itself
+void zero_shards(perf_counter_data_any_d& data)
+{
+  for (unsigned i = 0; i < data.num_shards; ++i) {
+    data.get_shard(i).u64 = 0;
+  }
+}
+}
+
 namespace TOPNSPC::common {
 PerfCountersCollectionImpl::PerfCountersCollectionImpl()
 {
@@ -168,13 +219,7 @@ void PerfCounters::inc(int idx, uint64_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount++;
-    data.u64 += amt;
-    data.avgcount2++;
-  } else {
-    data.u64 += amt;
-  }
+  add(data, amt);
 }
 
 void PerfCounters::dec(int idx, uint64_t amt)
@@ -190,7 +235,11 @@ void PerfCounters::dec(int idx, uint64_t amt)
   ceph_assert(!(data.type & PERFCOUNTER_LONGRUNAVG));
   if (!(data.type & PERFCOUNTER_U64))
     return;
-  data.u64 -= amt;
+  if (data.shard_blocks) {
+    data.get_shard(thread_shard & (data.num_shards - 1)).u64 -= amt;
+  } else {
+    data.u64 -= amt;
+  }
 }
 
 void PerfCounters::set(int idx, uint64_t amt)
@@ -215,6 +264,7 @@ void PerfCounters::set(int idx, uint64_t amt)
   } else {
     data.u64 = amt;
   }
+  zero_shards(data);
 }
 
 uint64_t PerfCounters::get(int idx) const
@@ -229,7 +279,7 @@ uint64_t PerfCounters::get(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return 0;
-  return data.u64;
+  return data.read_u64();
 }
 
 void PerfCounters::tinc(int idx, utime_t amt)
@@ -244,13 +294,7 @@ void PerfCounters::tinc(int idx, utime_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount++;
-    data.u64 += amt.to_nsec();
-    data.avgcount2++;
-  } else {
-    data.u64 += amt.to_nsec();
-  }
+  add(data, amt.to_nsec());
 }
 
 void PerfCounters::tinc(int idx, ceph::timespan amt)
@@ -265,13 +309,7 @@ void PerfCounters::tinc(int idx, ceph::timespan amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount++;
-    data.u64 += amt.count();
-    data.avgcount2++;
-  } else {
-    data.u64 += amt.count();
-  }
+  add(data, amt.count());
 }
 
 void PerfCounters::tset(int idx, utime_t amt)
@@ -303,7 +341,7 @@ utime_t PerfCounters::tget(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return utime_t();
-  uint64_t v = data.u64;
+  uint64_t v = data.read_u64();
   return utime_t(v / 1000000000ull, v % 1000000000ull);
 }
 
@@ -451,7 +489,7 @@ void PerfCounters::dump_formatted_generic(Formatter *f, bool schema,
         d->histogram->dump_formatted(f);
         f->close_section();
       } else {
-	uint64_t v = d->u64;
+	uint64_t v = d->read_u64();
 	if (d->type & PERFCOUNTER_U64) {
 	  f->dump_unsigned(d->name, v);
 	} else if (d->type & PERFCOUNTER_TIME) {
@@ -487,6 +525,34 @@ PerfCounters::PerfCounters(CephContext *cct, const std::string &name,
   m_data.resize(upper_bound - lower_bound - 1);
 }
 
+void PerfCounters::_add_shards(unsigned num_shards)
+{
+  unsigned n = 0;
+  for (auto& d : m_data) {
+    if (is_sharded_type(d.type)) {
+      ++n;
+    }
+  }
+  if (n == 0) {
+    return;
+  }
+  // every shard starts on a cache line of its own
+  const unsigned stride =
+    (n + shard_block_t::SLOTS - 1) / shard_block_t::SLOTS;
+  m_shards.reset(new shard_block_t[stride * num_shards]);
+  unsigned i = 0;
+  for (auto& d : m_data) {
+    if (!is_sharded_type(d.type)) {
+      continue;
+    }
+    d.shard_blocks = &m_shards[i / shard_block_t::SLOTS];
+    d.shard_slot = i % shard_block_t::SLOTS;
+    d.shard_stride = stride;
+    d.num_shards = num_shards;
+    ++i;
+  }
+}
+
 PerfCountersBuilder::PerfCountersBuilder(CephContext *cct, const std::string &name,
                   int first, int last)
   : m_perf_counters(new PerfCounters(cct, name, first, last))
@@ -584,6 +650,20 @@ PerfCounters *PerfCountersBuilder::create_perf_counters()
 
   PerfCounters *ret = m_perf_counters;
   m_perf_counters = NULL;
+#ifndef WITH_SEASTAR
+  if (sharded) {
+    unsigned num_shards = ret->m_cct->_conf.get_val<uint64_t>(
+      "perf_counters_shards");
+    if (num_shards == 0) {
+      num_shards = std::min(std::max(std::thread::hardware_concurrency(), 1u),
+			    32u);
+    }
+    num_shards = std::min(1u << cbits(num_shards - 1), 256u);
+    if (num_shards > 1) {
+      ret->_add_shards(num_shards);
+    }
+  }
+#endif
   return ret;
 }
 
@@ -29,6 +29,10 @@
 #include "common/ceph_mutex.h"
 #include "common/ceph_time.h"
 
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64 /* XXX arch-specific define */
+#endif
+
 namespace TOPNSPC::common {
   class CephContext;
   class PerfCountersBuilder;
@@ -113,6 +117,20 @@ public:
     prio_default = prio_;
   }
 
+  /**
+   * spread the counters over per-thread shards
+   *
+   * Counters and averages of a sharded PerfCounters are updated in a
+   * shard picked by the calling thread and summed up when read, so that
+   * threads bumping the same counter do not fight over its cache line.
+   * Meant for loggers that many threads update on every op; gauges and
+   * histograms are not sharded.
+   */
+  void set_sharded()
+  {
+    sharded = true;
+  }
+
   PerfCounters* create_perf_counters();
 private:
   PerfCountersBuilder(const PerfCountersBuilder &rhs);
@@ -124,6 +142,7 @@ private:
   PerfCounters *m_perf_counters;
 
   int prio_default = 0;
+  bool sharded = false;
 };
 
 /*
@@ -150,10 +169,28 @@ private:
  * For the time average, it returns the current value and
  * the "avgcount" member when read off. avgcount is incremented when you call
  * tinc. Calling tset on an average is an error and will assert out.
+ *
+ * A sharded PerfCounters (see PerfCountersBuilder::set_sharded()) keeps a
+ * copy of each counter and average per shard.  Updates go to the calling
+ * thread's shard and reads sum up all of them, so always read the values
+ * through get(), tget(), get_tavg_ns() or perf_counter_data_any_d's
+ * read_u64() and read_avg().
  */
 class PerfCounters
 {
 public:
+  /// one counter's share of a shard
+  struct shard_slot_t {
+    std::atomic<uint64_t> u64 = { 0 };
+    std::atomic<uint64_t> avgcount = { 0 };
+    std::atomic<uint64_t> avgcount2 = { 0 };
+  };
+  /// shards are made of whole cache lines
+  struct alignas(CACHE_LINE_SIZE) shard_block_t {
+    static constexpr unsigned SLOTS = 8;
+    shard_slot_t slot[SLOTS];
+  };
+
   /** Represents a PerfCounters data element. */
   struct perf_counter_data_any_d {
     perf_counter_data_any_d()
@@ -169,11 +206,13 @@ public:
         nick(other.nick),
 	 type(other.type),
 	 unit(other.unit),
-	 u64(other.u64.load()) {
-      auto a = other.read_avg();
-      u64 = a.first;
-      avgcount = a.second;
-      avgcount2 = a.second;
+	 u64(other.read_u64()) {
+      if (type & PERFCOUNTER_LONGRUNAVG) {
+	auto a = other.read_avg();
+	u64 = a.first;
+	avgcount = a.second;
+	avgcount2 = a.second;
+      }
       if (other.histogram) {
         histogram.reset(new PerfHistogram<>(*other.histogram));
       }
@@ -190,27 +229,63 @@ public:
     std::atomic<uint64_t> avgcount2 = { 0 };
     std::unique_ptr<PerfHistogram<>> histogram;
 
+    /// this counter's block in shard 0, or nullptr if it is not sharded;
+    /// shard i's block is shard_blocks[i * shard_stride]
+    shard_block_t *shard_blocks = nullptr;
+    uint32_t shard_stride = 0;
+    uint16_t num_shards = 0;   ///< a power of two
+    uint8_t shard_slot = 0;
+
+    shard_slot_t& get_shard(unsigned i) const {
+      return shard_blocks[i * shard_stride].slot[shard_slot];
+    }
+
     void reset()
     {
       if (type != PERFCOUNTER_U64) {
 	    u64 = 0;
 	    avgcount = 0;
 	    avgcount2 = 0;
+	    for (unsigned i = 0; i < num_shards; ++i) {
+	      auto& s = get_shard(i);
+	      s.u64 = 0;
+	      s.avgcount = 0;
+	      s.avgcount2 = 0;
+	    }
       }
       if (histogram) {
         histogram->reset();
       }
     }
 
+    uint64_t read_u64() const {
+      uint64_t v = u64;
+      for (unsigned i = 0; i < num_shards; ++i) {
+	v += get_shard(i).u64.load(std::memory_order_relaxed);
+      }
+      return v;
+    }
+
     // read <sum, count> safely by making sure the post- and pre-count
     // are identical; in other words the whole loop needs to be run
-    // without any intervening calls to inc, set, or tinc.
+    // without any intervening calls to inc, set, or tinc.  shards are
+    // read one at a time, so the pair is consistent within each shard.
     std::pair<uint64_t,uint64_t> read_avg() const {
       uint64_t sum, count;
       do {
 	count = avgcount2;
 	sum = u64;
       } while (avgcount != count);
+      for (unsigned i = 0; i < num_shards; ++i) {
+	auto& s = get_shard(i);
+	uint64_t ssum, scount;
+	do {
+	  scount = s.avgcount2;
+	  ssum = s.u64;
+	} while (s.avgcount != scount);
+	sum += ssum;
+	count += scount;
+      }
       return { sum, count };
     }
   };
@@ -282,6 +357,8 @@ private:
 
   typedef std::vector<perf_counter_data_any_d> perf_counter_data_vec_t;
 
+  void _add_shards(unsigned num_shards);
+
   CephContext *m_cct;
   int m_lower_bound;
   int m_upper_bound;
@@ -296,6 +373,7 @@ private:
 #endif
 
   perf_counter_data_vec_t m_data;
+  std::unique_ptr<shard_block_t[]> m_shards;
 
   friend class PerfCountersBuilder;
   friend class PerfCountersCollectionImpl;
@@ -0,0 +1,320 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_COMMON_TIMER_WHEEL_H
+#define CEPH_COMMON_TIMER_WHEEL_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+namespace ceph {
+
+/**
+ * timer_wheel
+ *
+ * Hierarchical timing wheel.  Time is cut into ticks of a fixed
+ * resolution; level L has 64 slots of 64^L ticks each, and an entry
+ * lives in the lowest level whose slot still tells it apart from the
+ * current tick.  Whenever the current tick crosses a slot boundary of a
+ * higher level, that slot is cascaded down.  insert() and remove() are
+ * O(1) regardless of how many entries are pending, which matters for
+ * the timeouts that are scheduled by the hundred thousand and nearly
+ * always cancelled.
+ *
+ * Entries are intrusive; the owner embeds an entry and keeps it alive
+ * while it is linked.  An entry is never reported before its deadline,
+ * and at most one tick after it.  Expired entries come out ordered by
+ * deadline, ties in insertion order, like a multimap.
+ *
+ * Not thread safe; callers provide their own locking.
+ */
+template <typename Clock>
+class timer_wheel {
+public:
+  using time_point = typename Clock::time_point;
+  using duration = typename Clock::duration;
+
+  static constexpr unsigned SLOT_BITS = 6;
+  static constexpr unsigned SLOTS = 1u << SLOT_BITS;
+  static constexpr uint64_t SLOT_MASK = SLOTS - 1;
+  /// 64^6 ticks, or two years at a millisecond resolution; entries
+  /// further out are parked in the top level and re-placed later
+  static constexpr unsigned LEVELS = 6;
+
+private:
+  struct link {
+    link *prev = nullptr;
+    link *next = nullptr;
+  };
+
+public:
+  struct entry : link {
+    time_point when;
+    uint64_t seq = 0;
+    uint64_t tick = 0;
+    uint16_t slot = 0;     ///< level * SLOTS + slot, or EXPIRED
+
+    bool is_linked() const {
+      return this->prev != nullptr;
+    }
+  };
+
+  explicit timer_wheel(duration resolution = std::chrono::milliseconds(1),
+		       time_point base = Clock::now())
+    : res(resolution.count() > 0 ? resolution.count() : 1),
+      base(base) {
+    for (auto& h : heads) {
+      _init_head(&h);
+    }
+    _init_head(&expired);
+  }
+  timer_wheel(const timer_wheel&) = delete;
+  timer_wheel& operator=(const timer_wheel&) = delete;
+  // entries still linked at destruction are left alone; their owner may
+  // well have freed them already
+  ~timer_wheel() = default;
+
+  size_t size() const {
+    return num;
+  }
+  bool empty() const {
+    return num == 0;
+  }
+
+  /// schedule e, which must not be linked, for when
+  void insert(entry *e, time_point when) {
+    assert(!e->is_linked());
+    e->when = when;
+    e->seq = ++last_seq;
+    e->tick = _ceil_tick(when);
+    _place(e);
+    ++num;
+  }
+
+  /// unschedule e, which may or may not have expired yet
+  void remove(entry *e) {
+    assert(e->is_linked());
+    _unlink(e);
+    --num;
+  }
+
+  /// unlink everything without reporting it
+  void clear() {
+    for (auto& h : heads) {
+      _drain(&h);
+    }
+    _drain(&expired);
+    occupied.fill(0);
+    num = 0;
+  }
+
+  /// move all entries due at now to the expired list
+  void advance(time_point now) {
+    const uint64_t target = _floor_tick(now);
+    while (cur < target) {
+      uint64_t next = _next_tick();
+      if (next > target) {
+	cur = target;
+	break;
+      }
+      cur = next;
+      _process();
+    }
+  }
+
+  /// take the earliest expired entry, or nullptr
+  entry* pop_expired() {
+    if (expired.next == &expired) {
+      return nullptr;
+    }
+    auto e = static_cast<entry*>(expired.next);
+    remove(e);
+    return e;
+  }
+
+  /**
+   * when advance() will next have something to do
+   *
+   * This may be a slot boundary rather than a deadline, in which case
+   * advancing there only cascades entries closer to the current tick.
+   *
+   * @returns time_point::max() if nothing is pending
+   */
+  time_point next_wakeup() const {
+    if (expired.next != &expired) {
+      return static_cast<const entry*>(expired.next)->when;
+    }
+    uint64_t next = _next_tick();
+    if (next == NO_TICK ||
+	next > uint64_t(std::numeric_limits<typename duration::rep>::max() -
+			base.time_since_epoch().count()) / res) {
+      return time_point::max();
+    }
+    return base + duration(typename duration::rep(next * res));
+  }
+
+private:
+  static constexpr uint64_t NO_TICK = std::numeric_limits<uint64_t>::max();
+  static constexpr uint16_t EXPIRED = LEVELS * SLOTS;
+
+  const uint64_t res;
+  const time_point base;
+  uint64_t cur = 0;        ///< every tick up to and including this is done
+  uint64_t last_seq = 0;
+  size_t num = 0;
+
+  std::array<link, LEVELS * SLOTS> heads;
+  std::array<uint64_t, LEVELS> occupied = {};  ///< non-empty slots
+  link expired;            ///< due entries, by (when, seq)
+
+  static void _init_head(link *h) {
+    h->prev = h->next = h;
+  }
+
+  static bool _before(const entry *a, const entry *b) {
+    return a->when < b->when || (a->when == b->when && a->seq < b->seq);
+  }
+
+  uint64_t _floor_tick(time_point t) const {
+    if (t <= base) {
+      return 0;
+    }
+    return uint64_t((t - base).count()) / res;
+  }
+  uint64_t _ceil_tick(time_point t) const {
+    if (t <= base) {
+      return 0;
+    }
+    uint64_t d = (t - base).count();
+    return d / res + (d % res ? 1 : 0);
+  }
+
+  static void _link_after(link *pos, link *l) {
+    l->prev = pos;
+    l->next = pos->next;
+    pos->next->prev = l;
+    pos->next = l;
+  }
+
+  void _unlink(entry *e) {
+    e->prev->next = e->next;
+    e->next->prev = e->prev;
+    if (e->slot != EXPIRED) {
+      auto& h = heads[e->slot];
+      if (h.next == &h) {
+	occupied[e->slot / SLOTS] &= ~(1ull << (e->slot % SLOTS));
+      }
+    }
+    e->prev = e->next = nullptr;
+  }
+
+  void _drain(link *h) {
+    while (h->next != h) {
+      auto l = h->next;
+      h->next = l->next;
+      l->prev = l->next = nullptr;
+    }
+    h->prev = h;
+  }
+
+  void _place(entry *e) {
+    if (e->tick <= cur) {
+      // keep the expired list sorted; new arrivals are nearly always last
+      e->slot = EXPIRED;
+      link *pos = expired.prev;
+      while (pos != &expired && _before(e, static_cast<entry*>(pos))) {
+	pos = pos->prev;
+      }
+      _link_after(pos, e);
+      return;
+    }
+    // the highest digit in which the deadline differs from now
+    unsigned level = (63 - __builtin_clzll(e->tick ^ cur)) / SLOT_BITS;
+    unsigned slot;
+    if (level < LEVELS) {
+      slot = (e->tick >> (level * SLOT_BITS)) & SLOT_MASK;
+    } else {
+      // due after this rotation of the top level at the earliest: park it
+      // in slot 0, which is cascaded when the next rotation starts
+      level = LEVELS - 1;
+      slot = 0;
+    }
+    e->slot = level * SLOTS + slot;
+    _link_after(heads[e->slot].prev, e);
+    occupied[level] |= 1ull << slot;
+  }
+
+  /// the first tick after cur at which some slot needs processing
+  uint64_t _next_tick() const {
+    uint64_t next = NO_TICK;
+    for (unsigned level = 0; level < LEVELS; ++level) {
+      if (!occupied[level]) {
+	continue;
+      }
+      const unsigned shift = level * SLOT_BITS;
+      const unsigned digit = (cur >> shift) & SLOT_MASK;
+      const uint64_t rotation = (cur >> (shift + SLOT_BITS)) << (shift + SLOT_BITS);
+      uint64_t later = digit == SLOT_MASK ? 0 :
+	occupied[level] & (~0ull << (digit + 1));
+      uint64_t t;
+      if (later) {
+	t = rotation + (uint64_t(__builtin_ctzll(later)) << shift);
+      } else {
+	// only the parked top level slot can be behind the current digit
+	t = rotation + (uint64_t(1) << (shift + SLOT_BITS)) +
+	  (uint64_t(__builtin_ctzll(occupied[level])) << shift);
+      }
+      next = std::min(next, t);
+    }
+    return next;
+  }
+
+  /// cascade and expire the slots that start at tick cur
+  void _process() {
+    for (unsigned level = LEVELS - 1; level > 0; --level) {
+      const unsigned shift = level * SLOT_BITS;
+      if (cur & ((uint64_t(1) << shift) - 1)) {
+	continue;
+      }
+      _respill(level * SLOTS + ((cur >> shift) & SLOT_MASK));
+    }
+    _respill(cur & SLOT_MASK);
+  }
+
+  void _respill(unsigned s) {
+    link *h = &heads[s];
+    if (h->next == h) {
+      return;
+    }
+    link l;
+    l.next = h->next;
+    l.prev = h->prev;
+    l.next->prev = &l;
+    l.prev->next = &l;
+    _init_head(h);
+    occupied[s / SLOTS] &= ~(1ull << (s % SLOTS));
+    while (l.next != &l) {
+      auto e = static_cast<entry*>(l.next);
+      l.next = e->next;
+      e->next->prev = &l;
+      _place(e);
+    }
+  }
+};
+
+} // namespace ceph
+
+#endif
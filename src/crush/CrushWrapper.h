@@ -1527,6 +1527,35 @@ public:
       out[i] = rawout[i];
   }
 
+  /**
+   * map each of x through rule, as do_rule() does, sharing one
+   * workspace across the whole batch
+   *
+   * @param out one result vector per x
+   */
+  template<typename WeightVector>
+  void do_rule_many(int rule, const std::vector<int>& x,
+		    std::vector<std::vector<int>> *out, int maxout,
+		    const WeightVector& weight,
+		    uint64_t choose_args_index) const {
+    std::vector<int> rawout(x.size() * maxout);
+    std::vector<int> lens(x.size());
+    std::vector<char> work(crush_work_size(crush, maxout));
+    crush_init_workspace(crush, work.data());
+    crush_choose_arg_map arg_map = choose_args_get_with_fallback(
+      choose_args_index);
+    crush_do_rule_many(crush, rule, x.data(), x.size(),
+		       rawout.data(), maxout, lens.data(),
+		       std::data(weight), std::size(weight),
+		       work.data(), arg_map.args);
+    out->resize(x.size());
+    for (size_t i = 0; i < x.size(); ++i) {
+      int numrep = std::max(lens[i], 0);
+      auto first = rawout.begin() + i * maxout;
+      (*out)[i].assign(first, first + numrep);
+    }
+  }
+
   int _choose_type_stack(
     CephContext *cct,
     const std::vector<std::pair<int,int>>& stack,
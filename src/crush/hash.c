@@ -140,6 +140,77 @@ __u32 crush_hash32_5(int type, __u32 a, __u32 b, __u32 c, __u32 d, __u32 e)
 	}
 }
 
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__KERNEL__)
+# include <immintrin.h>
+# include "arch/intel.h"
+
+#define crush_hashmix_avx2(a, b, c) do {				\
+		a = _mm256_sub_epi32(a, b);  a = _mm256_sub_epi32(a, c); \
+		a = _mm256_xor_si256(a, _mm256_srli_epi32(c, 13));	\
+		b = _mm256_sub_epi32(b, c);  b = _mm256_sub_epi32(b, a); \
+		b = _mm256_xor_si256(b, _mm256_slli_epi32(a, 8));	\
+		c = _mm256_sub_epi32(c, a);  c = _mm256_sub_epi32(c, b); \
+		c = _mm256_xor_si256(c, _mm256_srli_epi32(b, 13));	\
+		a = _mm256_sub_epi32(a, b);  a = _mm256_sub_epi32(a, c); \
+		a = _mm256_xor_si256(a, _mm256_srli_epi32(c, 12));	\
+		b = _mm256_sub_epi32(b, c);  b = _mm256_sub_epi32(b, a); \
+		b = _mm256_xor_si256(b, _mm256_slli_epi32(a, 16));	\
+		c = _mm256_sub_epi32(c, a);  c = _mm256_sub_epi32(c, b); \
+		c = _mm256_xor_si256(c, _mm256_srli_epi32(b, 5));	\
+		a = _mm256_sub_epi32(a, b);  a = _mm256_sub_epi32(a, c); \
+		a = _mm256_xor_si256(a, _mm256_srli_epi32(c, 3));	\
+		b = _mm256_sub_epi32(b, c);  b = _mm256_sub_epi32(b, a); \
+		b = _mm256_xor_si256(b, _mm256_slli_epi32(a, 10));	\
+		c = _mm256_sub_epi32(c, a);  c = _mm256_sub_epi32(c, b); \
+		c = _mm256_xor_si256(c, _mm256_srli_epi32(b, 15));	\
+	} while (0)
+
+/* crush_hash32_rjenkins1_3() of 8 values of b at once */
+__attribute__((target("avx2")))
+static unsigned crush_hash32_rjenkins1_3_avx2(__u32 a0, const __u32 *b0,
+					      __u32 c0, __u32 *out,
+					      unsigned n)
+{
+	unsigned i;
+	for (i = 0; i + 8 <= n; i += 8) {
+		__m256i a = _mm256_set1_epi32(a0);
+		__m256i b = _mm256_loadu_si256((const __m256i *)(b0 + i));
+		__m256i c = _mm256_set1_epi32(c0);
+		__m256i hash = _mm256_xor_si256(
+			_mm256_set1_epi32(crush_hash_seed ^ a0 ^ c0), b);
+		__m256i x = _mm256_set1_epi32(231232);
+		__m256i y = _mm256_set1_epi32(1232);
+		crush_hashmix_avx2(a, b, hash);
+		crush_hashmix_avx2(c, x, hash);
+		crush_hashmix_avx2(y, a, hash);
+		crush_hashmix_avx2(b, x, hash);
+		crush_hashmix_avx2(y, c, hash);
+		_mm256_storeu_si256((__m256i *)(out + i), hash);
+	}
+	return i;
+}
+#endif
+
+void crush_hash32_3_many(int type, __u32 a, const __u32 *b, __u32 c,
+			 __u32 *out, unsigned n)
+{
+	unsigned i = 0;
+	switch (type) {
+	case CRUSH_HASH_RJENKINS1:
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__KERNEL__)
+		if (ceph_arch_intel_avx2)
+			i = crush_hash32_rjenkins1_3_avx2(a, b, c, out, n);
+#endif
+		for (; i < n; i++)
+			out[i] = crush_hash32_rjenkins1_3(a, b[i], c);
+		break;
+	default:
+		for (; i < n; i++)
+			out[i] = 0;
+		break;
+	}
+}
+
 const char *crush_hash_name(int type)
 {
 	switch (type) {
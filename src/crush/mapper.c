@@ -309,10 +309,9 @@ static inline __s32 *get_choose_arg_ids(const struct crush_bucket_straw2 *bucket
  * for reference, see the exponential distribution example at:  
  * https://en.wikipedia.org/wiki/Inverse_transform_sampling#Examples
  */
-static inline __s64 generate_exponential_distribution(int type, int x, int y, int z, 
-                                                      int weight)
+static inline __s64 exponential_distribution_from_hash(unsigned int u,
+                                                       int weight)
 {
-	unsigned int u = crush_hash32_3(type, x, y, z);
 	u &= 0xffff;
 
 	/*
@@ -336,6 +335,20 @@ static inline __s64 generate_exponential_distribution(int type, int x, int y, in
 	return div64_s64(ln, weight);
 }
 
+static inline __s64 generate_exponential_distribution(int type, int x, int y, int z, 
+                                                      int weight)
+{
+	return exponential_distribution_from_hash(
+		crush_hash32_3(type, x, y, z), weight);
+}
+
+/*
+ * below this many items the batched hash does not fill a single
+ * vector and we hash one item at a time
+ */
+#define STRAW2_BATCH_MIN 8
+#define STRAW2_BATCH_MAX 64
+
 static int bucket_straw2_choose(const struct crush_bucket_straw2 *bucket,
 				int x, int r, const struct crush_choose_arg *arg,
                                 int position)
@@ -344,6 +357,34 @@ static int bucket_straw2_choose(const struct crush_bucket_straw2 *bucket,
 	__s64 draw, high_draw = 0;
         __u32 *weights = get_choose_arg_weights(bucket, arg, position);
         __s32 *ids = get_choose_arg_ids(bucket, arg);
+#ifndef __KERNEL__
+	if (bucket->h.size >= STRAW2_BATCH_MIN) {
+		/* hash a block of items up front so it can be vectorized */
+		__u32 hashes[STRAW2_BATCH_MAX];
+		unsigned int j, n;
+		for (i = 0; i < bucket->h.size; i += n) {
+			n = bucket->h.size - i;
+			if (n > STRAW2_BATCH_MAX)
+				n = STRAW2_BATCH_MAX;
+			crush_hash32_3_many(bucket->h.hash, x,
+					    (const __u32 *)ids + i, r,
+					    hashes, n);
+			for (j = 0; j < n; j++) {
+				if (weights[i + j]) {
+					draw = exponential_distribution_from_hash(
+						hashes[j], weights[i + j]);
+				} else {
+					draw = S64_MIN;
+				}
+				if (i + j == 0 || draw > high_draw) {
+					high = i + j;
+					high_draw = draw;
+				}
+			}
+		}
+		return bucket->h.items[high];
+	}
+#endif
 	for (i = 0; i < bucket->h.size; i++) {
                 dprintk("weight 0x%x item %d\n", weights[i], ids[i]);
 		if (weights[i]) {
@@ -1081,3 +1122,25 @@ int crush_do_rule(const struct crush_map *map,
 
 	return result_len;
 }
+
+int crush_do_rule_many(const struct crush_map *map,
+		       int ruleno, const int *x, int count,
+		       int *results, int result_max, int *result_lens,
+		       const __u32 *weight, int weight_max,
+		       void *cwin, const struct crush_choose_arg *choose_args)
+{
+	int i;
+
+	/*
+	 * the workspace only caches per-x state (the uniform bucket
+	 * permutations) that is recomputed whenever x changes, so it
+	 * can be shared by the whole batch
+	 */
+	for (i = 0; i < count; i++) {
+		result_lens[i] = crush_do_rule(map, ruleno, x[i],
+					       results + i * result_max,
+					       result_max, weight, weight_max,
+					       cwin, choose_args);
+	}
+	return count;
+}
@@ -77,6 +77,24 @@ extern int crush_do_rule(const struct crush_map *map,
 			 const __u32 *weights, int weight_max,
 			 void *cwin, const struct crush_choose_arg *choose_args);
 
+/** @ingroup API
+ *
+ * Map each of the __count__ values in __x__ through rule __ruleno__, as
+ * crush_do_rule() would.  The items for __x[i]__ are stored at
+ * __results + i * result_max__ and their number in __result_lens[i]__.
+ *
+ * All values share the workspace __cwin__, so it only has to be
+ * initialized once per batch rather than once per value.
+ *
+ * @return __count__
+ */
+extern int crush_do_rule_many(const struct crush_map *map,
+			      int ruleno, const int *x, int count,
+			      int *results, int result_max, int *result_lens,
+			      const __u32 *weights, int weight_max,
+			      void *cwin,
+			      const struct crush_choose_arg *choose_args);
+
 /* Returns the exact amount of workspace that will need to be used
    for a given combination of crush_map and result_max. The caller can
    then allocate this much on its own, either on the stack, in a
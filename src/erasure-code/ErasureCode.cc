@@ -247,6 +247,114 @@ int ErasureCode::decode(const set<int> &want_to_read,
   return _decode(want_to_read, chunks, decoded);
 }
 
+int ErasureCode::encode_stripes(const set<int> &want_to_encode,
+				const bufferlist &in,
+				unsigned stripe_width,
+				map<int, bufferlist> *encoded)
+{
+  ceph_assert(stripe_width > 0 && in.length() % stripe_width == 0);
+  const unsigned k = get_data_chunk_count();
+  const unsigned m = get_chunk_count() - k;
+  const unsigned chunk_size = get_chunk_size(stripe_width);
+  const unsigned stripes = in.length() / stripe_width;
+  if (stripes <= 1 || !can_batch_stripes() ||
+      chunk_size * k != stripe_width) {
+    for (unsigned s = 0; s < stripes; s++) {
+      bufferlist stripe;
+      stripe.substr_of(in, s * stripe_width, stripe_width);
+      map<int, bufferlist> stripe_encoded;
+      int r = encode(want_to_encode, stripe, &stripe_encoded);
+      if (r)
+	return r;
+      for (auto& [shard, bl] : stripe_encoded) {
+	(*encoded)[shard].claim_append(bl);
+      }
+    }
+    return 0;
+  }
+
+  // gather every data chunk of every stripe into one buffer per shard,
+  // reading the input once, front to back
+  const unsigned length = stripes * chunk_size;
+  vector<bufferptr> shards;
+  shards.reserve(k + m);
+  for (unsigned i = 0; i < k + m; i++) {
+    shards.push_back(buffer::create_aligned(length, SIMD_ALIGN));
+  }
+  auto p = in.begin();
+  for (unsigned s = 0; s < stripes; s++) {
+    for (unsigned i = 0; i < k; i++) {
+      p.copy(chunk_size, shards[i].c_str() + s * chunk_size);
+    }
+  }
+  for (unsigned i = 0; i < k + m; i++) {
+    (*encoded)[chunk_index(i)].push_back(std::move(shards[i]));
+  }
+  int r = encode_chunks(want_to_encode, encoded);
+  if (r)
+    return r;
+  for (unsigned i = 0; i < k + m; i++) {
+    if (want_to_encode.count(i) == 0)
+      encoded->erase(i);
+  }
+  return 0;
+}
+
+int ErasureCode::decode_stripes(const set<int> &want_to_read,
+				const map<int, bufferlist> &chunks,
+				map<int, bufferlist> *decoded,
+				unsigned chunk_size)
+{
+  ceph_assert(!chunks.empty());
+  const unsigned length = chunks.begin()->second.length();
+  ceph_assert(chunk_size > 0 && length % chunk_size == 0);
+  if (length == chunk_size || can_batch_stripes()) {
+    return decode(want_to_read, chunks, decoded, length);
+  }
+  for (unsigned off = 0; off < length; off += chunk_size) {
+    map<int, bufferlist> stripe_chunks;
+    for (auto& [shard, bl] : chunks) {
+      stripe_chunks[shard].substr_of(bl, off, chunk_size);
+    }
+    map<int, bufferlist> stripe_decoded;
+    int r = decode(want_to_read, stripe_chunks, &stripe_decoded, chunk_size);
+    if (r)
+      return r;
+    for (auto& [shard, bl] : stripe_decoded) {
+      (*decoded)[shard].claim_append(bl);
+    }
+  }
+  return 0;
+}
+
+void ErasureCode::encode_delta(const bufferlist &old_data,
+			       const bufferlist &new_data,
+			       bufferlist *delta)
+{
+  ceph_assert(old_data.length() == new_data.length());
+  const unsigned length = old_data.length();
+  bufferptr out(buffer::create_aligned(length, SIMD_ALIGN));
+  char *d = out.c_str();
+  new_data.begin().copy(length, d);
+  auto p = old_data.begin();
+  while (p.get_remaining()) {
+    const char *o;
+    unsigned off = p.get_off();
+    unsigned n = p.get_ptr_and_advance(p.get_remaining(), &o);
+    for (unsigned i = 0; i < n; i++) {
+      d[off + i] ^= o[i];
+    }
+  }
+  delta->clear();
+  delta->push_back(std::move(out));
+}
+
+int ErasureCode::apply_delta(const map<int, bufferlist> &deltas,
+			     map<int, bufferlist> *coding)
+{
+  return -EOPNOTSUPP;
+}
+
 int ErasureCode::parse(const ErasureCodeProfile &profile,
 		       ostream *ss)
 {
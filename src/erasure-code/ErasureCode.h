@@ -87,6 +87,27 @@ namespace ceph {
 			const std::map<int, bufferlist> &chunks,
 			std::map<int, bufferlist> *decoded);
 
+    int encode_stripes(const std::set<int> &want_to_encode,
+		       const bufferlist &in,
+		       unsigned stripe_width,
+		       std::map<int, bufferlist> *encoded) override;
+
+    int decode_stripes(const std::set<int> &want_to_read,
+		       const std::map<int, bufferlist> &chunks,
+		       std::map<int, bufferlist> *decoded,
+		       unsigned chunk_size) override;
+
+    bool supports_parity_delta() const override {
+      return false;
+    }
+
+    void encode_delta(const bufferlist &old_data,
+		      const bufferlist &new_data,
+		      bufferlist *delta) override;
+
+    int apply_delta(const std::map<int, bufferlist> &deltas,
+		    std::map<int, bufferlist> *coding) override;
+
     const std::vector<int> &get_chunk_mapping() const override;
 
     int to_mapping(const ErasureCodeProfile &profile,
@@ -117,6 +138,16 @@ namespace ceph {
     int parse(const ErasureCodeProfile &profile,
 	      std::ostream *ss);
 
+    /**
+     * true if encode_chunks() and decode_chunks() compute every
+     * aligned block of a chunk from the blocks at the same position in
+     * the other chunks only, so that the chunks of consecutive stripes
+     * can be processed as one large chunk
+     */
+    virtual bool can_batch_stripes() const {
+      return false;
+    }
+
   private:
     int chunk_index(unsigned int i) const;
   };
@@ -412,6 +412,97 @@ namespace ceph {
                               const std::map<int, bufferlist> &chunks,
                               std::map<int, bufferlist> *decoded) = 0;
 
+    /**
+     * Encode **in**, made of whole stripes of **stripe_width** bytes,
+     * and store in **encoded** one buffer per chunk index holding
+     * that chunk of every stripe, back to back.
+     *
+     * The result is the same as calling **encode** on each stripe
+     * and appending the chunks. Codes that treat every position of a
+     * chunk alike encode all the stripes in a single pass over large
+     * contiguous buffers instead of one call per stripe.
+     *
+     * Returns 0 on success.
+     *
+     * @param [in] want_to_encode chunk indexes to be encoded
+     * @param [in] in stripes to be encoded
+     * @param [in] stripe_width size of a stripe
+     * @param [out] encoded map chunk indexes to chunk data
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int encode_stripes(const std::set<int> &want_to_encode,
+                               const bufferlist &in,
+                               unsigned stripe_width,
+                               std::map<int, bufferlist> *encoded) = 0;
+
+    /**
+     * Decode **chunks**, each holding the same chunk of a whole
+     * number of stripes back to back, and store at least
+     * **want_to_read** chunks in **decoded** with the same layout.
+     *
+     * The result is the same as calling **decode** on each stripe
+     * and appending the chunks.
+     *
+     * Returns 0 on success.
+     *
+     * @param [in] want_to_read chunk indexes to be decoded
+     * @param [in] chunks map chunk indexes to chunk data
+     * @param [out] decoded map chunk indexes to chunk data
+     * @param [in] chunk_size size of a chunk of a single stripe
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int decode_stripes(const std::set<int> &want_to_read,
+                               const std::map<int, bufferlist> &chunks,
+                               std::map<int, bufferlist> *decoded,
+                               unsigned chunk_size) = 0;
+
+    /**
+     * Return true if the coding chunks can be updated with
+     * **apply_delta** when only some data chunks change, without
+     * reading the data chunks that did not change.
+     *
+     * This holds for linear codes where every coding chunk is a
+     * weighted sum of the data chunks: if data chunk **i** changes
+     * by **delta**, coding chunk **j** changes by the coefficient
+     * of **i** in **j** times **delta**.
+     *
+     * @return **true** if apply_delta is implemented
+     */
+    virtual bool supports_parity_delta() const = 0;
+
+    /**
+     * Compute in **delta** the difference between the
+     * **old_data** and **new_data** versions of a data chunk, to be
+     * given to **apply_delta**. Both must have the same length.
+     *
+     * @param [in] old_data data chunk before the change
+     * @param [in] new_data data chunk after the change
+     * @param [out] delta difference between old_data and new_data
+     */
+    virtual void encode_delta(const bufferlist &old_data,
+                              const bufferlist &new_data,
+                              bufferlist *delta) = 0;
+
+    /**
+     * Update **coding**, mapping coding chunk indexes to their
+     * content before the change, with the **deltas** of the data
+     * chunks that changed, as computed by **encode_delta**. After
+     * the call **coding** holds the same content **encode** would
+     * produce from the new data chunks. All buffers must have the
+     * same length and the same offset within their chunk.
+     *
+     * The buffers of **coding** are modified in place and must not
+     * be shared.
+     *
+     * Returns 0 on success.
+     *
+     * @param [in] deltas map data chunk indexes to their delta
+     * @param [in,out] coding map coding chunk indexes to chunk data
+     * @return **0** on success or a negative errno on error.
+     */
+    virtual int apply_delta(const std::map<int, bufferlist> &deltas,
+                            std::map<int, bufferlist> *coding) = 0;
+
     /**
      * Return the ordered list of chunks or an empty vector
      * if no remapping is necessary.
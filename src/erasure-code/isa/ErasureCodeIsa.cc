@@ -132,6 +132,56 @@ ErasureCodeIsaDefault::isa_encode(char **data,
 
 // -----------------------------------------------------------------------------
 
+int
+ErasureCodeIsaDefault::apply_delta(const map<int, bufferlist> &deltas,
+                                   map<int, bufferlist> *coding)
+{
+  if (m == 1) {
+    // isa_encode() uses a plain xor parity, whatever the matrix
+    if (coding->size() != 1 || coding->begin()->first != k)
+      return -EINVAL;
+    bufferlist &parity = coding->begin()->second;
+    for (auto &&[i, delta] : deltas) {
+      ceph_assert(i >= 0 && i < k);
+      ceph_assert(delta.length() == parity.length());
+      bufferlist d = delta;
+      unsigned char *src = (unsigned char*) d.c_str();
+      unsigned char *dst = (unsigned char*) parity.c_str();
+      unsigned vector_size = 0;
+      if (is_aligned(src, EC_ISA_VECTOR_OP_WORDSIZE) &&
+          is_aligned(dst, EC_ISA_VECTOR_OP_WORDSIZE)) {
+        vector_size = d.length() / EC_ISA_VECTOR_OP_WORDSIZE *
+          EC_ISA_VECTOR_OP_WORDSIZE;
+        vector_xor((vector_op_t*) src, (vector_op_t*) dst,
+                   (vector_op_t*) (src + vector_size));
+      }
+      byte_xor(src + vector_size, dst + vector_size, src + d.length());
+    }
+    return 0;
+  }
+
+  // ec_encode_data_update() updates every coding chunk at once
+  if (coding->size() != (unsigned) m)
+    return -EINVAL;
+  unsigned char *parity[m];
+  unsigned length = 0;
+  for (auto &&[j, chunk] : *coding) {
+    ceph_assert(j >= k && j < k + m);
+    parity[j - k] = (unsigned char*) chunk.c_str();
+    length = chunk.length();
+  }
+  for (auto &&[i, delta] : deltas) {
+    ceph_assert(i >= 0 && i < k);
+    ceph_assert(delta.length() == length);
+    bufferlist d = delta;
+    ec_encode_data_update(length, k, m, i, encode_tbls,
+                          (unsigned char*) d.c_str(), parity);
+  }
+  return 0;
+}
+
+// -----------------------------------------------------------------------------
+
 bool
 ErasureCodeIsaDefault::erasure_contains(int *erasures, int i)
 {
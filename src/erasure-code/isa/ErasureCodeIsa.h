@@ -96,6 +96,13 @@ public:
 
   virtual void prepare() = 0;
 
+ protected:
+  // ec_encode_data() and the xor paths are byte-wise
+  bool can_batch_stripes() const override
+  {
+    return true;
+  }
+
  private:
   virtual int parse(ceph::ErasureCodeProfile &profile,
                     std::ostream *ss) = 0;
@@ -145,6 +152,14 @@ public:
 
   void prepare() override;
 
+  bool supports_parity_delta() const override
+  {
+    return true;
+  }
+
+  int apply_delta(const std::map<int, ceph::buffer::list> &deltas,
+                  std::map<int, ceph::buffer::list> *coding) override;
+
  private:
   int parse(ceph::ErasureCodeProfile &profile,
             std::ostream *ss) override;
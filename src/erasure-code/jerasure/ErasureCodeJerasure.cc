@@ -137,6 +137,45 @@ int ErasureCodeJerasure::decode_chunks(const set<int> &want_to_read,
   return jerasure_decode(erasures, data, coding, blocksize);
 }
 
+int ErasureCodeJerasure::apply_delta(const map<int, bufferlist> &deltas,
+				     map<int, bufferlist> *coding)
+{
+  const int *matrix = get_coding_matrix();
+  if (!matrix)
+    return -EOPNOTSUPP;
+  for (auto &&[i, delta] : deltas) {
+    ceph_assert(i >= 0 && i < k);
+    bufferlist d = delta;
+    char *src = d.c_str();
+    for (auto &&[j, chunk] : *coding) {
+      ceph_assert(j >= k && j < k + m);
+      ceph_assert(chunk.length() == d.length());
+      int coefficient = matrix[(j - k) * k + i];
+      char *dst = chunk.c_str();
+      if (coefficient == 0)
+	continue;
+      if (coefficient == 1) {
+	galois_region_xor(src, dst, d.length());
+	continue;
+      }
+      switch (w) {
+      case 8:
+	galois_w08_region_multiply(src, coefficient, d.length(), dst, 1);
+	break;
+      case 16:
+	galois_w16_region_multiply(src, coefficient, d.length(), dst, 1);
+	break;
+      case 32:
+	galois_w32_region_multiply(src, coefficient, d.length(), dst, 1);
+	break;
+      default:
+	return -EOPNOTSUPP;
+      }
+    }
+  }
+  return 0;
+}
+
 bool ErasureCodeJerasure::is_prime(int value)
 {
   int prime55[] = {
@@ -63,6 +63,13 @@ public:
 		    const std::map<int, ceph::buffer::list> &chunks,
 		    std::map<int, ceph::buffer::list> *decoded) override;
 
+  bool supports_parity_delta() const override {
+    return get_coding_matrix() != nullptr;
+  }
+
+  int apply_delta(const std::map<int, ceph::buffer::list> &deltas,
+		  std::map<int, ceph::buffer::list> *coding) override;
+
   int init(ceph::ErasureCodeProfile &profile, std::ostream *ss) override;
 
   virtual void jerasure_encode(char **data,
@@ -77,6 +84,14 @@ public:
   static bool is_prime(int value);
 protected:
   virtual int parse(ceph::ErasureCodeProfile &profile, std::ostream *ss);
+  // every technique works on independent get_alignment() sized blocks
+  bool can_batch_stripes() const override {
+    return true;
+  }
+  /// m x k coding matrix over GF(2^w), nullptr for bitmatrix techniques
+  virtual const int *get_coding_matrix() const {
+    return nullptr;
+  }
 };
 class ErasureCodeJerasureReedSolomonVandermonde : public ErasureCodeJerasure {
 public:
@@ -104,6 +119,10 @@ public:
                                int blocksize) override;
   unsigned get_alignment() const override;
   void prepare() override;
+protected:
+  const int *get_coding_matrix() const override {
+    return matrix;
+  }
 private:
   int parse(ceph::ErasureCodeProfile& profile, std::ostream *ss) override;
 };
@@ -134,6 +153,10 @@ public:
                                int blocksize) override;
   unsigned get_alignment() const override;
   void prepare() override;
+protected:
+  const int *get_coding_matrix() const override {
+    return matrix;
+  }
 private:
   int parse(ceph::ErasureCodeProfile& profile, std::ostream *ss) override;
 };
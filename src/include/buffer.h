@@ -118,6 +118,9 @@ struct error_code;
   int get_missed_crc();
   /// enable/disable tracking of cached crcs
   void track_cached_crc(bool b);
+  /// free cached raw buffer memory left unused since the previous call;
+  /// returns the number of bytes given back to the heap
+  size_t trim_raw_cache();
 
   /*
    * an abstract raw buffer.  with a reference count.
@@ -372,6 +375,11 @@ struct error_code;
 
     ~ptr_node() = default;
 
+    // nodes come and go with every copy, share and substr_of of a list;
+    // these recycle them through a small per-thread cache
+    static void* operator new(size_t size);
+    static void operator delete(void *p);
+
     static std::unique_ptr<ptr_node, disposer>
     create(ceph::unique_leakable_ptr<raw> r) {
       return create_hypercombined(std::move(r));
@@ -35,6 +35,9 @@ inline namespace v15_2_0 {
   protected:
     char *data;
     unsigned len;
+    /// bytes allocated beyond len (size class rounding, headers), charged
+    /// to the mempool along with len
+    unsigned slack = 0;
   public:
     ceph::atomic<unsigned> nref { 0 };
     int mempool;
@@ -46,32 +49,39 @@ inline namespace v15_2_0 {
 
     explicit raw(unsigned l, int mempool=mempool::mempool_buffer_anon)
       : data(nullptr), len(l), nref(0), mempool(mempool) {
-      mempool::get_pool(mempool::pool_index_t(mempool)).adjust_count(1, len);
+      mempool::adjust_count_batched(mempool::pool_index_t(mempool), 1, len);
     }
     raw(char *c, unsigned l, int mempool=mempool::mempool_buffer_anon)
       : data(c), len(l), nref(0), mempool(mempool) {
-      mempool::get_pool(mempool::pool_index_t(mempool)).adjust_count(1, len);
+      mempool::adjust_count_batched(mempool::pool_index_t(mempool), 1, len);
     }
     virtual ~raw() {
-      mempool::get_pool(mempool::pool_index_t(mempool)).adjust_count(
-	-1, -(int)len);
+      mempool::adjust_count_batched(mempool::pool_index_t(mempool),
+	-1, -(ssize_t)(len + slack));
     }
 
     void _set_len(unsigned l) {
-      mempool::get_pool(mempool::pool_index_t(mempool)).adjust_count(
+      mempool::adjust_count_batched(mempool::pool_index_t(mempool),
 	-1, -(int)len);
       len = l;
-      mempool::get_pool(mempool::pool_index_t(mempool)).adjust_count(1, len);
+      mempool::adjust_count_batched(mempool::pool_index_t(mempool), 1, len);
+    }
+
+    void _set_slack(unsigned s) {
+      mempool::adjust_count_batched(mempool::pool_index_t(mempool),
+	0, (ssize_t)s - (ssize_t)slack);
+      slack = s;
     }
 
     void reassign_to_mempool(int pool) {
       if (pool == mempool) {
 	return;
       }
-      mempool::get_pool(mempool::pool_index_t(mempool)).adjust_count(
-	-1, -(int)len);
+      mempool::adjust_count_batched(mempool::pool_index_t(mempool),
+	-1, -(ssize_t)(len + slack));
       mempool = pool;
-      mempool::get_pool(mempool::pool_index_t(pool)).adjust_count(1, len);
+      mempool::adjust_count_batched(mempool::pool_index_t(pool),
+	1, len + slack);
     }
 
     void try_assign_to_mempool(int pool) {
@@ -237,6 +237,14 @@ struct stats_t {
 pool_t& get_pool(pool_index_t ix);
 const char *get_pool_name(pool_index_t ix);
 
+// Account for objects that come and go at a high rate (raw buffers).
+// The update is kept in a per-thread buffer until the net change for
+// the pool has drifted far enough to matter, sparing the shared
+// counters.  A thread's buffer is flushed when it exits and whenever it
+// reads pool stats, so its own updates are always visible to it.
+void adjust_count_batched(pool_index_t ix, ssize_t items, ssize_t bytes);
+void flush_batched_counts();
+
 struct type_t {
   const char *type_name;
   size_t item_size;
@@ -40,6 +40,8 @@ public:
   time m_stamp;
   pthread_t m_thread;
   short m_prio, m_subsys;
+  /// submission order within the thread, set by Log::submit_entry()
+  uint32_t m_seq = 0;
 
   static log_clock& clock() {
     static log_clock clock;
@@ -27,6 +27,8 @@
 
 #include <algorithm>
 #include <iostream>
+#include <numeric>
+#include <optional>
 #include <set>
 
 #include <fmt/format.h>
@@ -38,6 +40,50 @@ namespace logging {
 
 static OnExitManager exit_callbacks;
 
+static std::atomic<uint64_t> next_log_id = { 0 };
+
+/**
+ * single producer, single consumer ring of entries
+ *
+ * The producer is the thread owning the ring, the consumer whoever holds
+ * m_flush_mutex.  The ring is shared between the Log and a thread local
+ * cache in its thread, and outlives whichever of the two goes first.
+ */
+struct Log::ThreadRing {
+  static constexpr std::size_t SIZE = 32;
+
+  std::atomic<std::size_t> head = { 0 };  ///< next slot to drain
+  std::atomic<std::size_t> tail = { 0 };  ///< next slot to fill
+  std::atomic<bool> thread_exited = { false };
+  std::atomic<bool> log_gone = { false };
+  uint32_t next_seq = 0;  ///< for the producer's entries, ring or not
+  std::array<std::optional<ConcreteEntry>, SIZE> slots;
+
+  bool push(Entry&& e) {
+    auto t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) == SIZE) {
+      return false;
+    }
+    slots[t % SIZE].emplace(std::move(e));
+    // seq_cst, to be ordered before the load of m_flusher_waiting
+    tail.store(t + 1);
+    return true;
+  }
+  bool empty() const {
+    return head.load(std::memory_order_relaxed) == tail.load();
+  }
+  void drain(EntryVector& q) {
+    auto h = head.load(std::memory_order_relaxed);
+    auto t = tail.load(std::memory_order_acquire);
+    for (; h != t; ++h) {
+      auto& slot = slots[h % SIZE];
+      q.emplace_back(std::move(*slot));
+      slot.reset();
+    }
+    head.store(h, std::memory_order_release);
+  }
+};
+
 static void log_on_exit(void *p)
 {
   Log *l = *(Log **)p;
@@ -48,6 +94,7 @@ static void log_on_exit(void *p)
 
 Log::Log(const SubsystemMap *s)
   : m_indirect_this(nullptr),
+    m_id(next_log_id++),
     m_subs(s),
     m_recent(DEFAULT_MAX_RECENT)
 {
@@ -62,6 +109,9 @@ Log::~Log()
   }
 
   ceph_assert(!is_started());
+  for (auto& r : m_rings) {
+    r->log_gone = true;
+  }
   if (m_fd >= 0) {
     VOID_TEMP_FAILURE_RETRY(::close(m_fd));
     m_fd = -1;
@@ -246,14 +296,162 @@ void Log::stop_journald_logger()
   m_journald.reset();
 }
 
-void Log::submit_entry(Entry&& e)
+Log::ThreadRing *Log::_get_thread_ring()
 {
-  std::unique_lock lock(m_queue_mutex);
-  m_queue_mutex_holder = pthread_self();
+  struct cache_t {
+    std::vector<std::pair<uint64_t, ThreadRingRef>> rings;
+    ~cache_t() {
+      for (auto& r : rings) {
+	r.second->thread_exited = true;
+      }
+    }
+  };
+  static thread_local cache_t cache;
+  for (auto& [id, r] : cache.rings) {
+    if (id == m_id) {
+      return r.get();
+    }
+  }
+  // first entry from this thread
+  cache.rings.erase(
+    std::remove_if(cache.rings.begin(), cache.rings.end(),
+		   [](auto& r) { return r.second->log_gone.load(); }),
+    cache.rings.end());
+  auto r = std::make_shared<ThreadRing>();
+  {
+    std::scoped_lock lock(m_rings_mutex);
+    m_rings.push_back(r);
+  }
+  cache.rings.emplace_back(m_id, r);
+  return r.get();
+}
+
+bool Log::_rings_pending()
+{
+  std::scoped_lock lock(m_rings_mutex);
+  for (auto& r : m_rings) {
+    if (!r->empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void Log::_collect(EntryVector& q)
+{
+  ceph_assert(q.empty());
+  unsigned sources = 0;
+  {
+    // Hold off spills into m_new until the rings are drained: otherwise a
+    // thread could refill its ring and spill an entry that gets flushed
+    // ahead of the older ones left in its ring.
+    std::scoped_lock lock(m_queue_mutex, m_rings_mutex);
+    m_queue_mutex_holder = pthread_self();
+    for (auto i = m_rings.begin(); i != m_rings.end(); ) {
+      // nothing is added to the ring once its thread is gone
+      bool exited = (*i)->thread_exited;
+      auto n = q.size();
+      (*i)->drain(q);
+      if (q.size() > n) {
+	++sources;
+      }
+      if (exited) {
+	i = m_rings.erase(i);
+      } else {
+	++i;
+      }
+    }
+    if (!m_new.empty()) {
+      ++sources;
+      if (q.empty()) {
+	q.swap(m_new);
+      } else {
+	q.insert(q.end(), std::make_move_iterator(m_new.begin()),
+		 std::make_move_iterator(m_new.end()));
+	m_new.clear();
+      }
+    }
+    m_cond_loggers.notify_all();
+    m_queue_mutex_holder = 0;
+  }
+
+  if (sources > 1) {
+    _merge(q);
+  }
+}
+
+void Log::_merge(EntryVector& q)
+{
+  // Put each thread's entries in submission order: a thread's entries may
+  // be split between its ring and m_new, and coarse timestamps tie.  The
+  // seq wraps around, but one flush only sees a short run of it.
+  std::vector<uint32_t> order(q.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&q](auto a, auto b) {
+    if (q[a].m_thread != q[b].m_thread) {
+      return std::less<pthread_t>{}(q[a].m_thread, q[b].m_thread);
+    }
+    return static_cast<int32_t>(q[a].m_seq - q[b].m_seq) < 0;
+  });
+
+  // then merge the threads by timestamp
+  struct run_t {
+    std::size_t pos, end;
+  };
+  std::vector<run_t> runs;
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    if (i == 0 || q[order[i]].m_thread != q[order[i - 1]].m_thread) {
+      if (!runs.empty()) {
+	runs.back().end = i;
+      }
+      runs.push_back({i, 0});
+    }
+  }
+  runs.back().end = order.size();
+  auto later = [&](std::size_t a, std::size_t b) {
+    auto& ea = q[order[runs[a].pos]];
+    auto& eb = q[order[runs[b].pos]];
+    if (ea.m_stamp != eb.m_stamp) {
+      return eb.m_stamp < ea.m_stamp;
+    }
+    return b < a;
+  };
+  std::vector<std::size_t> heap(runs.size());
+  std::iota(heap.begin(), heap.end(), 0);
+  std::make_heap(heap.begin(), heap.end(), later);
+  EntryVector sorted;
+  sorted.reserve(q.size());
+  while (!heap.empty()) {
+    std::pop_heap(heap.begin(), heap.end(), later);
+    auto r = heap.back();
+    sorted.emplace_back(std::move(q[order[runs[r].pos]]));
+    if (++runs[r].pos == runs[r].end) {
+      heap.pop_back();
+    } else {
+      std::push_heap(heap.begin(), heap.end(), later);
+    }
+  }
+  q.swap(sorted);
+}
 
+void Log::submit_entry(Entry&& e)
+{
   if (unlikely(m_inject_segv))
     *(volatile int *)(0) = 0xdead;
 
+  auto ring = _get_thread_ring();
+  e.m_seq = ring->next_seq++;
+  if (likely(ring->push(std::move(e)))) {
+    if (m_flusher_waiting.load()) {
+      std::scoped_lock lock(m_queue_mutex);
+      m_cond_flusher.notify_all();
+    }
+    return;
+  }
+
+  std::unique_lock lock(m_queue_mutex);
+  m_queue_mutex_holder = pthread_self();
+
   // wait for flush to catch up
   while (is_started() &&
 	 m_new.size() > m_max_new) {
@@ -271,15 +469,7 @@ void Log::flush()
   std::scoped_lock lock1(m_flush_mutex);
   m_flush_mutex_holder = pthread_self();
 
-  {
-    std::scoped_lock lock2(m_queue_mutex);
-    m_queue_mutex_holder = pthread_self();
-    assert(m_flush.empty());
-    m_flush.swap(m_new);
-    m_cond_loggers.notify_all();
-    m_queue_mutex_holder = 0;
-  }
-
+  _collect(m_flush);
   _flush(m_flush, false);
   m_flush_mutex_holder = 0;
 }
@@ -481,14 +671,7 @@ void Log::dump_recent()
   std::scoped_lock lock1(m_flush_mutex);
   m_flush_mutex_holder = pthread_self();
 
-  {
-    std::scoped_lock lock2(m_queue_mutex);
-    m_queue_mutex_holder = pthread_self();
-    assert(m_flush.empty());
-    m_flush.swap(m_new);
-    m_queue_mutex_holder = 0;
-  }
-
+  _collect(m_flush);
   _flush(m_flush, false);
 
   _log_message("--- begin dump of recent events ---", true);
@@ -565,7 +748,10 @@ void *Log::entry()
     std::unique_lock lock(m_queue_mutex);
     m_queue_mutex_holder = pthread_self();
     while (!m_stop) {
-      if (!m_new.empty()) {
+      // seq_cst, to be ordered before the loads of the ring tails
+      m_flusher_waiting = true;
+      if (!m_new.empty() || _rings_pending()) {
+        m_flusher_waiting = false;
         m_queue_mutex_holder = 0;
         lock.unlock();
         flush();
@@ -576,6 +762,7 @@ void *Log::entry()
 
       m_cond_flusher.wait(lock);
     }
+    m_flusher_waiting = false;
     m_queue_mutex_holder = 0;
   }
   flush();
@@ -6,6 +6,7 @@
 
 #include <boost/circular_buffer.hpp>
 
+#include <atomic>
 #include <condition_variable>
 #include <memory>
 #include <mutex>
@@ -29,6 +30,17 @@ class Graylog;
 class JournaldLogger;
 class SubsystemMap;
 
+/**
+ * Log
+ *
+ * Each thread submits its entries to a small ring of its own, which the
+ * flusher thread drains, so a dout that passes its gather level costs a
+ * copy into memory only the submitting thread writes to.  When a thread's
+ * ring is full, its entries spill into the shared m_new queue under
+ * m_queue_mutex, which is also where loggers wait for the flusher to
+ * catch up.  Every flush keeps each thread's entries in the order they
+ * were submitted and merges the threads by timestamp.
+ */
 class Log : private Thread
 {
 public:
@@ -82,12 +94,17 @@ public:
 private:
   using EntryRing = boost::circular_buffer<ConcreteEntry>;
   using EntryVector = std::vector<ConcreteEntry>;
+  struct ThreadRing;
+  using ThreadRingRef = std::shared_ptr<ThreadRing>;
 
   static const std::size_t DEFAULT_MAX_NEW = 100;
   static const std::size_t DEFAULT_MAX_RECENT = 10000;
 
   Log **m_indirect_this;
 
+  /// tells the per-thread ring caches apart from those of other Logs
+  const uint64_t m_id;
+
   const SubsystemMap *m_subs;
 
   std::mutex m_queue_mutex;
@@ -98,7 +115,12 @@ private:
   pthread_t m_queue_mutex_holder;
   pthread_t m_flush_mutex_holder;
 
-  EntryVector m_new;    ///< new entries
+  std::mutex m_rings_mutex;
+  std::vector<ThreadRingRef> m_rings;  ///< one per submitting thread
+  /// the flusher is (about to be) waiting on m_cond_flusher
+  std::atomic<bool> m_flusher_waiting = false;
+
+  EntryVector m_new;    ///< new entries that did not fit in a thread ring
   EntryRing m_recent; ///< recent (less new) entries we've already written at low detail
   EntryVector m_flush; ///< entries to be flushed (here to optimize heap allocations)
 
@@ -132,6 +154,11 @@ private:
 
   void *entry() override;
 
+  ThreadRing *_get_thread_ring();
+  bool _rings_pending();
+  void _collect(EntryVector& q);
+  void _merge(EntryVector& q);
+
   void _log_safe_write(std::string_view sv);
   void _flush_logbuf();
   void _flush(EntryVector& q, bool crash);
@@ -14,6 +14,9 @@
 
 #include <limits.h>
 
+#include <fstream>
+#include <thread>
+
 using namespace std;
 using namespace ceph::logging;
 
@@ -335,6 +338,63 @@ TEST(Log, LargeLog)
   log.stop();
 }
 
+static void many_threads(bool coarse)
+{
+  SubsystemMap subs;
+  subs.set_log_level(1, 20);
+  subs.set_gather_level(1, 10);
+  Log log(&subs);
+  log.set_coarse_timestamps(coarse);
+  log.start();
+  ::unlink("threads");
+  log.set_log_file("threads");
+  log.reopen_log_file();
+  constexpr int threads = 8;
+  constexpr int entries = 2000;  // plenty to overflow the thread rings
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&log, t] {
+      for (int i = 0; i < entries; i++) {
+	MutableEntry e(10, 1);
+	e.get_ostream() << "thread " << t << " entry " << i;
+	log.submit_entry(std::move(e));
+      }
+    });
+  }
+  for (auto& w : workers) {
+    w.join();
+  }
+  log.flush();
+  log.stop();
+
+  // every entry made it, and each thread's entries are in order
+  std::ifstream in("threads");
+  std::vector<int> next(threads, 0);
+  std::string line;
+  while (std::getline(in, line)) {
+    auto p = line.find(" thread ");
+    ASSERT_NE(std::string::npos, p);
+    int t, i;
+    ASSERT_EQ(2, sscanf(line.c_str() + p, " thread %d entry %d", &t, &i));
+    ASSERT_EQ(next[t], i);
+    next[t]++;
+  }
+  for (int t = 0; t < threads; t++) {
+    ASSERT_EQ(entries, next[t]);
+  }
+}
+
+TEST(Log, ManyThreads)
+{
+  many_threads(false);
+}
+
+TEST(Log, ManyThreadsCoarse)
+{
+  // coarse stamps tie within a thread; its entries must still keep order
+  many_threads(true);
+}
+
 TEST(Log, LargeFromSmallLog)
 {
   SubsystemMap subs;
@@ -510,8 +510,8 @@ void MDRequestImpl::_dump(Formatter *f, bool has_mds_lock) const
 
   {
     f->open_array_section("events");
-    for (auto& i : events) {
-      f->dump_object("event", i);
+    for (size_t i = 0; i < events.size(); ++i) {
+      f->dump_object("event", events[i]);
     }
     f->close_section(); // events
   }
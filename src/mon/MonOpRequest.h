@@ -105,17 +105,15 @@ private:
     {
       f->open_array_section("events");
       std::lock_guard l(lock);
-    for (auto i = events.begin(); i != events.end(); ++i) {
+    for (size_t i = 0; i < events.size(); ++i) {
       f->open_object_section("event");
-      f->dump_string("event", i->str);
-      f->dump_stream("time") << i->stamp;
+      f->dump_string("event", events[i].str);
+      f->dump_stream("time") << events[i].stamp;
 
-      auto i_next = i + 1;
-
-      if (i_next < events.end()) {
-	f->dump_float("duration", i_next->stamp - i->stamp);
+      if (i + 1 < events.size()) {
+	f->dump_float("duration", events[i + 1].stamp - events[i].stamp);
       } else {
-	f->dump_float("duration", events.rbegin()->stamp - get_initiated());
+	f->dump_float("duration", events.back().stamp - get_initiated());
       }
 
       f->close_section();
@@ -790,6 +790,7 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
     dout(7) << __func__ << " loading latest full map e" << latest_full << dendl;
     osdmap = OSDMap();
     osdmap.decode(latest_bl);
+    mapping_changes.clear();
   }
 
   bufferlist bl;
@@ -887,6 +888,12 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
     }
     put_version_latest_full(t, osdmap.epoch);
 
+    if (osdmap.get_mapping_changes().all) {
+      // everything gets remapped anyway
+      mapping_changes.clear();
+    }
+    mapping_changes[osdmap.epoch] = osdmap.get_mapping_changes();
+
     // share
     dout(1) << osdmap << dendl;
 
@@ -1067,15 +1074,34 @@ void OSDMonitor::start_mapping()
     mapping_job->abort();
   }
   if (!osdmap.get_pools().empty()) {
+    // a canceled job leaves the mapping at its old epoch, so keep every
+    // epoch's changes until a job covering them completes
+    mapping_changes.erase(mapping_changes.begin(),
+			  mapping_changes.upper_bound(mapping.get_epoch()));
+    pg_mapping_changes_t changes;
+    if (!g_conf()->mon_osd_incremental_mapping ||
+	mapping_changes.size() != osdmap.get_epoch() - mapping.get_epoch() ||
+	(!mapping_changes.empty() &&
+	 mapping_changes.rbegin()->first != osdmap.get_epoch())) {
+      changes.mark_all();
+    } else {
+      for (auto& [epoch, c] : mapping_changes) {
+	changes.merge(c);
+      }
+    }
+    dout(10) << __func__ << " e" << mapping.get_epoch() << " -> e"
+	     << osdmap.get_epoch() << " remapping " << changes << dendl;
     auto fin = new C_UpdateCreatingPGs(this, osdmap.get_epoch());
     mapping_job = mapping.start_update(osdmap, mapper,
-				       g_conf()->mon_osd_mapping_pgs_per_chunk);
+				       g_conf()->mon_osd_mapping_pgs_per_chunk,
+				       changes);
     dout(10) << __func__ << " started mapping job " << mapping_job.get()
 	     << " at " << fin->start << dendl;
     mapping_job->set_finish_event(fin);
   } else {
     dout(10) << __func__ << " no pools, no mapping job" << dendl;
     mapping_job = nullptr;
+    mapping_changes.clear();
   }
 }
 
@@ -1609,15 +1635,27 @@ void OSDMonitor::encode_pending(MonitorDBStore::TransactionRef t)
 
     // clean inappropriate pg_upmap/pg_upmap_items (if any)
     {
-      // check every upmapped pg for now
-      // until we could reliably identify certain cases to ignore,
-      // which is obviously the hard part TBD..
+      // an upmap that was valid in the committed map stays valid unless
+      // its pool, crush or one of the osds it involves changed
       vector<pg_t> pgs_to_check;
       tmp.get_upmap_pgs(&pgs_to_check);
+      if (g_conf()->mon_osd_incremental_mapping) {
+	auto& changes = tmp.get_mapping_changes();
+	pgs_to_check.erase(
+	  std::remove_if(pgs_to_check.begin(), pgs_to_check.end(),
+			 [&](pg_t pgid) {
+			   return tmp.have_pg_pool(pgid.pool()) &&
+			     !changes.contains(pgid);
+			 }),
+	  pgs_to_check.end());
+      }
       if (pgs_to_check.size() <
 	  static_cast<uint64_t>(g_conf()->mon_clean_pg_upmaps_per_chunk * 2)) {
         // not enough pgs, do it inline
-        tmp.clean_pg_upmaps(cct, &pending_inc);
+        vector<pg_t> to_cancel;
+        map<pg_t, mempool::osdmap::vector<pair<int,int>>> to_remap;
+        tmp.check_pg_upmaps(cct, pgs_to_check, &to_cancel, &to_remap);
+        tmp.clean_pg_upmaps(cct, &pending_inc, to_cancel, to_remap);
       } else {
         CleanUpmapJob job(cct, tmp, pending_inc);
         mapper.queue(&job, g_conf()->mon_clean_pg_upmaps_per_chunk, pgs_to_check);
@@ -5450,7 +5488,7 @@ namespace {
     CSUM_TYPE, CSUM_MAX_BLOCK, CSUM_MIN_BLOCK, FINGERPRINT_ALGORITHM,
     PG_AUTOSCALE_MODE, PG_NUM_MIN, TARGET_SIZE_BYTES, TARGET_SIZE_RATIO,
     PG_AUTOSCALE_BIAS, DEDUP_TIER, DEDUP_CHUNK_ALGORITHM, 
-    DEDUP_CDC_CHUNK_SIZE, POOL_EIO, BULK, PG_NUM_MAX };
+    DEDUP_CDC_CHUNK_SIZE, POOL_EIO, BULK, PG_NUM_MAX, REPLICA_READS };
 
   std::set<osd_pool_get_choices>
     subtract_second_from_first(const std::set<osd_pool_get_choices>& first,
@@ -6210,7 +6248,8 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
       {"dedup_tier", DEDUP_TIER},
       {"dedup_chunk_algorithm", DEDUP_CHUNK_ALGORITHM},
       {"dedup_cdc_chunk_size", DEDUP_CDC_CHUNK_SIZE},
-      {"bulk", BULK}
+      {"bulk", BULK},
+      {"replica_reads", REPLICA_READS}
     };
 
     typedef std::set<osd_pool_get_choices> choices_set_t;
@@ -6329,6 +6368,7 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
 	  case POOL_EIO:
 	  case NODELETE:
 	  case BULK:
+	  case REPLICA_READS:
 	  case NOPGCHANGE:
 	  case NOSIZECHANGE:
 	  case WRITE_FADVISE_DONTNEED:
@@ -6559,6 +6599,7 @@ bool OSDMonitor::preprocess_command(MonOpRequestRef op)
 	  case POOL_EIO:
 	  case NODELETE:
 	  case BULK:
+	  case REPLICA_READS:
 	  case NOPGCHANGE:
 	  case NOSIZECHANGE:
 	  case WRITE_FADVISE_DONTNEED:
@@ -8617,6 +8658,25 @@ int OSDMonitor::prepare_command_pool_set(const cmdmap_t& cmdmap,
       ss << "expecting value 'true', 'false', '0', or '1'";
       return -EINVAL;
     }
+  } else if (var == "replica_reads") {
+    uint64_t flag = pg_pool_t::get_flag_by_name(var);
+    if (val == "true" || (interr.empty() && n == 1)) {
+      if (!p.is_replicated()) {
+	ss << "replica reads are only supported on replicated pools";
+	return -EINVAL;
+      }
+      if (osdmap.require_osd_release < ceph_release_t::octopus) {
+	// octopus osds are the first to hold read leases
+	ss << "replica reads require require_osd_release >= octopus";
+	return -EPERM;
+      }
+      p.set_flag(flag);
+    } else if (val == "false" || (interr.empty() && n == 0)) {
+      p.unset_flag(flag);
+    } else {
+      ss << "expecting value 'true', 'false', '0', or '1'";
+      return -EINVAL;
+    }
   } else if (var == "eio") {
     uint64_t flag = pg_pool_t::get_flag_by_name(var);
 
@@ -8660,6 +8720,11 @@ int OSDMonitor::prepare_command_pool_set(const cmdmap_t& cmdmap,
 	BloomHitSet::Params *bsp = new BloomHitSet::Params;
 	bsp->set_fpp(g_conf().get_val<double>("osd_pool_default_hit_set_bloom_fpp"));
 	p.hit_set_params = HitSet::Params(bsp);
+      } else if (val == "cuckoo") {
+	err = check_cluster_features(CEPH_FEATUREMASK_OSD_HITSET_CUCKOO, ss);
+	if (err)
+	  return err;
+	p.hit_set_params = HitSet::Params(new CuckooHitSet::Params);
       } else if (val == "explicit_hash")
 	p.hit_set_params = HitSet::Params(new ExplicitHashHitSet::Params);
       else if (val == "explicit_object")
@@ -13788,6 +13853,11 @@ bool OSDMonitor::prepare_command_impl(MonOpRequestRef op,
       BloomHitSet::Params *bsp = new BloomHitSet::Params;
       bsp->set_fpp(g_conf().get_val<double>("osd_pool_default_hit_set_bloom_fpp"));
       hsp = HitSet::Params(bsp);
+    } else if (cache_hit_set_type == "cuckoo") {
+      err = check_cluster_features(CEPH_FEATUREMASK_OSD_HITSET_CUCKOO, ss);
+      if (err)
+	goto reply;
+      hsp = HitSet::Params(new CuckooHitSet::Params);
     } else if (cache_hit_set_type == "explicit_hash") {
       hsp = HitSet::Params(new ExplicitHashHitSet::Params);
     } else if (cache_hit_set_type == "explicit_object") {
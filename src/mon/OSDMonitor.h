@@ -390,6 +390,8 @@ private:
   ParallelPGMapper mapper;                        ///< for background pg work
   OSDMapMapping mapping;                          ///< pg <-> osd mappings
   std::unique_ptr<ParallelPGMapper::Job> mapping_job;  ///< background mapping job
+  /// per-epoch mapping changes not yet covered by a completed mapping job
+  std::map<epoch_t, pg_mapping_changes_t> mapping_changes;
   void start_mapping();
 
   void update_logger();
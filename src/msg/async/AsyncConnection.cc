@@ -364,6 +364,11 @@ void AsyncConnection::inject_delay() {
 
 void AsyncConnection::process() {
   std::lock_guard<std::mutex> l(lock);
+  if (unlikely(!center->in_thread())) {
+    // queued on our previous worker before we migrated
+    center->dispatch_event_external(read_handler);
+    return;
+  }
   last_active = ceph::coarse_mono_clock::now();
   recv_start_time = ceph::mono_clock::now();
 
@@ -704,11 +709,22 @@ void AsyncConnection::mark_down()
 void AsyncConnection::handle_write()
 {
   ldout(async_msgr->cct, 10) << __func__ << dendl;
+  if (unlikely(migrated.load(std::memory_order_acquire))) {
+    std::lock_guard<std::mutex> l(write_lock);
+    if (!center->in_thread()) {
+      center->dispatch_event_external(write_handler);
+      return;
+    }
+  }
   protocol->write_event();
 }
 
 void AsyncConnection::handle_write_callback() {
   std::lock_guard<std::mutex> l(lock);
+  if (unlikely(!center->in_thread())) {
+    center->dispatch_event_external(write_callback_handler);
+    return;
+  }
   last_active = ceph::coarse_mono_clock::now();
   recv_start_time = ceph::mono_clock::now();
   write_lock.lock();
@@ -751,6 +767,75 @@ void AsyncConnection::wakeup_from(uint64_t id)
   process();
 }
 
+void AsyncConnection::request_migration(Worker *target)
+{
+  std::lock_guard<std::mutex> l(lock);
+  if (!async_msgr->get_stack()->support_migration() ||
+      migrating || target == worker || state != STATE_CONNECTION_ESTABLISHED) {
+    return;
+  }
+  migrating = true;
+  center->submit_to(center->get_id(),
+		    [this, target, conn=AsyncConnectionRef(this)] () mutable {
+		      migrate(target);
+		    }, true);
+}
+
+void AsyncConnection::migrate(Worker *target)
+{
+  std::lock_guard<std::mutex> l(lock);
+  ceph_assert(center->in_thread());
+  std::lock_guard<std::mutex> wl(write_lock);
+  // pending wakeups and delayed deliveries are bound to this center's timers
+  if (state != STATE_CONNECTION_ESTABLISHED || !protocol->is_connected() ||
+      !register_time_events.empty() || delay_state || writeCallback) {
+    ldout(async_msgr->cct, 10) << __func__ << " not migratable now" << dendl;
+    migrating = false;
+    return;
+  }
+  ldout(async_msgr->cct, 5) << __func__ << " from worker " << worker->id
+			    << " to worker " << target->id << dendl;
+  center->delete_file_event(cs.fd(), EVENT_READABLE | EVENT_WRITABLE);
+  open_write = false;
+  if (last_tick_id) {
+    center->delete_time_event(last_tick_id);
+    last_tick_id = 0;
+  }
+  worker->release_worker();
+  ++target->references;
+  worker = target;
+  center = &target->center;
+  logger = target->get_perf_counter();
+  migrated.store(true, std::memory_order_release);
+  center->submit_to(center->get_id(),
+		    [this, conn=AsyncConnectionRef(this)] () mutable {
+		      finish_migration();
+		    }, true);
+}
+
+void AsyncConnection::finish_migration()
+{
+  std::lock_guard<std::mutex> l(lock);
+  ceph_assert(center->in_thread());
+  migrating = false;
+  // faulted or closed meanwhile; whoever did that set up (or tore down)
+  // the events on this center already
+  if (state != STATE_CONNECTION_ESTABLISHED || !protocol->is_connected()) {
+    return;
+  }
+  if (!last_tick_id) {
+    last_tick_id = center->create_time_event(inactive_timeout_us, tick_handler);
+  }
+  center->create_file_event(cs.fd(), EVENT_READABLE, read_handler);
+  // pick up anything that arrived while no center was watching the socket
+  center->dispatch_event_external(read_handler);
+  std::lock_guard<std::mutex> wl(write_lock);
+  if (is_queued() && !open_write) {
+    center->create_file_event(cs.fd(), EVENT_WRITABLE, write_handler);
+    open_write = true;
+  }
+}
+
 void AsyncConnection::tick(uint64_t id)
 {
   auto now = ceph::coarse_mono_clock::now();
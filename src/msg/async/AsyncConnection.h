@@ -219,6 +219,12 @@ private:
   Worker *worker;
   EventCenter *center;
 
+  // worker migration (see AsyncMessenger::rebalance_workers)
+  bool migrating = false;       ///< protected by lock
+  std::atomic<bool> migrated = false;
+  void migrate(Worker *target);
+  void finish_migration();
+
   std::unique_ptr<Protocol> protocol;
 
   std::optional<std::function<void(ssize_t)>> writeCallback;
@@ -239,11 +245,34 @@ private:
     return logger;
   }
 
+  /// bytes sent and received, only updated from the connection's thread
+  std::atomic<uint64_t> traffic_bytes = 0;
+  void account_traffic(uint64_t bytes) {
+    traffic_bytes.store(traffic_bytes.load(std::memory_order_relaxed) + bytes,
+			std::memory_order_relaxed);
+  }
+  // used by the messenger's rebalancer only
+  uint64_t rebalance_last_bytes = 0;
+  uint64_t rebalance_bps = 0;
+
+  Worker *get_worker() {
+    std::lock_guard<std::mutex> l(lock);
+    return worker;
+  }
+  /**
+   * Move this connection's socket and timers to another worker.
+   *
+   * Asynchronous; silently ignored if the stack can't migrate sockets, the
+   * connection isn't established or a migration is already in flight.
+   */
+  void request_migration(Worker *target);
+
   bool is_msgr2() const override;
 
   friend class Protocol;
   friend class ProtocolV1;
   friend class ProtocolV2;
+  friend class MessengerTest;
 }; /* AsyncConnection */
 
 using AsyncConnectionRef = ceph::ref_t<AsyncConnection>;
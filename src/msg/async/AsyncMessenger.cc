@@ -273,6 +273,16 @@ class C_handle_reap : public EventCallback {
   }
 };
 
+class C_handle_rebalance : public EventCallback {
+  AsyncMessenger *msgr;
+
+  public:
+  explicit C_handle_rebalance(AsyncMessenger *m): msgr(m) {}
+  void do_request(uint64_t id) override {
+    msgr->rebalance_workers();
+  }
+};
+
 /*******************
  * AsyncMessenger
  */
@@ -299,6 +309,7 @@ AsyncMessenger::AsyncMessenger(CephContext *cct, entity_name_t name,
 					 local_worker, true, true);
   init_local_connection();
   reap_handler = new C_handle_reap(this);
+  rebalance_handler = new C_handle_rebalance(this);
   unsigned processor_num = 1;
   if (stack->support_local_listen_table())
     processor_num = stack->get_num_worker();
@@ -313,6 +324,7 @@ AsyncMessenger::AsyncMessenger(CephContext *cct, entity_name_t name,
 AsyncMessenger::~AsyncMessenger()
 {
   delete reap_handler;
+  delete rebalance_handler;
   ceph_assert(!did_bind); // either we didn't bind or we shut down the Processor
   for (auto &&p : processors)
     delete p;
@@ -335,6 +347,12 @@ void AsyncMessenger::ready()
   for (auto &&p : processors)
     p->start();
   dispatch_queue.start();
+  if (cct->_conf->ms_async_worker_balance == "load" &&
+      cct->_conf->ms_async_rebalance_interval > 0 &&
+      stack->support_migration()) {
+    local_worker->center.submit_to(
+      local_worker->center.get_id(), [this] { schedule_rebalance(); }, true);
+  }
 }
 
 int AsyncMessenger::shutdown()
@@ -342,6 +360,12 @@ int AsyncMessenger::shutdown()
   ldout(cct,10) << __func__ << " " << get_myaddrs() << dendl;
 
   // done!  clean up.
+  local_worker->center.submit_to(local_worker->center.get_id(), [this] {
+    if (rebalance_event_id) {
+      local_worker->center.delete_time_event(rebalance_event_id);
+      rebalance_event_id = 0;
+    }
+  }, false);
   for (auto &&p : processors)
     p->stop();
   mark_down_all();
@@ -961,3 +985,64 @@ void AsyncMessenger::reap_dead()
     deleted_conns.clear();
   }
 }
+
+void AsyncMessenger::schedule_rebalance()
+{
+  ceph_assert(local_worker->center.in_thread());
+  double interval = cct->_conf->ms_async_rebalance_interval;
+  rebalance_event_id = local_worker->center.create_time_event(
+    interval * 1000000, rebalance_handler);
+}
+
+void AsyncMessenger::rebalance_workers()
+{
+  rebalance_event_id = 0;
+  const auto& conf = cct->_conf;
+  const double interval = conf->ms_async_rebalance_interval;
+  if (interval <= 0 || conf->ms_async_worker_balance != "load" ||
+      !stack->support_migration()) {
+    return;
+  }
+
+  auto [coldest, hottest] = stack->get_load_extremes();
+  if (coldest && hottest && coldest != hottest &&
+      hottest->load_bps > conf->ms_async_rebalance_threshold *
+                          std::max<uint64_t>(coldest->load_bps, 1)) {
+    ++imbalanced_rounds;
+  } else {
+    imbalanced_rounds = 0;
+  }
+
+  AsyncConnectionRef victim;
+  {
+    std::lock_guard l{lock};
+    // move the connection whose traffic best halves the gap
+    const uint64_t wanted = imbalanced_rounds >= conf->ms_async_rebalance_rounds ?
+      (hottest->load_bps - coldest->load_bps) / 2 : 0;
+    uint64_t best_diff = std::numeric_limits<uint64_t>::max();
+    for (auto& [addrs, c] : conns) {
+      uint64_t bytes = c->traffic_bytes.load(std::memory_order_relaxed);
+      c->rebalance_bps = (bytes - c->rebalance_last_bytes) / interval;
+      c->rebalance_last_bytes = bytes;
+      if (!wanted || !c->rebalance_bps || c->get_worker() != hottest) {
+        continue;
+      }
+      uint64_t diff = c->rebalance_bps > wanted ?
+        c->rebalance_bps - wanted : wanted - c->rebalance_bps;
+      if (c->rebalance_bps < 2 * wanted && diff < best_diff) {
+        best_diff = diff;
+        victim = c;
+      }
+    }
+  }
+  if (victim) {
+    ldout(cct, 5) << __func__ << " worker " << hottest->id << " at "
+                  << hottest->load_bps << " B/s vs worker " << coldest->id
+                  << " at " << coldest->load_bps << " B/s for "
+                  << imbalanced_rounds << " rounds, moving " << victim
+                  << " (" << victim->rebalance_bps << " B/s)" << dendl;
+    victim->request_migration(coldest);
+    imbalanced_rounds = 0;
+  }
+  schedule_rebalance();
+}
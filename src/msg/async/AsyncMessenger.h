@@ -299,6 +299,12 @@ private:
 
   EventCallbackRef reap_handler;
 
+  /// periodic worker load balancing, runs on local_worker
+  EventCallbackRef rebalance_handler;
+  uint64_t rebalance_event_id = 0;
+  unsigned imbalanced_rounds = 0;
+  void schedule_rebalance();
+
   /// internal cluster protocol version, if any, for talking to entities of the same type.
   int cluster_protocol = 0;
 
@@ -425,6 +431,15 @@ public:
    */
   void reap_dead();
 
+  /**
+   * Move a busy connection from the most to the least loaded worker
+   *
+   * Only acts once the traffic imbalance between workers has exceeded
+   * ms_async_rebalance_threshold for ms_async_rebalance_rounds
+   * consecutive intervals.
+   */
+  void rebalance_workers();
+
   /**
    * @} // AsyncMessenger Internals
    */
@@ -21,6 +21,10 @@
 #include <errno.h>
 
 #include <algorithm>
+#include <deque>
+#if defined(__linux__)
+#include <linux/errqueue.h>
+#endif
 
 #include "PosixStack.h"
 
@@ -37,16 +41,43 @@
 #undef dout_prefix
 #define dout_prefix *_dout << "PosixStack "
 
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && defined(SO_EE_ORIGIN_ZEROCOPY)
+#define HAVE_MSG_ZEROCOPY
+#endif
+
 class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   ceph::NetHandler &handler;
   int _fd;
   entity_addr_t sa;
   bool connected;
+  PerfCounters *logger;
+
+  // sendmsg() chunks at least this large are sent with MSG_ZEROCOPY; 0
+  // disables zerocopy (either by configuration or lack of kernel support)
+  uint64_t zerocopy_min_bytes = 0;
+#ifdef HAVE_MSG_ZEROCOPY
+  // the kernel numbers every successful MSG_ZEROCOPY sendmsg() call; the
+  // buffers sent by a call must stay pinned until its completion is reaped
+  // from the socket error queue
+  uint32_t zerocopy_next_id = 0;
+  std::deque<std::pair<uint32_t, ceph::buffer::list>> zerocopy_pinned;
+#endif
 
  public:
   explicit PosixConnectedSocketImpl(ceph::NetHandler &h, const entity_addr_t &sa,
-				    int f, bool connected)
-      : handler(h), _fd(f), sa(sa), connected(connected) {}
+				    int f, bool connected,
+				    PerfCounters *logger = nullptr,
+				    uint64_t zerocopy_min = 0)
+      : handler(h), _fd(f), sa(sa), connected(connected), logger(logger) {
+#ifdef HAVE_MSG_ZEROCOPY
+    if (zerocopy_min) {
+      int on = 1;
+      if (::setsockopt(_fd, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)) == 0) {
+        zerocopy_min_bytes = zerocopy_min;
+      }
+    }
+#endif
+  }
 
   int is_connected() override {
     if (connected)
@@ -64,6 +95,11 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
   }
 
   ssize_t read(char *buf, size_t len) override {
+#ifdef HAVE_MSG_ZEROCOPY
+    // pending completions make the socket report EPOLLERR, which wakes the
+    // reader; drain them here so it doesn't spin
+    reap_zerocopy();
+#endif
     #ifdef _WIN32
     ssize_t r = ::recv(_fd, buf, len, 0);
     #else
@@ -74,25 +110,73 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
     return r;
   }
 
+#ifdef HAVE_MSG_ZEROCOPY
+  // release the buffers of every MSG_ZEROCOPY send the kernel is done with
+  void reap_zerocopy() {
+    while (!zerocopy_pinned.empty()) {
+      char control[CMSG_SPACE(sizeof(struct sock_extended_err)) + 64];
+      struct msghdr msg;
+      // FIPS zeroization audit 20191115: this memset is not security related.
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+      if (::recvmsg(_fd, &msg, MSG_ERRQUEUE) < 0) {
+        // EAGAIN: nothing (more) to reap
+        return;
+      }
+      for (auto cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+        if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+              (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))) {
+          continue;
+        }
+        auto serr = reinterpret_cast<struct sock_extended_err*>(CMSG_DATA(cm));
+        if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+          continue;
+        }
+        // [ee_info, ee_data] completed; TCP completes them in order
+        const uint32_t last = serr->ee_data;
+        while (!zerocopy_pinned.empty() &&
+               static_cast<int32_t>(zerocopy_pinned.front().first - last) <= 0) {
+          zerocopy_pinned.pop_front();
+        }
+      }
+    }
+  }
+#endif
+
   // return the sent length
   // < 0 means error occurred
   #ifndef _WIN32
-  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more)
+  static ssize_t do_sendmsg(int fd, struct msghdr &msg, unsigned len, bool more,
+			    bool zerocopy = false, uint32_t *zerocopy_sends = nullptr)
   {
     size_t sent = 0;
     while (1) {
       MSGR_SIGPIPE_STOPPER;
       ssize_t r;
-      r = ::sendmsg(fd, &msg, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
+      int flags = MSG_NOSIGNAL | (more ? MSG_MORE : 0);
+#ifdef HAVE_MSG_ZEROCOPY
+      if (zerocopy) {
+	flags |= MSG_ZEROCOPY;
+      }
+#endif
+      r = ::sendmsg(fd, &msg, flags);
       if (r < 0) {
         int err = ceph_sock_errno();
         if (err == EINTR) {
           continue;
         } else if (err == EAGAIN) {
           break;
+        } else if (err == ENOBUFS && zerocopy) {
+          // out of optmem for completion notifications; copy instead
+          zerocopy = false;
+          continue;
         }
         return -err;
       }
+      if (zerocopy) {
+        ++*zerocopy_sends;
+      }
 
       sent += r;
       if (len == sent) break;
@@ -115,8 +199,14 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
 
   ssize_t send(ceph::buffer::list &bl, bool more) override {
     size_t sent_bytes = 0;
+    uint32_t zerocopy_sends = 0;
     auto pb = std::cbegin(bl.buffers());
     uint64_t left_pbrs = bl.get_num_buffers();
+#ifdef HAVE_MSG_ZEROCOPY
+    if (!zerocopy_pinned.empty()) {
+      reap_zerocopy();
+    }
+#endif
     while (left_pbrs) {
       struct msghdr msg;
       struct iovec msgvec[IOV_MAX];
@@ -133,9 +223,15 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
 	msglen += pb->length();
 	++pb;
       }
-      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more);
+      const bool zerocopy = zerocopy_min_bytes && msglen >= zerocopy_min_bytes;
+      const uint32_t zerocopy_sends_before = zerocopy_sends;
+      ssize_t r = do_sendmsg(_fd, msg, msglen, left_pbrs || more,
+			     zerocopy, &zerocopy_sends);
       if (r < 0)
         return r;
+      if (logger && zerocopy_sends != zerocopy_sends_before) {
+        logger->inc(l_msgr_send_zerocopy_bytes, r);
+      }
 
       // "r" is the remaining length
       sent_bytes += r;
@@ -145,6 +241,17 @@ class PosixConnectedSocketImpl final : public ConnectedSocketImpl {
     }
 
     if (sent_bytes) {
+#ifdef HAVE_MSG_ZEROCOPY
+      if (zerocopy_sends) {
+        // the kernel may still be reading the sent buffers; keep them
+        // referenced until the last of these sends completes
+        ceph::buffer::list pinned;
+        bl.splice(0, sent_bytes, &pinned);
+        zerocopy_next_id += zerocopy_sends;
+        zerocopy_pinned.emplace_back(zerocopy_next_id - 1, std::move(pinned));
+        return static_cast<ssize_t>(sent_bytes);
+      }
+#endif
       ceph::buffer::list swapped;
       if (sent_bytes < bl.length()) {
         bl.splice(sent_bytes, bl.length()-sent_bytes, &swapped);
@@ -259,7 +366,9 @@ int PosixServerSocketImpl::accept(ConnectedSocket *sock, const SocketOptions &op
   out->set_sockaddr((sockaddr*)&ss);
   handler.set_priority(sd, opt.priority, out->get_family());
 
-  std::unique_ptr<PosixConnectedSocketImpl> csi(new PosixConnectedSocketImpl(handler, *out, sd, true));
+  std::unique_ptr<PosixConnectedSocketImpl> csi(
+    new PosixConnectedSocketImpl(handler, *out, sd, true, w->get_perf_counter(),
+				 w->cct->_conf->ms_async_zerocopy_min_bytes));
   *sock = ConnectedSocket(std::move(csi));
   return 0;
 }
@@ -328,7 +437,9 @@ int PosixWorker::connect(const entity_addr_t &addr, const SocketOptions &opts, C
 
   net.set_priority(sd, opts.priority, addr.get_family());
   *socket = ConnectedSocket(
-      std::unique_ptr<PosixConnectedSocketImpl>(new PosixConnectedSocketImpl(net, addr, sd, !opts.nonblock)));
+      std::unique_ptr<PosixConnectedSocketImpl>(
+	new PosixConnectedSocketImpl(net, addr, sd, !opts.nonblock, perf_logger,
+				     cct->_conf->ms_async_zerocopy_min_bytes)));
   return 0;
 }
 
@@ -1022,6 +1022,8 @@ CtPtr ProtocolV1::handle_message_footer(char *buffer, int r) {
   connection->logger->inc(
       l_msgr_recv_bytes,
       cur_msg_size + sizeof(ceph_msg_header) + sizeof(ceph_msg_footer));
+  connection->account_traffic(
+      cur_msg_size + sizeof(ceph_msg_header) + sizeof(ceph_msg_footer));
 
   messenger->ms_fast_preprocess(message);
   fast_dispatch_time = ceph::mono_clock::now();
@@ -1176,6 +1178,8 @@ ssize_t ProtocolV1::write_message(Message *m, ceph::buffer::list &bl, bool more)
   } else {
     connection->logger->inc(
         l_msgr_send_bytes, total_send_size - connection->outgoing_bl.length());
+    connection->account_traffic(
+        total_send_size - connection->outgoing_bl.length());
     ldout(cct, 10) << __func__ << " sending " << m
                    << (rc ? " continuely." : " done.") << dendl;
   }
@@ -154,6 +154,7 @@ void ProtocolV2::reset_session() {
   connection->dispatch_queue->discard_queue(connection->conn_id);
   discard_out_queue();
   connection->outgoing_bl.clear();
+  tx_batch_msgs = 0;
 
   connection->dispatch_queue->queue_remote_reset(connection);
 
@@ -559,16 +560,25 @@ ssize_t ProtocolV2::write_message(Message *m, bool more) {
                  << " src=" << entity_name_t(messenger->get_myname())
                  << " off=" << header2.data_off
                  << dendl;
-  ssize_t total_send_size = connection->outgoing_bl.length();
-  ssize_t rc = connection->_try_send(more);
-  if (rc < 0) {
-    ldout(cct, 1) << __func__ << " error sending " << m << ", "
-                  << cpp_strerror(rc) << dendl;
+  if (tx_batch_msgs++ == 0) {
+    tx_batch_start = ceph::mono_clock::now();
+  }
+  ssize_t rc = 0;
+  if (more && !tx_batch_full()) {
+    // more messages are queued behind this one: keep coalescing them into
+    // outgoing_bl and let a later message (or write_event) flush the batch
+    ldout(cct, 20) << __func__ << " batching " << m << " (" << tx_batch_msgs
+                   << " msgs, " << connection->outgoing_bl.length()
+                   << " bytes pending)" << dendl;
   } else {
-    connection->logger->inc(
-        l_msgr_send_bytes, total_send_size - connection->outgoing_bl.length());
-    ldout(cct, 10) << __func__ << " sending " << m
-                   << (rc ? " continuely." : " done.") << dendl;
+    rc = flush_tx_batch(more);
+    if (rc < 0) {
+      ldout(cct, 1) << __func__ << " error sending " << m << ", "
+                    << cpp_strerror(rc) << dendl;
+    } else {
+      ldout(cct, 10) << __func__ << " sending " << m
+                     << (rc ? " continuely." : " done.") << dendl;
+    }
   }
 
 #if defined(WITH_EVENTTRACE)
@@ -582,6 +592,32 @@ ssize_t ProtocolV2::write_message(Message *m, bool more) {
   return rc;
 }
 
+bool ProtocolV2::tx_batch_full() const {
+  const auto& conf = cct->_conf;
+  if (connection->outgoing_bl.length() >= conf->ms_async_send_batch_bytes) {
+    return true;
+  }
+  return ceph::mono_clock::now() - tx_batch_start >=
+    std::chrono::microseconds(conf->ms_async_send_batch_max_us);
+}
+
+ssize_t ProtocolV2::flush_tx_batch(bool more) {
+  ssize_t total_send_size = connection->outgoing_bl.length();
+  ssize_t rc = connection->_try_send(more);
+  if (rc >= 0) {
+    const uint64_t sent_bytes = total_send_size - connection->outgoing_bl.length();
+    connection->logger->inc(l_msgr_send_bytes, sent_bytes);
+    connection->account_traffic(sent_bytes);
+    if (tx_batch_msgs) {
+      connection->logger->inc(l_msgr_send_batches);
+      connection->logger->hinc(l_msgr_send_batch_histogram,
+                               tx_batch_msgs, total_send_size);
+    }
+  }
+  tx_batch_msgs = 0;
+  return rc;
+}
+
 template <class F>
 bool ProtocolV2::append_frame(F& frame) {
   ceph::bufferlist bl;
@@ -706,12 +742,12 @@ void ProtocolV2::write_event() {
         if (append_frame(ack_frame)) {
           ack_left -= left;
           left = ack_left;
-          r = connection->_try_send(left);
+          r = flush_tx_batch(left);
         } else {
           r = -EILSEQ;
         }
       } else if (is_queued()) {
-        r = connection->_try_send();
+        r = flush_tx_batch(false);
       }
     }
     connection->write_lock.unlock();
@@ -1479,6 +1515,7 @@ CtPtr ProtocolV2::handle_message() {
   connection->logger->inc(l_msgr_recv_messages);
   connection->logger->inc(l_msgr_recv_bytes,
                           rx_frame_asm.get_frame_onwire_len());
+  connection->account_traffic(rx_frame_asm.get_frame_onwire_len());
 
   messenger->ms_fast_preprocess(message);
   fast_dispatch_time = ceph::mono_clock::now();
@@ -122,6 +122,11 @@ private:
   bool keepalive;
   bool write_in_progress = false;
 
+  // messages appended to outgoing_bl since the last flush, and when the
+  // first of them was appended
+  uint64_t tx_batch_msgs = 0;
+  ceph::mono_time tx_batch_start;
+
   CompConnectionMeta comp_meta;
   std::ostream& _conn_prefix(std::ostream *_dout);
   void run_continuation(Ct<ProtocolV2> *pcontinuation);
@@ -151,6 +156,8 @@ private:
   void prepare_send_message(uint64_t features, Message *m);
   out_queue_entry_t _get_next_outgoing();
   ssize_t write_message(Message *m, bool more);
+  bool tx_batch_full() const;
+  ssize_t flush_tx_batch(bool more);
   void handle_message_ack(uint64_t seq);
   void reset_compression();
 
@@ -19,6 +19,7 @@
 #include "include/compat.h"
 #include "common/Cond.h"
 #include "common/errno.h"
+#include "common/numa.h"
 #include "PosixStack.h"
 #ifdef HAVE_RDMA
 #include "rdma/RDMAStack.h"
@@ -38,6 +39,7 @@ std::function<void ()> NetworkStack::add_thread(Worker* w)
 {
   return [this, w]() {
       rename_thread(w->id);
+      pin_thread(w);
       const unsigned EventMaxWaitUs = 30000000;
       w->center.set_owner();
       ldout(cct, 10) << __func__ << " starting" << dendl;
@@ -100,10 +102,70 @@ std::shared_ptr<NetworkStack> NetworkStack::create(CephContext *c,
       throw std::system_error(-ret, std::generic_category());
     stack->workers.push_back(w);
   }
+  stack->set_worker_affinity();
 
   return stack;
 }
 
+void NetworkStack::set_worker_affinity()
+{
+  const auto& conf = cct->_conf;
+  size_t cpu_set_size = 0;
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  std::string source;
+  int r = 0;
+  if (!conf->ms_async_affinity_cores.empty()) {
+    source = "ms_async_affinity_cores";
+    r = parse_cpu_set_list(conf->ms_async_affinity_cores.c_str(),
+			   &cpu_set_size, &cpu_set);
+  } else if (conf->ms_async_numa_node >= 0) {
+    source = "numa node " + std::to_string(conf->ms_async_numa_node);
+    r = get_numa_node_cpu_set(conf->ms_async_numa_node,
+			      &cpu_set_size, &cpu_set);
+  } else {
+    return;
+  }
+  if (r < 0) {
+    lderr(cct) << __func__ << " unable to determine cpus for " << source
+	       << ": " << cpp_strerror(r) << dendl;
+    return;
+  }
+  auto cpus = cpu_set_to_set(cpu_set_size, &cpu_set);
+  if (cpus.empty()) {
+    return;
+  }
+  // one core per worker; wrap around if there are more workers than cores
+  auto p = cpus.begin();
+  for (Worker* w : workers) {
+    w->cpu = *p;
+    if (++p == cpus.end()) {
+      p = cpus.begin();
+    }
+  }
+  ldout(cct, 1) << __func__ << " pinning " << workers.size()
+		<< " workers to cpus " << cpu_set_to_str_list(cpu_set_size, &cpu_set)
+		<< " (" << source << ")" << dendl;
+}
+
+void NetworkStack::pin_thread(Worker* w)
+{
+  if (w->cpu < 0) {
+    return;
+  }
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  CPU_SET(w->cpu, &cpu_set);
+  int r = set_cpu_affinity_this_thread(sizeof(cpu_set), &cpu_set);
+  if (r < 0) {
+    lderr(cct) << __func__ << " unable to pin worker " << w->id
+	       << " to cpu " << w->cpu << ": " << cpp_strerror(r) << dendl;
+  } else {
+    ldout(cct, 10) << __func__ << " worker " << w->id
+		   << " pinned to cpu " << w->cpu << dendl;
+  }
+}
+
 NetworkStack::NetworkStack(CephContext *c)
   : cct(c)
 {}
@@ -135,17 +197,25 @@ Worker* NetworkStack::get_worker()
 
    // start with some reasonably large number
   unsigned min_load = std::numeric_limits<int>::max();
+  uint64_t min_bps = std::numeric_limits<uint64_t>::max();
   Worker* current_best = nullptr;
+  const bool by_traffic = cct->_conf->ms_async_worker_balance == "load";
 
   pool_spin.lock();
-  // find worker with least references
+  if (by_traffic) {
+    _sample_load();
+  }
+  // find worker with least traffic (if requested) and then least references
   // tempting case is returning on references == 0, but in reality
   // this will happen so rarely that there's no need for special case.
   for (Worker* worker : workers) {
     unsigned worker_load = worker->references.load();
-    if (worker_load < min_load) {
+    uint64_t worker_bps = by_traffic ? worker->load_bps.load() : 0;
+    if (worker_bps < min_bps ||
+	(worker_bps == min_bps && worker_load < min_load)) {
       current_best = worker;
       min_load = worker_load;
+      min_bps = worker_bps;
     }
   }
 
@@ -155,6 +225,51 @@ Worker* NetworkStack::get_worker()
   return current_best;
 }
 
+void NetworkStack::_sample_load()
+{
+  auto now = ceph::coarse_mono_clock::now();
+  double elapsed = std::chrono::duration<double>(now - last_load_sample).count();
+  if (elapsed < 1.0) {
+    return;
+  }
+  bool first = last_load_sample == ceph::coarse_mono_time();
+  last_load_sample = now;
+  for (Worker* worker : workers) {
+    uint64_t bytes = worker->perf_logger->get(l_msgr_recv_bytes) +
+      worker->perf_logger->get(l_msgr_send_bytes);
+    uint64_t delta = bytes - worker->last_sampled_bytes;
+    worker->last_sampled_bytes = bytes;
+    if (first) {
+      continue;
+    }
+    // smooth over a few samples so short bursts don't steer placement
+    uint64_t bps = delta / elapsed;
+    worker->load_bps = (worker->load_bps.load() + bps) / 2;
+  }
+}
+
+void NetworkStack::sample_load()
+{
+  std::lock_guard lk(pool_spin);
+  _sample_load();
+}
+
+std::pair<Worker*, Worker*> NetworkStack::get_load_extremes()
+{
+  std::lock_guard lk(pool_spin);
+  _sample_load();
+  Worker *coldest = nullptr, *hottest = nullptr;
+  for (Worker* worker : workers) {
+    if (!coldest || worker->load_bps < coldest->load_bps) {
+      coldest = worker;
+    }
+    if (!hottest || worker->load_bps > hottest->load_bps) {
+      hottest = worker;
+    }
+  }
+  return {coldest, hottest};
+}
+
 void NetworkStack::stop()
 {
   std::lock_guard lk(pool_spin);
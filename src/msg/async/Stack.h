@@ -203,6 +203,10 @@ enum {
   l_msgr_send_messages_queue_lat,
   l_msgr_handle_ack_lat,
 
+  l_msgr_send_batches,
+  l_msgr_send_batch_histogram,
+  l_msgr_send_zerocopy_bytes,
+
   l_msgr_last,
 };
 
@@ -221,6 +225,12 @@ class Worker {
   std::atomic_uint references;
   EventCenter center;
 
+  /// core this worker's thread is pinned to, -1 if not pinned
+  int cpu = -1;
+  /// recent network traffic (bytes/sec), see NetworkStack::sample_load()
+  std::atomic<uint64_t> load_bps{0};
+  uint64_t last_sampled_bytes = 0;
+
   Worker(const Worker&) = delete;
   Worker& operator=(const Worker&) = delete;
 
@@ -246,6 +256,26 @@ class Worker {
     plb.add_time_avg(l_msgr_send_messages_queue_lat, "msgr_send_messages_queue_lat", "Network sent messages lat");
     plb.add_time_avg(l_msgr_handle_ack_lat, "msgr_handle_ack_lat", "Connection handle ack lat");
 
+    PerfHistogramCommon::axis_config_d batch_msgs_axis_config{
+      "Batch size (messages)",
+      PerfHistogramCommon::SCALE_LOG2,
+      0,
+      1,
+      12,
+    };
+    PerfHistogramCommon::axis_config_d batch_bytes_axis_config{
+      "Batch size (bytes)",
+      PerfHistogramCommon::SCALE_LOG2,
+      0,
+      512,
+      16,
+    };
+    plb.add_u64_counter(l_msgr_send_batches, "msgr_send_batches", "Coalesced message batches handed to the socket");
+    plb.add_u64_counter_histogram(l_msgr_send_batch_histogram, "msgr_send_batch_histogram",
+                                  batch_msgs_axis_config, batch_bytes_axis_config,
+                                  "Histogram of coalesced send batches by messages and bytes");
+    plb.add_u64_counter(l_msgr_send_zerocopy_bytes, "msgr_send_zerocopy_bytes", "Network bytes sent with MSG_ZEROCOPY", NULL, 0, unit_t(UNIT_BYTES));
+
     perf_logger = plb.create_perf_counters();
     cct->get_perfcounters_collection()->add(perf_logger);
   }
@@ -295,8 +325,12 @@ class Worker {
 class NetworkStack {
   ceph::spinlock pool_spin;
   bool started = false;
+  ceph::coarse_mono_time last_load_sample;
 
   std::function<void ()> add_thread(Worker* w);
+  void set_worker_affinity();
+  void pin_thread(Worker* w);
+  void _sample_load();
 
   virtual Worker* create_worker(CephContext *c, unsigned i) = 0;
   virtual void rename_thread(unsigned id) {
@@ -330,6 +364,10 @@ class NetworkStack {
   // need to let each thread do binding port.
   virtual bool support_local_listen_table() const { return false; }
   virtual bool nonblock_connect_need_writable_event() const { return true; }
+  // whether an established connection's socket can be moved to another
+  // worker.  Only kernel sockets can: dpdk and rdma sockets are bound to
+  // the worker (and its queues) that created them.
+  virtual bool support_migration() const { return false; }
 
   void start();
   void stop();
@@ -337,6 +375,10 @@ class NetworkStack {
   Worker *get_worker(unsigned worker_id) {
     return workers[worker_id];
   }
+  /// refresh each worker's load_bps if at least a second has passed
+  void sample_load();
+  /// least and most loaded workers by traffic, or {nullptr, nullptr}
+  std::pair<Worker*, Worker*> get_load_extremes();
   void drain();
   unsigned get_num_worker() const {
     return workers.size();
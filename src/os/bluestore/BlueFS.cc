@@ -272,6 +272,10 @@ void BlueFS::_init_logger()
 		    "Bytes written to WAL/SSTs at slow device",
 		    "slwb",
 		    PerfCountersBuilder::PRIO_CRITICAL, unit_t(UNIT_BYTES));
+  b.add_u64_counter(l_bluefs_bytes_written_direct, "bytes_written_direct",
+		    "Bytes persisted directly to byte addressable (pmem) devices",
+		    NULL,
+		    PerfCountersBuilder::PRIO_USEFUL, unit_t(UNIT_BYTES));
   b.add_u64_counter(l_bluefs_max_bytes_wal, "max_bytes_wal",
 		    "Maximum bytes allocated from WAL",
 		    "mxwb",
@@ -3452,6 +3456,9 @@ int BlueFS::_flush_data(FileWriter *h, uint64_t offset, uint64_t length, bool bu
   auto bl = h->flush_buffer(cct, partial, length, super);
   ceph_assert(bl.length() >= length);
   h->pos = offset + length;
+  // the new data within bl; the rest is the cached tail block and padding
+  const uint64_t new_off = partial;
+  const uint64_t new_len = length - partial;
   length = bl.length();
 
   logger->inc(l_bluefs_write_count, 1);
@@ -3472,13 +3479,40 @@ int BlueFS::_flush_data(FileWriter *h, uint64_t offset, uint64_t length, bool bu
   bl.hexdump(*_dout);
   *_dout << dendl;
 
+  // Regular files are only read up to fnode.size, so on a byte addressable
+  // device there is no need to rewrite the tail block or persist the
+  // padding: a persisting memcpy of the new bytes is all it takes, with
+  // nothing left for aio completion or a device flush to do.  The log
+  // (ino 1) is replayed block by block and keeps the aligned path.
+  const bool direct_ok = cct->_conf->bluefs_pmem_direct_write &&
+    h->file->fnode.ino > 1;
+  bool all_direct = direct_ok;
   uint64_t bloff = 0;
   uint64_t bytes_written_slow = 0;
+  uint64_t bytes_written_direct = 0;
   while (length > 0) {
     logger->inc(l_bluefs_write_disk_count, 1);
 
     uint64_t x_len = std::min(p->length - x_off, length);
     bufferlist t;
+    if (direct_ok && bdev[p->bdev]->is_byte_addressable()) {
+      uint64_t from = std::max(bloff, new_off);
+      uint64_t to = std::min(bloff + x_len, new_off + new_len);
+      if (from < to) {
+	t.substr_of(bl, from, to - from);
+	// not block aligned: write() would refuse it
+	int r = bdev[p->bdev]->write_persistent(
+	  p->offset + x_off + (from - bloff), t);
+	ceph_assert(r == 0);
+	bytes_written_direct += t.length();
+      }
+      bloff += x_len;
+      length -= x_len;
+      ++p;
+      x_off = 0;
+      continue;
+    }
+    all_direct = false;
     t.substr_of(bl, bloff, x_len);
     if (cct->_conf->bluefs_sync_write) {
       bdev[p->bdev]->write(p->offset + x_off, t, buffered, h->write_hint);
@@ -3498,6 +3532,10 @@ int BlueFS::_flush_data(FileWriter *h, uint64_t offset, uint64_t length, bool bu
   if (bytes_written_slow) {
     logger->inc(l_bluefs_bytes_written_slow, bytes_written_slow);
   }
+  if (bytes_written_direct) {
+    logger->inc(l_bluefs_bytes_written_direct, bytes_written_direct);
+  }
+  h->direct = all_direct;
   for (unsigned i = 0; i < MAX_BDEV; ++i) {
     if (bdev[i]) {
       if (h->iocv[i] && h->iocv[i]->has_pending_aios()) {
@@ -3707,6 +3745,10 @@ int BlueFS::fsync(FileWriter *h)/*_WF_WD_WLD_WLNF_WNF*/
   }
   if (old_dirty_seq) {
     _flush_and_sync_log_LD(old_dirty_seq);
+  } else if (h->direct) {
+    // data is persistent already and the log was not touched: keep the
+    // pmem sync path free of log compaction checks
+    return 0;
   }
   _maybe_compact_log_LNF_NF_LD_D();
 
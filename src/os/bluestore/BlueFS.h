@@ -40,6 +40,7 @@ enum {
   l_bluefs_bytes_written_wal,
   l_bluefs_bytes_written_sst,
   l_bluefs_bytes_written_slow,
+  l_bluefs_bytes_written_direct,
   l_bluefs_max_bytes_wal,
   l_bluefs_max_bytes_db,
   l_bluefs_max_bytes_slow,
@@ -308,6 +309,8 @@ public:
     ceph::mutex lock = ceph::make_mutex("BlueFS::FileWriter::lock");
     std::array<IOContext*,MAX_BDEV> iocv; ///< for each bdev
     std::array<bool, MAX_BDEV> dirty_devs;
+    /// last flush was persisted synchronously on byte addressable devices
+    bool direct = false;
 
     FileWriter(FileRef f)
       : file(std::move(f)),
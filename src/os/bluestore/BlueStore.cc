@@ -4627,7 +4627,8 @@ BlueStore::BlueStore(CephContext *cct,
   uint64_t _min_alloc_size)
   : ObjectStore(cct, path),
     throttle(cct),
-    finisher(cct, "commit_finisher", "cfin"),
+    finisher(cct, "commit_finisher", "cfin",
+	     cct->_conf->bluestore_finisher_shards),
     kv_sync_thread(this),
     kv_finalize_thread(this),
 #ifdef HAVE_LIBZBD
@@ -5017,6 +5018,8 @@ void BlueStore::_init_logger()
 {
   PerfCountersBuilder b(cct, "bluestore",
                         l_bluestore_first, l_bluestore_last);
+  // updated by the op shards, the kv threads and the finishers alike
+  b.set_sharded();
 
   // space utilization stats
   //****************************************
@@ -5185,6 +5188,19 @@ void BlueStore::_init_logger()
 		    NULL,
 		    PerfCountersBuilder::PRIO_DEBUGONLY,
 		    unit_t(UNIT_BYTES));
+  b.add_u64_counter(l_bluestore_deferred_pmem_staged_writes,
+		    "deferred_pmem_staged_writes",
+		    "Deferred transactions with payload staged on pmem");
+  b.add_u64_counter(l_bluestore_deferred_pmem_staged_bytes,
+		    "deferred_pmem_staged_bytes",
+		    "Deferred payload bytes staged on pmem",
+		    NULL,
+		    PerfCountersBuilder::PRIO_DEBUGONLY,
+		    unit_t(UNIT_BYTES));
+  b.add_u64_counter(l_bluestore_deferred_pmem_ring_full,
+		    "deferred_pmem_ring_full",
+		    "Deferred transactions kept in the KV store for lack of "
+		    "pmem ring space");
 
   b.add_u64_counter(l_bluestore_write_big_skipped_blobs,
       "write_big_skipped_blobs",
@@ -5570,6 +5586,18 @@ int BlueStore::_open_bdev(bool create)
   // get block dev optimal io size
   optimal_io_size = bdev->get_optimal_io_size();
 
+  if (!cct->_conf->bluestore_deferred_pmem_path.empty()) {
+    deferred_ring = std::make_unique<PMEMDeferredRing>(cct);
+    r = deferred_ring->open(cct->_conf->bluestore_deferred_pmem_path, fsid,
+			    create);
+    if (r < 0) {
+      derr << __func__ << " failed to open deferred pmem ring: "
+	   << cpp_strerror(r) << dendl;
+      deferred_ring.reset();
+      goto fail_close;
+    }
+  }
+
   return 0;
 
  fail_close:
@@ -5590,6 +5618,10 @@ void BlueStore::_validate_bdev()
 void BlueStore::_close_bdev()
 {
   ceph_assert(bdev);
+  if (deferred_ring) {
+    deferred_ring->close();
+    deferred_ring.reset();
+  }
   bdev->close();
   delete bdev;
   bdev = NULL;
@@ -12680,6 +12712,21 @@ void BlueStore::_txc_state_proc(TransContext *txc)
 	  _txc_apply_kv(txc, true);
 	}
       }
+      if (KVSyncLane *lane = _get_kv_lane(txc->osr.get()); lane) {
+	std::lock_guard l(lane->lock);
+	lane->queue.push_back(txc);
+	if (!lane->in_progress) {
+	  lane->in_progress = true;
+	  lane->cond.notify_one();
+	}
+	if (txc->get_state() != TransContext::STATE_KV_SUBMITTED) {
+	  ++txc->osr->kv_committing_serially;
+	}
+	if (txc->had_ios)
+	  lane->ios++;
+	lane->throttle_costs += txc->cost;
+	return;
+      }
       {
 	std::lock_guard l(kv_lock);
 	kv_queue.push_back(txc);
@@ -12953,7 +13000,8 @@ void BlueStore::_txc_committed_kv(TransContext *txc)
     if (txc->ch->commit_queue) {
       txc->ch->commit_queue->queue(txc->oncommits);
     } else {
-      finisher.queue(txc->oncommits);
+      finisher.queue(reinterpret_cast<uintptr_t>(txc->osr.get()),
+		     txc->oncommits);
     }
   }
   throttle.log_state_latency(*txc, logger, l_bluestore_state_kv_committing_lat);
@@ -13236,6 +13284,13 @@ void BlueStore::_kv_start()
   dout(10) << __func__ << dendl;
 
   finisher.start();
+  // the lanes are read without a lock, so they must all exist before
+  // anything that routes to them runs
+  ceph_assert(kv_lanes.empty());
+  for (unsigned i = 1; i < cct->_conf->bluestore_kv_sync_lanes; ++i) {
+    kv_lanes.emplace_back(std::make_unique<KVSyncLane>(this, i));
+    kv_lanes.back()->create(kv_lanes.back()->name.c_str());
+  }
   kv_sync_thread.create("bstore_kv_sync");
   kv_finalize_thread.create("bstore_kv_final");
 }
@@ -13251,6 +13306,17 @@ void BlueStore::_kv_stop()
     kv_stop = true;
     kv_cond.notify_all();
   }
+  for (auto& lane : kv_lanes) {
+    std::unique_lock l{lane->lock};
+    while (!lane->started) {
+      lane->cond.wait(l);
+    }
+    lane->stop = true;
+    lane->cond.notify_all();
+  }
+  for (auto& lane : kv_lanes) {
+    lane->join();
+  }
   {
     std::unique_lock l{kv_finalize_lock};
     while (!kv_finalize_started) {
@@ -13261,6 +13327,8 @@ void BlueStore::_kv_stop()
   }
   kv_sync_thread.join();
   kv_finalize_thread.join();
+  // nothing reads the lanes once the kv threads are gone
+  kv_lanes.clear();
   ceph_assert(removed_collections.empty());
   {
     std::lock_guard l(kv_lock);
@@ -13386,7 +13454,16 @@ void BlueStore::_kv_sync_thread()
       // it.  in either case, we increase the max in the earlier txn
       // we submit.
       uint64_t new_nid_max = 0, new_blobid_max = 0;
-      if (nid_last + cct->_conf->bluestore_nid_prealloc/2 > nid_max) {
+      if (!kv_lanes.empty()) {
+	// other lanes commit independently, so the new maxima must be
+	// stable before any txc relying on them is submitted
+	uint64_t min_nid = 0, min_blobid = 0;
+	for (auto txc : kv_submitting) {
+	  min_nid = std::max(min_nid, txc->last_nid);
+	  min_blobid = std::max(min_blobid, txc->last_blobid);
+	}
+	_kv_sync_id_max(min_nid, min_blobid);
+      } else if (nid_last + cct->_conf->bluestore_nid_prealloc/2 > nid_max) {
 	KeyValueDB::Transaction t =
 	  kv_submitting.empty() ? synct : kv_submitting.front()->t;
 	new_nid_max = nid_last + cct->_conf->bluestore_nid_prealloc;
@@ -13395,7 +13472,8 @@ void BlueStore::_kv_sync_thread()
 	t->set(PREFIX_SUPER, "nid_max", bl);
 	dout(10) << __func__ << " new_nid_max " << new_nid_max << dendl;
       }
-      if (blobid_last + cct->_conf->bluestore_blobid_prealloc/2 > blobid_max) {
+      if (kv_lanes.empty() &&
+	  blobid_last + cct->_conf->bluestore_blobid_prealloc/2 > blobid_max) {
 	KeyValueDB::Transaction t =
 	  kv_submitting.empty() ? synct : kv_submitting.front()->t;
 	new_blobid_max = blobid_last + cct->_conf->bluestore_blobid_prealloc;
@@ -13543,6 +13621,137 @@ void BlueStore::_kv_sync_thread()
   kv_sync_started = false;
 }
 
+void BlueStore::_kv_sync_id_max(uint64_t min_nid, uint64_t min_blobid)
+{
+  std::lock_guard l(id_max_lock);
+  uint64_t new_nid_max = 0, new_blobid_max = 0;
+  KeyValueDB::Transaction t = db->get_transaction();
+  if (nid_last + cct->_conf->bluestore_nid_prealloc/2 > nid_max ||
+      min_nid >= nid_max) {
+    new_nid_max = std::max(nid_last.load(), min_nid) +
+      cct->_conf->bluestore_nid_prealloc;
+    bufferlist bl;
+    encode(new_nid_max, bl);
+    t->set(PREFIX_SUPER, "nid_max", bl);
+  }
+  if (blobid_last + cct->_conf->bluestore_blobid_prealloc/2 > blobid_max ||
+      min_blobid >= blobid_max) {
+    new_blobid_max = std::max(blobid_last.load(), min_blobid) +
+      cct->_conf->bluestore_blobid_prealloc;
+    bufferlist bl;
+    encode(new_blobid_max, bl);
+    t->set(PREFIX_SUPER, "blobid_max", bl);
+  }
+  if (!new_nid_max && !new_blobid_max) {
+    return;
+  }
+  int r = cct->_conf->bluestore_debug_omit_kv_commit ? 0 :
+    db->submit_transaction_sync(t);
+  ceph_assert(r == 0);
+  if (new_nid_max) {
+    nid_max = new_nid_max;
+    dout(10) << __func__ << " nid_max now " << nid_max << dendl;
+  }
+  if (new_blobid_max) {
+    blobid_max = new_blobid_max;
+    dout(10) << __func__ << " blobid_max now " << blobid_max << dendl;
+  }
+}
+
+void BlueStore::_kv_sync_lane_thread(KVSyncLane *lane)
+{
+  dout(10) << __func__ << " " << lane->id << " start" << dendl;
+  std::unique_lock l{lane->lock};
+  ceph_assert(!lane->started);
+  lane->started = true;
+  lane->cond.notify_all();
+  while (true) {
+    if (lane->queue.empty()) {
+      if (lane->stop)
+	break;
+      lane->in_progress = false;
+      lane->cond.wait(l);
+      continue;
+    }
+    deque<TransContext*> committing;
+    committing.swap(lane->queue);
+    uint64_t aios = lane->ios;
+    uint64_t costs = lane->throttle_costs;
+    lane->ios = 0;
+    lane->throttle_costs = 0;
+    l.unlock();
+
+    dout(20) << __func__ << " " << lane->id << " committing "
+	     << committing.size() << dendl;
+    auto start = mono_clock::now();
+
+    // data ios of this lane's txcs must be stable before their metadata
+    if (aios) {
+      bdev->flush();
+    }
+    auto after_flush = mono_clock::now();
+
+    uint64_t min_nid = 0, min_blobid = 0;
+    for (auto txc : committing) {
+      if (txc->get_state() == TransContext::STATE_KV_QUEUED) {
+	min_nid = std::max(min_nid, txc->last_nid);
+	min_blobid = std::max(min_blobid, txc->last_blobid);
+      }
+    }
+    _kv_sync_id_max(min_nid, min_blobid);
+
+    // concurrent lanes end up in the same rocksdb write group, and
+    // share its wal sync
+    for (auto txc : committing) {
+      throttle.log_state_latency(*txc, logger, l_bluestore_state_kv_queued_lat);
+      if (txc->get_state() == TransContext::STATE_KV_QUEUED) {
+	_txc_apply_kv(txc, false);
+	--txc->osr->kv_committing_serially;
+      } else {
+	ceph_assert(txc->get_state() == TransContext::STATE_KV_SUBMITTED);
+      }
+      if (txc->had_ios) {
+	--txc->osr->txc_with_unstable_io;
+      }
+    }
+    throttle.release_kv_throttle(costs);
+
+    KeyValueDB::Transaction synct = db->get_transaction();
+    int r = cct->_conf->bluestore_debug_omit_kv_commit ? 0 :
+      db->submit_transaction_sync(synct);
+    ceph_assert(r == 0);
+
+    {
+      std::unique_lock m{kv_finalize_lock};
+      kv_committing_to_finalize.insert(
+	kv_committing_to_finalize.end(),
+	committing.begin(),
+	committing.end());
+      if (!kv_finalize_in_progress) {
+	kv_finalize_in_progress = true;
+	kv_finalize_cond.notify_one();
+      }
+    }
+
+    auto finish = mono_clock::now();
+    log_latency("kv_flush",
+      l_bluestore_kv_flush_lat,
+      after_flush - start,
+      cct->_conf->bluestore_log_op_age);
+    log_latency("kv_commit",
+      l_bluestore_kv_commit_lat,
+      finish - after_flush,
+      cct->_conf->bluestore_log_op_age);
+    log_latency("kv_sync",
+      l_bluestore_kv_sync_lat,
+      finish - start,
+      cct->_conf->bluestore_log_op_age);
+    l.lock();
+  }
+  dout(10) << __func__ << " " << lane->id << " finish" << dendl;
+  lane->started = false;
+}
+
 void BlueStore::_kv_finalize_thread()
 {
   deque<TransContext*> kv_committed;
@@ -13584,6 +13793,10 @@ void BlueStore::_kv_finalize_thread()
 	while (p != b->txcs.end()) {
 	  TransContext *txc = &*p;
 	  p = b->txcs.erase(p); // unlink here because
+	  if (deferred_ring && txc->deferred_txn->is_pmem_staged()) {
+	    // its kv record is gone, the slot can be reused
+	    deferred_ring->release(txc->deferred_txn->pmem_offset);
+	  }
 	  _txc_state_proc(txc); // this may destroy txc
 	}
 	delete b;
@@ -14001,7 +14214,7 @@ void BlueStore::_deferred_aio_finish(OpSequencer *osr)
       osr->deferred_lock.unlock();
       if (deferred_aggressive) {
 	dout(20) << __func__ << " queuing async deferred_try_submit" << dendl;
-	finisher.queue(new C_DeferredTrySubmit(this));
+	finisher.queue(0, new C_DeferredTrySubmit(this));
       } else {
 	dout(20) << __func__ << " leaving queued, more pending" << dendl;
       }
@@ -14051,6 +14264,7 @@ int BlueStore::_deferred_replay()
     fake_ch = true;
   }
   OpSequencer *osr = static_cast<OpSequencer*>(ch->osr.get());
+  KeyValueDB::Transaction cleanup;
   KeyValueDB::Iterator it = db->get_iterator(PREFIX_DEFERRED);
   for (it->lower_bound(string()); it->valid(); it->next(), ++count) {
     dout(20) << __func__ << " replay " << pretty_binary_string(it->key())
@@ -14068,6 +14282,13 @@ int BlueStore::_deferred_replay()
       r = -EIO;
       goto out;
     }
+    if (deferred_txn->is_pmem_staged()) {
+      r = _deferred_load_pmem(*deferred_txn);
+      if (r < 0) {
+	delete deferred_txn;
+	goto out;
+      }
+    }
     bool has_some = _eliminate_outdated_deferred(deferred_txn, bluefs_extents);
     if (has_some) {
       TransContext *txc = _txc_create(ch.get(), osr,  nullptr);
@@ -14075,6 +14296,12 @@ int BlueStore::_deferred_replay()
       txc->set_state(TransContext::STATE_KV_DONE);
       _txc_state_proc(txc);
     } else {
+      // nothing to apply, but the record may still point into the pmem
+      // ring, whose slots are about to be reused
+      if (!cleanup) {
+	cleanup = db->get_transaction();
+      }
+      cleanup->rmkey(PREFIX_DEFERRED, it->key());
       delete deferred_txn;
     }
   }
@@ -14085,10 +14312,96 @@ int BlueStore::_deferred_replay()
   if (fake_ch) {
     new_coll_map.clear();
   }
+  if (cleanup) {
+    int r2 = db->submit_transaction_sync(cleanup);
+    ceph_assert(r2 == 0);
+  }
+  if (deferred_ring && r == 0) {
+    // every record referencing the ring has been applied and removed
+    deferred_ring->reset();
+  }
   dout(10) << __func__ << " completed " << count << " events" << dendl;
   return r;
 }
 
+void BlueStore::_deferred_stage_pmem(bluestore_deferred_transaction_t& wt,
+				     bufferlist& bl)
+{
+  bufferlist payload;
+  for (auto& op : wt.ops) {
+    uint64_t len = 0;
+    for (auto& e : op.extents) {
+      len += e.length;
+    }
+    if (op.data.length() != len) {
+      // replay splits the payload by extent length
+      encode(wt, bl);
+      return;
+    }
+    payload.append(op.data);
+  }
+  if (payload.length() == 0 ||
+      payload.length() > std::numeric_limits<uint32_t>::max()) {
+    encode(wt, bl);
+    return;
+  }
+  if (!deferred_ring->append(wt.seq, payload,
+			     &wt.pmem_offset, &wt.pmem_length)) {
+    logger->inc(l_bluestore_deferred_pmem_ring_full);
+    encode(wt, bl);
+    return;
+  }
+  logger->inc(l_bluestore_deferred_pmem_staged_writes);
+  logger->inc(l_bluestore_deferred_pmem_staged_bytes, payload.length());
+
+  // keep the data out of the kv record; _deferred_queue still needs it
+  vector<bufferlist> data(wt.ops.size());
+  auto d = data.begin();
+  for (auto& op : wt.ops) {
+    (d++)->swap(op.data);
+  }
+  encode(wt, bl);
+  d = data.begin();
+  for (auto& op : wt.ops) {
+    (d++)->swap(op.data);
+  }
+}
+
+int BlueStore::_deferred_load_pmem(bluestore_deferred_transaction_t& wt)
+{
+  if (!deferred_ring) {
+    derr << __func__ << " deferred txn " << wt.seq
+	 << " is staged on pmem, but bluestore_deferred_pmem_path is not set"
+	 << dendl;
+    return -EIO;
+  }
+  bufferlist payload;
+  int r = deferred_ring->read(wt.seq, wt.pmem_offset, wt.pmem_length,
+			      &payload);
+  if (r < 0) {
+    derr << __func__ << " failed to read deferred txn " << wt.seq
+	 << " payload: " << cpp_strerror(r) << dendl;
+    return -EIO;
+  }
+  auto p = payload.cbegin();
+  for (auto& op : wt.ops) {
+    uint64_t len = 0;
+    for (auto& e : op.extents) {
+      len += e.length;
+    }
+    if (len > p.get_remaining()) {
+      derr << __func__ << " deferred txn " << wt.seq
+	   << " payload is shorter than its extents" << dendl;
+      return -EIO;
+    }
+    op.data.clear();
+    p.copy(len, op.data);
+  }
+  wt.pmem_offset = 0;
+  wt.pmem_length = 0;
+  return 0;
+}
+
 bool BlueStore::_eliminate_outdated_deferred(bluestore_deferred_transaction_t* deferred_txn,
 					     interval_set<uint64_t>& bluefs_extents)
 {
@@ -14205,7 +14518,11 @@ int BlueStore::queue_transactions(
   if (txc->deferred_txn) {
     txc->deferred_txn->seq = ++deferred_seq;
     bufferlist bl;
-    encode(*txc->deferred_txn, bl);
+    if (deferred_ring) {
+      _deferred_stage_pmem(*txc->deferred_txn, bl);
+    } else {
+      encode(*txc->deferred_txn, bl);
+    }
     string key;
     get_deferred_key(txc->deferred_txn->seq, &key);
     txc->t->set(PREFIX_DEFERRED, key, bl);
@@ -14266,7 +14583,7 @@ int BlueStore::queue_transactions(
     if (c->commit_queue) {
       c->commit_queue->queue(on_applied);
     } else {
-      finisher.queue(on_applied);
+      finisher.queue(reinterpret_cast<uintptr_t>(osr), on_applied);
     }
   }
 
@@ -51,6 +51,7 @@
 
 #include "bluestore_types.h"
 #include "BlueFS.h"
+#include "PMEMDeferredRing.h"
 #include "common/EventTrace.h"
 
 #ifdef WITH_BLKIN
@@ -143,6 +144,9 @@ enum {
   l_bluestore_issued_deferred_write_bytes,
   l_bluestore_submitted_deferred_writes,
   l_bluestore_submitted_deferred_write_bytes,
+  l_bluestore_deferred_pmem_staged_writes,
+  l_bluestore_deferred_pmem_staged_bytes,
+  l_bluestore_deferred_pmem_ring_full,
 
   l_bluestore_write_big_skipped_blobs,
   l_bluestore_write_big_skipped_bytes,
@@ -2161,6 +2165,27 @@ private:
       return NULL;
     }
   };
+  /// an additional kv sync lane (see bluestore_kv_sync_lanes); lane 0 is
+  /// the kv_sync_thread, which also owns deferred io bookkeeping
+  struct KVSyncLane : public Thread {
+    BlueStore *store;
+    const unsigned id;
+    const std::string name;
+    ceph::mutex lock = ceph::make_mutex("BlueStore::KVSyncLane::lock");
+    ceph::condition_variable cond;
+    bool started = false;
+    bool stop = false;
+    bool in_progress = false;
+    std::deque<TransContext*> queue;  ///< ready, in osr order
+    uint64_t ios = 0;                 ///< txcs in queue with unstable io
+    uint64_t throttle_costs = 0;
+    KVSyncLane(BlueStore *s, unsigned i)
+      : store(s), id(i), name("bstore_kv_ln" + std::to_string(i)) {}
+    void *entry() override {
+      store->_kv_sync_lane_thread(this);
+      return NULL;
+    }
+  };
 
 #ifdef HAVE_LIBZBD
   struct ZonedCleanerThread : public Thread {
@@ -2204,6 +2229,8 @@ private:
 
   KeyValueDB *db = nullptr;
   BlockDevice *bdev = nullptr;
+  /// optional pmem staging area for deferred write payloads
+  std::unique_ptr<PMEMDeferredRing> deferred_ring;
   std::string freelist_type;
   FreelistManager *fm = nullptr;
 
@@ -2245,7 +2272,7 @@ private:
   deferred_osr_queue_t deferred_queue; ///< osr's with deferred io pending
   std::atomic_int deferred_queue_size = {0};         ///< num txc's queued across all osrs
   std::atomic_int deferred_aggressive = {0}; ///< aggressive wakeup of kv thread
-  Finisher  finisher;
+  ShardedFinisher finisher;  ///< keyed by OpSequencer
   utime_t  deferred_last_submitted = utime_t();
 
   KVSyncThread kv_sync_thread;
@@ -2269,6 +2296,12 @@ private:
   std::deque<DeferredBatch*> deferred_stable_to_finalize; ///< pending finalization
   bool kv_finalize_in_progress = false;
 
+  /// lanes 1..n-1; only changed by _kv_start/_kv_stop while no kv thread
+  /// runs, so read without a lock
+  std::vector<std::unique_ptr<KVSyncLane>> kv_lanes;
+  /// serializes {nid,blobid}_max updates when there are several lanes
+  ceph::mutex id_max_lock = ceph::make_mutex("BlueStore::id_max_lock");
+
 #ifdef HAVE_LIBZBD
   ZonedCleanerThread zoned_cleaner_thread;
   ceph::mutex zoned_cleaner_lock = ceph::make_mutex("BlueStore::zoned_cleaner_lock");
@@ -2738,6 +2771,15 @@ private:
   void _kv_stop();
   void _kv_sync_thread();
   void _kv_finalize_thread();
+  KVSyncLane *_get_kv_lane(const OpSequencer *osr) {
+    if (kv_lanes.empty()) {
+      return nullptr;
+    }
+    unsigned i = osr->get_sequencer_id() % (kv_lanes.size() + 1);
+    return i ? kv_lanes[i - 1].get() : nullptr;
+  }
+  void _kv_sync_lane_thread(KVSyncLane *lane);
+  void _kv_sync_id_max(uint64_t min_nid, uint64_t min_blobid);
 
 #ifdef HAVE_LIBZBD
   void _zoned_cleaner_start();
@@ -2757,6 +2799,9 @@ private:
   void _deferred_submit_unlock(OpSequencer *osr);
   void _deferred_aio_finish(OpSequencer *osr);
   int _deferred_replay();
+  void _deferred_stage_pmem(bluestore_deferred_transaction_t& wt,
+			    ceph::buffer::list& bl);
+  int _deferred_load_pmem(bluestore_deferred_transaction_t& wt);
   bool _eliminate_outdated_deferred(bluestore_deferred_transaction_t* deferred_txn,
 				    interval_set<uint64_t>& bluefs_extents);
 
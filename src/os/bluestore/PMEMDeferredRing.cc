@@ -0,0 +1,318 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "PMEMDeferredRing.h"
+
+#include "blk/BlockDevice.h"
+#include "include/byteorder.h"
+#include "include/intarith.h"
+#include "common/debug.h"
+#include "common/errno.h"
+
+#define dout_context cct
+#define dout_subsys ceph_subsys_bluestore
+#undef dout_prefix
+#define dout_prefix *_dout << "pmem_deferred_ring(" << path << ") "
+
+using ceph::bufferlist;
+using ceph::bufferptr;
+
+static const std::string RING_MAGIC = "ceph bluestore pmem deferred ring v1";
+static constexpr uint64_t RECORD_MAGIC = 0x444546524d454d50ull; // "PMEMRFED"
+static constexpr uint64_t SUPER_LEN = 4096;
+
+struct pmem_ring_record_header_t {
+  ceph_le64 magic;
+  ceph_le64 seq;
+  ceph_le32 length;       ///< payload length
+  ceph_le32 payload_crc;
+  ceph_le32 header_crc;   ///< crc of the fields above
+  char pad[36];
+} __attribute__ ((packed));
+static_assert(sizeof(pmem_ring_record_header_t) == 64);
+
+static uint32_t header_crc(const pmem_ring_record_header_t& h)
+{
+  return ceph_crc32c(-1, reinterpret_cast<const unsigned char*>(&h),
+		     offsetof(pmem_ring_record_header_t, header_crc));
+}
+
+static void noop_aio_cb(void *priv, void *priv2)
+{
+}
+
+PMEMDeferredRing::PMEMDeferredRing(CephContext *cct)
+  : cct(cct)
+{
+}
+
+PMEMDeferredRing::~PMEMDeferredRing()
+{
+  ceph_assert(!bdev);
+}
+
+int PMEMDeferredRing::open(const std::string& p, const uuid_d& fsid,
+			   bool create)
+{
+  path = p;
+  bdev.reset(BlockDevice::create(cct, path, noop_aio_cb, nullptr,
+				 noop_aio_cb, nullptr));
+  int r = bdev->open(path);
+  if (r < 0) {
+    derr << __func__ << " failed to open: " << cpp_strerror(r) << dendl;
+    bdev.reset();
+    return r;
+  }
+  if (!bdev->is_byte_addressable()) {
+    dout(0) << __func__ << " WARNING: not a persistent memory device; every"
+	    << " deferred write will pay a device flush" << dendl;
+    align = bdev->get_block_size();
+  } else {
+    align = sizeof(pmem_ring_record_header_t);  // one cache line
+  }
+  ring_start = p2roundup(SUPER_LEN, bdev->get_block_size());
+  if (bdev->get_size() < ring_start + 16 * SUPER_LEN) {
+    derr << __func__ << " device too small (" << bdev->get_size() << " bytes)"
+	 << dendl;
+    r = -EINVAL;
+    goto out_close;
+  }
+  ring_len = p2align(bdev->get_size() - ring_start, align);
+
+  r = create ? -ENOENT : _read_super(fsid);
+  if (r == -ENOENT) {
+    // a fresh (or freshly assigned) device: nothing in the KV store can
+    // reference it yet
+    r = _write_super(fsid);
+  }
+  if (r < 0) {
+    goto out_close;
+  }
+  dout(1) << __func__ << " ring 0x" << std::hex << ring_start << "~" << ring_len
+	  << std::dec << " record alignment " << align << dendl;
+  return 0;
+
+ out_close:
+  bdev->close();
+  bdev.reset();
+  return r;
+}
+
+void PMEMDeferredRing::close()
+{
+  if (bdev) {
+    bdev->close();
+    bdev.reset();
+  }
+  reset();
+}
+
+int PMEMDeferredRing::_read_super(const uuid_d& fsid)
+{
+  bufferlist bl;
+  int r = bdev->read(0, SUPER_LEN, &bl, nullptr, false);
+  if (r < 0) {
+    return r;
+  }
+  std::string magic;
+  uuid_d ring_fsid;
+  uint64_t len;
+  uint32_t crc, expected_crc;
+  try {
+    auto p = bl.cbegin();
+    decode(magic, p);
+    if (magic != RING_MAGIC) {
+      dout(1) << __func__ << " no ring superblock found" << dendl;
+      return -ENOENT;
+    }
+    decode(ring_fsid, p);
+    decode(len, p);
+    bufferlist covered;
+    covered.substr_of(bl, 0, p.get_off());
+    expected_crc = covered.crc32c(-1);
+    decode(crc, p);
+  } catch (ceph::buffer::error& e) {
+    return -ENOENT;
+  }
+  if (crc != expected_crc) {
+    derr << __func__ << " superblock crc mismatch" << dendl;
+    return -EIO;
+  }
+  if (ring_fsid != fsid && !fsid.is_zero()) {
+    derr << __func__ << " ring belongs to " << ring_fsid << ", not " << fsid
+	 << dendl;
+    return -EINVAL;
+  }
+  if (len != ring_len) {
+    // the device was resized; existing records stay where they are, and new
+    // ones are only placed after replay has emptied the ring
+    dout(1) << __func__ << " ring length changed 0x" << std::hex << len
+	    << " -> 0x" << ring_len << std::dec << dendl;
+    ring_len = std::min(len, ring_len);
+  }
+  return 0;
+}
+
+int PMEMDeferredRing::_write_super(const uuid_d& fsid)
+{
+  bufferlist bl;
+  encode(RING_MAGIC, bl);
+  encode(fsid, bl);
+  encode(ring_len, bl);
+  uint32_t crc = bl.crc32c(-1);
+  encode(crc, bl);
+  bl.append_zero(ring_start - bl.length());
+  int r = bdev->write(0, bl, false);
+  if (r == 0 && !bdev->is_byte_addressable()) {
+    r = bdev->flush();
+  }
+  if (r < 0) {
+    derr << __func__ << " failed to write superblock: " << cpp_strerror(r)
+	 << dendl;
+  }
+  return r;
+}
+
+bool PMEMDeferredRing::append(uint64_t seq, const bufferlist& payload,
+			      uint64_t *offset, uint32_t *length)
+{
+  const uint64_t need = p2roundup<uint64_t>(
+    sizeof(pmem_ring_record_header_t) + payload.length(), align);
+  if (need > ring_len / 4) {
+    // large payloads would starve the ring; leave them in the KV record
+    return false;
+  }
+
+  uint64_t phys;
+  {
+    std::lock_guard l(lock);
+    // records never wrap around the end of the ring
+    uint64_t pos = tail % ring_len;
+    uint64_t pad = pos + need > ring_len ? ring_len - pos : 0;
+    if (tail + pad + need - head > ring_len) {
+      dout(20) << __func__ << " seq " << seq << " ring full" << dendl;
+      return false;
+    }
+    phys = ring_start + (tail + pad) % ring_len;
+    slots[tail] = slot_t{tail + pad + need};
+    phys_to_logical[phys] = tail;
+    tail += pad + need;
+  }
+
+  pmem_ring_record_header_t h;
+  memset(&h, 0, sizeof(h));
+  h.magic = RECORD_MAGIC;
+  h.seq = seq;
+  h.length = payload.length();
+  h.payload_crc = payload.crc32c(-1);
+  h.header_crc = header_crc(h);
+
+  bufferlist bl;
+  bl.append(reinterpret_cast<const char*>(&h), sizeof(h));
+  bl.append(payload);
+  bl.append_zero(need - bl.length());
+  int r;
+  if (bdev->is_byte_addressable()) {
+    // records are cache line, not block, aligned
+    r = bdev->write_persistent(phys, bl);
+  } else {
+    r = bdev->write(phys, bl, false);
+    if (r == 0) {
+      r = bdev->flush();
+    }
+  }
+  ceph_assert(r == 0);
+
+  dout(20) << __func__ << " seq " << seq << " 0x" << std::hex << phys
+	   << "~" << payload.length() << std::dec << dendl;
+  *offset = phys;
+  *length = payload.length();
+  return true;
+}
+
+int PMEMDeferredRing::read(uint64_t seq, uint64_t offset, uint32_t length,
+			   bufferlist *payload)
+{
+  if (offset < ring_start ||
+      offset + sizeof(pmem_ring_record_header_t) + length >
+        ring_start + ring_len) {
+    derr << __func__ << " seq " << seq << " record 0x" << std::hex << offset
+	 << "~" << length << std::dec << " out of bounds" << dendl;
+    return -EIO;
+  }
+  pmem_ring_record_header_t h;
+  int r = bdev->read_random(offset, sizeof(h), reinterpret_cast<char*>(&h),
+			    false);
+  if (r < 0) {
+    return r;
+  }
+  if (h.magic != RECORD_MAGIC || h.header_crc != header_crc(h) ||
+      h.seq != seq || h.length != length) {
+    derr << __func__ << " seq " << seq << " bad record header at 0x"
+	 << std::hex << offset << std::dec << " (seq " << h.seq
+	 << " length " << h.length << ")" << dendl;
+    return -EIO;
+  }
+  bufferptr bp = ceph::buffer::create_small_page_aligned(length);
+  r = bdev->read_random(offset + sizeof(h), length, bp.c_str(), false);
+  if (r < 0) {
+    return r;
+  }
+  payload->clear();
+  payload->push_back(std::move(bp));
+  if (payload->crc32c(-1) != h.payload_crc) {
+    derr << __func__ << " seq " << seq << " payload crc mismatch at 0x"
+	 << std::hex << offset << std::dec << dendl;
+    return -EIO;
+  }
+  return 0;
+}
+
+void PMEMDeferredRing::release(uint64_t offset)
+{
+  std::lock_guard l(lock);
+  auto p = phys_to_logical.find(offset);
+  if (p == phys_to_logical.end()) {
+    // staged before the last mount and replayed since
+    return;
+  }
+  auto s = slots.find(p->second);
+  ceph_assert(s != slots.end());
+  s->second.released = true;
+  phys_to_logical.erase(p);
+  _trim();
+}
+
+void PMEMDeferredRing::_trim()
+{
+  while (!slots.empty() && slots.begin()->second.released) {
+    head = slots.begin()->second.end;
+    slots.erase(slots.begin());
+  }
+  if (slots.empty()) {
+    head = tail;
+  }
+}
+
+void PMEMDeferredRing::reset()
+{
+  std::lock_guard l(lock);
+  slots.clear();
+  phys_to_logical.clear();
+  head = tail = 0;
+}
+
+uint64_t PMEMDeferredRing::get_used() const
+{
+  std::lock_guard l(lock);
+  return tail - head;
+}
@@ -0,0 +1,96 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_OS_BLUESTORE_PMEMDEFERREDRING_H
+#define CEPH_OS_BLUESTORE_PMEMDEFERREDRING_H
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "include/buffer.h"
+#include "include/uuid.h"
+#include "common/ceph_mutex.h"
+
+class BlockDevice;
+class CephContext;
+
+/**
+ * Staging ring for deferred write payloads on a persistent memory device.
+ *
+ * Deferred writes normally carry their data inside the
+ * bluestore_deferred_transaction_t record committed to the KV store, so
+ * the data lands in the KV WAL before it is written to the main device.
+ * With the ring enabled the payload is persisted here before the KV commit
+ * and the KV record only references its location.
+ *
+ * Every record carries a header with the deferred sequence number and
+ * checksums so replay can verify it.  A slot is only reused once the KV
+ * record referencing it is gone, so no head/tail pointers are persisted:
+ * replay reads exactly the slots that surviving deferred records point at.
+ */
+class PMEMDeferredRing {
+public:
+  explicit PMEMDeferredRing(CephContext *cct);
+  ~PMEMDeferredRing();
+
+  /// open (and format if needed or requested) the ring at path
+  int open(const std::string& path, const uuid_d& fsid, bool create);
+  void close();
+
+  /**
+   * persist payload for deferred transaction seq
+   *
+   * @returns false if the ring is too full; the caller falls back to
+   *          keeping the data in the KV record
+   */
+  bool append(uint64_t seq, const ceph::buffer::list& payload,
+	      uint64_t *offset, uint32_t *length);
+  /// read back and verify the payload of deferred transaction seq
+  int read(uint64_t seq, uint64_t offset, uint32_t length,
+	   ceph::buffer::list *payload);
+  /// free the slot at offset; its KV record must already be removed
+  void release(uint64_t offset);
+  /// forget all slots (after replay, nothing references the ring anymore)
+  void reset();
+
+  uint64_t get_size() const {
+    return ring_len;
+  }
+  uint64_t get_used() const;
+
+private:
+  struct slot_t {
+    uint64_t end;           ///< logical end, including alignment/wrap padding
+    bool released = false;
+  };
+
+  CephContext *cct;
+  std::unique_ptr<BlockDevice> bdev;
+  std::string path;
+  uint64_t align = 0;       ///< record alignment
+  uint64_t ring_start = 0;  ///< device offset of the first record
+  uint64_t ring_len = 0;
+
+  mutable ceph::mutex lock = ceph::make_mutex("PMEMDeferredRing::lock");
+  /// logical (monotonic) positions; physical = ring_start + pos % ring_len
+  uint64_t head = 0;
+  uint64_t tail = 0;
+  std::map<uint64_t, slot_t> slots;           ///< logical start -> slot
+  std::map<uint64_t, uint64_t> phys_to_logical;
+
+  int _read_super(const uuid_d& fsid);
+  int _write_super(const uuid_d& fsid);
+  void _trim();
+};
+
+#endif
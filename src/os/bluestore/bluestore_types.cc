@@ -1148,6 +1148,10 @@ void bluestore_deferred_op_t::generate_test_instances(list<bluestore_deferred_op
 void bluestore_deferred_transaction_t::dump(Formatter *f) const
 {
   f->dump_unsigned("seq", seq);
+  if (is_pmem_staged()) {
+    f->dump_unsigned("pmem_offset", pmem_offset);
+    f->dump_unsigned("pmem_length", pmem_length);
+  }
   f->open_array_section("ops");
   for (list<bluestore_deferred_op_t>::const_iterator p = ops.begin(); p != ops.end(); ++p) {
     f->dump_object("op", *p);
@@ -1174,6 +1178,13 @@ void bluestore_deferred_transaction_t::generate_test_instances(list<bluestore_de
   o.back()->ops.back().op = bluestore_deferred_op_t::OP_WRITE;
   o.back()->ops.back().extents.push_back(bluestore_pextent_t(1,7));
   o.back()->ops.back().data.append("foodata");
+  o.push_back(new bluestore_deferred_transaction_t());
+  o.back()->seq = 124;
+  o.back()->ops.push_back(bluestore_deferred_op_t());
+  o.back()->ops.back().op = bluestore_deferred_op_t::OP_WRITE;
+  o.back()->ops.back().extents.push_back(bluestore_pextent_t(0x1000, 0x1000));
+  o.back()->pmem_offset = 0x2000;
+  o.back()->pmem_length = 0x1000;
 }
 
 void bluestore_compression_header_t::dump(Formatter *f) const
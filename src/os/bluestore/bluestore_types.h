@@ -1090,13 +1090,26 @@ struct bluestore_deferred_transaction_t {
   std::list<bluestore_deferred_op_t> ops;
   interval_set<uint64_t> released;  ///< allocations to release after tx
 
+  /// if pmem_length != 0, the ops' data is not part of this record but is
+  /// staged in the pmem deferred ring at pmem_offset (see PMEMDeferredRing)
+  uint64_t pmem_offset = 0;
+  uint32_t pmem_length = 0;
+
   bluestore_deferred_transaction_t() : seq(0) {}
 
+  bool is_pmem_staged() const {
+    return pmem_length != 0;
+  }
+
   DENC(bluestore_deferred_transaction_t, v, p) {
-    DENC_START(1, 1, p);
+    DENC_START(2, 1, p);
     denc(v.seq, p);
     denc(v.ops, p);
     denc(v.released, p);
+    if (struct_v >= 2) {
+      denc(v.pmem_offset, p);
+      denc(v.pmem_length, p);
+    }
     DENC_FINISH(p);
   }
   void dump(ceph::Formatter *f) const;
@@ -172,6 +172,7 @@ ostream &operator<<(ostream &lhs, const ECBackend::Op &rhs)
       << " pending_read=" << rhs.pending_read
       << " remote_read=" << rhs.remote_read
       << " remote_read_result=" << rhs.remote_read_result
+      << " delta_writes=" << rhs.plan.delta_writes.size()
       << " pending_apply=" << rhs.pending_apply
       << " pending_commit=" << rhs.pending_commit
       << " plan.to_read=" << rhs.plan.to_read
@@ -1940,12 +1941,28 @@ bool ECBackend::try_state_to_reads()
     return false;
   }
 
+  if (op->requires_rmw()) {
+    for (auto &&hpair: op->plan.to_read) {
+      if (uncached_write_in_flight(hpair.first)) {
+	dout(20) << __func__ << ": blocking " << *op
+		 << " because it requires an rmw of " << hpair.first
+		 << " and an uncached write to it is in flight"
+		 << dendl;
+	return false;
+      }
+    }
+  }
+
   if (!pipeline_state.caching_enabled()) {
     op->using_cache = false;
   } else if (op->invalidates_cache()) {
     dout(20) << __func__ << ": invalidating cache after this op"
 	     << dendl;
     pipeline_state.invalidate();
+  } else if (op->requires_rmw() && try_plan_delta_writes(op)) {
+    // the new stripes never exist in full on the primary, so there is
+    // nothing to present to the cache
+    op->using_cache = false;
   }
 
   waiting_state.pop_front();
@@ -1986,19 +2003,180 @@ bool ECBackend::try_state_to_reads()
 
   if (!op->remote_read.empty()) {
     ceph_assert(get_parent()->get_pool().allows_ecoverwrites());
-    objects_read_async_no_cache(
-      op->remote_read,
-      [this, op](map<hobject_t,pair<int, extent_map> > &&results) {
-	for (auto &&i: results) {
-	  op->remote_read_result.emplace(i.first, i.second.second);
-	}
-	check_ops();
-      });
+    if (op->is_delta_write()) {
+      start_delta_reads(op);
+    } else {
+      start_rmw_reads(op);
+    }
   }
 
   return true;
 }
 
+bool ECBackend::uncached_write_in_flight(const hobject_t &oid) const
+{
+  // While the cache is valid, only delta writes bypass it.  Their reads
+  // and writes are not visible through the cache, so an rmw of the same
+  // object has to wait for them to finish.
+  for (auto *l : {&waiting_reads, &waiting_commit}) {
+    for (auto &&op : *l) {
+      if (!op.using_cache && op.plan.will_write.count(oid)) {
+	return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool ECBackend::try_plan_delta_writes(Op *op)
+{
+  if (!cct->_conf->osd_ec_parity_delta_writes) {
+    return false;
+  }
+  for (auto &&hpair: op->plan.to_read) {
+    if (cache.has_pinned_extents(hpair.first)) {
+      // an earlier write to the object is only complete in the cache
+      return false;
+    }
+  }
+  if (!ECTransaction::plan_delta_writes(
+	sinfo, ec_impl, op->plan, get_parent()->get_dpp())) {
+    return false;
+  }
+  for (auto &&[hoid, dw] : op->plan.delta_writes) {
+    set<int> have;
+    map<shard_id_t, pg_shard_t> shards;
+    get_all_avail_shards(hoid, set<pg_shard_t>(), have, shards, false);
+    for (auto &&s : {&dw.data_shards, &dw.coding_shards}) {
+      if (!std::includes(have.begin(), have.end(), s->begin(), s->end())) {
+	dout(20) << __func__ << ": " << hoid << " has shards " << have
+		 << ", reading the full stripes" << dendl;
+	op->plan.delta_writes.clear();
+	return false;
+      }
+    }
+  }
+  return true;
+}
+
+void ECBackend::start_rmw_reads(Op *op)
+{
+  objects_read_async_no_cache(
+    op->remote_read,
+    [this, op](map<hobject_t,pair<int, extent_map> > &&results) {
+      for (auto &&i: results) {
+	op->remote_read_result.emplace(i.first, i.second.second);
+      }
+      check_ops();
+    });
+}
+
+struct FinishDeltaRead :
+  public GenContext<pair<RecoveryMessages*, ECBackend::read_result_t& > &> {
+  ECBackend *ec;
+  ECBackend::Op *op;
+  hobject_t hoid;
+  FinishDeltaRead(ECBackend *ec, ECBackend::Op *op, const hobject_t &hoid)
+    : ec(ec), op(op), hoid(hoid) {}
+  void finish(pair<RecoveryMessages *, ECBackend::read_result_t &> &in) override {
+    ec->finish_delta_read(op, hoid, in.second);
+  }
+};
+
+void ECBackend::start_delta_reads(Op *op)
+{
+  map<hobject_t, set<int>> want_to_read;
+  map<hobject_t, read_request_t> for_read_op;
+  for (auto &&[hoid, dw] : op->plan.delta_writes) {
+    set<int> have;
+    map<shard_id_t, pg_shard_t> shards;
+    get_all_avail_shards(hoid, set<pg_shard_t>(), have, shards, false);
+
+    set<int> &want = want_to_read[hoid];
+    want.insert(dw.data_shards.begin(), dw.data_shards.end());
+    want.insert(dw.coding_shards.begin(), dw.coding_shards.end());
+    map<pg_shard_t, vector<pair<int, int>>> need;
+    for (auto shard : want) {
+      need[shards.at(shard_id_t(shard))].push_back(
+	make_pair(0, ec_impl->get_sub_chunk_count()));
+    }
+    list<boost::tuple<uint64_t, uint64_t, uint32_t> > to_read;
+    for (auto &&extent : dw.stripes) {
+      to_read.push_back(boost::make_tuple(extent.first, extent.second, 0));
+    }
+    for_read_op.insert(
+      make_pair(
+	hoid,
+	read_request_t(
+	  to_read,
+	  need,
+	  false,
+	  new FinishDeltaRead(this, op, hoid))));
+  }
+  start_read_op(
+    CEPH_MSG_PRIO_DEFAULT,
+    want_to_read,
+    for_read_op,
+    OpRequestRef(),
+    false, false);
+}
+
+void ECBackend::finish_delta_read(
+  Op *op,
+  const hobject_t &hoid,
+  read_result_t &res)
+{
+  if (!op->is_delta_write()) {
+    // an earlier object of the same read fell back to full stripes
+    return;
+  }
+  const auto &dw = op->plan.delta_writes.at(hoid);
+  map<int, extent_map> chunks;
+  if (res.r == 0) {
+    for (auto &&extent : res.returned) {
+      uint64_t chunk_off = sinfo.aligned_logical_offset_to_chunk_offset(
+	extent.get<0>());
+      uint64_t chunk_len = sinfo.aligned_logical_offset_to_chunk_offset(
+	extent.get<1>());
+      for (auto &&[shard, bl] : extent.get<2>()) {
+	if (bl.length() != chunk_len) {
+	  continue;
+	}
+	chunks[shard.shard].insert(chunk_off, chunk_len, bl);
+      }
+    }
+  }
+  extent_set expected;
+  for (auto &&extent : dw.stripes) {
+    auto chunk = sinfo.aligned_offset_len_to_chunk(extent);
+    expected.insert(chunk.first, chunk.second);
+  }
+  bool complete = res.r == 0;
+  for (auto &&s : {&dw.data_shards, &dw.coding_shards}) {
+    for (auto shard : *s) {
+      auto c = chunks.find(shard);
+      if (c == chunks.end() || !(c->second.get_interval_set() == expected)) {
+	complete = false;
+      }
+    }
+  }
+  if (!complete) {
+    // a shard failed to read: the normal path reconstructs the stripes
+    // from whatever k shards are left
+    dout(10) << __func__ << ": " << hoid << " r=" << res.r
+	     << " errors=" << res.errors
+	     << ", falling back to full stripe reads for " << *op << dendl;
+    op->plan.delta_writes.clear();
+    op->delta_read_result.clear();
+    start_rmw_reads(op);
+    return;
+  }
+  op->delta_read_result[hoid] = std::move(chunks);
+  if (!op->read_in_progress()) {
+    check_ops();
+  }
+}
+
 bool ECBackend::try_reads_to_commit()
 {
   if (waiting_reads.empty())
@@ -2047,6 +2225,7 @@ bool ECBackend::try_reads_to_commit()
       get_parent()->get_info().pgid.pgid,
       sinfo,
       op->remote_read_result,
+      op->delta_read_result,
       op->log_entries,
       &written,
       &trans,
@@ -2074,6 +2253,9 @@ bool ECBackend::try_reads_to_commit()
   for (auto &&i: written) {
     written_set[i.first] = i.second.get_interval_set();
   }
+  for (auto &&i: op->plan.delta_writes) {
+    written_set[i.first] = i.second.stripes;
+  }
   dout(20) << __func__ << ": written_set: " << written_set << dendl;
   ceph_assert(written_set == op->plan.will_write);
 
@@ -2085,6 +2267,7 @@ bool ECBackend::try_reads_to_commit()
   }
   op->remote_read.clear();
   op->remote_read_result.clear();
+  op->delta_read_result.clear();
 
   ObjectStore::Transaction empty;
   bool should_write_local = false;
@@ -481,7 +481,13 @@ public:
     std::map<hobject_t,extent_set> pending_read; // subset already being read
     std::map<hobject_t,extent_set> remote_read;  // subset we must read
     std::map<hobject_t,extent_map> remote_read_result;
+    /// old data and coding chunks read for plan.delta_writes, by shard
+    std::map<hobject_t,std::map<int,extent_map>> delta_read_result;
+    bool is_delta_write() const { return !plan.delta_writes.empty(); }
     bool read_in_progress() const {
+      if (is_delta_write()) {
+	return delta_read_result.size() < remote_read.size();
+      }
       return !remote_read.empty() && remote_read_result.empty();
     }
 
@@ -562,6 +568,12 @@ public:
   eversion_t committed_to;
   void start_rmw(Op *op, PGTransactionUPtr &&t);
   bool try_state_to_reads();
+  bool uncached_write_in_flight(const hobject_t &oid) const;
+  bool try_plan_delta_writes(Op *op);
+  void start_rmw_reads(Op *op);
+  void start_delta_reads(Op *op);
+  friend struct FinishDeltaRead;
+  void finish_delta_read(Op *op, const hobject_t &hoid, read_result_t &res);
   bool try_reads_to_commit();
   bool try_finish_rmw();
   void check_ops();
@@ -93,6 +93,215 @@ void encode_and_write(
   }
 }
 
+static bufferlist get_chunk_range(
+  const extent_map &chunks,
+  uint64_t off,
+  uint64_t len)
+{
+  bufferlist bl;
+  for (auto &&extent : chunks.intersect(off, len)) {
+    ceph_assert(extent.get_off() == off + bl.length());
+    bl.append(extent.get_val());
+  }
+  ceph_assert(bl.length() == len);
+  return bl;
+}
+
+void delta_write(
+  pg_t pgid,
+  const hobject_t &oid,
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ecimpl,
+  const PGTransaction::ObjectOperation &op,
+  const ECTransaction::WritePlan::delta_write_t &plan,
+  const map<int, extent_map> &old_chunks,
+  pg_log_entry_t *entry,
+  ECUtil::HashInfoRef hinfo,
+  map<shard_id_t, ObjectStore::Transaction> *transactions,
+  DoutPrefixProvider *dpp) {
+  const uint64_t chunk_size = sinfo.get_chunk_size();
+  const uint64_t stripe_width = sinfo.get_stripe_width();
+  const vector<int> &mapping = ecimpl->get_chunk_mapping();
+  auto shard_of = [&mapping](unsigned i) {
+    return mapping.size() > i ? mapping[i] : (int)i;
+  };
+
+  // apply the buffer updates to the old data chunks
+  map<int, extent_map> new_chunks;
+  for (auto shard : plan.data_shards) {
+    new_chunks[shard] = old_chunks.at(shard);
+  }
+  uint32_t fadvise_flags = 0;
+  for (auto &&extent: op.buffer_updates) {
+    using BufferUpdate = PGTransaction::ObjectOperation::BufferUpdate;
+    bufferlist bl;
+    match(
+      extent.get_val(),
+      [&](const BufferUpdate::Write &op) {
+	bl = op.buffer;
+	fadvise_flags |= op.fadvise_flags;
+      },
+      [&](const BufferUpdate::Zero &) {
+	bl.append_zero(extent.get_len());
+      },
+      [&](const BufferUpdate::CloneRange &) {
+	ceph_assert(
+	  0 ==
+	  "CloneRange is not allowed, do_op should have returned ENOTSUPP");
+      });
+    uint64_t pos = 0;
+    while (pos < extent.get_len()) {
+      uint64_t logical = extent.get_off() + pos;
+      uint64_t in_chunk = logical % chunk_size;
+      uint64_t len = std::min(chunk_size - in_chunk, extent.get_len() - pos);
+      bufferlist piece;
+      piece.substr_of(bl, pos, len);
+      new_chunks[shard_of((logical % stripe_width) / chunk_size)].insert(
+	sinfo.logical_to_prev_chunk_offset(logical) + in_chunk,
+	len,
+	piece);
+      pos += len;
+    }
+  }
+
+  vector<pair<uint64_t, uint64_t> > rollback_extents;
+  for (auto &&extent : plan.stripes) {
+    uint64_t chunk_off = sinfo.aligned_logical_offset_to_chunk_offset(
+      extent.first);
+    uint64_t chunk_len = sinfo.aligned_logical_offset_to_chunk_offset(
+      extent.second);
+    ldpp_dout(dpp, 20) << __func__ << ": " << oid << " updating "
+		       << chunk_off << "~" << chunk_len
+		       << " data shards " << plan.data_shards
+		       << " coding shards " << plan.coding_shards
+		       << dendl;
+
+    // the shards we don't write must be able to roll back too
+    if (entry) {
+      if (rollback_extents.empty()) {
+	for (auto &&st : *transactions) {
+	  st.second.touch(
+	    coll_t(spg_t(pgid, st.first)),
+	    ghobject_t(oid, entry->version.version, st.first));
+	}
+      }
+      rollback_extents.emplace_back(make_pair(chunk_off, chunk_len));
+      for (auto &&st : *transactions) {
+	st.second.clone_range(
+	  coll_t(spg_t(pgid, st.first)),
+	  ghobject_t(oid, ghobject_t::NO_GEN, st.first),
+	  ghobject_t(oid, entry->version.version, st.first),
+	  chunk_off,
+	  chunk_len,
+	  chunk_off);
+      }
+    }
+
+    map<int, bufferlist> deltas;
+    map<int, bufferlist> to_write;
+    for (auto shard : plan.data_shards) {
+      bufferlist old_bl = get_chunk_range(old_chunks.at(shard),
+					  chunk_off, chunk_len);
+      bufferlist &new_bl = to_write[shard];
+      new_bl = get_chunk_range(new_chunks[shard], chunk_off, chunk_len);
+      ecimpl->encode_delta(old_bl, new_bl, &deltas[shard]);
+    }
+    map<int, bufferlist> coding;
+    for (auto shard : plan.coding_shards) {
+      // apply_delta() works in place: never on the buffers we read
+      bufferptr bp = ceph::buffer::create_page_aligned(chunk_len);
+      get_chunk_range(old_chunks.at(shard), chunk_off, chunk_len).begin().copy(
+	chunk_len, bp.c_str());
+      coding[shard].push_back(std::move(bp));
+    }
+    int r = ecimpl->apply_delta(deltas, &coding);
+    ceph_assert(r == 0);
+    to_write.merge(coding);
+
+    for (auto &&st : *transactions) {
+      auto w = to_write.find(st.first);
+      if (w == to_write.end()) {
+	continue;
+      }
+      st.second.write(
+	coll_t(spg_t(pgid, st.first)),
+	ghobject_t(oid, ghobject_t::NO_GEN, st.first),
+	chunk_off,
+	chunk_len,
+	w->second,
+	fadvise_flags);
+    }
+  }
+
+  if (entry) {
+    ldpp_dout(dpp, 20) << __func__ << ": " << oid
+		       << " marking rollback extents "
+		       << rollback_extents
+		       << dendl;
+    entry->mod_desc.rollback_extents(
+      entry->version.version, rollback_extents);
+  }
+  hinfo->set_total_chunk_size_clear_hash(hinfo->get_total_chunk_size());
+}
+
+bool ECTransaction::plan_delta_writes(
+  const ECUtil::stripe_info_t &sinfo,
+  ErasureCodeInterfaceRef &ecimpl,
+  WritePlan &plan,
+  DoutPrefixProvider *dpp)
+{
+  ceph_assert(plan.delta_writes.empty());
+  if (plan.to_read.empty() || plan.invalidates_cache ||
+      !ecimpl->supports_parity_delta()) {
+    return false;
+  }
+  const unsigned k = ecimpl->get_data_chunk_count();
+  const unsigned m = ecimpl->get_chunk_count() - k;
+  const uint64_t chunk_size = sinfo.get_chunk_size();
+  const uint64_t stripe_width = sinfo.get_stripe_width();
+  const vector<int> &mapping = ecimpl->get_chunk_mapping();
+  auto shard_of = [&mapping](unsigned i) {
+    return mapping.size() > i ? mapping[i] : (int)i;
+  };
+
+  map<hobject_t, WritePlan::delta_write_t> delta_writes;
+  for (auto &&[oid, to_read] : plan.to_read) {
+    auto op = plan.t->op_map.find(oid);
+    // every stripe written must be a partial stripe we would read: no
+    // appends, no full stripes, no truncates
+    if (op == plan.t->op_map.end() ||
+	!op->second.is_none() ||
+	op->second.truncate ||
+	!(plan.will_write[oid] == to_read)) {
+      ldpp_dout(dpp, 20) << __func__ << ": " << oid
+			 << " is not a plain overwrite" << dendl;
+      return false;
+    }
+    auto &dw = delta_writes[oid];
+    dw.stripes = to_read;
+    for (auto &&extent : op->second.buffer_updates) {
+      for (uint64_t off = extent.get_off();
+	   off < extent.get_off() + extent.get_len();
+	   off = (off / chunk_size + 1) * chunk_size) {
+	dw.data_shards.insert(shard_of((off % stripe_width) / chunk_size));
+      }
+    }
+    // the full stripe path reads k chunks per stripe
+    if (dw.data_shards.size() + m > k) {
+      ldpp_dout(dpp, 20) << __func__ << ": " << oid << " changes "
+			 << dw.data_shards.size() << " of " << k
+			 << " data chunks, reading the stripe is cheaper"
+			 << dendl;
+      return false;
+    }
+    for (unsigned i = k; i < k + m; ++i) {
+      dw.coding_shards.insert(shard_of(i));
+    }
+  }
+  plan.delta_writes = std::move(delta_writes);
+  return true;
+}
+
 bool ECTransaction::requires_overwrite(
   uint64_t prev_size,
   const PGTransaction::ObjectOperation &op) {
@@ -112,6 +321,7 @@ void ECTransaction::generate_transactions(
   pg_t pgid,
   const ECUtil::stripe_info_t &sinfo,
   const map<hobject_t,extent_map> &partial_extents,
+  const map<hobject_t,map<int,extent_map>> &delta_chunks,
   vector<pg_log_entry_t> &entries,
   map<hobject_t,extent_map> *written_map,
   map<shard_id_t, ObjectStore::Transaction> *transactions,
@@ -400,6 +610,34 @@ void ECTransaction::generate_transactions(
 	}
       }
 
+      auto dwiter = plan.delta_writes.find(oid);
+      if (dwiter != plan.delta_writes.end()) {
+	auto dciter = delta_chunks.find(oid);
+	ceph_assert(dciter != delta_chunks.end());
+	delta_write(
+	  pgid,
+	  oid,
+	  sinfo,
+	  ecimpl,
+	  op,
+	  dwiter->second,
+	  dciter->second,
+	  entry,
+	  hinfo,
+	  transactions,
+	  dpp);
+	bufferlist hbuf;
+	encode(*hinfo, hbuf);
+	for (auto &&i : *transactions) {
+	  i.second.setattr(
+	    coll_t(spg_t(pgid, i.first)),
+	    ghobject_t(oid, ghobject_t::NO_GEN, i.first),
+	    ECUtil::get_hinfo_key(),
+	    hbuf);
+	}
+	return;
+      }
+
       extent_map to_write;
       auto pextiter = partial_extents.find(oid);
       if (pextiter != partial_extents.end()) {
@@ -30,6 +30,15 @@ namespace ECTransaction {
     std::map<hobject_t,extent_set> will_write; // superset of to_read
 
     std::map<hobject_t,ECUtil::HashInfoRef> hash_infos;
+
+    /// partial stripe overwrite updating the coding chunks with deltas
+    struct delta_write_t {
+      std::set<int> data_shards;   ///< data chunks the write changes
+      std::set<int> coding_shards;
+      extent_set stripes;          ///< logical, stripe aligned
+    };
+    /// set by plan_delta_writes(), replaces to_read for these objects
+    std::map<hobject_t,delta_write_t> delta_writes;
   };
 
   bool requires_overwrite(
@@ -182,12 +191,34 @@ namespace ECTransaction {
     return plan;
   }
 
+  /**
+   * Plan parity delta updates for the objects of plan that need a
+   * read-modify-write
+   *
+   * A partial stripe overwrite normally reads the data chunks of the
+   * stripes it touches and encodes them again.  If the plugin supports
+   * it, it can instead read the old version of the data chunks it
+   * changes and of the coding chunks, and update the coding chunks
+   * with the difference, which reads and writes fewer shards when the
+   * write touches few data chunks.
+   *
+   * Fills plan.delta_writes and returns true if every object reading
+   * partial stripes qualifies (overwrite of existing stripes only) and
+   * reads fewer chunks that way.
+   */
+  bool plan_delta_writes(
+    const ECUtil::stripe_info_t &sinfo,
+    ceph::ErasureCodeInterfaceRef &ecimpl,
+    WritePlan &plan,
+    DoutPrefixProvider *dpp);
+
   void generate_transactions(
     WritePlan &plan,
     ceph::ErasureCodeInterfaceRef &ecimpl,
     pg_t pgid,
     const ECUtil::stripe_info_t &sinfo,
     const std::map<hobject_t,extent_map> &partial_extents,
+    const std::map<hobject_t,std::map<int,extent_map>> &delta_chunks,
     std::vector<pg_log_entry_t> &entries,
     std::map<hobject_t,extent_map> *written,
     std::map<shard_id_t, ObjectStore::Transaction> *transactions,
@@ -31,18 +31,26 @@ int ECUtil::decode(
   if (total_data_size == 0)
     return 0;
 
+  const vector<int> &mapping = ec_impl->get_chunk_mapping();
+  const unsigned k = ec_impl->get_data_chunk_count();
+  set<int> want;
+  for (unsigned i = 0; i < k; i++) {
+    want.insert(mapping.size() > i ? mapping[i] : i);
+  }
+  map<int, bufferlist> decoded;
+  int r = ec_impl->decode_stripes(want, to_decode, &decoded,
+				  sinfo.get_chunk_size());
+  ceph_assert(r == 0);
+  for (auto shard : want) {
+    ceph_assert(decoded[shard].length() == total_data_size);
+  }
   for (uint64_t i = 0; i < total_data_size; i += sinfo.get_chunk_size()) {
-    map<int, bufferlist> chunks;
-    for (map<int, bufferlist>::iterator j = to_decode.begin();
-	 j != to_decode.end();
-	 ++j) {
-      chunks[j->first].substr_of(j->second, i, sinfo.get_chunk_size());
+    for (unsigned j = 0; j < k; j++) {
+      bufferlist bl;
+      bl.substr_of(decoded[mapping.size() > j ? mapping[j] : j],
+		   i, sinfo.get_chunk_size());
+      out->claim_append(bl);
     }
-    bufferlist bl;
-    int r = ec_impl->decode_concat(chunks, &bl);
-    ceph_assert(r == 0);
-    ceph_assert(bl.length() == sinfo.get_stripe_width());
-    out->claim_append(bl);
   }
   return 0;
 }
@@ -96,23 +104,35 @@ int ECUtil::decode(
     }
   }
 
-  for (int i = 0; i < chunks_count; i++) {
-    map<int, bufferlist> chunks;
-    for (auto j = to_decode.begin();
-	 j != to_decode.end();
-	 ++j) {
-      chunks[j->first].substr_of(j->second, 
-                                 i*repair_data_per_chunk, 
-                                 repair_data_per_chunk);
-    }
+  if (repair_data_per_chunk == (int)sinfo.get_chunk_size()) {
+    // whole chunks: decode every stripe at once
     map<int, bufferlist> out_bls;
-    r = ec_impl->decode(need, chunks, &out_bls, sinfo.get_chunk_size());
+    r = ec_impl->decode_stripes(need, to_decode, &out_bls,
+				sinfo.get_chunk_size());
     ceph_assert(r == 0);
     for (auto j = out.begin(); j != out.end(); ++j) {
       ceph_assert(out_bls.count(j->first));
-      ceph_assert(out_bls[j->first].length() == sinfo.get_chunk_size());
       j->second->claim_append(out_bls[j->first]);
     }
+  } else {
+    for (int i = 0; i < chunks_count; i++) {
+      map<int, bufferlist> chunks;
+      for (auto j = to_decode.begin();
+	   j != to_decode.end();
+	   ++j) {
+	chunks[j->first].substr_of(j->second, 
+				   i*repair_data_per_chunk, 
+				   repair_data_per_chunk);
+      }
+      map<int, bufferlist> out_bls;
+      r = ec_impl->decode(need, chunks, &out_bls, sinfo.get_chunk_size());
+      ceph_assert(r == 0);
+      for (auto j = out.begin(); j != out.end(); ++j) {
+	ceph_assert(out_bls.count(j->first));
+	ceph_assert(out_bls[j->first].length() == sinfo.get_chunk_size());
+	j->second->claim_append(out_bls[j->first]);
+      }
+    }
   }
   for (auto &&i : out) {
     ceph_assert(i.second->length() == chunks_count * sinfo.get_chunk_size());
@@ -136,19 +156,8 @@ int ECUtil::encode(
   if (logical_size == 0)
     return 0;
 
-  for (uint64_t i = 0; i < logical_size; i += sinfo.get_stripe_width()) {
-    map<int, bufferlist> encoded;
-    bufferlist buf;
-    buf.substr_of(in, i, sinfo.get_stripe_width());
-    int r = ec_impl->encode(want, buf, &encoded);
-    ceph_assert(r == 0);
-    for (map<int, bufferlist>::iterator i = encoded.begin();
-	 i != encoded.end();
-	 ++i) {
-      ceph_assert(i->second.length() == sinfo.get_chunk_size());
-      (*out)[i->first].claim_append(i->second);
-    }
-  }
+  int r = ec_impl->encode_stripes(want, in, sinfo.get_stripe_width(), out);
+  ceph_assert(r == 0);
 
   for (map<int, bufferlist>::iterator i = out->begin();
        i != out->end();
@@ -473,6 +473,14 @@ public:
     write_pin &pin,
     const extent_map &extents);
 
+  /**
+   * True if any write pin holds extents of oid, i.e. a write to oid is
+   * still in flight through the cache
+   */
+  bool has_pinned_extents(const hobject_t &oid) {
+    return get_if_exists(oid) != nullptr;
+  }
+
   /**
    * Release all buffers pinned by pin
    */
@@ -14,6 +14,8 @@
 
 #include "HitSet.h"
 #include "common/Formatter.h"
+#include "include/byteorder.h"
+#include "include/intarith.h"
 
 using std::ostream;
 using std::list;
@@ -41,6 +43,10 @@ HitSet::HitSet(const HitSet::Params& params)
     impl.reset(new ExplicitObjectHitSet(static_cast<ExplicitObjectHitSet::Params*>(params.impl.get())));
     break;
 
+  case TYPE_CUCKOO:
+    impl.reset(new CuckooHitSet(static_cast<CuckooHitSet::Params*>(params.impl.get())));
+    break;
+
   default:
     assert (0 == "unknown HitSet type");
   }
@@ -75,6 +81,9 @@ void HitSet::decode(ceph::buffer::list::const_iterator& bl)
   case TYPE_BLOOM:
     impl.reset(new BloomHitSet);
     break;
+  case TYPE_CUCKOO:
+    impl.reset(new CuckooHitSet);
+    break;
   case TYPE_NONE:
     impl.reset(NULL);
     break;
@@ -109,6 +118,10 @@ void HitSet::generate_test_instances(list<HitSet*>& o)
   o.back()->insert(hobject_t());
   o.back()->insert(hobject_t("asdf", "", CEPH_NOSNAP, 123, 1, ""));
   o.back()->insert(hobject_t("qwer", "", CEPH_NOSNAP, 456, 1, ""));
+  o.push_back(new HitSet(new CuckooHitSet(10, 1)));
+  o.back()->insert(hobject_t());
+  o.back()->insert(hobject_t("asdf", "", CEPH_NOSNAP, 123, 1, ""));
+  o.back()->insert(hobject_t("qwer", "", CEPH_NOSNAP, 456, 1, ""));
 }
 
 HitSet::Params::Params(const Params& o) noexcept
@@ -162,6 +175,9 @@ bool HitSet::Params::create_impl(impl_type_t type)
   case TYPE_BLOOM:
     impl.reset(new BloomHitSet::Params);
     break;
+  case TYPE_CUCKOO:
+    impl.reset(new CuckooHitSet::Params);
+    break;
   case TYPE_NONE:
     impl.reset(NULL);
     break;
@@ -207,6 +223,8 @@ void HitSet::Params::generate_test_instances(list<HitSet::Params*>& o)
   loop_hitset_params(ExplicitHashHitSet);
   o.push_back(new Params(new ExplicitObjectHitSet::Params));
   loop_hitset_params(ExplicitObjectHitSet);
+  o.push_back(new Params(new CuckooHitSet::Params));
+  loop_hitset_params(CuckooHitSet);
 }
 
 ostream& operator<<(ostream& out, const HitSet::Params& p) {
@@ -254,3 +272,346 @@ void BloomHitSet::dump(Formatter *f) const {
   bloom.dump(f);
   f->close_section();
 }
+
+// -- CuckooHitSet --
+
+static inline uint64_t hitset_mix(uint64_t h)
+{
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ull;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebull;
+  h ^= h >> 31;
+  return h;
+}
+
+static constexpr uint64_t CUCKOO_LANES = 0x0001000100010001ull;
+static constexpr uint64_t CUCKOO_FP_MASK = 0xfff0fff0fff0fff0ull;
+static constexpr uint16_t CUCKOO_COUNT_MASK = 0xf;
+
+/// bit offset of the lane flagged by the high bit set in m
+static inline unsigned cuckoo_lane_shift(uint64_t m)
+{
+  return ctz(m) - 15;
+}
+
+CuckooHitSet::CuckooHitSet(uint64_t target_size, uint64_t seed)
+  : seed(seed)
+{
+  // stay under ~90% full, where inserts start failing
+  uint64_t want = std::max<uint64_t>(target_size, 1) * 10 / 9 / SLOTS + 1;
+  uint32_t n = 1;
+  while (n < want) {
+    n <<= 1;
+  }
+  table = ceph::buffer::create(n * sizeof(uint64_t));
+  table.zero();
+}
+
+uint64_t CuckooHitSet::get_bucket(uint32_t b) const
+{
+  ceph_le64 w;
+  memcpy(&w, table.c_str() + b * sizeof(w), sizeof(w));
+  return w;
+}
+
+void CuckooHitSet::set_bucket(uint32_t b, uint64_t w)
+{
+  ceph_le64 v(w);
+  memcpy(table.c_str() + b * sizeof(v), &v, sizeof(v));
+}
+
+uint32_t CuckooHitSet::alt_bucket(uint32_t b, uint16_t fp) const
+{
+  // an involution, so either bucket leads to the other
+  return (b ^ (uint32_t)hitset_mix(fp)) & (num_buckets() - 1);
+}
+
+void CuckooHitSet::locate(const hobject_t& o, uint16_t *fp, uint32_t *b1,
+			  uint32_t *b2) const
+{
+  uint64_t h = hitset_mix(o.get_hash() + seed * 0x9e3779b97f4a7c15ull);
+  *fp = h >> 52;
+  if (*fp == 0) {
+    *fp = 1;  // 0 marks an empty slot
+  }
+  *b1 = h & (num_buckets() - 1);
+  *b2 = alt_bucket(*b1, *fp);
+}
+
+uint64_t CuckooHitSet::match(uint64_t w, uint16_t fp)
+{
+  // zero the lanes holding fp, then flag the zero lanes without letting
+  // a borrow cross into the next lane
+  constexpr uint64_t low = 0x7fff7fff7fff7fffull;
+  uint64_t x = (w & CUCKOO_FP_MASK) ^ ((uint64_t)(fp << 4) * CUCKOO_LANES);
+  return ~(((x & low) + low) | x) & ~low;
+}
+
+void CuckooHitSet::unshare()
+{
+  if (shared) {
+    table = ceph::buffer::copy(table.c_str(), table.length());
+    shared = false;
+  }
+}
+
+void CuckooHitSet::insert(const hobject_t& o)
+{
+  ++count;
+  if (table.length() == 0) {
+    return;
+  }
+  unshare();
+  uint16_t fp;
+  uint32_t b[2];
+  locate(o, &fp, &b[0], &b[1]);
+
+  // seen before: count the hit
+  for (auto i : b) {
+    uint64_t w = get_bucket(i);
+    if (uint64_t m = match(w, fp); m) {
+      unsigned shift = cuckoo_lane_shift(m);
+      if (((w >> shift) & CUCKOO_COUNT_MASK) != CUCKOO_COUNT_MASK) {
+	set_bucket(i, w + (1ull << shift));
+      }
+      return;
+    }
+  }
+  if (stash_slot >> 4 == fp &&
+      (stash_bucket == b[0] || stash_bucket == b[1])) {
+    if ((stash_slot & CUCKOO_COUNT_MASK) != CUCKOO_COUNT_MASK) {
+      ++stash_slot;
+    }
+    return;
+  }
+
+  uint16_t slot = fp << 4 | 1;
+  for (auto i : b) {
+    uint64_t w = get_bucket(i);
+    if (uint64_t m = match(w, 0); m) {
+      set_bucket(i, w | (uint64_t)slot << cuckoo_lane_shift(m));
+      ++unique;
+      return;
+    }
+  }
+  if (is_full()) {
+    // the set is about to be archived; drop the hit rather than evict
+    return;
+  }
+
+  // make room by moving residents to their alternate buckets
+  uint32_t at = b[count & 1];
+  uint64_t rnd = seed ^ count;
+  for (unsigned kick = 0; kick < MAX_KICKS; ++kick) {
+    rnd = rnd * 6364136223846793005ull + 1442695040888963407ull;
+    unsigned shift = ((rnd >> 33) % SLOTS) * 16;
+    uint64_t w = get_bucket(at);
+    uint16_t victim = w >> shift;
+    set_bucket(at, (w & ~(0xffffull << shift)) | (uint64_t)slot << shift);
+    slot = victim;
+    at = alt_bucket(at, slot >> 4);
+    w = get_bucket(at);
+    if (uint64_t m = match(w, 0); m) {
+      set_bucket(at, w | (uint64_t)slot << cuckoo_lane_shift(m));
+      ++unique;
+      return;
+    }
+  }
+  stash_slot = slot;
+  stash_bucket = at;
+  ++unique;
+}
+
+unsigned CuckooHitSet::hit_count(const hobject_t& o) const
+{
+  if (table.length() == 0) {
+    return 0;
+  }
+  uint16_t fp;
+  uint32_t b1, b2;
+  locate(o, &fp, &b1, &b2);
+  for (auto i : {b1, b2}) {
+    uint64_t w = get_bucket(i);
+    if (uint64_t m = match(w, fp); m) {
+      return (w >> cuckoo_lane_shift(m)) & CUCKOO_COUNT_MASK;
+    }
+  }
+  if (stash_slot >> 4 == fp && (stash_bucket == b1 || stash_bucket == b2)) {
+    return stash_slot & CUCKOO_COUNT_MASK;
+  }
+  return 0;
+}
+
+void CuckooHitSet::encode(ceph::buffer::list &bl) const
+{
+  ENCODE_START(1, 1, bl);
+  encode(seed, bl);
+  encode(count, bl);
+  encode(unique, bl);
+  encode(stash_slot, bl);
+  encode(stash_bucket, bl);
+  // the table is already in wire format; share it rather than copy it
+  encode(table, bl);
+  shared = true;
+  ENCODE_FINISH(bl);
+}
+
+void CuckooHitSet::decode(ceph::buffer::list::const_iterator& bl)
+{
+  DECODE_START(1, bl);
+  decode(seed, bl);
+  decode(count, bl);
+  decode(unique, bl);
+  decode(stash_slot, bl);
+  decode(stash_bucket, bl);
+  decode(table, bl);
+  shared = true;
+  if (table.length() % sizeof(uint64_t) ||
+      !isp2(num_buckets()) ||
+      (table.length() && stash_bucket >= num_buckets())) {
+    throw ceph::buffer::malformed_input("bad cuckoo HitSet table");
+  }
+  DECODE_FINISH(bl);
+}
+
+void CuckooHitSet::Params::dump(Formatter *f) const {
+  f->dump_int("target_size", target_size);
+  f->dump_int("seed", seed);
+}
+
+void CuckooHitSet::dump(Formatter *f) const {
+  f->dump_unsigned("insert_count", count);
+  f->dump_unsigned("approx_unique_insert_count", unique);
+  f->dump_unsigned("seed", seed);
+  f->dump_unsigned("buckets", num_buckets());
+  f->dump_bool("full", is_full());
+}
+
+// -- HitSetTemperatureSketch --
+
+void HitSetTemperatureSketch::reset(uint32_t w)
+{
+  width = w;
+  cells = ceph::buffer::create(DEPTH * width * sizeof(uint16_t));
+  cells.zero();
+  periods = 0;
+}
+
+void HitSetTemperatureSketch::clear()
+{
+  width = 0;
+  cells = ceph::buffer::ptr();
+  periods = 0;
+  current_complete = false;
+}
+
+void HitSetTemperatureSketch::locate(const hobject_t& o,
+				     uint32_t (&idx)[DEPTH]) const
+{
+  // double hashing: one mix gives all the rows
+  uint64_t h = hitset_mix(o.get_hash() ^ 0x5bd1e9955bd1e995ull);
+  uint32_t a = h;
+  uint32_t b = (h >> 32) | 1;
+  for (unsigned i = 0; i < DEPTH; ++i) {
+    idx[i] = i * width + ((a + i * b) & (width - 1));
+  }
+}
+
+void HitSetTemperatureSketch::insert(const hobject_t& o)
+{
+  if (!width) {
+    return;
+  }
+  uint32_t idx[DEPTH];
+  locate(o, idx);
+  auto c = reinterpret_cast<ceph_le16*>(cells.c_str());
+  for (auto i : idx) {
+    c[i] = c[i] | 1;
+  }
+}
+
+uint16_t HitSetTemperatureSketch::lookup(const hobject_t& o) const
+{
+  if (!width) {
+    return 0;
+  }
+  uint32_t idx[DEPTH];
+  locate(o, idx);
+  auto c = reinterpret_cast<const ceph_le16*>(cells.c_str());
+  uint16_t r = 0xffff;
+  for (auto i : idx) {
+    r &= c[i];
+  }
+  return r;
+}
+
+void HitSetTemperatureSketch::roll(uint64_t unique)
+{
+  // keep each row at most half full per period
+  uint64_t want = std::min<uint64_t>(unique * 2, 1u << 22);
+  if (width < std::max<uint64_t>(want, MIN_WIDTH)) {
+    uint32_t w = MIN_WIDTH;
+    while (w < want) {
+      w <<= 1;
+    }
+    reset(w);
+    current_complete = true;
+    return;
+  }
+  auto c = reinterpret_cast<ceph_le16*>(cells.c_str());
+  for (size_t i = 0; i < DEPTH * width; ++i) {
+    c[i] = (uint16_t)(c[i] << 1);
+  }
+  if (current_complete && periods < MAX_PERIODS - 1) {
+    ++periods;
+  }
+  current_complete = true;
+}
+
+void HitSetTemperatureSketch::encode(ceph::buffer::list &bl) const
+{
+  ENCODE_START(1, 1, bl);
+  encode(width, bl);
+  encode(periods, bl);
+  encode(current_complete, bl);
+  encode(cells, bl);
+  ENCODE_FINISH(bl);
+}
+
+void HitSetTemperatureSketch::decode(ceph::buffer::list::const_iterator& bl)
+{
+  DECODE_START(1, bl);
+  decode(width, bl);
+  decode(periods, bl);
+  decode(current_complete, bl);
+  decode(cells, bl);
+  if (!isp2(width) ||
+      cells.length() != DEPTH * width * sizeof(uint16_t) ||
+      periods >= MAX_PERIODS) {
+    throw ceph::buffer::malformed_input("bad HitSetTemperatureSketch");
+  }
+  if (cells.length()) {
+    // the cells are modified in place; do not share the decoded buffer
+    cells = ceph::buffer::copy(cells.c_str(), cells.length());
+  }
+  DECODE_FINISH(bl);
+}
+
+void HitSetTemperatureSketch::dump(Formatter *f) const
+{
+  f->dump_unsigned("width", width);
+  f->dump_unsigned("depth", DEPTH);
+  f->dump_unsigned("complete_periods", periods);
+}
+
+void HitSetTemperatureSketch::generate_test_instances(
+  list<HitSetTemperatureSketch*>& o)
+{
+  o.push_back(new HitSetTemperatureSketch);
+  o.push_back(new HitSetTemperatureSketch);
+  o.back()->roll(0);
+  o.back()->insert(hobject_t("asdf", "", CEPH_NOSNAP, 123, 1, ""));
+  o.back()->roll(1);
+  o.back()->insert(hobject_t("qwer", "", CEPH_NOSNAP, 456, 1, ""));
+}
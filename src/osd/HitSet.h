@@ -38,7 +38,8 @@ public:
     TYPE_NONE = 0,
     TYPE_EXPLICIT_HASH = 1,
     TYPE_EXPLICIT_OBJECT = 2,
-    TYPE_BLOOM = 3
+    TYPE_BLOOM = 3,
+    TYPE_CUCKOO = 4
   } impl_type_t;
 
   static std::string_view get_type_name(impl_type_t t) {
@@ -47,6 +48,7 @@ public:
     case TYPE_EXPLICIT_HASH: return "explicit_hash";
     case TYPE_EXPLICIT_OBJECT: return "explicit_object";
     case TYPE_BLOOM: return "bloom";
+    case TYPE_CUCKOO: return "cuckoo";
     default: return "???";
     }
   }
@@ -452,4 +454,187 @@ public:
 };
 WRITE_CLASS_ENCODER(BloomHitSet)
 
+/**
+ * use a counting cuckoo filter to track hits to the set
+ *
+ * Each bucket is one 64-bit word of four 16-bit slots, a 12-bit
+ * fingerprint and a 4-bit saturating hit count, so a lookup is two word
+ * loads and a few SWAR compares.  The table is kept in its little-endian
+ * wire format: encode appends it as is and decode keeps referencing the
+ * decoded buffer, copying it only if the set is modified afterwards.
+ */
+class CuckooHitSet : public HitSet::Impl {
+public:
+  class Params : public HitSet::Params::Impl {
+  public:
+    HitSet::impl_type_t get_type() const override {
+      return HitSet::TYPE_CUCKOO;
+    }
+    HitSet::Impl *get_new_impl() const override {
+      return new CuckooHitSet;
+    }
+
+    uint64_t target_size;  ///< number of unique insertions we expect to this HitSet
+    uint64_t seed;         ///< seed for the hash
+
+    Params()
+      : target_size(0), seed(0) {}
+    Params(uint64_t t, uint64_t s)
+      : target_size(t), seed(s) {}
+    ~Params() override {}
+
+    void encode(ceph::buffer::list& bl) const override {
+      ENCODE_START(1, 1, bl);
+      encode(target_size, bl);
+      encode(seed, bl);
+      ENCODE_FINISH(bl);
+    }
+    void decode(ceph::buffer::list::const_iterator& bl) override {
+      DECODE_START(1, bl);
+      decode(target_size, bl);
+      decode(seed, bl);
+      DECODE_FINISH(bl);
+    }
+    void dump(ceph::Formatter *f) const override;
+    void dump_stream(std::ostream& o) const override {
+      o << "target_size: " << target_size << ", seed: " << seed;
+    }
+    static void generate_test_instances(std::list<Params*>& o) {
+      o.push_back(new Params);
+      o.push_back(new Params(300, 99));
+    }
+  };
+
+private:
+  static constexpr unsigned SLOTS = 4;      ///< slots per bucket
+  static constexpr unsigned MAX_KICKS = 500;
+
+  uint64_t seed = 0;
+  uint64_t count = 0;    ///< inserts
+  uint64_t unique = 0;   ///< occupied slots, including the stash
+  /// where a fingerprint that found no room went; the set is full
+  uint16_t stash_slot = 0;
+  uint32_t stash_bucket = 0;
+  ceph::buffer::ptr table;    ///< buckets, little-endian
+  mutable bool shared = false;  ///< table is referenced elsewhere
+
+  uint32_t num_buckets() const {
+    return table.length() / sizeof(uint64_t);
+  }
+  uint64_t get_bucket(uint32_t b) const;
+  void set_bucket(uint32_t b, uint64_t w);
+  uint32_t alt_bucket(uint32_t b, uint16_t fp) const;
+  void locate(const hobject_t& o, uint16_t *fp, uint32_t *b1,
+	      uint32_t *b2) const;
+  /// lanes of w holding fingerprint fp (0: empty), one high bit per lane
+  static uint64_t match(uint64_t w, uint16_t fp);
+  void unshare();
+
+public:
+  CuckooHitSet() {}
+  CuckooHitSet(uint64_t target_size, uint64_t seed);
+  explicit CuckooHitSet(const CuckooHitSet::Params *p)
+    : CuckooHitSet(p->target_size, p->seed) {}
+  CuckooHitSet(const CuckooHitSet &o)
+    : seed(o.seed), count(o.count), unique(o.unique),
+      stash_slot(o.stash_slot), stash_bucket(o.stash_bucket),
+      table(o.table), shared(true) {
+    o.shared = true;
+  }
+
+  HitSet::Impl *clone() const override {
+    return new CuckooHitSet(*this);
+  }
+
+  HitSet::impl_type_t get_type() const override {
+    return HitSet::TYPE_CUCKOO;
+  }
+  bool is_full() const override {
+    return stash_slot != 0 || table.length() == 0;
+  }
+  void insert(const hobject_t& o) override;
+  bool contains(const hobject_t& o) const override {
+    return hit_count(o) > 0;
+  }
+  /// hits to o in this set, saturating at 15
+  unsigned hit_count(const hobject_t& o) const;
+  unsigned insert_count() const override {
+    return count;
+  }
+  unsigned approx_unique_insert_count() const override {
+    return unique;
+  }
+
+  void encode(ceph::buffer::list &bl) const override;
+  void decode(ceph::buffer::list::const_iterator& bl) override;
+  void dump(ceph::Formatter *f) const override;
+  static void generate_test_instances(std::list<CuckooHitSet*>& o) {
+    o.push_back(new CuckooHitSet);
+    o.push_back(new CuckooHitSet(10, 1));
+    o.back()->insert(hobject_t());
+    o.back()->insert(hobject_t("asdf", "", CEPH_NOSNAP, 123, 1, ""));
+    o.back()->insert(hobject_t("qwer", "", CEPH_NOSNAP, 456, 1, ""));
+  }
+};
+WRITE_CLASS_ENCODER(CuckooHitSet)
+
+/**
+ * which of the recent HitSet periods an object was hit in
+ *
+ * A count-min sketch whose cells hold a bitmap of periods instead of a
+ * count: bit 0 is the current period and bit i the i-th most recent
+ * archived one.  Inserting sets bit 0 in one cell of every row; the
+ * estimate is the AND of those cells, which like a count-min minimum can
+ * only err by including periods the object was not hit in.  Archiving a
+ * period shifts every cell, so the cost of a temperature estimate does not
+ * grow with the number of archived HitSets.
+ *
+ * Periods that were archived before the sketch was (re)built are unknown
+ * to it; see get_complete_periods().
+ */
+class HitSetTemperatureSketch {
+public:
+  static constexpr unsigned DEPTH = 4;
+  /// the current period and up to MAX_PERIODS - 1 archived ones
+  static constexpr unsigned MAX_PERIODS = 16;
+  static constexpr uint32_t MIN_WIDTH = 1024;
+
+  /// mark o as hit in the current period
+  void insert(const hobject_t& o);
+  /// periods o may have been hit in, bit 0 being the current one
+  uint16_t lookup(const hobject_t& o) const;
+
+  /**
+   * archive the current period
+   *
+   * @param unique approximate number of objects hit in it; the sketch is
+   *               rebuilt, forgetting its history, if it is too small
+   */
+  void roll(uint64_t unique);
+
+  /// number of archived periods the sketch has seen in full
+  unsigned get_complete_periods() const {
+    return periods;
+  }
+  uint32_t get_width() const {
+    return width;
+  }
+  void clear();
+
+  void encode(ceph::buffer::list &bl) const;
+  void decode(ceph::buffer::list::const_iterator& bl);
+  void dump(ceph::Formatter *f) const;
+  static void generate_test_instances(std::list<HitSetTemperatureSketch*>& o);
+
+private:
+  uint32_t width = 0;     ///< cells per row, a power of two
+  unsigned periods = 0;
+  bool current_complete = false;  ///< seen every insert of this period
+  ceph::buffer::ptr cells;  ///< DEPTH rows of little-endian uint16_t
+
+  void reset(uint32_t width);
+  void locate(const hobject_t& o, uint32_t (&idx)[DEPTH]) const;
+};
+WRITE_CLASS_ENCODER(HitSetTemperatureSketch)
+
 #endif
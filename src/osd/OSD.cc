@@ -259,6 +259,7 @@ OSDService::OSDService(OSD *osd, ceph::async::io_context_pool& poolctx) :
   monc(osd->monc),
   osd_max_object_size(cct->_conf, "osd_max_object_size"),
   osd_skip_data_digest(cct->_conf, "osd_skip_data_digest"),
+  mclock_calibration(cct),
   publish_lock{ceph::make_mutex("OSDService::publish_lock")},
   pre_publish_lock{ceph::make_mutex("OSDService::pre_publish_lock")},
   m_scrub_queue{cct, *this},
@@ -2407,6 +2408,7 @@ OSD::OSD(CephContext *cct_,
                                            cct->_conf->osd_op_history_duration);
   op_tracker.set_history_slow_op_size_and_threshold(cct->_conf->osd_op_history_slow_op_size,
                                                     cct->_conf->osd_op_history_slow_op_threshold);
+  op_tracker.set_history_sample_rate(cct->_conf->osd_op_history_sample_rate);
   ObjectCleanRegions::set_max_num_intervals(cct->_conf->osd_object_clean_region_max_num_intervals);
 #ifdef WITH_BLKIN
   std::stringstream ss;
@@ -10176,6 +10178,7 @@ const char** OSD::get_tracked_conf_keys() const
     "osd_op_history_duration",
     "osd_op_history_slow_op_size",
     "osd_op_history_slow_op_threshold",
+    "osd_op_history_sample_rate",
     "osd_enable_op_tracker",
     "osd_map_cache_size",
     "osd_pg_epoch_max_lag_factor",
@@ -10273,6 +10276,9 @@ void OSD::handle_conf_change(const ConfigProxy& conf,
     op_tracker.set_history_slow_op_size_and_threshold(cct->_conf->osd_op_history_slow_op_size,
                                                       cct->_conf->osd_op_history_slow_op_threshold);
   }
+  if (changed.count("osd_op_history_sample_rate")) {
+    op_tracker.set_history_sample_rate(cct->_conf->osd_op_history_sample_rate);
+  }
   if (changed.count("osd_enable_op_tracker")) {
       op_tracker.set_tracking(cct->_conf->osd_enable_op_tracker);
   }
@@ -11163,7 +11169,7 @@ OSDShard::OSDShard(
     shard_lock{make_mutex(shard_lock_name)},
     scheduler(ceph::osd::scheduler::make_scheduler(
       cct, osd->whoami, osd->num_shards, id, osd->store->is_rotational(),
-      osd->store->get_type(), osd->monc)),
+      osd->store->get_type(), osd->monc, &osd->service.mclock_calibration)),
     context_queue(sdata_wait_lock, sdata_cond)
 {
   dout(0) << "using op scheduler " << *scheduler << dendl;
@@ -11200,10 +11206,33 @@ void OSD::ShardedOpWQ::_add_slot_waiter(
 #undef dout_prefix
 #define dout_prefix *_dout << "osd." << osd->whoami << " op_wq(" << shard_index << ") "
 
+OSDShard *OSD::ShardedOpWQ::_lock_steal_victim(uint32_t shard_index)
+{
+  const uint32_t n = osd->num_shards;
+  // start at a random shard so idle workers spread over busy shards
+  const uint32_t start = ceph::util::generate_random_number<uint32_t>(0, n - 2);
+  for (uint32_t i = 0; i < n - 1; ++i) {
+    uint32_t victim_index = (shard_index + 1 + (start + i) % (n - 1)) % n;
+    OSDShard *victim = osd->shards[victim_index];
+    if (victim->idle_threads.load(std::memory_order_relaxed) > 0) {
+      continue;  // it will wake up for its own work
+    }
+    // never wait on a busy shard's lock; just move on
+    if (!victim->shard_lock.try_lock()) {
+      continue;
+    }
+    if (!victim->scheduler->empty() && !victim->stop_waiting) {
+      return victim;
+    }
+    victim->shard_lock.unlock();
+  }
+  return nullptr;
+}
+
 void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
 {
   uint32_t shard_index = thread_index % osd->num_shards;
-  auto& sdata = osd->shards[shard_index];
+  OSDShard *sdata = osd->shards[shard_index];
   ceph_assert(sdata);
 
   // If all threads of shards do oncommits, there is a out-of-order
@@ -11212,9 +11241,30 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
   // callback.
   bool is_smallest_thread_index = thread_index < osd->num_shards;
 
+  const bool work_stealing = osd->cct->_conf->osd_op_queue_work_stealing &&
+    osd->num_shards > 1;
+  bool stolen = false;
+
   // peek at spg_t
   sdata->shard_lock.lock();
-  if (sdata->scheduler->empty() &&
+  if (work_stealing &&
+      sdata->scheduler->empty() &&
+      (!is_smallest_thread_index || sdata->context_queue.empty())) {
+    // nothing to do here: act as an extra worker of a backlogged shard.
+    // its pg slots keep per-pg ordering just like for its own threads.
+    sdata->shard_lock.unlock();
+    if (OSDShard *victim = _lock_steal_victim(shard_index); victim) {
+      dout(20) << __func__ << " shard " << shard_index << " empty, helping "
+	       << victim->shard_id << dendl;
+      sdata = victim;
+      is_smallest_thread_index = false;  // oncommits stay with their shard
+      stolen = true;
+    } else {
+      sdata->shard_lock.lock();
+    }
+  }
+  if (!stolen &&
+      sdata->scheduler->empty() &&
       (!is_smallest_thread_index || sdata->context_queue.empty())) {
     std::unique_lock wait_lock{sdata->sdata_wait_lock};
     if (is_smallest_thread_index && !sdata->context_queue.empty()) {
@@ -11224,7 +11274,17 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
       dout(20) << __func__ << " empty q, waiting" << dendl;
       osd->cct->get_heartbeat_map()->clear_timeout(hb);
       sdata->shard_lock.unlock();
-      sdata->sdata_cond.wait(wait_lock);
+      ++sdata->idle_threads;
+      if (work_stealing) {
+	// wake up now and then to look for other shards' backlog
+	sdata->sdata_cond.wait_for(
+	  wait_lock,
+	  std::chrono::milliseconds(
+	    osd->cct->_conf->osd_op_queue_work_stealing_idle_ms));
+      } else {
+	sdata->sdata_cond.wait(wait_lock);
+      }
+      --sdata->idle_threads;
       wait_lock.unlock();
       sdata->shard_lock.lock();
       if (sdata->scheduler->empty() &&
@@ -11277,6 +11337,11 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
     // If the work item is scheduled in the future, wait until
     // the time returned in the dequeue response before retrying.
     if (auto when_ready = std::get_if<double>(&work_item)) {
+      if (stolen) {
+	// leave the victim's throttled work to its own threads
+	sdata->shard_lock.unlock();
+	return;
+      }
       if (is_smallest_thread_index) {
         sdata->shard_lock.unlock();
         handle_oncommits(oncommits);
@@ -11321,6 +11386,12 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
     r.first->second = make_unique<OSDShardPGSlot>();
   }
   OSDShardPGSlot *slot = r.first->second.get();
+  if (stolen) {
+    osd->logger->inc(l_osd_op_wq_steal);
+    if (slot->num_running == 0 && slot->to_process.empty()) {
+      osd->logger->inc(l_osd_op_wq_steal_idle_pg);
+    }
+  }
   dout(20) << __func__ << " " << token
 	   << (r.second ? " (new)" : "")
 	   << " to_process " << slot->to_process
@@ -11522,8 +11593,22 @@ void OSD::ShardedOpWQ::_process(uint32_t thread_index, heartbeat_handle_d *hb)
   delete f;
   *_dout << dendl;
 
+  // client ops are accounted on completion, see PrimaryLogPG::log_op_stats
+  const auto klass = qi.get_scheduler_class();
+  const bool calibrate = klass == op_scheduler_class::background_recovery ||
+    klass == op_scheduler_class::background_best_effort;
+  const auto cost = qi.get_cost();
+  const auto start = qi.get_start_time();
+  const auto run_start = calibrate ? ceph::mono_clock::now() : ceph::mono_time{};
+
   qi.run(osd, sdata, pg, tp_handle);
 
+  if (calibrate) {
+    osd->service.mclock_calibration.record(
+      klass, cost, ceph::mono_clock::now() - run_start,
+      ceph::make_timespan(ceph_clock_now() - start));
+  }
+
   {
 #ifdef WITH_LTTNG
     osd_reqid_t reqid;
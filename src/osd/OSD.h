@@ -39,6 +39,7 @@
 #include "Session.h"
 
 #include "osd/scheduler/OpScheduler.h"
+#include "osd/scheduler/mClockCalibration.h"
 
 #include <atomic>
 #include <map>
@@ -116,6 +117,9 @@ public:
   md_config_cacher_t<Option::size_t> osd_max_object_size;
   md_config_cacher_t<bool> osd_skip_data_digest;
 
+  /// cost and latency feedback for the mclock schedulers of all shards
+  ceph::osd::scheduler::mClockCalibration mclock_calibration;
+
   void enqueue_back(OpSchedulerItem&& qi);
   void enqueue_front(OpSchedulerItem&& qi);
 
@@ -984,6 +988,8 @@ struct OSDShard {
   ceph::mutex sdata_wait_lock;
   ceph::condition_variable sdata_cond;
   int waiting_threads = 0;
+  /// threads waiting for this shard's queue to become non-empty
+  std::atomic<int> idle_threads = {0};
 
   ceph::mutex osdmap_lock;  ///< protect shard_osdmap updates vs users w/o shard_lock
   OSDMapRef shard_osdmap;
@@ -1604,6 +1610,8 @@ protected:
 
     /// try to do some work
     void _process(uint32_t thread_index, ceph::heartbeat_handle_d *hb) override;
+    /// find a backlogged shard other than shard_index; returned shard_lock'ed
+    OSDShard *_lock_steal_victim(uint32_t shard_index);
 
     void stop_for_fast_shutdown();
 
@@ -202,6 +202,52 @@ ostream& operator<<(ostream& out, const osd_xinfo_t& xi)
 	     << " dead_epoch " << xi.dead_epoch;
 }
 
+// ----------------------------------
+// pg_mapping_changes_t
+
+void pg_mapping_changes_t::add_pool(int64_t pool)
+{
+  if (all) {
+    return;
+  }
+  pools.insert(pool);
+  // pgs are only tracked outside of the dirty pools
+  pgs.erase(pgs.lower_bound(pg_t(0, pool)),
+	    pgs.lower_bound(pg_t(0, pool + 1)));
+}
+
+void pg_mapping_changes_t::add_pg(pg_t pgid)
+{
+  if (!all && !pools.count(pgid.pool())) {
+    pgs.insert(pgid);
+  }
+}
+
+void pg_mapping_changes_t::merge(const pg_mapping_changes_t& o)
+{
+  if (all) {
+    return;
+  }
+  if (o.all) {
+    mark_all();
+    return;
+  }
+  for (auto pool : o.pools) {
+    add_pool(pool);
+  }
+  for (auto& pgid : o.pgs) {
+    add_pg(pgid);
+  }
+}
+
+ostream& operator<<(ostream& out, const pg_mapping_changes_t& c)
+{
+  if (c.all) {
+    return out << "all";
+  }
+  return out << "pools " << c.pools << " pgs " << c.pgs;
+}
+
 // ----------------------------------
 // OSDMap::Incremental
 
@@ -1742,6 +1788,10 @@ uint64_t OSDMap::get_features(int entity_type, uint64_t *pmask) const
 	pool.second.is_tier()) {
       features |= CEPH_FEATURE_OSD_CACHEPOOL;
     }
+    if (pool.second.hit_set_params.get_type() == HitSet::TYPE_CUCKOO) {
+      // older daemons and clients can't decode the pool
+      features |= CEPH_FEATUREMASK_OSD_HITSET_CUCKOO;
+    }
     int ruleid = pool.second.get_crush_rule();
     if (ruleid >= 0) {
       if (crush->is_v2_rule(ruleid))
@@ -1752,7 +1802,8 @@ uint64_t OSDMap::get_features(int entity_type, uint64_t *pmask) const
 	features |= CEPH_FEATURE_CRUSH_TUNABLES5;
     }
   }
-  mask |= CEPH_FEATURE_OSDHASHPSPOOL | CEPH_FEATURE_OSD_CACHEPOOL;
+  mask |= CEPH_FEATURE_OSDHASHPSPOOL | CEPH_FEATURE_OSD_CACHEPOOL |
+    CEPH_FEATUREMASK_OSD_HITSET_CUCKOO;
 
   if (osd_primary_affinity) {
     for (int i = 0; i < max_osd; ++i) {
@@ -2233,6 +2284,8 @@ int OSDMap::apply_incremental(const Incremental &inc)
   }
 
   // nope, incremental.
+  mapping_changes.clear();
+  std::set<int> changed_osds;
   if (inc.new_flags >= 0) {
     flags = inc.new_flags;
     // the below is just to cover a newly-upgraded luminous mon
@@ -2250,13 +2303,27 @@ int OSDMap::apply_incremental(const Incremental &inc)
     }
   }
 
-  if (inc.new_max_osd >= 0)
+  if (inc.new_max_osd >= 0) {
     set_max_osd(inc.new_max_osd);
+    mapping_changes.mark_all();
+  }
 
   if (inc.new_pool_max != -1)
     pool_max = inc.new_pool_max;
 
   for (const auto &pool : inc.new_pools) {
+    auto p = pools.find(pool.first);
+    if (p == pools.end() ||
+	p->second.get_type() != pool.second.get_type() ||
+	p->second.get_size() != pool.second.get_size() ||
+	p->second.get_crush_rule() != pool.second.get_crush_rule() ||
+	p->second.get_pg_num() != pool.second.get_pg_num() ||
+	p->second.get_pgp_num() != pool.second.get_pgp_num() ||
+	p->second.get_pg_num_pending() != pool.second.get_pg_num_pending() ||
+	p->second.has_flag(pg_pool_t::FLAG_HASHPSPOOL) !=
+	  pool.second.has_flag(pg_pool_t::FLAG_HASHPSPOOL)) {
+      mapping_changes.add_pool(pool.first);
+    }
     pools[pool.first] = pool.second;
     pools[pool.first].last_change = epoch;
   }
@@ -2305,6 +2372,7 @@ int OSDMap::apply_incremental(const Incremental &inc)
 
   for (const auto &weight : inc.new_weight) {
     set_weight(weight.first, weight.second);
+    changed_osds.insert(weight.first);
 
     // if we are marking in, clear the AUTOOUT and NEW bits, and clear
     // xinfo old_weight.
@@ -2316,6 +2384,7 @@ int OSDMap::apply_incremental(const Incremental &inc)
 
   for (const auto &primary_affinity : inc.new_primary_affinity) {
     set_primary_affinity(primary_affinity.first, primary_affinity.second);
+    changed_osds.insert(primary_affinity.first);
   }
 
   // erasure_code_profiles
@@ -2330,6 +2399,7 @@ int OSDMap::apply_incremental(const Incremental &inc)
   for (const auto &state : inc.new_state) {
     const auto osd = state.first;
     int s = state.second ? state.second : CEPH_OSD_UP;
+    changed_osds.insert(osd);
     if ((osd_state[osd] & CEPH_OSD_UP) &&
 	(s & CEPH_OSD_UP)) {
       osd_info[osd].down_at = epoch;
@@ -2353,6 +2423,7 @@ int OSDMap::apply_incremental(const Incremental &inc)
   }
 
   for (const auto &client : inc.new_up_client) {
+    changed_osds.insert(client.first);
     osd_state[client.first] |= CEPH_OSD_EXISTS | CEPH_OSD_UP;
     osd_state[client.first] &= ~CEPH_OSD_STOP; // if any
     osd_addrs->client_addrs[client.first].reset(
@@ -2395,10 +2466,12 @@ int OSDMap::apply_incremental(const Incremental &inc)
       pg_temp->erase(pg.first);
     else
       pg_temp->set(pg.first, pg.second);
+    mapping_changes.add_pg(pg.first);
   }
   if (!inc.new_pg_temp.empty()) {
-    // make sure pg_temp is efficiently stored
-    pg_temp->rebuild();
+    // re-encoding every entry on each epoch costs more than the garbage
+    // left behind by a few updates; only rebuild once it piles up
+    pg_temp->compact();
   }
 
   for (const auto &pg : inc.new_primary_temp) {
@@ -2406,19 +2479,24 @@ int OSDMap::apply_incremental(const Incremental &inc)
       primary_temp->erase(pg.first);
     else
       (*primary_temp)[pg.first] = pg.second;
+    mapping_changes.add_pg(pg.first);
   }
 
   for (auto& p : inc.new_pg_upmap) {
     pg_upmap[p.first] = p.second;
+    mapping_changes.add_pg(p.first);
   }
   for (auto& pg : inc.old_pg_upmap) {
     pg_upmap.erase(pg);
+    mapping_changes.add_pg(pg);
   }
   for (auto& p : inc.new_pg_upmap_items) {
     pg_upmap_items[p.first] = p.second;
+    mapping_changes.add_pg(p.first);
   }
   for (auto& pg : inc.old_pg_upmap_items) {
     pg_upmap_items.erase(pg);
+    mapping_changes.add_pg(pg);
   }
 
   // blocklist
@@ -2496,6 +2574,7 @@ int OSDMap::apply_incremental(const Incremental &inc)
     auto blp = bl.cbegin();
     crush.reset(new CrushWrapper);
     crush->decode(blp);
+    mapping_changes.mark_all();
     if (require_osd_release >= ceph_release_t::luminous) {
       // only increment if this is a luminous-encoded osdmap, lest
       // the mon's crush_version diverge from what the osds or others
@@ -2521,11 +2600,78 @@ int OSDMap::apply_incremental(const Incremental &inc)
     stretch_mode_bucket = inc.new_stretch_mode_bucket;
   }
 
+  if (!changed_osds.empty() && !mapping_changes.all) {
+    _note_changed_osds(changed_osds);
+  }
+
   calc_num_osds();
   _calc_up_osd_features();
   return 0;
 }
 
+void OSDMap::_note_changed_osds(const std::set<int>& osds)
+{
+  // a pool is affected if its rule can place PGs on any of the osds
+  map<int, bool> rule_affected;
+  for (auto& [poolid, pool] : pools) {
+    if (mapping_changes.pools.count(poolid)) {
+      continue;
+    }
+    int rule = pool.get_crush_rule();
+    auto r = rule_affected.find(rule);
+    if (r == rule_affected.end()) {
+      set<int> roots;
+      crush->find_takes_by_rule(rule, &roots);
+      bool affected = roots.empty();  // bad rule; don't guess
+      for (auto root = roots.begin();
+	   !affected && root != roots.end();
+	   ++root) {
+	for (auto osd : osds) {
+	  if (crush->subtree_contains(*root, osd)) {
+	    affected = true;
+	    break;
+	  }
+	}
+      }
+      r = rule_affected.emplace(rule, affected).first;
+    }
+    if (r->second) {
+      mapping_changes.add_pool(poolid);
+    }
+  }
+
+  // explicit mappings may point anywhere
+  for (const auto& pg : *pg_temp) {
+    for (auto osd : pg.second) {
+      if (osds.count(osd)) {
+	mapping_changes.add_pg(pg.first);
+	break;
+      }
+    }
+  }
+  for (auto& [pgid, osd] : *primary_temp) {
+    if (osds.count(osd)) {
+      mapping_changes.add_pg(pgid);
+    }
+  }
+  for (auto& [pgid, up] : pg_upmap) {
+    for (auto osd : up) {
+      if (osds.count(osd)) {
+	mapping_changes.add_pg(pgid);
+	break;
+      }
+    }
+  }
+  for (auto& [pgid, items] : pg_upmap_items) {
+    for (auto& [from, to] : items) {
+      if (osds.count(from) || osds.count(to)) {
+	mapping_changes.add_pg(pgid);
+	break;
+      }
+    }
+  }
+}
+
 // mapping
 int OSDMap::map_to_pg(
   int64_t poolid,
@@ -2828,6 +2974,58 @@ void OSDMap::pg_to_raw_up(pg_t pg, vector<int> *up, int *primary) const
   _apply_primary_affinity(pps, *pool, up, primary);
 }
 
+void OSDMap::_raw_to_up_with_primary(
+  const pg_pool_t& pool, pg_t pg, ps_t pps,
+  vector<int> *raw, vector<int> *up, int *up_primary) const
+{
+  _apply_upmap(pool, pg, raw);
+  _raw_to_up_osds(pool, *raw, up);
+  *up_primary = _pick_primary(*up);
+  _apply_primary_affinity(pps, pool, up, up_primary);
+}
+
+void OSDMap::pg_range_to_up_acting_osds(
+  int64_t poolid, ps_t ps_begin, ps_t ps_end,
+  vector<vector<int>> *up, vector<int> *up_primary,
+  vector<vector<int>> *acting, vector<int> *acting_primary) const
+{
+  const pg_pool_t *pool = get_pg_pool(poolid);
+  ceph_assert(pool);
+  ceph_assert(ps_begin <= ps_end);
+  ceph_assert(ps_end <= pool->get_pg_num());
+  const size_t n = ps_end - ps_begin;
+  vector<int> pps(n);
+  for (size_t i = 0; i < n; ++i) {
+    pps[i] = pool->raw_pg_to_pps(pg_t(ps_begin + i, poolid));
+  }
+  vector<vector<int>> raw;
+  int ruleno = pool->get_crush_rule();
+  if (ruleno >= 0) {
+    crush->do_rule_many(ruleno, pps, &raw, pool->get_size(), osd_weight,
+			poolid);
+  } else {
+    raw.resize(n);
+  }
+
+  up->resize(n);
+  up_primary->resize(n);
+  acting->resize(n);
+  acting_primary->resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    pg_t pg(ps_begin + i, poolid);
+    _remove_nonexistent_osds(*pool, raw[i]);
+    _raw_to_up_with_primary(*pool, pg, pps[i], &raw[i], &(*up)[i],
+			    &(*up_primary)[i]);
+    _get_temp_osds(*pool, pg, &(*acting)[i], &(*acting_primary)[i]);
+    if ((*acting)[i].empty()) {
+      (*acting)[i] = (*up)[i];
+      if ((*acting_primary)[i] == -1) {
+	(*acting_primary)[i] = (*up_primary)[i];
+      }
+    }
+  }
+}
+
 void OSDMap::_pg_to_up_acting_osds(
   const pg_t& pg, vector<int> *up, int *up_primary,
   vector<int> *acting, int *acting_primary,
@@ -2855,10 +3053,7 @@ void OSDMap::_pg_to_up_acting_osds(
   _get_temp_osds(*pool, pg, &_acting, &_acting_primary);
   if (_acting.empty() || up || up_primary) {
     _pg_to_raw_osds(*pool, pg, &raw, &pps);
-    _apply_upmap(*pool, pg, &raw);
-    _raw_to_up_osds(*pool, raw, &_up);
-    _up_primary = _pick_primary(_up);
-    _apply_primary_affinity(pps, *pool, &_up, &_up_primary);
+    _raw_to_up_with_primary(*pool, pg, pps, &raw, &_up, &_up_primary);
     if (_acting.empty()) {
       _acting = _up;
       if (_acting_primary == -1) {
@@ -3643,6 +3838,8 @@ void OSDMap::decode(ceph::buffer::list::const_iterator& bl)
 
 void OSDMap::post_decode()
 {
+  mapping_changes.mark_all();
+
   // index pool names
   name_pool.clear();
   for (const auto &pname : pool_name) {
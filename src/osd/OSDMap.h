@@ -113,6 +113,7 @@ struct PGTempMap {
   ceph::buffer::list data;
   typedef btree::btree_map<pg_t,ceph_le32*> map_t;
   map_t map;
+  size_t dead = 0;  ///< bytes in data no longer referenced by map
 
   void encode(ceph::buffer::list& bl) const {
     using ceph::encode;
@@ -127,6 +128,7 @@ struct PGTempMap {
     using ceph::decode;
     data.clear();
     map.clear();
+    dead = 0;
     uint32_t n;
     decode(n, p);
     if (!n)
@@ -161,10 +163,29 @@ struct PGTempMap {
     auto p = std::cbegin(bl);
     decode(p);
   }
+  /// rebuild only once most of data is garbage left by set() and erase()
+  void compact() {
+    if (dead && dead * 2 >= data.length()) {
+      rebuild();
+    }
+  }
   friend bool operator==(const PGTempMap& l, const PGTempMap& r) {
-    return
-      l.map.size() == r.map.size() &&
-      l.data.contents_equal(r.data);
+    // entries set since the last rebuild() are not laid out in order, so
+    // compare them one by one rather than the raw data
+    if (l.map.size() != r.map.size()) {
+      return false;
+    }
+    for (auto p = l.map.begin(), q = r.map.begin();
+	 p != l.map.end();
+	 ++p, ++q) {
+      if (p->first != q->first ||
+	  *p->second != *q->second ||
+	  memcmp(p->second + 1, q->second + 1,
+		 *p->second * sizeof(ceph_le32)) != 0) {
+	return false;
+      }
+    }
+    return true;
   }
 
   class iterator {
@@ -231,22 +252,34 @@ struct PGTempMap {
     return map.count(pgid);
   }
   void erase(pg_t pgid) {
-    map.erase(pgid);
+    auto p = map.find(pgid);
+    if (p != map.end()) {
+      dead += sizeof(ceph_le32) * (1 + *p->second);
+      map.erase(p);
+    }
   }
   void clear() {
     map.clear();
     data.clear();
+    dead = 0;
   }
   void set(pg_t pgid, const mempool::osdmap::vector<int32_t>& v) {
-    using ceph::encode;
     size_t need = sizeof(ceph_le32) * (1 + v.size());
-    if (need < data.get_append_buffer_unused_tail_length()) {
-      ceph::buffer::ptr z(data.get_append_buffer_unused_tail_length());
-      z.zero();
-      data.append(z.c_str(), z.length());
+    // the entry must be contiguous; append_hole() starts a new buffer if
+    // the tail of the current one is too short
+    auto filler = data.append_hole(need);
+    ceph_le32 *e = reinterpret_cast<ceph_le32*>(filler.c_str());
+    e[0] = v.size();
+    for (size_t i = 0; i < v.size(); ++i) {
+      e[1 + i] = v[i];
+    }
+    auto p = map.find(pgid);
+    if (p != map.end()) {
+      dead += sizeof(ceph_le32) * (1 + *p->second);
+      p->second = e;
+    } else {
+      map.insert(std::make_pair(pgid, e));
     }
-    encode(v, data);
-    map[pgid] = (ceph_le32*)(data.back().end_c_str()) - (1 + v.size());
   }
   mempool::osdmap::vector<int32_t> get(pg_t pgid) {
     mempool::osdmap::vector<int32_t> v;
@@ -345,6 +378,40 @@ struct PGTempMap {
 };
 WRITE_CLASS_ENCODER(PGTempMap)
 
+/**
+ * pools and PGs whose mapping an OSDMap change may have affected
+ *
+ * This is a conservative superset: every PG whose up or acting set
+ * differs between the two maps is covered, but not every covered PG
+ * necessarily moved.
+ */
+struct pg_mapping_changes_t {
+  bool all = false;            ///< anything may have changed
+  std::set<int64_t> pools;     ///< every PG in these pools
+  std::set<pg_t> pgs;          ///< individual PGs outside of pools
+
+  bool empty() const {
+    return !all && pools.empty() && pgs.empty();
+  }
+  bool contains(pg_t pgid) const {
+    return all || pools.count(pgid.pool()) || pgs.count(pgid);
+  }
+  void clear() {
+    all = false;
+    pools.clear();
+    pgs.clear();
+  }
+  void mark_all() {
+    clear();
+    all = true;
+  }
+  void add_pool(int64_t pool);
+  void add_pg(pg_t pgid);
+  /// accumulate the changes of a later epoch
+  void merge(const pg_mapping_changes_t& o);
+};
+std::ostream& operator<<(std::ostream& out, const pg_mapping_changes_t& c);
+
 /** OSDMap
  */
 class OSDMap {
@@ -623,6 +690,9 @@ private:
   std::string cluster_snapshot;
   bool new_blocklist_entries;
 
+  /// mappings the last apply_incremental() may have changed
+  pg_mapping_changes_t mapping_changes;
+
   float full_ratio = 0, backfillfull_ratio = 0, nearfull_ratio = 0;
 
   /// min compat client we want to support
@@ -673,6 +743,7 @@ private:
 	     crush(std::make_shared<CrushWrapper>()),
 	     stretch_mode_enabled(false), stretch_bucket_count(0),
 	     degraded_stretch_mode(0), recovering_stretch_mode(0), stretch_mode_bucket(0) {
+    mapping_changes.mark_all();
   }
 
 private:
@@ -1114,6 +1185,16 @@ public:
 
   int apply_incremental(const Incremental &inc);
 
+  /**
+   * pools and PGs the last apply_incremental() may have remapped
+   *
+   * A freshly constructed or decoded map (or one that applied a full
+   * map) reports that everything changed.
+   */
+  const pg_mapping_changes_t& get_mapping_changes() const {
+    return mapping_changes;
+  }
+
   /// try to re-use/reference addrs in oldmap from newmap
   static void dedup(const OSDMap *oldmap, OSDMap *newmap);
 
@@ -1211,6 +1292,7 @@ private:
     ps_t *ppps) const;
   int _pick_primary(const std::vector<int>& osds) const;
   void _remove_nonexistent_osds(const pg_pool_t& pool, std::vector<int>& osds) const;
+  void _note_changed_osds(const std::set<int>& osds);
 
   void _apply_primary_affinity(ps_t seed, const pg_pool_t& pool,
 			       std::vector<int> *osds, int *primary) const;
@@ -1232,6 +1314,11 @@ private:
   void _get_temp_osds(const pg_pool_t& pool, pg_t pg,
                       std::vector<int> *temp_pg, int *temp_primary) const;
 
+  /// upmap, up filtering and primary affinity of a raw crush mapping
+  void _raw_to_up_with_primary(const pg_pool_t& pool, pg_t pg, ps_t pps,
+			       std::vector<int> *raw, std::vector<int> *up,
+			       int *up_primary) const;
+
   /**
    *  map to up and acting. Fills in whatever fields are non-NULL.
    */
@@ -1277,6 +1364,16 @@ public:
     int up_primary, acting_primary;
     pg_to_up_acting_osds(pg, &up, &up_primary, &acting, &acting_primary);
   }
+  /**
+   * map pgs [ps_begin, ps_end) of a pool as pg_to_up_acting_osds() does,
+   * mapping all of them through CRUSH in one batch. The output vectors
+   * are indexed by ps - ps_begin.
+   */
+  void pg_range_to_up_acting_osds(
+    int64_t pool, ps_t ps_begin, ps_t ps_end,
+    std::vector<std::vector<int>> *up, std::vector<int> *up_primary,
+    std::vector<std::vector<int>> *acting,
+    std::vector<int> *acting_primary) const;
   bool pg_is_ec(pg_t pg) const {
     auto i = pools.find(pg.pool());
     ceph_assert(i != pools.end());
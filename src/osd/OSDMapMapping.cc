@@ -15,7 +15,8 @@ MEMPOOL_DEFINE_OBJECT_FACTORY(OSDMapMapping, osdmapmapping,
 
 // ensure that we have a PoolMappings for each pool and that
 // the dimensions (pg_num and size) match up.
-void OSDMapMapping::_init_mappings(const OSDMap& osdmap)
+void OSDMapMapping::_init_mappings(const OSDMap& osdmap,
+				   std::set<int64_t> *created)
 {
   num_pgs = 0;
   auto q = pools.begin();
@@ -39,6 +40,9 @@ void OSDMapMapping::_init_mappings(const OSDMap& osdmap)
     pools.emplace(p.first, PoolMapping(p.second.get_size(),
 				       p.second.get_pg_num(),
 				       p.second.is_erasure()));
+    if (created) {
+      created->insert(p.first);
+    }
   }
   pools.erase(q, pools.end());
   ceph_assert(pools.size() == osdmap.get_pools().size());
@@ -46,7 +50,7 @@ void OSDMapMapping::_init_mappings(const OSDMap& osdmap)
 
 void OSDMapMapping::update(const OSDMap& osdmap)
 {
-  _start(osdmap);
+  _start(osdmap, nullptr);
   for (auto& p : osdmap.get_pools()) {
     _update_range(osdmap, p.first, 0, p.second.get_pg_num());
   }
@@ -86,10 +90,54 @@ void OSDMapMapping::_build_rmap(const OSDMap& osdmap)
   }
 }
 
+std::unique_ptr<OSDMapMapping::MappingJob> OSDMapMapping::start_update(
+  const OSDMap& map,
+  ParallelPGMapper& mapper,
+  unsigned pgs_per_item,
+  const pg_mapping_changes_t& changes)
+{
+  if (changes.all || epoch == 0) {
+    return start_update(map, mapper, pgs_per_item);
+  }
+  // pools whose dimensions changed start from scratch
+  std::set<int64_t> remap_pools;
+  std::unique_ptr<MappingJob> job(new MappingJob(&map, this, &remap_pools));
+  for (auto pool : changes.pools) {
+    if (pools.count(pool)) {
+      remap_pools.insert(pool);
+    }
+  }
+  vector<pg_t> remap_pgs;
+  for (auto& pgid : changes.pgs) {
+    auto p = pools.find(pgid.pool());
+    if (p != pools.end() &&
+	pgid.ps() < p->second.pg_num &&
+	!remap_pools.count(pgid.pool())) {
+      remap_pgs.push_back(pgid);
+    }
+  }
+  mapper.queue(job.get(), pgs_per_item, remap_pools, remap_pgs);
+  return job;
+}
+
 void OSDMapMapping::_finish(const OSDMap& osdmap)
 {
   _build_rmap(osdmap);
   epoch = osdmap.get_epoch();
+
+  std::lock_guard l(changed_lock);
+  changed.clear();
+  changed.swap(changing);
+  std::sort(changed.begin(), changed.end());
+  changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+  // drop rows of pools that went away since they were rewritten
+  changed.erase(
+    std::remove_if(changed.begin(), changed.end(),
+		   [this](pg_t pgid) {
+		     auto p = pools.find(pgid.pool());
+		     return p == pools.end() || pgid.ps() >= p->second.pg_num;
+		   }),
+    changed.end());
 }
 
 void OSDMapMapping::_dump()
@@ -114,14 +162,45 @@ void OSDMapMapping::_update_range(
   ceph_assert(i != pools.end());
   ceph_assert(pg_begin <= pg_end);
   ceph_assert(pg_end <= i->second.pg_num);
+  std::vector<std::vector<int>> up, acting;
+  std::vector<int> up_primary, acting_primary;
+  osdmap.pg_range_to_up_acting_osds(
+    pool, pg_begin, pg_end,
+    &up, &up_primary, &acting, &acting_primary);
+  vector<pg_t> changed_pgs;
   for (unsigned ps = pg_begin; ps < pg_end; ++ps) {
-    std::vector<int> up, acting;
-    int up_primary, acting_primary;
-    osdmap.pg_to_up_acting_osds(
-      pg_t(ps, pool),
-      &up, &up_primary, &acting, &acting_primary);
-    i->second.set(ps, std::move(up), up_primary,
-		  std::move(acting), acting_primary);
+    unsigned j = ps - pg_begin;
+    if (i->second.set(ps, std::move(up[j]), up_primary[j],
+		      std::move(acting[j]), acting_primary[j])) {
+      changed_pgs.push_back(pg_t(ps, pool));
+    }
+  }
+  if (!changed_pgs.empty()) {
+    std::lock_guard l(changed_lock);
+    changing.insert(changing.end(), changed_pgs.begin(), changed_pgs.end());
+  }
+}
+
+void OSDMapMapping::_update_pgs(
+  const OSDMap& osdmap,
+  const vector<pg_t>& pgs)
+{
+  vector<pg_t> changed_pgs;
+  std::vector<int> up, acting;
+  int up_primary, acting_primary;
+  for (auto& pgid : pgs) {
+    auto i = pools.find(pgid.pool());
+    ceph_assert(i != pools.end());
+    ceph_assert(pgid.ps() < i->second.pg_num);
+    osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary,
+				&acting, &acting_primary);
+    if (i->second.set(pgid.ps(), up, up_primary, acting, acting_primary)) {
+      changed_pgs.push_back(pgid);
+    }
+  }
+  if (!changed_pgs.empty()) {
+    std::lock_guard l(changed_lock);
+    changing.insert(changing.end(), changed_pgs.begin(), changed_pgs.end());
   }
 }
 
@@ -205,3 +284,34 @@ void ParallelPGMapper::queue(
   }
   ceph_assert(any);
 }
+
+void ParallelPGMapper::queue(
+  Job *job,
+  unsigned pgs_per_item,
+  const std::set<int64_t>& pools,
+  const vector<pg_t>& input_pgs)
+{
+  // hold a shard ourselves so that the job cannot complete before
+  // everything is queued, and still completes if there is nothing to do
+  job->start_one();
+  for (auto pool : pools) {
+    const pg_pool_t *pi = job->osdmap->get_pg_pool(pool);
+    if (!pi) {
+      continue;
+    }
+    for (unsigned ps = 0; ps < pi->get_pg_num(); ps += pgs_per_item) {
+      unsigned ps_end = std::min(ps + pgs_per_item, pi->get_pg_num());
+      job->start_one();
+      wq.queue(new Item(job, pool, ps, ps_end));
+    }
+  }
+  for (size_t i = 0; i < input_pgs.size(); i += pgs_per_item) {
+    size_t end = std::min<size_t>(i + pgs_per_item, input_pgs.size());
+    job->start_one();
+    wq.queue(new Item(job, vector<pg_t>(input_pgs.begin() + i,
+					input_pgs.begin() + end)));
+  }
+  ldout(cct, 20) << __func__ << " " << job << " pools " << pools
+		 << " and " << input_pgs.size() << " pgs" << dendl;
+  job->finish_one();
+}
@@ -7,12 +7,14 @@
 
 #include <vector>
 #include <map>
+#include <set>
 
 #include "osd/osd_types.h"
 #include "common/WorkQueue.h"
 #include "common/Cond.h"
 
 class OSDMap;
+struct pg_mapping_changes_t;
 
 /// work queue to perform work on batches of pgids on multiple CPUs
 class ParallelPGMapper {
@@ -163,6 +165,12 @@ public:
     Job *job,
     unsigned pgs_per_item,
     const std::vector<pg_t>& input_pgs);
+  /// queue every pg of pools plus the individual pgs; both may be empty
+  void queue(
+    Job *job,
+    unsigned pgs_per_item,
+    const std::set<int64_t>& pools,
+    const std::vector<pg_t>& input_pgs);
 
   void drain() {
     wq.drain();
@@ -227,25 +235,36 @@ private:
       }
     }
 
-    void set(size_t ps,
+    /// @returns true if the row changed
+    bool set(size_t ps,
 	     const std::vector<int>& up,
 	     int up_primary,
 	     const std::vector<int>& acting,
 	     int acting_primary) {
       int32_t *row = &table[row_size() * ps];
-      row[0] = acting_primary;
-      row[1] = up_primary;
       // these should always be <= the pool size, but just in case, avoid
       // blowing out the array.  Note that our mapping is not completely
       // accurate in this case--this is just to avoid crashing.
-      row[2] = std::min<int32_t>(acting.size(), size);
-      row[3] = std::min<int32_t>(up.size(), size);
+      int32_t num_acting = std::min<int32_t>(acting.size(), size);
+      int32_t num_up = std::min<int32_t>(up.size(), size);
+      bool changed =
+	row[0] != acting_primary ||
+	row[1] != up_primary ||
+	row[2] != num_acting ||
+	row[3] != num_up;
+      row[0] = acting_primary;
+      row[1] = up_primary;
+      row[2] = num_acting;
+      row[3] = num_up;
       for (int i = 0; i < row[2]; ++i) {
+	changed |= row[4 + i] != acting[i];
 	row[4 + i] = acting[i];
       }
       for (int i = 0; i < row[3]; ++i) {
+	changed |= row[4 + size + i] != up[i];
 	row[4 + size + i] = up[i];
       }
+      return changed;
     }
   };
 
@@ -256,16 +275,25 @@ private:
   epoch_t epoch = 0;
   uint64_t num_pgs = 0;
 
-  void _init_mappings(const OSDMap& osdmap);
+  /// rows rewritten with a different mapping since the last _finish();
+  /// this outlives aborted jobs so their updates are still reported
+  mutable ceph::mutex changed_lock =
+    ceph::make_mutex("OSDMapMapping::changed_lock");
+  std::vector<pg_t> changing;
+  std::vector<pg_t> changed;  ///< sorted; as of the last _finish()
+
+  void _init_mappings(const OSDMap& osdmap,
+		      std::set<int64_t> *created = nullptr);
   void _update_range(
     const OSDMap& map,
     int64_t pool,
     unsigned pg_begin, unsigned pg_end);
+  void _update_pgs(const OSDMap& map, const std::vector<pg_t>& pgs);
 
   void _build_rmap(const OSDMap& osdmap);
 
-  void _start(const OSDMap& osdmap) {
-    _init_mappings(osdmap);
+  void _start(const OSDMap& osdmap, std::set<int64_t> *created) {
+    _init_mappings(osdmap, created);
   }
   void _finish(const OSDMap& osdmap);
 
@@ -275,11 +303,14 @@ private:
 
   struct MappingJob : public ParallelPGMapper::Job {
     OSDMapMapping *mapping;
-    MappingJob(const OSDMap *osdmap, OSDMapMapping *m)
+    MappingJob(const OSDMap *osdmap, OSDMapMapping *m,
+	       std::set<int64_t> *created = nullptr)
       : Job(osdmap), mapping(m) {
-      mapping->_start(*osdmap);
+      mapping->_start(*osdmap, created);
+    }
+    void process(const std::vector<pg_t>& pgs) override {
+      mapping->_update_pgs(*osdmap, pgs);
     }
-    void process(const std::vector<pg_t>& pgs) override {}
     void process(int64_t pool, unsigned ps_begin, unsigned ps_end) override {
       mapping->_update_range(*osdmap, pool, ps_begin, ps_end);
     }
@@ -341,10 +372,34 @@ public:
     return job;
   }
 
+  /**
+   * remap only what changed since the last completed update
+   *
+   * @param changes the changes between get_epoch() and map (see
+   *        OSDMap::get_mapping_changes()), merged across epochs
+   */
+  std::unique_ptr<MappingJob> start_update(
+    const OSDMap& map,
+    ParallelPGMapper& mapper,
+    unsigned pgs_per_item,
+    const pg_mapping_changes_t& changes);
+
   epoch_t get_epoch() const {
     return epoch;
   }
 
+  /**
+   * pgs whose up or acting set changed in the last update
+   *
+   * PGs of pools that were just created (or resized) are included; PGs of
+   * deleted pools are not.  Returns a copy, since an update in progress
+   * may replace the list when it completes.
+   */
+  std::vector<pg_t> get_changed_pgs() const {
+    std::lock_guard l(changed_lock);
+    return changed;
+  }
+
   uint64_t get_num_pgs() const {
     return num_pgs;
   }
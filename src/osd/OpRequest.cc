@@ -69,16 +69,15 @@ void OpRequest::_dump(Formatter *f) const
     f->open_array_section("events");
     std::lock_guard l(lock);
 
-    for (auto i = events.begin(); i != events.end(); ++i) {
+    for (size_t i = 0; i < events.size(); ++i) {
       f->open_object_section("event");
-      f->dump_string("event", i->str);
-      f->dump_stream("time") << i->stamp;
+      f->dump_string("event", events[i].str);
+      f->dump_stream("time") << events[i].stamp;
 
       double duration = 0;
 
-      if (i != events.begin()) {
-        auto i_prev = i - 1;
-        duration = i->stamp - i_prev->stamp;
+      if (i > 0) {
+        duration = events[i].stamp - events[i - 1].stamp;
       }
 
       f->dump_float("duration", duration);
@@ -116,17 +115,17 @@ int OpRequest::maybe_init_op_info(const OSDMap &osdmap) {
   return ret;
 }
 
-void OpRequest::mark_flag_point(uint8_t flag, const char *s) {
+void OpRequest::mark_flag_point(uint8_t flag, static_event_t s) {
 #ifdef WITH_LTTNG
   uint8_t old_flags = hit_flag_points;
 #endif
   mark_event(s);
-  last_event_detail = s;
+  last_event_detail = s.c_str();
   hit_flag_points |= flag;
   latest_flag_point = flag;
   tracepoint(oprequest, mark_flag_point, reqid.name._type,
 	     reqid.name._num, reqid.tid, reqid.inc, op_info.get_flags(),
-	     flag, s, old_flags, hit_flag_points);
+	     flag, s.c_str(), old_flags, hit_flag_points);
 }
 
 void OpRequest::mark_flag_point_string(uint8_t flag, const string& s) {
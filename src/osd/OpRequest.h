@@ -154,7 +154,7 @@ public:
   void mark_reached_pg() {
     mark_flag_point(flag_reached_pg, "reached_pg");
   }
-  void mark_delayed(const char* s) {
+  void mark_delayed(static_event_t s) {
     mark_flag_point(flag_delayed, s);
   }
   void mark_started() {
@@ -181,7 +181,7 @@ public:
   typedef boost::intrusive_ptr<OpRequest> Ref;
 
 private:
-  void mark_flag_point(uint8_t flag, const char *s);
+  void mark_flag_point(uint8_t flag, static_event_t s);
   void mark_flag_point_string(uint8_t flag, const std::string& s);
 };
 
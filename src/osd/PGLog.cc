@@ -610,6 +610,10 @@ bool PGLog::merge_log_dups(const pg_log_t& olog) {
 void PGLog::check() {
   if (!pg_log_debug)
     return;
+  if (on_disk_segment_entries.value_or(0)) {
+    // log_keys_debug models one key per entry
+    return;
+  }
   if (log.log.size() != log_keys_debug.size()) {
     derr << "log.log.size() != log_keys_debug.size()" << dendl;
     derr << "actual log:" << dendl;
@@ -638,6 +642,17 @@ void PGLog::write_log_and_missing(
   bool require_rollback)
 {
   if (needs_write()) {
+    const uint32_t segment_entries = cct->_conf->osd_pg_log_segment_entries;
+    if (on_disk_segment_entries &&
+	*on_disk_segment_entries != segment_entries) {
+      dout(1) << "write_log_and_missing converting log from "
+	      << *on_disk_segment_entries << " to " << segment_entries
+	      << " entries per record" << dendl;
+      mark_log_for_rewrite();
+    }
+    if (segment_entries) {
+      log_keys_debug.clear();
+    }
     dout(6) << "write_log_and_missing with: "
 	     << "dirty_to: " << dirty_to
 	     << ", dirty_from: " << dirty_from
@@ -660,9 +675,11 @@ void PGLog::write_log_and_missing(
       dirty_to_dups,
       dirty_from_dups,
       write_from_dups,
+      segment_entries,
       &may_include_deletes_in_missing_dirty,
-      (pg_log_debug ? &log_keys_debug : nullptr),
+      (pg_log_debug && !segment_entries ? &log_keys_debug : nullptr),
       this);
+    on_disk_segment_entries = segment_entries;
     undirty();
   } else {
     dout(10) << "log is not dirty" << dendl;
@@ -711,9 +728,31 @@ void PGLog::write_log_and_missing(
     eversion_t::max(),
     eversion_t(),
     eversion_t(),
+    0,
     may_include_deletes_in_missing_dirty, nullptr, dpp);
 }
 
+/// a full rewrite in either format drops the records of the segmented one
+static void clear_log_segments(
+  ObjectStore::Transaction& t,
+  const coll_t& coll, const ghobject_t &log_oid,
+  eversion_t dirty_to,
+  eversion_t dirty_to_dups)
+{
+  if (dirty_to == eversion_t::max()) {
+    t.omap_rmkeyrange(
+      coll, log_oid,
+      PGLog::get_log_segment_key(eversion_t()),
+      PGLog::get_log_segment_key(eversion_t::max()));
+  }
+  if (dirty_to_dups == eversion_t::max()) {
+    t.omap_rmkeyrange(
+      coll, log_oid,
+      PGLog::get_dup_segment_key(eversion_t()),
+      PGLog::get_dup_segment_key(eversion_t::max()));
+  }
+}
+
 // static
 void PGLog::_write_log_and_missing_wo_missing(
   ObjectStore::Transaction& t,
@@ -740,6 +779,7 @@ void PGLog::_write_log_and_missing_wo_missing(
 		     << " write_from_dups=" << write_from_dups << dendl;
   if (touch_log)
     t.touch(coll, log_oid);
+  clear_log_segments(t, coll, log_oid, dirty_to, dirty_to_dups);
   if (dirty_to != eversion_t()) {
     t.omap_rmkeyrange(
       coll, log_oid,
@@ -863,6 +903,7 @@ void PGLog::_write_log_and_missing(
   eversion_t dirty_to_dups,
   eversion_t dirty_from_dups,
   eversion_t write_from_dups,
+  uint32_t segment_entries,
   bool *may_include_deletes_in_missing_dirty, // in/out param
   set<string> *log_keys_debug,
   const DoutPrefixProvider *dpp
@@ -873,110 +914,123 @@ void PGLog::_write_log_and_missing(
 		     << " write_from_dups=" << write_from_dups
 		     << " trimmed_dups.size()=" << trimmed_dups.size() << dendl;
   set<string> to_remove;
-  to_remove.swap(trimmed_dups);
-  for (auto& t : trimmed) {
-    string key = t.get_key_name();
-    if (log_keys_debug) {
-      auto it = log_keys_debug->find(key);
-      ceph_assert(it != log_keys_debug->end());
-      log_keys_debug->erase(it);
+  if (segment_entries) {
+    if (touch_log)
+      t.touch(coll, log_oid);
+    _write_log_segments(
+      t, km, log, coll, log_oid, segment_entries,
+      dirty_to, dirty_from, writeout_from, trimmed,
+      dirty_to_dups, dirty_from_dups, write_from_dups, trimmed_dups,
+      &to_remove, dpp);
+    trimmed.clear();
+    trimmed_dups.clear();
+  } else {
+    to_remove.swap(trimmed_dups);
+    for (auto& t : trimmed) {
+      string key = t.get_key_name();
+      if (log_keys_debug) {
+	auto it = log_keys_debug->find(key);
+	ceph_assert(it != log_keys_debug->end());
+	log_keys_debug->erase(it);
+      }
+      to_remove.emplace(std::move(key));
+    }
+    trimmed.clear();
+
+    if (touch_log)
+      t.touch(coll, log_oid);
+    clear_log_segments(t, coll, log_oid, dirty_to, dirty_to_dups);
+    if (dirty_to != eversion_t()) {
+      t.omap_rmkeyrange(
+	coll, log_oid,
+	eversion_t().get_key_name(), dirty_to.get_key_name());
+      clear_up_to(log_keys_debug, dirty_to.get_key_name());
+    }
+    if (dirty_to != eversion_t::max() && dirty_from != eversion_t::max()) {
+      ldpp_dout(dpp, 10) << "write_log_and_missing, clearing from "
+			 << dirty_from << dendl;
+      t.omap_rmkeyrange(
+	coll, log_oid,
+	dirty_from.get_key_name(), eversion_t::max().get_key_name());
+      clear_after(log_keys_debug, dirty_from.get_key_name());
     }
-    to_remove.emplace(std::move(key));
-  }
-  trimmed.clear();
-
-  if (touch_log)
-    t.touch(coll, log_oid);
-  if (dirty_to != eversion_t()) {
-    t.omap_rmkeyrange(
-      coll, log_oid,
-      eversion_t().get_key_name(), dirty_to.get_key_name());
-    clear_up_to(log_keys_debug, dirty_to.get_key_name());
-  }
-  if (dirty_to != eversion_t::max() && dirty_from != eversion_t::max()) {
-    ldpp_dout(dpp, 10) << "write_log_and_missing, clearing from "
-		       << dirty_from << dendl;
-    t.omap_rmkeyrange(
-      coll, log_oid,
-      dirty_from.get_key_name(), eversion_t::max().get_key_name());
-    clear_after(log_keys_debug, dirty_from.get_key_name());
-  }
-
-  for (auto p = log.log.begin();
-       p != log.log.end() && p->version <= dirty_to;
-       ++p) {
-    bufferlist bl(sizeof(*p) * 2);
-    p->encode_with_checksum(bl);
-    (*km)[p->get_key_name()] = std::move(bl);
-  }
 
-  for (auto p = log.log.rbegin();
-       p != log.log.rend() &&
-	 (p->version >= dirty_from || p->version >= writeout_from) &&
-	 p->version >= dirty_to;
-       ++p) {
-    bufferlist bl(sizeof(*p) * 2);
-    p->encode_with_checksum(bl);
-    (*km)[p->get_key_name()] = std::move(bl);
-  }
+    for (auto p = log.log.begin();
+	 p != log.log.end() && p->version <= dirty_to;
+	 ++p) {
+      bufferlist bl(sizeof(*p) * 2);
+      p->encode_with_checksum(bl);
+      (*km)[p->get_key_name()] = std::move(bl);
+    }
 
-  if (log_keys_debug) {
-    for (auto i = (*km).begin();
-	 i != (*km).end();
-	 ++i) {
-      if (i->first[0] == '_')
-	continue;
-      ceph_assert(!log_keys_debug->count(i->first));
-      log_keys_debug->insert(i->first);
+    for (auto p = log.log.rbegin();
+	 p != log.log.rend() &&
+	   (p->version >= dirty_from || p->version >= writeout_from) &&
+	   p->version >= dirty_to;
+	 ++p) {
+      bufferlist bl(sizeof(*p) * 2);
+      p->encode_with_checksum(bl);
+      (*km)[p->get_key_name()] = std::move(bl);
     }
-  }
 
-  // process dups after log_keys_debug is filled, so dups do not
-  // end up in that set
-  if (dirty_to_dups != eversion_t()) {
-    pg_log_dup_t min, dirty_to_dup;
-    dirty_to_dup.version = dirty_to_dups;
-    ldpp_dout(dpp, 10) << __func__ << " remove dups min=" << min.get_key_name()
-		       << " to dirty_to_dup=" << dirty_to_dup.get_key_name() << dendl;
-    t.omap_rmkeyrange(
-      coll, log_oid,
-      min.get_key_name(), dirty_to_dup.get_key_name());
-  }
-  if (dirty_to_dups != eversion_t::max() && dirty_from_dups != eversion_t::max()) {
-    pg_log_dup_t max, dirty_from_dup;
-    max.version = eversion_t::max();
-    dirty_from_dup.version = dirty_from_dups;
-    ldpp_dout(dpp, 10) << __func__ << " remove dups dirty_from_dup="
-		       << dirty_from_dup.get_key_name()
-		       << " to max=" << max.get_key_name() << dendl;
-    t.omap_rmkeyrange(
-      coll, log_oid,
-      dirty_from_dup.get_key_name(), max.get_key_name());
-  }
+    if (log_keys_debug) {
+      for (auto i = (*km).begin();
+	   i != (*km).end();
+	   ++i) {
+	if (i->first[0] == '_')
+	  continue;
+	ceph_assert(!log_keys_debug->count(i->first));
+	log_keys_debug->insert(i->first);
+      }
+    }
 
-  ldpp_dout(dpp, 10) << __func__ << " going to encode log.dups.size()="
-		     << log.dups.size() << dendl;
-  for (const auto& entry : log.dups) {
-    if (entry.version > dirty_to_dups)
-      break;
-    bufferlist bl;
-    encode(entry, bl);
-    (*km)[entry.get_key_name()] = std::move(bl);
-  }
-  ldpp_dout(dpp, 10) << __func__ << " 1st round encoded log.dups.size()="
-		     << log.dups.size() << dendl;
+    // process dups after log_keys_debug is filled, so dups do not
+    // end up in that set
+    if (dirty_to_dups != eversion_t()) {
+      pg_log_dup_t min, dirty_to_dup;
+      dirty_to_dup.version = dirty_to_dups;
+      ldpp_dout(dpp, 10) << __func__ << " remove dups min=" << min.get_key_name()
+			 << " to dirty_to_dup=" << dirty_to_dup.get_key_name() << dendl;
+      t.omap_rmkeyrange(
+	coll, log_oid,
+	min.get_key_name(), dirty_to_dup.get_key_name());
+    }
+    if (dirty_to_dups != eversion_t::max() && dirty_from_dups != eversion_t::max()) {
+      pg_log_dup_t max, dirty_from_dup;
+      max.version = eversion_t::max();
+      dirty_from_dup.version = dirty_from_dups;
+      ldpp_dout(dpp, 10) << __func__ << " remove dups dirty_from_dup="
+			 << dirty_from_dup.get_key_name()
+			 << " to max=" << max.get_key_name() << dendl;
+      t.omap_rmkeyrange(
+	coll, log_oid,
+	dirty_from_dup.get_key_name(), max.get_key_name());
+    }
 
-  for (auto p = log.dups.rbegin();
-       p != log.dups.rend() &&
-	 (p->version >= dirty_from_dups || p->version >= write_from_dups) &&
-	 p->version >= dirty_to_dups;
-       ++p) {
-    bufferlist bl;
-    encode(*p, bl);
-    (*km)[p->get_key_name()] = std::move(bl);
+    ldpp_dout(dpp, 10) << __func__ << " going to encode log.dups.size()="
+		       << log.dups.size() << dendl;
+    for (const auto& entry : log.dups) {
+      if (entry.version > dirty_to_dups)
+	break;
+      bufferlist bl;
+      encode(entry, bl);
+      (*km)[entry.get_key_name()] = std::move(bl);
+    }
+    ldpp_dout(dpp, 10) << __func__ << " 1st round encoded log.dups.size()="
+		       << log.dups.size() << dendl;
+
+    for (auto p = log.dups.rbegin();
+	 p != log.dups.rend() &&
+	   (p->version >= dirty_from_dups || p->version >= write_from_dups) &&
+	   p->version >= dirty_to_dups;
+	 ++p) {
+      bufferlist bl;
+      encode(*p, bl);
+      (*km)[p->get_key_name()] = std::move(bl);
+    }
+    ldpp_dout(dpp, 10) << __func__ << " 2st round encoded log.dups.size()="
+		       << log.dups.size() << dendl;
   }
-  ldpp_dout(dpp, 10) << __func__ << " 2st round encoded log.dups.size()="
-		     << log.dups.size() << dendl;
 
   if (clear_divergent_priors) {
     ldpp_dout(dpp, 10) << "write_log_and_missing: writing divergent_priors"
@@ -1013,6 +1067,237 @@ void PGLog::_write_log_and_missing(
   ldpp_dout(dpp, 10) << "end of " << __func__ << dendl;
 }
 
+namespace {
+
+/// inverse of pg_log_dup_t::get_key_name()
+eversion_t dup_key_version(const string &key)
+{
+  ceph_assert(key.size() == 35 && key.compare(0, 4, "dup_") == 0);
+  return eversion_t(strtoul(key.c_str() + 4, nullptr, 10),
+		    strtoull(key.c_str() + 15, nullptr, 10));
+}
+
+/**
+ * call f(start, first, last) for every segment of entries holding an
+ * entry with a version in [from, to]
+ *
+ * The scan starts from the back, so rewriting the newest segment costs
+ * only the entries in it.
+ */
+template <typename T, typename F>
+void for_each_segment(
+  const mempool::osd_pglog::list<T> &entries,
+  uint32_t segment_entries,
+  eversion_t from,
+  eversion_t to,
+  F &&f)
+{
+  const auto first = PGLog::get_segment_start(from, segment_entries);
+  const auto last = PGLog::get_segment_start(to, segment_entries);
+  auto p = entries.end();
+  while (p != entries.begin() &&
+	 PGLog::get_segment_start(std::prev(p)->version, segment_entries) >=
+	   first) {
+    --p;
+  }
+  while (p != entries.end()) {
+    auto start = PGLog::get_segment_start(p->version, segment_entries);
+    if (start > last)
+      break;
+    auto q = p;
+    while (q != entries.end() &&
+	   PGLog::get_segment_start(q->version, segment_entries) == start) {
+      ++q;
+    }
+    f(start, p, q);
+    p = q;
+  }
+}
+
+/// remove the records of all segments overlapping [from, to]
+void remove_segments(
+  ObjectStore::Transaction& t,
+  const coll_t& coll, const ghobject_t &log_oid,
+  std::string (*key)(eversion_t),
+  uint32_t segment_entries,
+  eversion_t from,
+  eversion_t to)
+{
+  auto end = PGLog::get_segment_start(to, segment_entries);
+  t.omap_rmkeyrange(
+    coll, log_oid,
+    key(PGLog::get_segment_start(from, segment_entries)),
+    to == eversion_t::max() ? key(to) : key(eversion_t(end.epoch,
+						       end.version + 1)));
+}
+
+} // anonymous namespace
+
+// static
+void PGLog::_write_log_segments(
+  ObjectStore::Transaction& t,
+  map<string,bufferlist>* km,
+  pg_log_t &log,
+  const coll_t& coll, const ghobject_t &log_oid,
+  uint32_t segment_entries,
+  eversion_t dirty_to,
+  eversion_t dirty_from,
+  eversion_t writeout_from,
+  const set<eversion_t> &trimmed,
+  eversion_t dirty_to_dups,
+  eversion_t dirty_from_dups,
+  eversion_t write_from_dups,
+  const set<string> &trimmed_dups,
+  set<string> *to_remove,
+  const DoutPrefixProvider *dpp)
+{
+  const uint32_t n = segment_entries;
+  auto write_log_segment = [&](eversion_t start, auto first, auto last) {
+    bufferlist bl;
+    ENCODE_START(1, 1, bl);
+    encode(n, bl);
+    encode((uint32_t)std::distance(first, last), bl);
+    for (; first != last; ++first) {
+      first->encode_with_checksum(bl);
+    }
+    ENCODE_FINISH(bl);
+    (*km)[get_log_segment_key(start)] = std::move(bl);
+  };
+  auto write_dup_segment = [&](eversion_t start, auto first, auto last) {
+    bufferlist bl;
+    ENCODE_START(1, 1, bl);
+    encode(n, bl);
+    encode((uint32_t)std::distance(first, last), bl);
+    for (; first != last; ++first) {
+      encode(*first, bl);
+    }
+    ENCODE_FINISH(bl);
+    (*km)[get_dup_segment_key(start)] = std::move(bl);
+  };
+
+  // log entries: records are replaced wholesale, so whatever is rewritten
+  // below needs no removal first unless it may have lost all its entries
+  if (dirty_to == eversion_t::max()) {
+    ldpp_dout(dpp, 10) << __func__ << " rewriting all log segments" << dendl;
+    t.omap_rmkeyrange(
+      coll, log_oid,
+      eversion_t().get_key_name(), eversion_t::max().get_key_name());
+    t.omap_rmkeyrange(
+      coll, log_oid,
+      get_log_segment_key(eversion_t()),
+      get_log_segment_key(eversion_t::max()));
+    for_each_segment(log.log, n, eversion_t(), eversion_t::max(),
+		     write_log_segment);
+  } else {
+    if (dirty_to != eversion_t()) {
+      remove_segments(t, coll, log_oid, get_log_segment_key, n,
+		      eversion_t(), dirty_to);
+      for_each_segment(log.log, n, eversion_t(), dirty_to, write_log_segment);
+    }
+    if (dirty_from != eversion_t::max()) {
+      ldpp_dout(dpp, 10) << __func__ << " clearing from " << dirty_from
+			 << dendl;
+      remove_segments(t, coll, log_oid, get_log_segment_key, n,
+		      dirty_from, eversion_t::max());
+    }
+    auto from = std::min(dirty_from, writeout_from);
+    if (from != eversion_t::max()) {
+      for_each_segment(log.log, n, std::max(from, dirty_to), eversion_t::max(),
+		       write_log_segment);
+    }
+    // a record goes once its last entry is trimmed; until then readers
+    // skip its entries at or before the log tail
+    const auto oldest = log.log.empty() ?
+      eversion_t::max() : get_segment_start(log.log.front().version, n);
+    for (auto& v : trimmed) {
+      auto start = get_segment_start(v, n);
+      if (start < oldest) {
+	to_remove->insert(get_log_segment_key(start));
+      }
+    }
+  }
+
+  // dups
+  if (dirty_to_dups == eversion_t::max()) {
+    ldpp_dout(dpp, 10) << __func__ << " rewriting all dup segments" << dendl;
+    pg_log_dup_t min, max;
+    max.version = eversion_t::max();
+    t.omap_rmkeyrange(
+      coll, log_oid,
+      min.get_key_name(), max.get_key_name());
+    t.omap_rmkeyrange(
+      coll, log_oid,
+      get_dup_segment_key(eversion_t()),
+      get_dup_segment_key(eversion_t::max()));
+    for_each_segment(log.dups, n, eversion_t(), eversion_t::max(),
+		     write_dup_segment);
+  } else {
+    if (dirty_to_dups != eversion_t()) {
+      remove_segments(t, coll, log_oid, get_dup_segment_key, n,
+		      eversion_t(), dirty_to_dups);
+      for_each_segment(log.dups, n, eversion_t(), dirty_to_dups,
+		       write_dup_segment);
+    }
+    if (dirty_from_dups != eversion_t::max()) {
+      remove_segments(t, coll, log_oid, get_dup_segment_key, n,
+		      dirty_from_dups, eversion_t::max());
+    }
+    auto from = std::min(dirty_from_dups, write_from_dups);
+    if (from != eversion_t::max()) {
+      for_each_segment(log.dups, n, std::max(from, dirty_to_dups),
+		       eversion_t::max(), write_dup_segment);
+    }
+    // a partially trimmed record just brings back a few more dups than
+    // osd_pg_log_dups_tracked on the next load
+    const auto oldest = log.dups.empty() ?
+      eversion_t::max() : get_segment_start(log.dups.front().version, n);
+    for (auto& key : trimmed_dups) {
+      auto start = get_segment_start(dup_key_version(key), n);
+      if (start < oldest) {
+	to_remove->insert(get_dup_segment_key(start));
+      }
+    }
+  }
+  ldpp_dout(dpp, 10) << __func__ << " wrote " << km->size() << " keys, "
+		     << to_remove->size() << " to remove" << dendl;
+}
+
+// static
+uint32_t PGLog::decode_log_segment(
+  const bufferlist &bl,
+  std::list<pg_log_entry_t> *entries)
+{
+  auto p = bl.cbegin();
+  uint32_t segment_entries, count;
+  DECODE_START(1, p);
+  decode(segment_entries, p);
+  decode(count, p);
+  while (count--) {
+    entries->emplace_back();
+    entries->back().decode_with_checksum(p);
+  }
+  DECODE_FINISH(p);
+  return segment_entries;
+}
+
+// static
+uint32_t PGLog::decode_dup_segment(
+  const bufferlist &bl,
+  std::list<pg_log_dup_t> *dups)
+{
+  auto p = bl.cbegin();
+  uint32_t segment_entries, count;
+  DECODE_START(1, p);
+  decode(segment_entries, p);
+  decode(count, p);
+  while (count--) {
+    dups->emplace_back();
+    decode(dups->back(), p);
+  }
+  DECODE_FINISH(p);
+  return segment_entries;
+}
+
 void PGLog::rebuild_missing_set_with_deletes(
   ObjectStore *store,
   ObjectStore::CollectionHandle& ch,
@@ -1081,6 +1366,7 @@ namespace {
     std::set<std::string>* log_keys_debug = NULL;
     pg_missing_tracker_t &missing;
     const DoutPrefixProvider *dpp;
+    std::optional<uint32_t> *on_disk_segment_entries = nullptr;
 
     eversion_t on_disk_can_rollback_to;
     eversion_t on_disk_rollback_info_trimmed_to;
@@ -1118,7 +1404,32 @@ namespace {
           ceph_assert(missing.may_include_deletes);
         }
         missing.add(oid, std::move(item));
+      } else if (PGLog::is_log_segment_key(p->key())) {
+        std::list<pg_log_entry_t> seg;
+        auto segment_entries = PGLog::decode_log_segment(bl, &seg);
+        if (on_disk_segment_entries)
+          *on_disk_segment_entries = segment_entries;
+        for (auto& e : seg) {
+          if (e.version <= info.log_tail)
+            continue;
+          if (!entries.empty()) {
+            ceph_assert(entries.back().version.version < e.version.version);
+            ceph_assert(entries.back().version.epoch <= e.version.epoch);
+          }
+          entries.push_back(std::move(e));
+        }
+      } else if (PGLog::is_dup_segment_key(p->key())) {
+        std::list<pg_log_dup_t> seg;
+        auto segment_entries = PGLog::decode_dup_segment(bl, &seg);
+        if (on_disk_segment_entries)
+          *on_disk_segment_entries = segment_entries;
+        if (!dups.empty() && !seg.empty()) {
+          ceph_assert(dups.back().version <= seg.front().version);
+        }
+        dups.splice(dups.end(), seg);
       } else if (p->key().substr(0, 4) == std::string("dup_")) {
+        if (on_disk_segment_entries)
+          *on_disk_segment_entries = 0;
         pg_log_dup_t dup;
         decode(dup, bp);
         if (!dups.empty()) {
@@ -1128,6 +1439,8 @@ namespace {
       } else {
         pg_log_entry_t e;
         e.decode_with_checksum(bp);
+        if (on_disk_segment_entries)
+          *on_disk_segment_entries = 0;
         ldpp_dout(dpp, 20) << "read_log_and_missing " << e << dendl;
         if (!entries.empty()) {
           pg_log_entry_t last_e(entries.back());
@@ -1178,14 +1491,15 @@ seastar::future<> PGLog::read_log_and_missing_crimson(
   std::set<std::string>* log_keys_debug,
   pg_missing_tracker_t &missing,
   ghobject_t pgmeta_oid,
-  const DoutPrefixProvider *dpp)
+  const DoutPrefixProvider *dpp,
+  std::optional<uint32_t> *on_disk_segment_entries)
 {
   ldpp_dout(dpp, 20) << "read_log_and_missing coll "
                      << ch->get_cid()
                      << " " << pgmeta_oid << dendl;
   return seastar::do_with(FuturizedStoreLogReader{
       store, info, log, log_keys_debug,
-      missing, dpp},
+      missing, dpp, on_disk_segment_entries},
     [ch, pgmeta_oid](FuturizedStoreLogReader& reader) {
     return reader.read(ch, pgmeta_oid);
   });
@@ -20,8 +20,10 @@
 #include "include/ceph_assert.h"
 #include "include/common_fwd.h"
 #include "osd_types.h"
+#include "ReqidIndex.h"
 #include "os/ObjectStore.h"
 #include <list>
+#include <optional>
 
 #ifdef WITH_SEASTAR
 #include <seastar/core/future.hh>
@@ -147,9 +149,9 @@ public:
    */
   struct IndexedLog : public pg_log_t {
     mutable ceph::unordered_map<hobject_t,pg_log_entry_t*> objects;  // ptrs into log.  be careful!
-    mutable ceph::unordered_map<osd_reqid_t,pg_log_entry_t*> caller_ops;
+    mutable reqid_index_t<pg_log_entry_t> caller_ops;
     mutable ceph::unordered_multimap<osd_reqid_t,pg_log_entry_t*> extra_caller_ops;
-    mutable ceph::unordered_map<osd_reqid_t,pg_log_dup_t*> dup_index;
+    mutable reqid_index_t<pg_log_dup_t> dup_index;
 
     // recovery pointers
     std::list<pg_log_entry_t>::iterator complete_to; // not inclusive of referenced item
@@ -219,7 +221,9 @@ public:
       rollback_info_trimmed_to_riter(log.rbegin())
     {
       reset_rollback_info_trimmed_to_riter();
-      index();
+      // dups are only looked at when checking for a resent op; leave
+      // them to get_request() to index
+      index(PGLOG_INDEXED_ALL & ~PGLOG_INDEXED_DUPS);
     }
 
     IndexedLog(const IndexedLog &rhs) :
@@ -327,7 +331,7 @@ public:
       if (!(indexed_data & PGLOG_INDEXED_CALLER_OPS)) {
         index_caller_ops();
       }
-      if (!caller_ops.count(r)) {
+      if (!caller_ops.find(r)) {
         if (!(indexed_data & PGLOG_INDEXED_EXTRA_CALLER_OPS)) {
           index_extra_caller_ops();
         }
@@ -349,12 +353,11 @@ public:
       if (!(indexed_data & PGLOG_INDEXED_CALLER_OPS)) {
         index_caller_ops();
       }
-      auto p = caller_ops.find(r);
-      if (p != caller_ops.end()) {
-	*version = p->second->version;
-	*user_version = p->second->user_version;
-	*return_code = p->second->return_code;
-	*op_returns = p->second->op_returns;
+      if (auto e = caller_ops.find(r); e) {
+	*version = e->version;
+	*user_version = e->user_version;
+	*return_code = e->return_code;
+	*op_returns = e->op_returns;
 	return true;
       }
 
@@ -363,7 +366,7 @@ public:
       if (!(indexed_data & PGLOG_INDEXED_EXTRA_CALLER_OPS)) {
         index_extra_caller_ops();
       }
-      p = extra_caller_ops.find(r);
+      auto p = extra_caller_ops.find(r);
       if (p != extra_caller_ops.end()) {
 	uint32_t idx = 0;
 	for (auto i = p->second->extra_reqids.begin();
@@ -389,12 +392,11 @@ public:
       if (!(indexed_data & PGLOG_INDEXED_DUPS)) {
         index_dups();
       }
-      auto q = dup_index.find(r);
-      if (q != dup_index.end()) {
-	*version = q->second->version;
-	*user_version = q->second->user_version;
-	*return_code = q->second->return_code;
-	*op_returns = q->second->op_returns;
+      if (auto q = dup_index.find(r); q) {
+	*version = q->version;
+	*user_version = q->user_version;
+	*return_code = q->return_code;
+	*op_returns = q->op_returns;
 	return true;
       }
 
@@ -452,14 +454,17 @@ public:
 
       if (to_index & PGLOG_INDEXED_OBJECTS)
 	objects.clear();
-      if (to_index & PGLOG_INDEXED_CALLER_OPS)
+      if (to_index & PGLOG_INDEXED_CALLER_OPS) {
 	caller_ops.clear();
+	caller_ops.reserve(log.size());
+      }
       if (to_index & PGLOG_INDEXED_EXTRA_CALLER_OPS)
 	extra_caller_ops.clear();
       if (to_index & PGLOG_INDEXED_DUPS) {
 	dup_index.clear();
+	dup_index.reserve(dups.size());
 	for (auto& i : dups) {
-	  dup_index[i.reqid] = const_cast<pg_log_dup_t*>(&i);
+	  dup_index.set(const_cast<pg_log_dup_t*>(&i));
 	}
       }
 
@@ -478,7 +483,7 @@ public:
 
 	  if (to_index & PGLOG_INDEXED_CALLER_OPS) {
 	    if (i->reqid_is_indexed()) {
-	      caller_ops[i->reqid] = const_cast<pg_log_entry_t*>(&(*i));
+	      caller_ops.set(const_cast<pg_log_entry_t*>(&(*i)));
 	    }
 	  }
 
@@ -521,7 +526,7 @@ public:
       if (indexed_data & PGLOG_INDEXED_CALLER_OPS) {
 	// divergent merge_log indexes new before unindexing old
         if (e.reqid_is_indexed()) {
-	  caller_ops[e.reqid] = &e;
+	  caller_ops.set(&e);
         }
       }
       if (indexed_data & PGLOG_INDEXED_EXTRA_CALLER_OPS) {
@@ -550,10 +555,8 @@ public:
       }
       if (e.reqid_is_indexed()) {
         if (indexed_data & PGLOG_INDEXED_CALLER_OPS) {
-	  auto it = caller_ops.find(e.reqid);
 	  // divergent merge_log indexes new before unindexing old
-          if (it != caller_ops.end() && it->second == &e)
-            caller_ops.erase(it);
+	  caller_ops.erase(e.reqid, &e);
         }
       }
       if (indexed_data & PGLOG_INDEXED_EXTRA_CALLER_OPS) {
@@ -574,16 +577,13 @@ public:
 
     void index(pg_log_dup_t& e) {
       if (indexed_data & PGLOG_INDEXED_DUPS) {
-	dup_index[e.reqid] = &e;
+	dup_index.set(&e);
       }
     }
 
     void unindex(const pg_log_dup_t& e) {
       if (indexed_data & PGLOG_INDEXED_DUPS) {
-	auto i = dup_index.find(e.reqid);
-	if (i != dup_index.end()) {
-	  dup_index.erase(i);
-	}
+	dup_index.erase(e.reqid);
       }
     }
 
@@ -613,7 +613,7 @@ public:
       }
       if (indexed_data & PGLOG_INDEXED_CALLER_OPS) {
         if (e.reqid_is_indexed()) {
-	  caller_ops[e.reqid] = &(log.back());
+	  caller_ops.set(&(log.back()));
         }
       }
 
@@ -662,6 +662,9 @@ protected:
   bool dirty_log;
   bool clear_divergent_priors;
   bool may_include_deletes_in_missing_dirty = false;
+  /// osd_pg_log_segment_entries the log on disk was written with; unset
+  /// if nothing has been read back or written yet
+  std::optional<uint32_t> on_disk_segment_entries;
 
   void mark_dirty_to(eversion_t to) {
     if (to > dirty_to)
@@ -1384,11 +1387,62 @@ public:
     eversion_t dirty_to_dups,
     eversion_t dirty_from_dups,
     eversion_t write_from_dups,
+    uint32_t segment_entries,
     bool *may_include_deletes_in_missing_dirty,
     std::set<std::string> *log_keys_debug,
     const DoutPrefixProvider *dpp = nullptr
     );
 
+  static void _write_log_segments(
+    ObjectStore::Transaction& t,
+    std::map<std::string,ceph::buffer::list>* km,
+    pg_log_t &log,
+    const coll_t& coll, const ghobject_t &log_oid,
+    uint32_t segment_entries,
+    eversion_t dirty_to,
+    eversion_t dirty_from,
+    eversion_t writeout_from,
+    const std::set<eversion_t> &trimmed,
+    eversion_t dirty_to_dups,
+    eversion_t dirty_from_dups,
+    eversion_t write_from_dups,
+    const std::set<std::string> &trimmed_dups,
+    std::set<std::string> *to_remove,
+    const DoutPrefixProvider *dpp);
+
+  /**
+   * segmented log format (osd_pg_log_segment_entries > 0)
+   *
+   * Entries and dups are packed into records keyed by the first version
+   * of the segment they fall into; a segment covers segment_entries
+   * versions of one epoch.  Trimming leaves the oldest record in place
+   * until all of its entries are trimmed, so readers skip log entries at
+   * or before info.log_tail.
+   */
+  static eversion_t get_segment_start(eversion_t v, uint32_t segment_entries) {
+    return eversion_t(v.epoch, v.version - v.version % segment_entries);
+  }
+  static std::string get_log_segment_key(eversion_t start) {
+    return "seg_log_" + start.get_key_name();
+  }
+  static std::string get_dup_segment_key(eversion_t start) {
+    return "seg_dup_" + start.get_key_name();
+  }
+  static bool is_log_segment_key(const std::string &key) {
+    return key.compare(0, 8, "seg_log_") == 0;
+  }
+  static bool is_dup_segment_key(const std::string &key) {
+    return key.compare(0, 8, "seg_dup_") == 0;
+  }
+  /// append the entries of a log segment record; returns its segment size
+  static uint32_t decode_log_segment(
+    const ceph::buffer::list &bl,
+    std::list<pg_log_entry_t> *entries);
+  /// append the dups of a dup segment record; returns its segment size
+  static uint32_t decode_dup_segment(
+    const ceph::buffer::list &bl,
+    std::list<pg_log_dup_t> *dups);
+
   void read_log_and_missing(
     ObjectStore *store,
     ObjectStore::CollectionHandle& ch,
@@ -1405,7 +1459,8 @@ public:
       &clear_divergent_priors,
       this,
       (pg_log_debug ? &log_keys_debug : nullptr),
-      debug_verify_stored_missing);
+      debug_verify_stored_missing,
+      &on_disk_segment_entries);
   }
 
   template <typename missing_type>
@@ -1422,7 +1477,8 @@ public:
     bool *clear_divergent_priors = nullptr,
     const DoutPrefixProvider *dpp = nullptr,
     std::set<std::string> *log_keys_debug = nullptr,
-    bool debug_verify_stored_missing = false
+    bool debug_verify_stored_missing = false,
+    std::optional<uint32_t> *on_disk_segment_entries = nullptr
     ) {
     ldpp_dout(dpp, 10) << "read_log_and_missing coll " << ch->cid
 		       << " " << pgmeta_oid << dendl;
@@ -1475,8 +1531,38 @@ public:
 	    ceph_assert(missing.may_include_deletes);
 	  }
 	  missing.add(oid, std::move(item));
+	} else if (is_log_segment_key(p->key())) {
+	  std::list<pg_log_entry_t> seg;
+	  auto segment_entries = decode_log_segment(bl, &seg);
+	  if (on_disk_segment_entries)
+	    *on_disk_segment_entries = segment_entries;
+	  for (auto& e : seg) {
+	    if (e.version <= info.log_tail) {
+	      // trimmed; the record stays until all of it is
+	      continue;
+	    }
+	    ldpp_dout(dpp, 20) << "read_log_and_missing " << e << dendl;
+	    if (!entries.empty()) {
+	      ceph_assert(entries.back().version.version < e.version.version);
+	      ceph_assert(entries.back().version.epoch <= e.version.epoch);
+	    }
+	    entries.push_back(std::move(e));
+	  }
+	} else if (is_dup_segment_key(p->key())) {
+	  std::list<pg_log_dup_t> seg;
+	  auto segment_entries = decode_dup_segment(bl, &seg);
+	  if (on_disk_segment_entries)
+	    *on_disk_segment_entries = segment_entries;
+	  total_dups += seg.size();
+	  if (!dups.empty() && !seg.empty()) {
+	    // extra reqids share the version of their op
+	    ceph_assert(dups.back().version <= seg.front().version);
+	  }
+	  dups.splice(dups.end(), seg);
 	} else if (p->key().substr(0, 4) == std::string("dup_")) {
 	  ++total_dups;
+	  if (on_disk_segment_entries)
+	    *on_disk_segment_entries = 0;
 	  pg_log_dup_t dup;
 	  decode(dup, bp);
 	  if (!dups.empty()) {
@@ -1494,6 +1580,8 @@ public:
 	} else {
 	  pg_log_entry_t e;
 	  e.decode_with_checksum(bp);
+	  if (on_disk_segment_entries)
+	    *on_disk_segment_entries = 0;
 	  ldpp_dout(dpp, 20) << "read_log_and_missing " << e << dendl;
 	  if (!entries.empty()) {
 	    pg_log_entry_t last_e(entries.back());
@@ -1684,7 +1772,7 @@ public:
     return read_log_and_missing_crimson(
       store, ch, info,
       log, (pg_log_debug ? &log_keys_debug : nullptr),
-      missing, pgmeta_oid, this);
+      missing, pgmeta_oid, this, &on_disk_segment_entries);
   }
 
   static seastar::future<> read_log_and_missing_crimson(
@@ -1695,7 +1783,8 @@ public:
     std::set<std::string>* log_keys_debug,
     pg_missing_tracker_t &missing,
     ghobject_t pgmeta_oid,
-    const DoutPrefixProvider *dpp = nullptr);
+    const DoutPrefixProvider *dpp = nullptr,
+    std::optional<uint32_t> *on_disk_segment_entries = nullptr);
 
 #endif
 
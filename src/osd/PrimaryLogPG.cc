@@ -839,6 +839,7 @@ bool PrimaryLogPG::check_laggy(OpRequestRef& op)
 	     << " > readable_until " << ru << dendl;
 
     if (!is_primary()) {
+      osd->logger->inc(l_osd_replica_read_lease_expired);
       osd->reply_op_error(op, -EAGAIN);
       return false;
     }
@@ -2185,6 +2186,7 @@ void PrimaryLogPG::do_op(OpRequestRef& op)
   // missing object?
   if (is_unreadable_object(head)) {
     if (!is_primary()) {
+      osd->logger->inc(l_osd_replica_read_bounced);
       osd->reply_op_error(op, -EAGAIN);
       return;
     }
@@ -2308,11 +2310,13 @@ void PrimaryLogPG::do_op(OpRequestRef& op)
       dout(20) << __func__
                << ": unstable write on replica, bouncing to primary "
 	       << *m << dendl;
+      osd->logger->inc(l_osd_replica_read_bounced);
       osd->reply_op_error(op, -EAGAIN);
       return;
     }
     dout(20) << __func__ << ": serving replica read on oid " << oid
              << dendl;
+    osd->logger->inc(l_osd_replica_read);
   }
 
   int r = find_object_context(
@@ -2366,6 +2370,8 @@ void PrimaryLogPG::do_op(OpRequestRef& op)
     }
     if (!op->hitset_inserted) {
       hit_set->insert(oid);
+      if (agent_state)
+	agent_state->temp_sketch.insert(oid);
       op->hitset_inserted = true;
       if (hit_set->is_full() ||
           hit_set_start_stamp + pool.info.hit_set_period <= m->get_recv_stamp()) {
@@ -4392,6 +4398,9 @@ void PrimaryLogPG::log_op_stats(const OpRequest& op,
   osd->logger->inc(l_osd_op_inb, inb);
   osd->logger->tinc(l_osd_op_lat, latency);
   osd->logger->tinc(l_osd_op_process_lat, process_latency);
+  osd->mclock_calibration.record(
+    ceph::osd::scheduler::op_scheduler_class::client, inb + outb,
+    ceph::make_timespan(process_latency), ceph::make_timespan(latency));
 
   if (op.may_read() && op.may_write()) {
     osd->logger->inc(l_osd_op_rw);
@@ -14431,6 +14440,10 @@ void PrimaryLogPG::hit_set_setup()
 
   // FIXME: discard any previous data for now
   hit_set_create();
+  if (agent_state) {
+    // the sketch already marked hits the new set will not have
+    agent_state->temp_sketch.clear();
+  }
 
   // include any writes we know about from the pg log.  this doesn't
   // capture reads, but it is better than nothing!
@@ -14482,37 +14495,48 @@ void PrimaryLogPG::hit_set_create()
   HitSet::Params params(pool.info.hit_set_params);
 
   dout(20) << __func__ << " " << params << dendl;
-  if (pool.info.hit_set_params.get_type() == HitSet::TYPE_BLOOM) {
-    BloomHitSet::Params *p =
-      static_cast<BloomHitSet::Params*>(params.impl.get());
-
-    // convert false positive rate so it holds up across the full period
-    p->set_fpp(p->get_fpp() / pool.info.hit_set_count);
-    if (p->get_fpp() <= 0.0)
-      p->set_fpp(.01);  // fpp cannot be zero!
 
-    // if we don't have specified size, estimate target size based on the
-    // previous bin!
-    if (p->target_size == 0 && hit_set) {
+  // if we don't have specified size, estimate target size based on the
+  // previous bin!
+  auto estimate_target_size = [&](uint64_t& target_size) {
+    if (target_size == 0 && hit_set) {
       utime_t dur = now - hit_set_start_stamp;
       unsigned unique = hit_set->approx_unique_insert_count();
       dout(20) << __func__ << " previous set had approx " << unique
 	       << " unique items over " << dur << " seconds" << dendl;
-      p->target_size = (double)unique * (double)pool.info.hit_set_period
-		     / (double)dur;
+      target_size = (double)unique * (double)pool.info.hit_set_period
+		  / (double)dur;
     }
-    if (p->target_size <
+    if (target_size <
 	static_cast<uint64_t>(cct->_conf->osd_hit_set_min_size))
-      p->target_size = cct->_conf->osd_hit_set_min_size;
+      target_size = cct->_conf->osd_hit_set_min_size;
 
-    if (p->target_size
+    if (target_size
 	> static_cast<uint64_t>(cct->_conf->osd_hit_set_max_size))
-      p->target_size = cct->_conf->osd_hit_set_max_size;
+      target_size = cct->_conf->osd_hit_set_max_size;
+  };
 
+  if (pool.info.hit_set_params.get_type() == HitSet::TYPE_BLOOM) {
+    BloomHitSet::Params *p =
+      static_cast<BloomHitSet::Params*>(params.impl.get());
+
+    // convert false positive rate so it holds up across the full period
+    p->set_fpp(p->get_fpp() / pool.info.hit_set_count);
+    if (p->get_fpp() <= 0.0)
+      p->set_fpp(.01);  // fpp cannot be zero!
+
+    estimate_target_size(p->target_size);
     p->seed = now.sec();
 
     dout(10) << __func__ << " target_size " << p->target_size
 	     << " fpp " << p->get_fpp() << dendl;
+  } else if (pool.info.hit_set_params.get_type() == HitSet::TYPE_CUCKOO) {
+    CuckooHitSet::Params *p =
+      static_cast<CuckooHitSet::Params*>(params.impl.get());
+    estimate_target_size(p->target_size);
+    p->seed = now.sec();
+
+    dout(10) << __func__ << " target_size " << p->target_size << dendl;
   }
   hit_set.reset(new HitSet(params));
   hit_set_start_stamp = now;
@@ -14543,6 +14567,8 @@ bool PrimaryLogPG::hit_set_apply_log()
     ++p;
   while (p != recovery_state.get_pg_log().get_log().log.rend() && p->version > from) {
     hit_set->insert(p->soid);
+    if (agent_state)
+      agent_state->temp_sketch.insert(p->soid);
     ++p;
   }
 
@@ -14610,6 +14636,7 @@ void PrimaryLogPG::hit_set_persist()
 
   if (agent_state) {
     agent_state->add_hit_set(new_hset.begin, hit_set);
+    agent_state->temp_sketch.roll(hit_set->approx_unique_insert_count());
     uint32_t size = agent_state->hit_set_map.size();
     if (size >= pool.info.hit_set_count) {
       size = pool.info.hit_set_count > 0 ? pool.info.hit_set_count - 1: 0;
@@ -15431,6 +15458,21 @@ void PrimaryLogPG::agent_estimate_temp(const hobject_t& oid, int *temp)
     *temp = 1000000;
   unsigned i = 0;
   int last_n = pool.info.hit_set_search_last_n;
+  const auto& sketch = agent_state->temp_sketch;
+  if (cct->_conf->osd_agent_temperature_sketch &&
+      sketch.get_complete_periods() >= agent_state->hit_set_map.size()) {
+    // the sketch has seen every period we have a HitSet for; bit i + 1 is
+    // hit_set_map's i-th newest
+    unsigned periods = sketch.lookup(oid) >> 1;
+    periods &= (1u << agent_state->hit_set_map.size()) - 1;
+    for (; last_n > 0 && periods; periods >>= 1, ++i) {
+      if (periods & 1) {
+	*temp += pool.info.get_grade(i);
+	--last_n;
+      }
+    }
+    return;
+  }
   for (map<time_t,HitSetRef>::reverse_iterator p =
        agent_state->hit_set_map.rbegin(); last_n > 0 &&
        p != agent_state->hit_set_map.rend(); ++p, ++i) {
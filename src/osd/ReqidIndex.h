@@ -0,0 +1,167 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#pragma once
+
+#include "include/ceph_assert.h"
+#include "include/mempool.h"
+#include "osd_types.h"
+
+/**
+ * reqid -> entry index for the pg log
+ *
+ * Every PG keeps one index over its log entries and one over its dups,
+ * and there are thousands of entries per PG, so the per-entry overhead of
+ * a node based map (a heap node holding a copy of the key, the mapped
+ * pointer and the chain link, plus a bucket) dominates the size of the
+ * index.  This is an open addressing table of bare entry pointers instead:
+ * the key is read back from the entry it points at, so a slot costs one
+ * pointer.  The table doubles when it would exceed 3/4 full and halves
+ * once trims leave it less than 1/8 full, so it stays within 1/8..3/4 full
+ * (3/8..3/4 while it is only growing).
+ *
+ * T must have a public `osd_reqid_t reqid` member that does not change
+ * while the entry is indexed.
+ */
+template <typename T>
+class reqid_index_t {
+  mempool::osd_pglog::vector<T*> slots;  ///< nullptr: empty slot
+  size_t num = 0;
+
+  static constexpr size_t MIN_SLOTS = 16;
+
+  /// std::hash<osd_reqid_t> is the identity of (num ^ tid ^ inc), which
+  /// clusters badly under a power-of-two mask
+  static size_t hash(const osd_reqid_t& r) {
+    uint64_t h = r.name.num() * 0x9e3779b97f4a7c15ull;
+    h ^= (r.tid + ((uint64_t)r.inc << 32) + r.name.type()) *
+      0xc2b2ae3d27d4eb4full;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h;
+  }
+  size_t mask() const {
+    return slots.size() - 1;
+  }
+  size_t home(const osd_reqid_t& r) const {
+    return hash(r) & mask();
+  }
+
+  /// slot holding r, or the empty slot where it would go
+  size_t _probe(const osd_reqid_t& r) const {
+    size_t i = home(r);
+    while (slots[i] && slots[i]->reqid != r) {
+      i = (i + 1) & mask();
+    }
+    return i;
+  }
+
+  void _rehash(size_t n) {
+    mempool::osd_pglog::vector<T*> old(n, nullptr);
+    old.swap(slots);
+    for (auto e : old) {
+      if (e) {
+	slots[_probe(e->reqid)] = e;
+      }
+    }
+  }
+
+  void _erase_slot(size_t i) {
+    // backward shift deletion: pull later members of the probe run into
+    // the hole so lookups never need tombstones
+    size_t j = i;
+    while (true) {
+      j = (j + 1) & mask();
+      if (!slots[j]) {
+	break;
+      }
+      size_t k = home(slots[j]->reqid);
+      // move slots[j] unless its home lies cyclically within (i, j]
+      if (i <= j ? (k <= i || k > j) : (k <= i && k > j)) {
+	slots[i] = slots[j];
+	i = j;
+      }
+    }
+    slots[i] = nullptr;
+    --num;
+    if (slots.size() > MIN_SLOTS && num * 8 < slots.size()) {
+      // a big trim (or a shrinking osd_max_pg_log_entries) leaves the
+      // table sparse; give the memory back
+      _rehash(slots.size() / 2);
+    }
+  }
+
+public:
+  size_t size() const {
+    return num;
+  }
+  bool empty() const {
+    return num == 0;
+  }
+  size_t count(const osd_reqid_t& r) const {
+    return find(r) ? 1 : 0;
+  }
+
+  T* find(const osd_reqid_t& r) const {
+    if (num == 0) {
+      return nullptr;
+    }
+    return slots[_probe(r)];
+  }
+
+  /// index e, replacing whatever entry was indexed under the same reqid
+  void set(T* e) {
+    ceph_assert(e);
+    if ((num + 1) * 4 > slots.size() * 3) {
+      _rehash(slots.empty() ? MIN_SLOTS : slots.size() * 2);
+    }
+    size_t i = _probe(e->reqid);
+    if (!slots[i]) {
+      ++num;
+    }
+    slots[i] = e;
+  }
+
+  /// remove r; if e is given, only if r is still indexed to e
+  bool erase(const osd_reqid_t& r, const T* e = nullptr) {
+    if (num == 0) {
+      return false;
+    }
+    size_t i = _probe(r);
+    if (!slots[i] || (e && slots[i] != e)) {
+      return false;
+    }
+    _erase_slot(i);
+    return true;
+  }
+
+  void reserve(size_t n) {
+    size_t want = MIN_SLOTS;
+    while (want * 3 < n * 4) {
+      want *= 2;
+    }
+    if (want > slots.size()) {
+      _rehash(want);
+    }
+  }
+
+  void clear() {
+    mempool::osd_pglog::vector<T*>().swap(slots);
+    num = 0;
+  }
+
+  /// bytes held by the table itself
+  size_t get_bytes() const {
+    return slots.capacity() * sizeof(T*);
+  }
+};
@@ -40,6 +40,9 @@ struct TierAgentState {
   /// past HitSet(s) (not current)
   std::map<time_t,HitSetRef> hit_set_map;
 
+  /// which recent HitSet periods objects were hit in
+  HitSetTemperatureSketch temp_sketch;
+
   /// a few recent things we've seen that are clean
   std::list<hobject_t> recent_clean;
 
@@ -112,6 +115,7 @@ struct TierAgentState {
   /// discard all open hit sets
   void discard_hit_sets() {
     hit_set_map.clear();
+    temp_sketch.clear();
   }
 
   void dump(ceph::Formatter *f) const {
@@ -122,6 +126,9 @@ struct TierAgentState {
     f->open_object_section("temp_hist");
     temp_hist.dump(f);
     f->close_section();
+    f->open_object_section("temp_sketch");
+    temp_sketch.dump(f);
+    f->close_section();
   }
 };
 
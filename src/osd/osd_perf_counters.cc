@@ -7,6 +7,8 @@
 
 PerfCounters *build_osd_logger(CephContext *cct) {
   PerfCountersBuilder osd_plb(cct, "osd", l_osd_first, l_osd_last);
+  // every op shard and messenger thread bumps these
+  osd_plb.set_sharded();
 
   // Latency axis configuration for op histograms, values are in nanoseconds
   PerfHistogramCommon::axis_config_d op_hist_x_axis_config{
@@ -319,6 +321,23 @@ PerfCounters *build_osd_logger(CephContext *cct) {
   osd_plb.add_u64_counter(
     l_osd_pg_biginfo, "osd_pg_biginfo", "PG updated its biginfo attr");
 
+  osd_plb.add_u64_counter(
+    l_osd_op_wq_steal, "op_wq_steal",
+    "Op queue items processed by a worker of another shard");
+  osd_plb.add_u64_counter(
+    l_osd_op_wq_steal_idle_pg, "op_wq_steal_idle_pg",
+    "Stolen op queue items whose PG was not running on its own shard");
+
+  osd_plb.add_u64_counter(
+    l_osd_replica_read, "replica_read",
+    "Client reads served by a replica holding a read lease");
+  osd_plb.add_u64_counter(
+    l_osd_replica_read_lease_expired, "replica_read_lease_expired",
+    "Client reads a replica bounced because its read lease expired");
+  osd_plb.add_u64_counter(
+    l_osd_replica_read_bounced, "replica_read_bounced",
+    "Client reads a replica bounced for an unstable or missing object");
+
   return osd_plb.create_perf_counters();
 }
  
@@ -131,6 +131,13 @@ enum {
   l_osd_pg_fastinfo,
   l_osd_pg_biginfo,
 
+  l_osd_op_wq_steal,
+  l_osd_op_wq_steal_idle_pg,
+
+  l_osd_replica_read,
+  l_osd_replica_read_lease_expired,
+  l_osd_replica_read_bounced,
+
   l_osd_last,
 };
 
@@ -1263,6 +1263,7 @@ struct pg_pool_t {
     FLAG_CREATING = 1<<15,          // initial pool PGs are being created
     FLAG_EIO = 1<<16,               // return EIO for all client ops
     FLAG_BULK = 1<<17, //pool is large
+    FLAG_REPLICA_READS = 1<<19, // clients read from the nearest replica holding a read lease
   };
 
   static const char *get_flag_name(uint64_t f) {
@@ -1285,6 +1286,7 @@ struct pg_pool_t {
     case FLAG_CREATING: return "creating";
     case FLAG_EIO: return "eio";
     case FLAG_BULK: return "bulk";
+    case FLAG_REPLICA_READS: return "replica_reads";
     default: return "???";
     }
   }
@@ -1339,6 +1341,8 @@ struct pg_pool_t {
       return FLAG_EIO;
     if (name == "bulk")
       return FLAG_BULK;
+    if (name == "replica_reads")
+      return FLAG_REPLICA_READS;
     return 0;
   }
 
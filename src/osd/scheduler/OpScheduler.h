@@ -61,9 +61,12 @@ public:
 std::ostream &operator<<(std::ostream &lhs, const OpScheduler &);
 using OpSchedulerRef = std::unique_ptr<OpScheduler>;
 
+class mClockCalibration;
+
 OpSchedulerRef make_scheduler(
   CephContext *cct, int whoami, uint32_t num_shards, int shard_id,
-  bool is_rotational, std::string_view osd_objectstore, MonClient *monc);
+  bool is_rotational, std::string_view osd_objectstore, MonClient *monc,
+  mClockCalibration *calibration = nullptr);
 
 /**
  * Implements OpScheduler in terms of OpQueue
@@ -0,0 +1,281 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "osd/scheduler/mClockCalibration.h"
+
+#include "common/dout.h"
+#include "include/intarith.h"
+
+#define dout_context cct
+#define dout_subsys ceph_subsys_mclock
+#undef dout_prefix
+#define dout_prefix *_dout << "mClockCalibration: "
+
+namespace ceph::osd::scheduler {
+
+/// weight of the previous model at each update
+static constexpr double DECAY = 0.7;
+
+/// grow or shrink the boost by these factors per update
+static constexpr double BOOST_UP = 1.25;
+static constexpr double BOOST_DOWN = 0.9;
+
+mClockCalibration::mClockCalibration(CephContext *cct)
+  : cct(cct)
+{
+  for (size_t c = 0; c < NUM_CLASSES; ++c) {
+    cost_per_io[c] = 0;
+    res_boost[c] = 1.0;
+  }
+}
+
+unsigned mClockCalibration::size_bucket(uint64_t bytes)
+{
+  if (bytes <= 4096) {
+    return 0;
+  }
+  unsigned b = cbits(bytes - 1) - 12;
+  return std::min(b, NUM_SIZE_BUCKETS - 1);
+}
+
+unsigned mClockCalibration::latency_bucket(uint64_t usec)
+{
+  if (usec < 4) {
+    return usec;
+  }
+  unsigned e = cbits(usec) - 1;  // 2^e <= usec < 2^(e+1)
+  unsigned m = (usec >> (e - 2)) & 3;
+  return std::min(4 * (e - 1) + m, NUM_LATENCY_BUCKETS - 1);
+}
+
+uint64_t mClockCalibration::latency_bucket_max(unsigned b)
+{
+  if (b < 4) {
+    return b + 1;
+  }
+  unsigned e = b / 4 + 1;
+  unsigned m = b % 4;
+  return uint64_t(5 + m) << (e - 2);
+}
+
+void mClockCalibration::record(
+  op_scheduler_class c,
+  uint64_t bytes,
+  ceph::timespan service,
+  ceph::timespan latency)
+{
+  if (!enabled.load(std::memory_order_relaxed) ||
+      c == op_scheduler_class::immediate) {
+    return;
+  }
+  auto& w = window[static_cast<size_t>(c)];
+  unsigned b = size_bucket(bytes);
+  w.count[b].fetch_add(1, std::memory_order_relaxed);
+  w.bytes[b].fetch_add(bytes, std::memory_order_relaxed);
+  w.service_us[b].fetch_add(
+    std::chrono::duration_cast<std::chrono::microseconds>(service).count(),
+    std::memory_order_relaxed);
+  w.latency[latency_bucket(
+      std::chrono::duration_cast<std::chrono::microseconds>(latency).count())]
+    .fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t mClockCalibration::_get_latency_target_us(op_scheduler_class c) const
+{
+  std::chrono::milliseconds target{0};
+  switch (c) {
+  case op_scheduler_class::client:
+    target = cct->_conf.get_val<std::chrono::milliseconds>(
+      "osd_mclock_scheduler_client_latency_target");
+    break;
+  case op_scheduler_class::background_recovery:
+    target = cct->_conf.get_val<std::chrono::milliseconds>(
+      "osd_mclock_scheduler_background_recovery_latency_target");
+    break;
+  case op_scheduler_class::background_best_effort:
+    target = cct->_conf.get_val<std::chrono::milliseconds>(
+      "osd_mclock_scheduler_background_best_effort_latency_target");
+    break;
+  default:
+    break;
+  }
+  return std::chrono::duration_cast<std::chrono::microseconds>(target).count();
+}
+
+// weighted least squares of service time over size across the buckets
+double mClockCalibration::_fit_cost_per_io(
+  size_t c, uint64_t min_samples) const
+{
+  double w = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+  unsigned points = 0;
+  for (auto& b : model[c]) {
+    if (b.count < min_samples) {
+      continue;
+    }
+    double x = b.bytes / b.count;
+    double y = b.service_us / b.count;
+    w += b.count;
+    sx += b.count * x;
+    sy += b.count * y;
+    sxx += b.count * x * x;
+    sxy += b.count * x * y;
+    ++points;
+  }
+  if (points < 2) {
+    return 0;
+  }
+  double var = sxx - sx * sx / w;
+  if (var <= 0) {
+    return 0;
+  }
+  double slope = (sxy - sx * sy / w) / var;    // usec per byte
+  double intercept = (sy - slope * sx) / w;    // usec per io
+  if (slope <= 0 || intercept <= 0) {
+    // noise, or a device that does not care about io size
+    return 0;
+  }
+  return intercept / slope;
+}
+
+bool mClockCalibration::maybe_update(ceph::mono_time now)
+{
+  int64_t now_ns = now.time_since_epoch().count();
+  int64_t due = next_update.load(std::memory_order_relaxed);
+  if (now_ns < due) {
+    return false;
+  }
+  auto interval = cct->_conf.get_val<std::chrono::seconds>(
+    "osd_mclock_cost_calibration_interval");
+  int64_t next = now_ns +
+    std::chrono::duration_cast<std::chrono::nanoseconds>(interval).count();
+  if (!next_update.compare_exchange_strong(due, next)) {
+    return false;  // another shard got here first
+  }
+
+  const bool calibrate = cct->_conf.get_val<bool>("osd_mclock_cost_calibration");
+  const uint64_t min_samples = cct->_conf.get_val<uint64_t>(
+    "osd_mclock_cost_calibration_min_samples");
+  const double max_boost = cct->_conf.get_val<double>(
+    "osd_mclock_latency_target_max_boost");
+  std::array<uint64_t, NUM_CLASSES> targets;
+  bool any_target = false;
+  for (size_t c = 0; c < NUM_CLASSES; ++c) {
+    targets[c] = _get_latency_target_us(static_cast<op_scheduler_class>(c));
+    any_target |= targets[c] > 0;
+  }
+  enabled = calibrate || any_target;
+
+  bool changed = false;
+  std::lock_guard l(lock);
+  for (size_t c = 0; c < NUM_CLASSES; ++c) {
+    auto& w = window[c];
+    uint64_t total = 0;
+    for (unsigned b = 0; b < NUM_SIZE_BUCKETS; ++b) {
+      uint64_t n = w.count[b].exchange(0, std::memory_order_relaxed);
+      uint64_t bytes = w.bytes[b].exchange(0, std::memory_order_relaxed);
+      uint64_t us = w.service_us[b].exchange(0, std::memory_order_relaxed);
+      auto& m = model[c][b];
+      m.count = m.count * DECAY + n;
+      m.bytes = m.bytes * DECAY + bytes;
+      m.service_us = m.service_us * DECAY + us;
+      total += n;
+    }
+    std::array<uint64_t, NUM_LATENCY_BUCKETS> hist;
+    for (unsigned b = 0; b < NUM_LATENCY_BUCKETS; ++b) {
+      hist[b] = w.latency[b].exchange(0, std::memory_order_relaxed);
+    }
+
+    double cpi = calibrate ? _fit_cost_per_io(c, min_samples) : 0;
+    if (cpi != cost_per_io[c].load(std::memory_order_relaxed)) {
+      cost_per_io[c] = cpi;
+      changed = true;
+    }
+
+    double boost = res_boost[c].load(std::memory_order_relaxed);
+    double new_boost = boost;
+    if (!targets[c]) {
+      new_boost = 1.0;
+    } else if (total >= min_samples) {
+      // p99 from the latency histogram, rounded up to the bucket bound
+      uint64_t rank = total - total / 100;
+      uint64_t seen = 0;
+      unsigned b = 0;
+      for (; b < NUM_LATENCY_BUCKETS - 1; ++b) {
+	seen += hist[b];
+	if (seen >= rank) {
+	  break;
+	}
+      }
+      last_p99_us[c] = latency_bucket_max(b);
+      if (last_p99_us[c] > targets[c]) {
+	new_boost = std::min(boost * BOOST_UP, std::max(1.0, max_boost));
+      } else if (last_p99_us[c] * 5 < targets[c] * 4) {
+	new_boost = std::max(1.0, boost * BOOST_DOWN);
+      }
+    }
+    if (new_boost != boost) {
+      ldout(cct, 10) << __func__ << " " << static_cast<op_scheduler_class>(c)
+		     << " p99 " << last_p99_us[c] << "us target "
+		     << targets[c] << "us reservation boost " << boost
+		     << " -> " << new_boost << dendl;
+      res_boost[c] = new_boost;
+      changed = true;
+    }
+  }
+  if (changed) {
+    generation.fetch_add(1, std::memory_order_release);
+    ldout(cct, 10) << __func__ << " cost_per_io client "
+		   << get_cost_per_io(op_scheduler_class::client)
+		   << " background_recovery "
+		   << get_cost_per_io(op_scheduler_class::background_recovery)
+		   << " background_best_effort "
+		   << get_cost_per_io(op_scheduler_class::background_best_effort)
+		   << dendl;
+  }
+  return changed;
+}
+
+void mClockCalibration::dump(ceph::Formatter *f) const
+{
+  std::lock_guard l(lock);
+  f->dump_bool("enabled", enabled);
+  f->open_array_section("classes");
+  for (size_t c = 0; c < NUM_CLASSES; ++c) {
+    auto klass = static_cast<op_scheduler_class>(c);
+    if (klass == op_scheduler_class::immediate) {
+      continue;
+    }
+    f->open_object_section("class");
+    f->dump_stream("class") << klass;
+    f->dump_float("cost_per_io", get_cost_per_io(klass));
+    f->dump_float("reservation_boost", get_reservation_boost(klass));
+    f->dump_unsigned("p99_latency_us", last_p99_us[c]);
+    f->open_array_section("size_buckets");
+    for (unsigned b = 0; b < NUM_SIZE_BUCKETS; ++b) {
+      auto& m = model[c][b];
+      if (m.count < 1) {
+	continue;
+      }
+      f->open_object_section("bucket");
+      f->dump_unsigned("max_bytes", 4096ull << b);
+      f->dump_float("ops", m.count);
+      f->dump_float("avg_bytes", m.bytes / m.count);
+      f->dump_float("avg_service_us", m.service_us / m.count);
+      f->close_section();
+    }
+    f->close_section();
+    f->close_section();
+  }
+  f->close_section();
+}
+
+}
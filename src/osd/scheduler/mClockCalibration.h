@@ -0,0 +1,122 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+
+#include "common/ceph_mutex.h"
+#include "common/ceph_time.h"
+#include "common/Formatter.h"
+#include "osd/scheduler/OpSchedulerItem.h"
+
+namespace ceph::osd::scheduler {
+
+/**
+ * mClockCalibration
+ *
+ * Online feedback for the mClock cost model, shared by all the scheduler
+ * shards of an OSD.
+ *
+ * Completed ops report their size, the time the OSD spent serving them
+ * and their end-to-end latency.  Every osd_mclock_cost_calibration_interval
+ * the samples are folded into a decaying per class, per size bucket
+ * average of service time.  Fitting service = a + b * size across the
+ * buckets gives the fixed per-io overhead expressed in sequentially
+ * transferred bytes, a / b, which is exactly what the static
+ * osd_bandwidth_cost_per_io approximates from the configured bandwidth
+ * and iops capacity.
+ *
+ * The same samples give each class's p99 latency.  A class with a latency
+ * target that it misses gets its reservation boosted, and the boost decays
+ * once the target is comfortably met again.
+ */
+class mClockCalibration {
+public:
+  static constexpr size_t NUM_CLASSES =
+    static_cast<size_t>(op_scheduler_class::client) + 1;
+  /// 4KiB << i, the last bucket is open ended
+  static constexpr unsigned NUM_SIZE_BUCKETS = 10;
+  /// four buckets per power of two microseconds
+  static constexpr unsigned NUM_LATENCY_BUCKETS = 128;
+
+  explicit mClockCalibration(CephContext *cct);
+
+  /// account one completed op; safe to call from any thread
+  void record(op_scheduler_class c, uint64_t bytes,
+	      ceph::timespan service, ceph::timespan latency);
+
+  /**
+   * fold the samples gathered since the last update into the model
+   *
+   * Does nothing until the calibration interval has passed, so all shards
+   * may call this on every dequeue.
+   *
+   * @returns true if the published estimates changed
+   */
+  bool maybe_update(ceph::mono_time now);
+
+  /// calibrated cost per io in bytes, or 0 if there is no estimate
+  double get_cost_per_io(op_scheduler_class c) const {
+    return cost_per_io[static_cast<size_t>(c)].load(std::memory_order_relaxed);
+  }
+  /// reservation multiplier for a class missing its latency target
+  double get_reservation_boost(op_scheduler_class c) const {
+    return res_boost[static_cast<size_t>(c)].load(std::memory_order_relaxed);
+  }
+  /// changes whenever any published estimate does
+  uint64_t get_generation() const {
+    return generation.load(std::memory_order_acquire);
+  }
+
+  void dump(ceph::Formatter *f) const;
+
+  static unsigned size_bucket(uint64_t bytes);
+  static unsigned latency_bucket(uint64_t usec);
+  /// upper bound of a latency bucket, in microseconds
+  static uint64_t latency_bucket_max(unsigned b);
+
+private:
+  CephContext *cct;
+  /// set by maybe_update(); record() is a no-op while false
+  std::atomic<bool> enabled = false;
+  std::atomic<int64_t> next_update = 0;  ///< mono_time ns since epoch
+
+  /// samples since the last update
+  struct window_t {
+    std::array<std::atomic<uint64_t>, NUM_SIZE_BUCKETS> count = {};
+    std::array<std::atomic<uint64_t>, NUM_SIZE_BUCKETS> bytes = {};
+    std::array<std::atomic<uint64_t>, NUM_SIZE_BUCKETS> service_us = {};
+    std::array<std::atomic<uint64_t>, NUM_LATENCY_BUCKETS> latency = {};
+  };
+  std::array<window_t, NUM_CLASSES> window;
+
+  mutable ceph::mutex lock = ceph::make_mutex("mClockCalibration::lock");
+  /// decayed sums, under lock
+  struct bucket_t {
+    double count = 0;
+    double bytes = 0;
+    double service_us = 0;
+  };
+  std::array<std::array<bucket_t, NUM_SIZE_BUCKETS>, NUM_CLASSES> model;
+  std::array<uint64_t, NUM_CLASSES> last_p99_us = {};
+
+  std::array<std::atomic<double>, NUM_CLASSES> cost_per_io;
+  std::array<std::atomic<double>, NUM_CLASSES> res_boost;
+  std::atomic<uint64_t> generation = 0;
+
+  double _fit_cost_per_io(size_t c, uint64_t min_samples) const;
+  uint64_t _get_latency_target_us(op_scheduler_class c) const;
+};
+
+}
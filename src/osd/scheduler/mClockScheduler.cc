@@ -35,13 +35,15 @@ mClockScheduler::mClockScheduler(CephContext *cct,
   uint32_t num_shards,
   int shard_id,
   bool is_rotational,
-  MonClient *monc)
+  MonClient *monc,
+  mClockCalibration *calibration)
   : cct(cct),
     whoami(whoami),
     num_shards(num_shards),
     shard_id(shard_id),
     is_rotational(is_rotational),
     monc(monc),
+    calibration(calibration),
     scheduler(
       std::bind(&mClockScheduler::ClientRegistry::get_info,
                 &client_registry,
@@ -91,9 +93,43 @@ void mClockScheduler::ClientRegistry::update_from_config(
     }
   };
 
-  // Set external client infos
-  double res = conf.get_val<double>(
+  // Resolve the reservation ratios, boosted for classes missing their
+  // latency target.  The reservations must not add up to more than the
+  // OSD's capacity, so the classes that are not boosted give way first.
+  const size_t classes[] = {
+    static_cast<size_t>(op_scheduler_class::client),
+    static_cast<size_t>(op_scheduler_class::background_recovery),
+    static_cast<size_t>(op_scheduler_class::background_best_effort)
+  };
+  std::array<double, mClockCalibration::NUM_CLASSES> res_ratio = {};
+  res_ratio[classes[0]] = conf.get_val<double>(
     "osd_mclock_scheduler_client_res");
+  res_ratio[classes[1]] = conf.get_val<double>(
+    "osd_mclock_scheduler_background_recovery_res");
+  res_ratio[classes[2]] = conf.get_val<double>(
+    "osd_mclock_scheduler_background_best_effort_res");
+  double boosted = 0, unboosted = 0;
+  for (auto c : classes) {
+    if (res_boost[c] > 1.0) {
+      // a class without a reservation still needs something to scale
+      res_ratio[c] = std::min(
+	1.0, std::max(res_ratio[c], MIN_BOOSTED_RES) * res_boost[c]);
+      boosted += res_ratio[c];
+    } else {
+      unboosted += res_ratio[c];
+    }
+  }
+  if (boosted > 0 && boosted + unboosted > 1.0) {
+    double boosted_scale = std::min(1.0, 1.0 / boosted);
+    double unboosted_scale = unboosted > 0 ?
+      std::max(0.0, 1.0 - boosted * boosted_scale) / unboosted : 0;
+    for (auto c : classes) {
+      res_ratio[c] *= res_boost[c] > 1.0 ? boosted_scale : unboosted_scale;
+    }
+  }
+
+  // Set external client infos
+  double res = res_ratio[classes[0]];
   double lim = conf.get_val<double>(
     "osd_mclock_scheduler_client_lim");
   uint64_t wgt = conf.get_val<uint64_t>(
@@ -104,8 +140,7 @@ void mClockScheduler::ClientRegistry::update_from_config(
     get_lim(lim));
 
   // Set background recovery client infos
-  res = conf.get_val<double>(
-    "osd_mclock_scheduler_background_recovery_res");
+  res = res_ratio[classes[1]];
   lim = conf.get_val<double>(
     "osd_mclock_scheduler_background_recovery_lim");
   wgt = conf.get_val<uint64_t>(
@@ -117,8 +152,7 @@ void mClockScheduler::ClientRegistry::update_from_config(
       get_lim(lim));
 
   // Set background best effort client infos
-  res = conf.get_val<double>(
-    "osd_mclock_scheduler_background_best_effort_res");
+  res = res_ratio[classes[2]];
   lim = conf.get_val<double>(
     "osd_mclock_scheduler_background_best_effort_lim");
   wgt = conf.get_val<uint64_t>(
@@ -186,6 +220,34 @@ void mClockScheduler::set_osd_capacity_params_from_config()
           << ", osd_bandwidth_capacity_per_shard "
           << osd_bandwidth_capacity_per_shard << " bytes/second"
           << dendl;
+  _apply_calibration();
+}
+
+void mClockScheduler::_apply_calibration()
+{
+  for (size_t c = 0; c < class_cost_per_io.size(); ++c) {
+    auto klass = static_cast<op_scheduler_class>(c);
+    double estimate = calibration ? calibration->get_cost_per_io(klass) : 0;
+    // never stray too far from what the configured capacity implies
+    class_cost_per_io[c] = estimate > 0 ?
+      std::clamp(estimate,
+		 osd_bandwidth_cost_per_io / 4,
+		 osd_bandwidth_cost_per_io * 4) :
+      osd_bandwidth_cost_per_io;
+    if (calibration) {
+      client_registry.set_reservation_boost(
+	klass, calibration->get_reservation_boost(klass));
+    }
+  }
+  dout(10) << __func__ << " cost_per_io client: "
+	   << class_cost_per_io[static_cast<size_t>(op_scheduler_class::client)]
+	   << ", background_recovery: "
+	   << class_cost_per_io[
+	     static_cast<size_t>(op_scheduler_class::background_recovery)]
+	   << ", background_best_effort: "
+	   << class_cost_per_io[
+	     static_cast<size_t>(op_scheduler_class::background_best_effort)]
+	   << dendl;
 }
 
 /**
@@ -341,6 +403,20 @@ uint32_t mClockScheduler::calc_scaled_cost(int item_cost)
   return std::max<uint32_t>(cost, cost_per_io);
 }
 
+uint32_t mClockScheduler::calc_scaled_cost(
+  int item_cost,
+  op_scheduler_class klass)
+{
+  auto cost = static_cast<uint32_t>(
+    std::max<int>(
+      1, // ensure cost is non-zero and positive
+      item_cost));
+  auto cost_per_io = static_cast<uint32_t>(
+    class_cost_per_io[static_cast<size_t>(klass)]);
+
+  return std::max<uint32_t>(cost, cost_per_io);
+}
+
 void mClockScheduler::update_configuration()
 {
   // Apply configuration change. The expectation is that
@@ -369,6 +445,12 @@ void mClockScheduler::dump(ceph::Formatter &f) const
   f.open_object_section("mClockQueues");
   f.dump_string("queues", display_queues());
   f.close_section();
+
+  if (calibration) {
+    f.open_object_section("calibration");
+    calibration->dump(&f);
+    f.close_section();
+  }
 }
 
 void mClockScheduler::enqueue(OpSchedulerItem&& item)
@@ -379,7 +461,7 @@ void mClockScheduler::enqueue(OpSchedulerItem&& item)
   if (op_scheduler_class::immediate == id.class_id) {
     immediate.push_front(std::move(item));
   } else {
-    auto cost = calc_scaled_cost(item.get_cost());
+    auto cost = calc_scaled_cost(item.get_cost(), id.class_id);
     item.set_qos_cost(cost);
     dout(20) << __func__ << " " << id
              << " item_cost: " << item.get_cost()
@@ -414,6 +496,16 @@ void mClockScheduler::enqueue_front(OpSchedulerItem&& item)
 
 WorkItem mClockScheduler::dequeue()
 {
+  if (calibration) {
+    calibration->maybe_update(ceph::mono_clock::now());
+    if (auto gen = calibration->get_generation();
+	gen != calibration_generation) {
+      calibration_generation = gen;
+      _apply_calibration();
+      client_registry.update_from_config(
+	cct->_conf, osd_bandwidth_capacity_per_shard);
+    }
+  }
   if (!immediate.empty()) {
     WorkItem work_item{std::move(immediate.back())};
     immediate.pop_back();
@@ -24,6 +24,7 @@
 #include "dmclock/src/dmclock_server.h"
 
 #include "osd/scheduler/OpScheduler.h"
+#include "osd/scheduler/mClockCalibration.h"
 #include "common/config.h"
 #include "include/cmp.h"
 #include "common/ceph_context.h"
@@ -37,6 +38,8 @@ constexpr double default_min = 0.0;
 constexpr double default_max = std::numeric_limits<double>::is_iec559 ?
   std::numeric_limits<double>::infinity() :
   std::numeric_limits<double>::max();
+/// reservation ratio scaled up for a boosted class without a reservation
+constexpr double MIN_BOOSTED_RES = 0.1;
 
 /**
  * client_profile_id_t
@@ -147,6 +150,19 @@ class mClockScheduler : public OpScheduler, md_config_obs_t {
    */
   double osd_bandwidth_capacity_per_shard;
 
+  /**
+   * calibration
+   *
+   * Optional, shared by all shards of the OSD.  When set, the cost per io
+   * of each class and the reservation boosts for latency targets follow
+   * its estimates; see _apply_calibration().
+   */
+  mClockCalibration *calibration;
+  uint64_t calibration_generation = 0;
+
+  /// osd_bandwidth_cost_per_io, possibly calibrated, per class
+  std::array<double, mClockCalibration::NUM_CLASSES> class_cost_per_io;
+
   class ClientRegistry {
     std::array<
       crimson::dmclock::ClientInfo,
@@ -162,13 +178,24 @@ class mClockScheduler : public OpScheduler, md_config_obs_t {
 	     crimson::dmclock::ClientInfo> external_client_infos;
     const crimson::dmclock::ClientInfo *get_external_client(
       const client_profile_id_t &client) const;
+
+    /// reservation multipliers from latency targets, per class
+    std::array<double, mClockCalibration::NUM_CLASSES> res_boost;
   public:
+    ClientRegistry() {
+      res_boost.fill(1.0);
+    }
+
+    void set_reservation_boost(op_scheduler_class c, double boost) {
+      res_boost[static_cast<size_t>(c)] = boost;
+    }
     /**
      * update_from_config
      *
      * Sets the mclock paramaters (reservation, weight, and limit)
      * for each class of IO (background_recovery, background_best_effort,
-     * and client).
+     * and client).  Boosted reservations are applied here, taking the
+     * difference from the classes that are not boosted.
      */
     void update_from_config(
       const ConfigProxy &conf,
@@ -210,13 +237,18 @@ class mClockScheduler : public OpScheduler, md_config_obs_t {
   // Set the mclock related config params based on the profile
   void set_config_defaults_from_profile();
 
+  // Pick up new estimates from calibration, if any
+  void _apply_calibration();
+
 public:
   mClockScheduler(CephContext *cct, int whoami, uint32_t num_shards,
-    int shard_id, bool is_rotational, MonClient *monc);
+    int shard_id, bool is_rotational, MonClient *monc,
+    mClockCalibration *calibration = nullptr);
   ~mClockScheduler() override;
 
   /// Calculate scaled cost per item
   uint32_t calc_scaled_cost(int cost);
+  uint32_t calc_scaled_cost(int cost, op_scheduler_class klass);
 
   // Helper method to display mclock queues
   std::string display_queues() const;
@@ -801,6 +801,7 @@ Objecter::LingerOp *Objecter::linger_register(const object_t& oid,
   if (info->target.base_oloc.key == oid)
     info->target.base_oloc.key.clear();
   info->target.flags = flags;
+  info->target.primary_only = true;
   info->watch_valid_thru = ceph::coarse_mono_clock::now();
   ldout(cct, 10) << __func__ << " info " << info
 		 << " linger_id " << info->linger_id
@@ -2387,6 +2388,17 @@ void Objecter::_op_submit(Op *op, shunique_lock<ceph::shared_mutex>& sul, ceph_t
   ceph_assert(op->session == NULL);
   OSDSession *s = NULL;
 
+  for (auto& o : op->ops) {
+    switch (o.op.op) {
+    case CEPH_OSD_OP_WATCH:
+    case CEPH_OSD_OP_NOTIFY:
+    case CEPH_OSD_OP_NOTIFY_ACK:
+    case CEPH_OSD_OP_LIST_WATCHERS:
+      op->target.primary_only = true;
+      break;
+    }
+  }
+
   bool check_for_latest_map = false;
   int r = _calc_target(&op->target, nullptr);
   switch(r) {
@@ -2951,12 +2963,22 @@ int Objecter::_calc_target(op_target_t *t, Connection *con, bool any_change)
 		   << " acting " << t->acting
 		   << " primary " << acting_primary << dendl;
     t->used_replica = false;
-    if ((t->flags & (CEPH_OSD_FLAG_BALANCE_READS |
-                     CEPH_OSD_FLAG_LOCALIZE_READS)) &&
+    int read_policy = t->flags & (CEPH_OSD_FLAG_BALANCE_READS |
+				  CEPH_OSD_FLAG_LOCALIZE_READS);
+    bool pool_replica_reads = false;
+    if (!read_policy && is_read && !t->replica_read_bounced &&
+	!t->primary_only && !(t->flags & CEPH_OSD_FLAG_PGOP) &&
+	pi->has_flag(pg_pool_t::FLAG_REPLICA_READS)) {
+      // replicas holding a read lease from the primary may serve plain
+      // object reads
+      read_policy = CEPH_OSD_FLAG_LOCALIZE_READS;
+      pool_replica_reads = true;
+    }
+    if (read_policy &&
         !is_write && pi->is_replicated() && t->acting.size() > 1) {
       int osd;
       ceph_assert(is_read && t->acting[0] == acting_primary);
-      if (t->flags & CEPH_OSD_FLAG_BALANCE_READS) {
+      if (read_policy & CEPH_OSD_FLAG_BALANCE_READS) {
 	int p = rand() % t->acting.size();
 	if (p)
 	  t->used_replica = true;
@@ -2985,6 +3007,15 @@ int Objecter::_calc_target(op_target_t *t, Connection *con, bool any_change)
 	  }
 	}
 	ceph_assert(best >= 0);
+	if (pool_replica_reads && best_locality < 0) {
+	  // we do not know where we are; spread the objects over the
+	  // replicas, sending each one's reads to the same osd so that
+	  // they hit its cache
+	  best = std::hash<std::string>{}(t->target_oid.name) %
+	    t->acting.size();
+	  t->used_replica = best != 0;
+	  ldout(cct, 20) << __func__ << " no locality, rank " << best << dendl;
+	}
 	osd = t->acting[best];
       }
       t->osd = osd;
@@ -3198,6 +3229,11 @@ Objecter::MOSDOp *Objecter::_prepare_osd_op(Op *op)
   if (!honor_pool_full)
     flags |= CEPH_OSD_FLAG_FULL_FORCE;
 
+  if (op->target.used_replica) {
+    // tell the replica we mean it, whether the client or the pool asked
+    flags |= CEPH_OSD_FLAG_LOCALIZE_READS;
+  }
+
   op->target.paused = false;
   op->stamp = ceph::coarse_mono_clock::now();
 
@@ -3472,6 +3508,7 @@ void Objecter::handle_osd_op_reply(MOSDOpReply *m)
     op->tid = 0;
     op->target.flags &= ~(CEPH_OSD_FLAG_BALANCE_READS |
 			  CEPH_OSD_FLAG_LOCALIZE_READS);
+    op->target.replica_read_bounced = true;
     op->target.pgid = pg_t();
     _op_submit(op, sul, NULL);
     m->put();
@@ -4499,6 +4536,8 @@ void Objecter::op_target_t::dump(Formatter *f) const
   f->dump_stream("target_object_locator") << target_oloc;
   f->dump_int("paused", (int)paused);
   f->dump_int("used_replica", (int)used_replica);
+  f->dump_bool("replica_read_bounced", replica_read_bounced);
+  f->dump_bool("primary_only", primary_only);
   f->dump_int("precalc_pgid", (int)precalc_pgid);
 }
 
@@ -1798,6 +1798,11 @@ public:
     int32_t peering_crush_mandatory_member = CRUSH_ITEM_NONE;
 
     bool used_replica = false;
+    /// a replica bounced us; the pool's replica_reads no longer apply
+    bool replica_read_bounced = false;
+    /// watch/notify state is only on the primary; the pool's
+    /// replica_reads never apply
+    bool primary_only = false;
     bool paused = false;
 
     int osd = -1;      ///< the final target osd, or -1
@@ -157,6 +157,87 @@ TEST(BufferRaw, ostream) {
   EXPECT_GT(stream.str().size(), stream.str().find("len 1 nref 1)"));
 }
 
+TEST(BufferRaw, slab) {
+  if (get_env_bool("CEPH_BUFFER_NO_SLAB")) {
+    GTEST_SKIP();
+  }
+  // a freed block is reused by the next allocation in its class
+  const char *p;
+  {
+    bufferptr a(buffer::create(100));
+    p = a.c_str();
+  }
+  {
+    bufferptr b(buffer::create(120));
+    EXPECT_EQ(p, b.c_str());
+  }
+  {
+    bufferptr a(buffer::create_page_aligned(3 * CEPH_PAGE_SIZE));
+    p = a.c_str();
+  }
+  {
+    bufferptr b(buffer::create_page_aligned(3 * CEPH_PAGE_SIZE - 100));
+    EXPECT_EQ(p, b.c_str());
+    EXPECT_TRUE(b.is_page_aligned());
+  }
+  // a page is its own class, even without page alignment
+  {
+    bufferptr a(buffer::create_page_aligned(CEPH_PAGE_SIZE));
+    p = a.c_str();
+  }
+  {
+    bufferptr b(buffer::create(CEPH_PAGE_SIZE));
+    EXPECT_EQ(p, b.c_str());
+  }
+  // and the alignment holds for every class
+  for (unsigned len = 1; len < 1024 * 1024; len = len * 3 + 1) {
+    for (unsigned align : {8u, 64u, 512u, 4096u}) {
+      bufferptr a(buffer::create_aligned(len, align));
+      EXPECT_EQ(0u, (uintptr_t)a.c_str() % align) << len << " " << align;
+      ::memset(a.c_str(), 'X', len);
+    }
+  }
+}
+
+TEST(BufferRaw, slab_charge) {
+  if (get_env_bool("CEPH_BUFFER_NO_SLAB")) {
+    GTEST_SKIP();
+  }
+  // the mempool sees the whole block, and above 64K the next class is
+  // still at most 1.5x away
+  size_t before = mempool::buffer_anon::allocated_bytes();
+  {
+    bufferptr a(buffer::create_page_aligned(64 * 1024 + CEPH_PAGE_SIZE));
+    EXPECT_EQ(before + 96 * 1024, mempool::buffer_anon::allocated_bytes());
+    bufferptr b(buffer::create_page_aligned(128 * 1024 + CEPH_PAGE_SIZE));
+    EXPECT_EQ(before + (96 + 192) * 1024,
+	      mempool::buffer_anon::allocated_bytes());
+    bufferlist bl;
+    bl.append(a);
+    bl.reassign_to_mempool(mempool::mempool_osd);
+    EXPECT_EQ(before + 192 * 1024, mempool::buffer_anon::allocated_bytes());
+  }
+  EXPECT_EQ(before, mempool::buffer_anon::allocated_bytes());
+}
+
+TEST(BufferRaw, slab_trim) {
+  if (get_env_bool("CEPH_BUFFER_NO_SLAB")) {
+    GTEST_SKIP();
+  }
+  // freeing more 64K blocks than a magazine holds parks the full
+  // magazines in the depot
+  {
+    std::vector<bufferptr> v;
+    for (unsigned i = 0; i < 8; ++i) {
+      v.emplace_back(buffer::create_page_aligned(64 * 1024));
+    }
+  }
+  // they count as idle only after a whole interval without use
+  buffer::trim_raw_cache();
+  EXPECT_GE(buffer::trim_raw_cache(), 4 * 64 * 1024u);
+  EXPECT_EQ(0u, buffer::trim_raw_cache());
+}
+
 //                                     
 // +-----------+                +-----+
 // |           |                |     |
@@ -2361,6 +2442,34 @@ TEST(BufferList, substr_of) {
   EXPECT_EQ((unsigned)2, other.get_num_buffers());
   EXPECT_EQ((unsigned)4, other.length());
   EXPECT_EQ(0, ::memcmp("EFGH", other.c_str(), 4));
+
+  // within the first buffer
+  other.substr_of(bl, 1, 2);
+  EXPECT_EQ((unsigned)1, other.get_num_buffers());
+  EXPECT_EQ((unsigned)2, other.length());
+  EXPECT_EQ(0, ::memcmp("BC", other.c_str(), 2));
+  other.substr_of(bl, 0, 3);
+  EXPECT_EQ((unsigned)1, other.get_num_buffers());
+  EXPECT_EQ(0, ::memcmp("ABC", other.c_str(), 3));
+  other.substr_of(bl, 0, 0);
+  EXPECT_EQ((unsigned)0, other.get_num_buffers());
+  EXPECT_EQ((unsigned)0, other.length());
+}
+
+TEST(BufferList, ptr_node_cache) {
+  bufferptr ptr("ABC", 3);
+  const void *node;
+  {
+    bufferlist bl;
+    bl.push_back(ptr);
+    node = &bl.front();
+  }
+  bufferlist bl;
+  bl.push_back(ptr);
+  if (!getenv("CEPH_BUFFER_NO_SLAB")) {
+    EXPECT_EQ(node, &bl.front());
+  }
+  EXPECT_EQ(0, ::memcmp("ABC", bl.c_str(), 3));
 }
 
 TEST(BufferList, splice) {
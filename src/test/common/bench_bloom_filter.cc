@@ -0,0 +1,93 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "include/buffer.h"
+#include "common/bloom_filter.hpp"
+#include "common/ceph_time.h"
+
+using namespace std;
+
+static void usage(const char *name)
+{
+  cout << name << " [num_keys [fpp [reps]]]\n"
+       << "\t num_keys: keys to insert, default 10000000\n"
+       << "\t fpp: target false positive probability, default .01\n"
+       << "\t reps: best of this many runs, default 3\n";
+}
+
+template <typename F>
+static double run(size_t num, int reps, F&& f)
+{
+  double best = 0;
+  for (int i = 0; i < reps; ++i) {
+    auto start = ceph::mono_clock::now();
+    f();
+    double secs = ceph::to_seconds<double>(ceph::mono_clock::now() - start);
+    if (!best || secs < best) {
+      best = secs;
+    }
+  }
+  return best * 1e9 / num;
+}
+
+int main(int argc, const char **argv)
+{
+  if (argc > 1 && (string(argv[1]) == "-h" || string(argv[1]) == "--help")) {
+    usage(argv[0]);
+    return 0;
+  }
+  long num = argc > 1 ? atol(argv[1]) : 10000000;
+  double fpp = argc > 2 ? atof(argv[2]) : .01;
+  int reps = argc > 3 ? atoi(argv[3]) : 3;
+  if (num <= 0 || fpp <= 0 || fpp >= 1 || reps <= 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  // the uint32_t routines are fed hash values in ceph, so use random keys
+  std::mt19937 rng(0);
+  vector<uint32_t> keys(num), others(num);
+  for (auto& k : keys) {
+    k = rng();
+  }
+  for (auto& k : others) {
+    k = rng();
+  }
+
+  cout << "# type\tbytes\tinsert ns\thit ns\tmiss ns\tactual fpp" << std::endl;
+  for (bool blocked : {false, true}) {
+    bloom_filter bf(num, fpp, 1, blocked);
+    double insert_ns = run(num, 1, [&] {
+      for (auto k : keys) {
+	bf.insert(k);
+      }
+    });
+    size_t hits = 0;
+    double hit_ns = run(num, reps, [&] {
+      hits = 0;
+      for (auto k : keys) {
+	hits += bf.contains(k);
+      }
+    });
+    ceph_assert(hits == keys.size());
+    size_t false_hits = 0;
+    double miss_ns = run(num, reps, [&] {
+      false_hits = 0;
+      for (auto k : others) {
+	false_hits += bf.contains(k);
+      }
+    });
+    cout << (blocked ? "blocked" : "classic")
+	 << "\t" << bf.size() / CHAR_BIT
+	 << "\t" << insert_ns
+	 << "\t" << hit_ns
+	 << "\t" << miss_ns
+	 << "\t" << (double)false_hits / num
+	 << std::endl;
+  }
+  return 0;
+}
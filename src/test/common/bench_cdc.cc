@@ -0,0 +1,86 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <iostream>
+#include <vector>
+
+#include "include/types.h"
+#include "include/buffer.h"
+#include "common/ceph_time.h"
+#include "common/CDC.h"
+#include "common/FastCDC.h"
+
+using namespace std;
+
+static void usage(const char *name)
+{
+  cout << name << " [size_mb [bits [reps]]]\n"
+       << "\t size_mb: how much (random) data to chunk, default 256\n"
+       << "\t bits: target chunk size bits, default 16\n"
+       << "\t reps: best of this many runs, default 3\n";
+}
+
+template <typename F>
+static void run(const char *name, uint64_t size, int reps, F&& f)
+{
+  double best = 0;
+  size_t num = 0;
+  for (int i = 0; i < reps; ++i) {
+    vector<pair<uint64_t, uint64_t>> chunks;
+    auto start = ceph::mono_clock::now();
+    f(&chunks);
+    double secs = ceph::to_seconds<double>(ceph::mono_clock::now() - start);
+    best = std::max(best, size / secs);
+    num = chunks.size();
+  }
+  cout << name << "\t" << (uint64_t)(best / (1024 * 1024)) << " MB/s\t"
+       << num << " chunks\t" << (num ? size / num : 0) << " avg bytes"
+       << std::endl;
+}
+
+int main(int argc, const char **argv)
+{
+  if (argc > 1 && (string(argv[1]) == "-h" || string(argv[1]) == "--help")) {
+    usage(argv[0]);
+    return 0;
+  }
+  int size_mb = argc > 1 ? atoi(argv[1]) : 256;
+  int bits = argc > 2 ? atoi(argv[2]) : 16;
+  int reps = argc > 3 ? atoi(argv[3]) : 3;
+  if (size_mb <= 0 || size_mb >= 2048 || bits < 8 || bits > 30 || reps <= 0) {
+    usage(argv[0]);
+    return 1;
+  }
+  uint64_t size = (uint64_t)size_mb << 20;
+
+  // generate_buffer() hands back a list of random segments of up to 1MB
+  bufferlist bl;
+  generate_buffer(size, &bl);
+  bufferlist flat = bl;
+  flat.rebuild();
+
+  cout << size_mb << " MB, target " << (1 << bits) << " bytes, "
+       << bl.get_num_buffers() << " segments" << std::endl;
+
+  auto fixed = CDC::create("fixed", bits);
+  run("fixed", size, reps, [&](auto *chunks) {
+    fixed->calc_chunks(bl, chunks);
+  });
+
+  FastCDC fastcdc(bits);
+  run("fastcdc", size, reps, [&](auto *chunks) {
+    fastcdc.calc_chunks(bl, chunks);
+  });
+  run("fastcdc (flat)", size, reps, [&](auto *chunks) {
+    fastcdc.calc_chunks(flat, chunks);
+  });
+  run("fastcdc (4k stream)", size, reps, [&](auto *chunks) {
+    FastCDC::Stream s(fastcdc);
+    const char *p = flat.c_str();
+    for (uint64_t pos = 0; pos < size; pos += 4096) {
+      s.append(p + pos, std::min<uint64_t>(4096, size - pos), chunks);
+    }
+    s.finish(chunks);
+  });
+  return 0;
+}
@@ -9,6 +9,7 @@
 #include "include/buffer.h"
 
 #include "common/CDC.h"
+#include "common/FastCDC.h"
 #include "gtest/gtest.h"
 
 using namespace std;
@@ -153,6 +154,33 @@ TEST_P(CDCTest, chunk_random)
   print_histogram(h);
 }
 
+TEST(FastCDC, stream)
+{
+  bufferlist bl;
+  generate_buffer(16*1024*1024, &bl, 7);
+  bl.rebuild();  // long contiguous scans are split into lanes
+  const char *data = bl.c_str();
+  std::mt19937 engine(1);
+  for (int bits : {10, 13, 16, 18}) {
+    FastCDC cdc(bits);
+    vector<pair<uint64_t, uint64_t>> expected, chunks;
+    cdc.calc_chunks(bl, &expected);
+
+    // mostly small pieces, which are scanned a byte at a time
+    FastCDC::Stream s(cdc);
+    uint64_t pos = 0;
+    while (pos < bl.length()) {
+      size_t max = engine() % 8 ? 1500 : 300000;
+      size_t len = std::min<uint64_t>(bl.length() - pos, 1 + engine() % max);
+      s.append(data + pos, len, &chunks);
+      pos += len;
+    }
+    ASSERT_EQ(pos, s.get_pos());
+    ASSERT_EQ(expected.size() - 1, chunks.size());
+    s.finish(&chunks);
+    ASSERT_EQ(expected, chunks);
+  }
+}
 
 INSTANTIATE_TEST_SUITE_P(
   CDC,
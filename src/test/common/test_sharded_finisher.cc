@@ -0,0 +1,57 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "common/Finisher.h"
+#include "global/global_context.h"
+
+TEST(ShardedFinisher, order_per_key)
+{
+  constexpr unsigned KEYS = 16;
+  constexpr unsigned PER_KEY = 2000;
+  ShardedFinisher fin(g_ceph_context, "test", "tfin", 4);
+  ASSERT_EQ(4u, fin.get_num_shards());
+  fin.start();
+
+  std::vector<unsigned> seen(KEYS, 0);
+  std::atomic<unsigned> out_of_order = 0;
+  std::vector<std::thread> threads;
+  // one producer per key keeps the queueing order well defined
+  for (unsigned k = 0; k < KEYS; ++k) {
+    threads.emplace_back([&, k] {
+      for (unsigned i = 0; i < PER_KEY; ++i) {
+	fin.queue(k, new LambdaContext([&, k, i](int r) {
+	  if (seen[k] != i || r != int(k)) {
+	    ++out_of_order;
+	  }
+	  seen[k] = i + 1;
+	}), k);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  fin.wait_for_empty();
+  EXPECT_EQ(0u, out_of_order);
+  for (unsigned k = 0; k < KEYS; ++k) {
+    EXPECT_EQ(PER_KEY, seen[k]);
+  }
+
+  // batched queueing
+  std::list<Context*> ls;
+  unsigned done = 0;
+  for (unsigned i = 0; i < 10; ++i) {
+    ls.push_back(new LambdaContext([&done](int) { ++done; }));
+  }
+  fin.queue(1, ls);
+  EXPECT_TRUE(ls.empty());
+  fin.wait_for_empty();
+  EXPECT_EQ(10u, done);
+  fin.stop();
+}
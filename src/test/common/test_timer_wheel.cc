@@ -0,0 +1,153 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation. See file COPYING.
+ *
+ */
+
+#include <map>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "common/ceph_time.h"
+#include "common/timer_wheel.h"
+
+using namespace std::literals;
+
+using wheel_t = ceph::timer_wheel<ceph::mono_clock>;
+using time_point = ceph::mono_clock::time_point;
+
+namespace {
+struct event_t : wheel_t::entry {
+  int id = 0;
+};
+}
+
+TEST(TimerWheel, basic)
+{
+  const time_point base{1h};
+  wheel_t w(1ms, base);
+  EXPECT_TRUE(w.empty());
+  EXPECT_EQ(time_point::max(), w.next_wakeup());
+
+  event_t a, b, c;
+  a.id = 1;
+  b.id = 2;
+  c.id = 3;
+  w.insert(&a, base + 10ms);
+  w.insert(&b, base + 5ms + 500us);
+  w.insert(&c, base + 10ms);
+  EXPECT_EQ(3u, w.size());
+  EXPECT_LE(w.next_wakeup(), base + 6ms);
+
+  w.advance(base + 5ms);
+  EXPECT_EQ(nullptr, w.pop_expired());
+  w.advance(base + 6ms);
+  EXPECT_EQ(&b, w.pop_expired());
+  EXPECT_EQ(nullptr, w.pop_expired());
+  EXPECT_FALSE(b.is_linked());
+
+  w.remove(&c);
+  EXPECT_FALSE(c.is_linked());
+  w.advance(base + 1s);
+  EXPECT_EQ(&a, w.pop_expired());
+  EXPECT_EQ(nullptr, w.pop_expired());
+  EXPECT_TRUE(w.empty());
+
+  // already due on insert
+  w.insert(&a, base + 1s);
+  w.insert(&b, base + 500ms);
+  EXPECT_EQ(&b, w.pop_expired());
+  EXPECT_EQ(&a, w.pop_expired());
+  EXPECT_EQ(nullptr, w.pop_expired());
+}
+
+TEST(TimerWheel, far)
+{
+  const time_point base{1h};
+  wheel_t w(1ms, base);
+  event_t a, b;
+  // beyond the reach of the top level
+  w.insert(&a, base + 24h * 365 * 5);
+  w.insert(&b, time_point::max());
+  w.advance(base + 24h * 365 * 5 - 1ms);
+  EXPECT_EQ(nullptr, w.pop_expired());
+  EXPECT_LT(w.next_wakeup(), time_point::max());
+  w.advance(base + 24h * 365 * 5);
+  EXPECT_EQ(&a, w.pop_expired());
+  EXPECT_EQ(nullptr, w.pop_expired());
+  w.clear();
+  EXPECT_FALSE(b.is_linked());
+  EXPECT_TRUE(w.empty());
+}
+
+// compare against a multimap, the way SafeTimer used to keep its events
+TEST(TimerWheel, random)
+{
+  const time_point base{1h};
+  wheel_t w(1ms, base);
+  std::mt19937_64 rng(42);
+  std::vector<event_t> events(5000);
+  std::multimap<time_point, int> ref;
+  std::map<int, std::multimap<time_point, int>::iterator> ref_pos;
+  for (size_t i = 0; i < events.size(); ++i) {
+    events[i].id = i;
+  }
+
+  time_point now = base;
+  for (int round = 0; round < 2000; ++round) {
+    for (int n = 0; n < 20; ++n) {
+      int i = rng() % events.size();
+      auto& e = events[i];
+      if (e.is_linked()) {
+	w.remove(&e);
+	ref.erase(ref_pos[i]);
+	ref_pos.erase(i);
+	continue;
+      }
+      std::chrono::nanoseconds d;
+      switch (rng() % 4) {
+      case 0: d = std::chrono::nanoseconds(rng() % 5000000); break;
+      case 1: d = std::chrono::milliseconds(rng() % 5000); break;
+      case 2: d = std::chrono::seconds(rng() % 100000); break;
+      default: d = -std::chrono::nanoseconds(rng() % 1000000); break;
+      }
+      w.insert(&e, now + d);
+      ref_pos[i] = ref.emplace(now + d, i);
+    }
+    ASSERT_EQ(ref.size(), w.size());
+
+    // sometimes step to the next wakeup, sometimes jump further
+    auto next = w.next_wakeup();
+    if (next != time_point::max() && rng() % 2) {
+      now = std::max(now, next);
+    } else {
+      now += std::chrono::nanoseconds(rng() % 20000000000ull);
+    }
+    w.advance(now);
+    const auto now_tick = (now - base) / 1ms;
+    for (auto e = w.pop_expired(); e; e = w.pop_expired()) {
+      auto ev = static_cast<event_t*>(e);
+      ASSERT_FALSE(ref.empty());
+      auto p = ref.begin();
+      ASSERT_EQ(p->second, ev->id);
+      ASSERT_LE(p->first, now);
+      ref_pos.erase(p->second);
+      ref.erase(p);
+    }
+    // nothing that is due was held back
+    if (!ref.empty()) {
+      auto first = ref.begin()->first;
+      ASSERT_GT((first - base + 1ms - 1ns) / 1ms, now_tick);
+      ASSERT_LE(w.next_wakeup(), std::max(first, base) + 1ms);
+    }
+  }
+  w.clear();
+}
@@ -0,0 +1,98 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "common/TrackedOp.h"
+#include "global/global_context.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+class TestOp : public TrackedOp {
+public:
+  TestOp(OpTracker *tracker, const utime_t& initiated = ceph_clock_now())
+    : TrackedOp(tracker, initiated) {}
+
+  void _dump_op_descriptor(std::ostream& stream) const override {
+    stream << "test_op";
+  }
+  std::vector<std::string> get_events() const {
+    std::lock_guard l(lock);
+    std::vector<std::string> ret;
+    for (size_t i = 0; i < events.size(); ++i) {
+      ret.emplace_back(events[i].c_str());
+    }
+    return ret;
+  }
+  size_t get_dropped() const {
+    std::lock_guard l(lock);
+    return events.dropped();
+  }
+};
+
+TEST(TrackedOp, events_wrap)
+{
+  OpTracker tracker(g_ceph_context, true, 1);
+  {
+    boost::intrusive_ptr<TestOp> op(new TestOp(&tracker));
+    op->tracking_start();
+    for (int i = 0; i < 40; i++) {
+      op->mark_event("e" + std::to_string(i));
+    }
+    // "initiated" and the first 8 marked events are gone
+    auto events = op->get_events();
+    ASSERT_EQ(size_t(OPTRACKER_MAX_EVENTS), events.size());
+    ASSERT_EQ(41u - OPTRACKER_MAX_EVENTS, op->get_dropped());
+    ASSERT_EQ("e8", events.front());
+    ASSERT_EQ("e39", events.back());
+    ASSERT_EQ("e39", op->state_string());
+
+    op->mark_event("literal");
+    events = op->get_events();
+    ASSERT_EQ("e9", events.front());
+    ASSERT_EQ("literal", events.back());
+
+    // a name in a mutable buffer is copied
+    char buf[16] = "before";
+    op->mark_event(buf);
+    strcpy(buf, "after");
+    ASSERT_EQ("before", op->get_events().back());
+  }
+  tracker.on_shutdown();
+}
+
+TEST(TrackedOp, history_sample_rate)
+{
+  OpTracker tracker(g_ceph_context, true, 1);
+  tracker.set_history_slow_op_size_and_threshold(20, 10);
+  tracker.set_history_sample_rate(4);
+  {
+    std::vector<boost::intrusive_ptr<TestOp>> ops;
+    unsigned wanted = 0;
+    for (int i = 0; i < 16; i++) {
+      ops.emplace_back(new TestOp(&tracker));
+      ops.back()->tracking_start();
+      if (tracker.want_history(*ops.back())) {
+	++wanted;
+      }
+    }
+    ASSERT_EQ(4u, wanted);
+
+    // slow ops are kept whatever their seq
+    utime_t long_ago = ceph_clock_now();
+    long_ago -= 100;
+    for (int i = 0; i < 3; i++) {
+      ops.emplace_back(new TestOp(&tracker, long_ago));
+      ops.back()->tracking_start();
+      ASSERT_TRUE(tracker.want_history(*ops.back()));
+    }
+
+    tracker.set_history_sample_rate(1);
+    for (auto& op : ops) {
+      ASSERT_TRUE(tracker.want_history(*op));
+    }
+  }
+  tracker.on_shutdown();
+}
@@ -13,6 +13,7 @@
 #include <memory>
 #include <set>
 
+#include "arch/intel.h"
 #include "common/ceph_argparse.h"
 #include "common/common_init.h"
 #include "include/stringify.h"
@@ -265,6 +266,39 @@ TEST_F(CRUSHTest, indep_out_progressive) {
 
 }
 
+TEST_F(CRUSHTest, do_rule_many) {
+  // racks of 12 hosts and hosts of 10 osds: wide enough buckets for the
+  // batched straw2 hash
+  std::unique_ptr<CrushWrapper> c(build_indep_map(cct, 3, 12, 10));
+  vector<__u32> weight(c->get_max_devices(), 0x10000);
+  weight[7] = 0;
+  weight[42] = 0x8000;
+
+  vector<int> x(5000);
+  for (unsigned i = 0; i < x.size(); ++i) {
+    x[i] = i * 2654435761u;
+  }
+  vector<vector<int>> out;
+  c->do_rule_many(0, x, &out, 7, weight, 0);
+  ASSERT_EQ(x.size(), out.size());
+  for (unsigned i = 0; i < x.size(); ++i) {
+    vector<int> one;
+    c->do_rule(0, x[i], one, 7, weight, 0);
+    ASSERT_EQ(one, out[i]);
+  }
+
+#if defined(__x86_64__)
+  if (ceph_arch_intel_avx2) {
+    // the vectorized hash must give the same draws as the scalar one
+    ceph_arch_intel_avx2 = 0;
+    vector<vector<int>> scalar;
+    c->do_rule_many(0, x, &scalar, 7, weight, 0);
+    ceph_arch_intel_avx2 = 1;
+    ASSERT_EQ(out, scalar);
+  }
+#endif
+}
+
 TEST_F(CRUSHTest, straw_zero) {
   // zero weight items should have no effect on placement.
 
@@ -368,6 +368,103 @@ TEST_F(IsaErasureCodeTest, encode)
   }
 }
 
+TEST_F(IsaErasureCodeTest, encode_decode_stripes)
+{
+  ErasureCodeIsaDefault Isa(tcache);
+  ErasureCodeProfile profile;
+  profile["k"] = "4";
+  profile["m"] = "2";
+  Isa.init(profile, &cerr);
+
+  const unsigned chunk_size = Isa.get_chunk_size(1);
+  const unsigned stripe_width = 4 * chunk_size;
+  const unsigned stripes = 7;
+  bufferlist in;
+  for (unsigned i = 0; i < stripes * stripe_width; i++) {
+    in.append((char)(i * 13 + i / 509));
+  }
+  // only the coding chunks, as a partial overwrite would
+  set<int> want_to_encode = { 4, 5 };
+  map<int, bufferlist> encoded;
+  EXPECT_EQ(0, Isa.encode_stripes(want_to_encode, in, stripe_width,
+				  &encoded));
+  EXPECT_EQ(2u, encoded.size());
+
+  map<int, bufferlist> all;
+  for (unsigned s = 0; s < stripes; s++) {
+    bufferlist stripe;
+    stripe.substr_of(in, s * stripe_width, stripe_width);
+    map<int, bufferlist> one;
+    EXPECT_EQ(0, Isa.encode(set<int>{ 0, 1, 2, 3, 4, 5 }, stripe, &one));
+    for (auto& [shard, bl] : one) {
+      all[shard].claim_append(bl);
+    }
+  }
+  EXPECT_TRUE(encoded[4].contents_equal(all[4]));
+  EXPECT_TRUE(encoded[5].contents_equal(all[5]));
+
+  // two data chunks are missing
+  map<int, bufferlist> degraded = all;
+  degraded.erase(1);
+  degraded.erase(3);
+  map<int, bufferlist> decoded;
+  EXPECT_EQ(0, Isa.decode_stripes(set<int>{ 0, 1, 2, 3 }, degraded, &decoded,
+				  chunk_size));
+  for (int i = 0; i < 4; i++) {
+    EXPECT_TRUE(decoded[i].contents_equal(all[i]));
+  }
+}
+
+TEST_F(IsaErasureCodeTest, parity_delta)
+{
+  // m == 1 is a plain xor parity, m > 1 goes through the matrix
+  for (int m = 1; m <= 2; m++) {
+    ErasureCodeIsaDefault Isa(tcache);
+    ErasureCodeProfile profile;
+    profile["k"] = "4";
+    profile["m"] = stringify(m);
+    Isa.init(profile, &cerr);
+    EXPECT_TRUE(Isa.supports_parity_delta());
+
+    const unsigned chunk_size = Isa.get_chunk_size(1);
+    bufferlist in;
+    for (unsigned i = 0; i < 4 * chunk_size; i++) {
+      in.append((char)(i * 13 + i / 509));
+    }
+    set<int> want_to_encode;
+    for (int i = 0; i < 4 + m; i++) {
+      want_to_encode.insert(i);
+    }
+    map<int, bufferlist> encoded;
+    EXPECT_EQ(0, Isa.encode(want_to_encode, in, &encoded));
+
+    // overwrite data chunks 0 and 2
+    map<int, bufferlist> changed;
+    map<int, bufferlist> deltas;
+    for (int i : { 0, 2 }) {
+      for (unsigned j = 0; j < chunk_size; j++) {
+	changed[i].append((char)(j * 3 + i));
+      }
+      Isa.encode_delta(encoded[i], changed[i], &deltas[i]);
+    }
+    map<int, bufferlist> coding;
+    for (int i = 4; i < 4 + m; i++) {
+      coding[i].append(encoded[i].c_str(), chunk_size);
+    }
+    EXPECT_EQ(0, Isa.apply_delta(deltas, &coding));
+
+    bufferlist new_in;
+    for (int i = 0; i < 4; i++) {
+      new_in.append(changed.count(i) ? changed[i] : encoded[i]);
+    }
+    map<int, bufferlist> reencoded;
+    EXPECT_EQ(0, Isa.encode(want_to_encode, new_in, &reencoded));
+    for (int i = 4; i < 4 + m; i++) {
+      EXPECT_TRUE(coding[i].contents_equal(reencoded[i]));
+    }
+  }
+}
+
 TEST_F(IsaErasureCodeTest, sanity_check_k)
 {
   ErasureCodeIsaDefault Isa(tcache);
@@ -130,6 +130,99 @@ TYPED_TEST(ErasureCodeTest, encode_decode)
   }
 }
 
+TYPED_TEST(ErasureCodeTest, encode_decode_stripes)
+{
+  TypeParam jerasure;
+  ErasureCodeProfile profile;
+  profile["k"] = "2";
+  profile["m"] = "2";
+  profile["packetsize"] = "8";
+  jerasure.init(profile, &cerr);
+
+  const unsigned chunk_size = jerasure.get_chunk_size(1);
+  const unsigned stripe_width = 2 * chunk_size;
+  const unsigned stripes = 5;
+  bufferlist in;
+  for (unsigned i = 0; i < stripes * stripe_width; i++) {
+    in.append((char)(i * 7 + i / 251));
+  }
+  set<int> want_to_encode = { 0, 1, 2, 3 };
+  map<int, bufferlist> encoded;
+  EXPECT_EQ(0, jerasure.encode_stripes(want_to_encode, in, stripe_width,
+				       &encoded));
+  EXPECT_EQ(4u, encoded.size());
+
+  // the same as encoding one stripe at a time
+  for (unsigned s = 0; s < stripes; s++) {
+    bufferlist stripe;
+    stripe.substr_of(in, s * stripe_width, stripe_width);
+    map<int, bufferlist> one;
+    EXPECT_EQ(0, jerasure.encode(want_to_encode, stripe, &one));
+    for (auto& [shard, bl] : one) {
+      bufferlist batched;
+      batched.substr_of(encoded[shard], s * chunk_size, chunk_size);
+      EXPECT_TRUE(batched.contents_equal(bl));
+    }
+  }
+
+  // two chunks are missing
+  map<int, bufferlist> degraded = encoded;
+  degraded.erase(0);
+  degraded.erase(2);
+  map<int, bufferlist> decoded;
+  EXPECT_EQ(0, jerasure.decode_stripes(set<int>{ 0, 1 }, degraded, &decoded,
+				       chunk_size));
+  EXPECT_TRUE(decoded[0].contents_equal(encoded[0]));
+  EXPECT_TRUE(decoded[1].contents_equal(encoded[1]));
+}
+
+TYPED_TEST(ErasureCodeTest, parity_delta)
+{
+  TypeParam jerasure;
+  ErasureCodeProfile profile;
+  profile["k"] = "3";
+  profile["m"] = "2";
+  profile["packetsize"] = "8";
+  jerasure.init(profile, &cerr);
+
+  const unsigned chunk_size = jerasure.get_chunk_size(1);
+  bufferlist in;
+  for (unsigned i = 0; i < 3 * chunk_size; i++) {
+    in.append((char)(i * 13 + i / 241));
+  }
+  set<int> want_to_encode = { 0, 1, 2, 3, 4 };
+  map<int, bufferlist> encoded;
+  EXPECT_EQ(0, jerasure.encode(want_to_encode, in, &encoded));
+
+  // overwrite chunk 1 and update the parity from the delta alone
+  bufferlist new_data;
+  for (unsigned i = 0; i < chunk_size; i++) {
+    new_data.append((char)(i * 5 + 1));
+  }
+  map<int, bufferlist> deltas;
+  jerasure.encode_delta(encoded[1], new_data, &deltas[1]);
+  map<int, bufferlist> coding;
+  for (int i = 3; i < 5; i++) {
+    coding[i].append(encoded[i].c_str(), chunk_size);
+  }
+  if (!jerasure.supports_parity_delta()) {
+    EXPECT_EQ(-EOPNOTSUPP, jerasure.apply_delta(deltas, &coding));
+    return;
+  }
+  EXPECT_EQ(0, jerasure.apply_delta(deltas, &coding));
+
+  bufferlist changed;
+  changed.substr_of(in, 0, chunk_size);
+  changed.append(new_data);
+  bufferlist tail;
+  tail.substr_of(in, 2 * chunk_size, chunk_size);
+  changed.append(tail);
+  map<int, bufferlist> reencoded;
+  EXPECT_EQ(0, jerasure.encode(want_to_encode, changed, &reencoded));
+  EXPECT_TRUE(coding[3].contents_equal(reencoded[3]));
+  EXPECT_TRUE(coding[4].contents_equal(reencoded[4]));
+}
+
 TYPED_TEST(ErasureCodeTest, minimum_to_decode)
 {
   TypeParam jerasure;
@@ -62,6 +62,11 @@ int ErasureCodeBench::setup(int argc, char** argv) {
      " the first chunk, then the second etc.)")
     ("parameter,P", po::value<vector<string> >(),
      "add a parameter to the erasure code profile")
+    ("stripe-width", po::value<unsigned>()->default_value(0),
+     "if not zero, the buffer is made of stripes of this size, encoded and "
+     " decoded the way the OSD does, with encode_stripes and decode_stripes")
+    ("per-stripe", "with --stripe-width, call encode or decode once per "
+     " stripe instead, for comparison")
     ;
 
   po::variables_map vm;
@@ -121,6 +126,16 @@ int ErasureCodeBench::setup(int argc, char** argv) {
     exhaustive_erasures = false;
   if (vm.count("erased") > 0)
     erased = vm["erased"].as<vector<int> >();
+  stripe_width = vm["stripe-width"].as<unsigned>();
+  per_stripe = vm.count("per-stripe") > 0;
+  if (stripe_width > 0) {
+    in_size -= in_size % stripe_width;
+    if (in_size == 0) {
+      cout << "--size must be at least --stripe-width " << stripe_width
+	   << endl;
+      return -EINVAL;
+    }
+  }
   
   try {
     k = stoi(profile["k"]);
@@ -176,7 +191,7 @@ int ErasureCodeBench::encode()
   utime_t begin_time = ceph_clock_now();
   for (int i = 0; i < max_iterations; i++) {
     map<int,bufferlist> encoded;
-    code = erasure_code->encode(want_to_encode, in, &encoded);
+    code = encode_chunks(erasure_code, want_to_encode, in, &encoded);
     if (code)
       return code;
   }
@@ -185,6 +200,56 @@ int ErasureCodeBench::encode()
   return 0;
 }
 
+int ErasureCodeBench::encode_chunks(ErasureCodeInterfaceRef erasure_code,
+				    const set<int> &want_to_encode,
+				    const bufferlist &in,
+				    map<int,bufferlist> *encoded)
+{
+  if (stripe_width == 0)
+    return erasure_code->encode(want_to_encode, in, encoded);
+  if (!per_stripe)
+    return erasure_code->encode_stripes(want_to_encode, in, stripe_width,
+					encoded);
+  for (unsigned off = 0; off < in.length(); off += stripe_width) {
+    bufferlist stripe;
+    stripe.substr_of(in, off, stripe_width);
+    map<int,bufferlist> stripe_encoded;
+    int code = erasure_code->encode(want_to_encode, stripe, &stripe_encoded);
+    if (code)
+      return code;
+    for (auto& [chunk, bl] : stripe_encoded)
+      (*encoded)[chunk].claim_append(bl);
+  }
+  return 0;
+}
+
+int ErasureCodeBench::decode_chunks(ErasureCodeInterfaceRef erasure_code,
+				    const set<int> &want_to_read,
+				    const map<int,bufferlist> &chunks,
+				    map<int,bufferlist> *decoded)
+{
+  if (stripe_width == 0)
+    return erasure_code->decode(want_to_read, chunks, decoded, 0);
+  unsigned chunk_size = erasure_code->get_chunk_size(stripe_width);
+  if (!per_stripe)
+    return erasure_code->decode_stripes(want_to_read, chunks, decoded,
+					chunk_size);
+  unsigned length = chunks.begin()->second.length();
+  for (unsigned off = 0; off < length; off += chunk_size) {
+    map<int,bufferlist> stripe_chunks;
+    for (auto& [chunk, bl] : chunks)
+      stripe_chunks[chunk].substr_of(bl, off, chunk_size);
+    map<int,bufferlist> stripe_decoded;
+    int code = erasure_code->decode(want_to_read, stripe_chunks,
+				    &stripe_decoded, chunk_size);
+    if (code)
+      return code;
+    for (auto& [chunk, bl] : stripe_decoded)
+      (*decoded)[chunk].claim_append(bl);
+  }
+  return 0;
+}
+
 static void display_chunks(const map<int,bufferlist> &chunks,
 			   unsigned int chunk_count) {
   cout << "chunks ";
@@ -216,7 +281,7 @@ int ErasureCodeBench::decode_erasures(const map<int,bufferlist> &all_chunks,
 	want_to_read.insert(chunk);
 
     map<int,bufferlist> decoded;
-    code = erasure_code->decode(want_to_read, chunks, &decoded, 0);
+    code = decode_chunks(erasure_code, want_to_read, chunks, &decoded);
     if (code)
       return code;
     for (set<int>::iterator chunk = want_to_read.begin();
@@ -271,7 +336,7 @@ int ErasureCodeBench::decode()
   }
 
   map<int,bufferlist> encoded;
-  code = erasure_code->encode(want_to_encode, in, &encoded);
+  code = encode_chunks(erasure_code, want_to_encode, in, &encoded);
   if (code)
     return code;
 
@@ -293,7 +358,7 @@ int ErasureCodeBench::decode()
 	return code;
     } else if (erased.size() > 0) {
       map<int,bufferlist> decoded;
-      code = erasure_code->decode(want_to_read, encoded, &decoded, 0);
+      code = decode_chunks(erasure_code, want_to_read, encoded, &decoded);
       if (code)
 	return code;
     } else {
@@ -306,7 +371,7 @@ int ErasureCodeBench::decode()
 	chunks.erase(erasure);
       }
       map<int,bufferlist> decoded;
-      code = erasure_code->decode(want_to_read, chunks, &decoded, 0);
+      code = decode_chunks(erasure_code, want_to_read, chunks, &decoded);
       if (code)
 	return code;
     }
@@ -28,6 +28,8 @@ class ErasureCodeBench {
   int erasures;
   int k;
   int m;
+  unsigned stripe_width;
+  bool per_stripe;
 
   string plugin;
 
@@ -47,6 +49,14 @@ public:
 		      unsigned i,
 		      unsigned want_erasures,
 		      ErasureCodeInterfaceRef erasure_code);
+  int encode_chunks(ErasureCodeInterfaceRef erasure_code,
+		    const set<int> &want_to_encode,
+		    const bufferlist &in,
+		    map<int,bufferlist> *encoded);
+  int decode_chunks(ErasureCodeInterfaceRef erasure_code,
+		    const set<int> &want_to_read,
+		    const map<int,bufferlist> &chunks,
+		    map<int,bufferlist> *decoded);
   int decode();
   int encode();
 };
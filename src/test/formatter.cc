@@ -15,6 +15,7 @@
 #include "gtest/gtest.h"
 #include "common/Formatter.h"
 #include "common/HTMLFormatter.h"
+#include "include/buffer.h"
 
 #include <sstream>
 #include <string>
@@ -69,6 +70,29 @@ TEST(JsonFormatter, Empty) {
   ASSERT_EQ(oss.str(), "");
 }
 
+TEST(JsonFormatter, Escapes) {
+  bufferlist bl;
+  JSONFormatter fmt(false);
+  fmt.open_array_section("foo");
+  fmt.dump_string("s", "plain text, long enough for a few words");
+  fmt.dump_string("s", "a\"b\\c\td\ne\x01" "f\x7fg\xc3\xa9");
+  fmt.dump_stream("s") << "quote\" in a stream";
+  fmt.dump_null("n");
+  fmt.close_section();
+  fmt.flush(bl);
+  ASSERT_EQ(bl.to_str(), "[\"plain text, long enough for a few words\","
+	    "\"a\\\"b\\\\c\\td\\ne\\u0001f\\u007fg\xc3\xa9\","
+	    "\"quote\\\" in a stream\",null]");
+
+  // the formatter is empty again after a flush
+  fmt.open_object_section("foo");
+  fmt.dump_int("a", -1);
+  fmt.close_section();
+  bl.clear();
+  fmt.flush(bl);
+  ASSERT_EQ(bl.to_str(), "{\"a\":-1}");
+}
+
 TEST(XmlFormatter, Simple1) {
   ostringstream oss;
   XMLFormatter fmt(false);
@@ -255,6 +255,64 @@ TEST_F(LibRadosWatchNotify, WatchNotify2) {
   rados_watch_flush(cluster);
 }
 
+// watchers are registered on the primary; the pool's replica_reads must
+// not send notifies to a replica
+TEST_F(LibRadosWatchNotify, WatchNotify2ReplicaReads) {
+  char *buf, *st;
+  size_t buflen, stlen;
+  std::string cmd = "{\"prefix\": \"osd pool set\", \"pool\": \"" +
+    pool_name + "\", \"var\": \"replica_reads\", \"val\": \"true\"}";
+  const char *cmds[] = { cmd.c_str(), nullptr };
+  ASSERT_EQ(0, rados_mon_command(cluster, cmds, 1, "", 0, &buf, &buflen,
+				 &st, &stlen));
+  rados_buffer_free(buf);
+  rados_buffer_free(st);
+  ASSERT_EQ(0, rados_wait_for_latest_osdmap(cluster));
+
+  notify_io = ioctx;
+  char data[128];
+  memset(data, 0xcc, sizeof(data));
+  // enough objects that some would hash to a replica
+  for (int i = 0; i < 16; ++i) {
+    std::string oid = "foo" + std::to_string(i);
+    notify_oid = oid.c_str();
+    notify_cookies.clear();
+    ASSERT_EQ(0, rados_write(ioctx, notify_oid, data, sizeof(data), 0));
+    uint64_t handle;
+    ASSERT_EQ(0,
+	      rados_watch2(ioctx, notify_oid, &handle,
+			   watch_notify2_test_cb,
+			   watch_notify2_test_errcb, this));
+    char *reply_buf = 0;
+    size_t reply_buf_len;
+    ASSERT_EQ(0, rados_notify2(ioctx, notify_oid,
+			       "notify", 6, 300000,
+			       &reply_buf, &reply_buf_len));
+    bufferlist reply;
+    reply.append(reply_buf, reply_buf_len);
+    std::map<std::pair<uint64_t,uint64_t>, bufferlist> reply_map;
+    std::set<std::pair<uint64_t,uint64_t> > missed_map;
+    auto reply_p = reply.cbegin();
+    decode(reply_map, reply_p);
+    decode(missed_map, reply_p);
+    ASSERT_EQ(1u, reply_map.size());
+    ASSERT_EQ(0u, missed_map.size());
+    ASSERT_EQ(1u, notify_cookies.count(handle));
+    rados_buffer_free(reply_buf);
+
+    rados_unwatch2(ioctx, handle);
+  }
+  rados_watch_flush(cluster);
+
+  cmd = "{\"prefix\": \"osd pool set\", \"pool\": \"" +
+    pool_name + "\", \"var\": \"replica_reads\", \"val\": \"false\"}";
+  cmds[0] = cmd.c_str();
+  ASSERT_EQ(0, rados_mon_command(cluster, cmds, 1, "", 0, &buf, &buflen,
+				 &st, &stlen));
+  rados_buffer_free(buf);
+  rados_buffer_free(st);
+}
+
 TEST_F(LibRadosWatchNotify, AioWatchNotify2) {
   notify_io = ioctx;
   notify_oid = "foo";
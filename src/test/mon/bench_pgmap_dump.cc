@@ -0,0 +1,108 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "common/ceph_argparse.h"
+#include "common/ceph_time.h"
+#include "common/Formatter.h"
+#include "global/global_context.h"
+#include "global/global_init.h"
+#include "mon/PGMap.h"
+
+using namespace std;
+
+static void usage(const char *name)
+{
+  cout << name << " [num_pgs [num_osds [reps]]]\n"
+       << "\t num_pgs: pgs in the map, default 100000\n"
+       << "\t num_osds: osds in the map, default 1000\n"
+       << "\t reps: best of this many runs, default 3\n";
+}
+
+int main(int argc, const char **argv)
+{
+  auto args = argv_to_vec(argc, argv);
+  auto cct = global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+  common_init_finish(g_ceph_context);
+
+  if (!args.empty() && (string(args[0]) == "-h" ||
+			string(args[0]) == "--help")) {
+    usage(argv[0]);
+    return 0;
+  }
+  int num_pgs = args.size() > 0 ? atoi(args[0]) : 100000;
+  int num_osds = args.size() > 1 ? atoi(args[1]) : 1000;
+  int reps = args.size() > 2 ? atoi(args[2]) : 3;
+  if (num_pgs <= 0 || num_osds < 3 || reps <= 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  const utime_t now = ceph_clock_now();
+  PGMap::Incremental inc;
+  inc.version = 1;
+  inc.osdmap_epoch = 1;
+  inc.stamp = now;
+  for (int osd = 0; osd < num_osds; ++osd) {
+    osd_stat_t st;
+    st.statfs.total = 4ull << 40;
+    st.statfs.available = 3ull << 40;
+    st.statfs.allocated = 1ull << 40;
+    st.up_from = 1;
+    st.seq = osd;
+    for (int i = 1; i <= 8; ++i) {
+      st.hb_peers.push_back((osd + i) % num_osds);
+    }
+    inc.update_stat(osd, std::move(st));
+  }
+  const int num_pools = 4;
+  for (int i = 0; i < num_pgs; ++i) {
+    pg_stat_t s;
+    s.version = eversion_t(1, i);
+    s.reported_seq = i;
+    s.reported_epoch = 1;
+    s.state = PG_STATE_ACTIVE | PG_STATE_CLEAN;
+    s.last_fresh = s.last_change = s.last_active = s.last_peered =
+      s.last_clean = s.last_unstale = s.last_undegraded =
+      s.last_fullsized = s.last_scrub_stamp = s.last_deep_scrub_stamp =
+      s.last_clean_scrub_stamp = now;
+    for (int r = 0; r < 3; ++r) {
+      s.up.push_back((i + r * 7) % num_osds);
+    }
+    s.acting = s.up;
+    s.up_primary = s.acting_primary = s.up[0];
+    s.stats.sum.num_bytes = 4ull << 30;
+    s.stats.sum.num_objects = 1024 + i % 100;
+    s.stats.sum.num_rd = s.stats.sum.num_wr = i;
+    s.log_size = s.ondisk_log_size = 3000;
+    inc.pg_stat_updates[pg_t(i / num_pools, i % num_pools + 1)] = s;
+  }
+  PGMap pg_map;
+  pg_map.apply_incremental(g_ceph_context, inc);
+
+  cout << num_pgs << " pgs, " << num_osds << " osds" << std::endl;
+  for (auto type : {"json", "json-pretty", "xml"}) {
+    double best = 0;
+    size_t len = 0;
+    for (int i = 0; i < reps; ++i) {
+      auto start = ceph::mono_clock::now();
+      std::unique_ptr<Formatter> f(Formatter::create(type));
+      pg_map.dump(f.get());
+      bufferlist bl;
+      f->flush(bl);
+      double secs = ceph::to_seconds<double>(ceph::mono_clock::now() - start);
+      if (!best || secs < best) {
+	best = secs;
+      }
+      len = bl.length();
+    }
+    cout << type << "\t" << (len >> 20) << " MB\t" << best << " s\t"
+	 << (uint64_t)(len / best / (1024 * 1024)) << " MB/s" << std::endl;
+  }
+  return 0;
+}
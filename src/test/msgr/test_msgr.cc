@@ -40,6 +40,7 @@
 #include "msg/Message.h"
 #include "msg/Messenger.h"
 #include "msg/msg_types.h"
+#include "msg/async/AsyncMessenger.h"
 
 typedef boost::mt11213b gen_type;
 
@@ -93,6 +94,17 @@ class MessengerTest : public ::testing::TestWithParam<const char*> {
     delete client_msgr;
   }
 
+  // see AsyncConnection::request_migration()
+  static Worker *get_worker(const ConnectionRef& con) {
+    return static_cast<AsyncConnection*>(con.get())->get_worker();
+  }
+  static void migrate(const ConnectionRef& con, Worker *target) {
+    for (int n = 0; n < 1000 && get_worker(con) != target; n++) {
+      // declined while timers or a delayed delivery are pending; retry
+      static_cast<AsyncConnection*>(con.get())->request_migration(target);
+      usleep(1000);
+    }
+  }
 };
 
 
@@ -976,6 +988,71 @@ TEST_P(MessengerTest, SimpleTest) {
   server_msgr->wait();
 }
 
+TEST_P(MessengerTest, MigrateTest) {
+  FakeDispatcher cli_dispatcher(false), srv_dispatcher(true);
+  entity_addr_t bind_addr;
+  bind_addr.parse("v2:127.0.0.1");
+  server_msgr->bind(bind_addr);
+  server_msgr->add_dispatcher_head(&srv_dispatcher);
+  server_msgr->start();
+
+  client_msgr->add_dispatcher_head(&cli_dispatcher);
+  client_msgr->start();
+
+  auto stack = static_cast<AsyncMessenger*>(client_msgr)->get_stack();
+  if (!stack->support_migration() || stack->get_num_worker() < 2) {
+    client_msgr->shutdown();
+    client_msgr->wait();
+    server_msgr->shutdown();
+    server_msgr->wait();
+    GTEST_SKIP() << "network stack cannot migrate connections";
+  }
+
+  ConnectionRef srv_conn;
+  srv_dispatcher.last_accept_con_ptr = &srv_conn;
+  ConnectionRef conn = client_msgr->connect_to(server_msgr->get_mytype(),
+					       server_msgr->get_myaddrs());
+  {
+    ASSERT_EQ(conn->send_message(new MPing()), 0);
+    std::unique_lock l{cli_dispatcher.lock};
+    cli_dispatcher.cond.wait(l, [&] { return cli_dispatcher.got_new; });
+    cli_dispatcher.got_new = false;
+  }
+  ASSERT_TRUE(srv_conn);
+
+  // move both ends between workers while pings and replies are in flight
+  constexpr unsigned rounds = 20;
+  constexpr unsigned per_round = 50;
+  const unsigned workers = stack->get_num_worker();
+  for (unsigned i = 0; i < rounds; i++) {
+    for (unsigned j = 0; j < per_round; j++) {
+      ASSERT_EQ(conn->send_message(new MPing()), 0);
+    }
+    auto& moved = i % 2 ? srv_conn : conn;
+    Worker *target = stack->get_worker((get_worker(moved)->id + 1) % workers);
+    migrate(moved, target);
+    ASSERT_EQ(target, get_worker(moved));
+  }
+  {
+    std::unique_lock l{cli_dispatcher.lock};
+    cli_dispatcher.cond.wait(l, [&] {
+      return static_cast<Session*>(conn->get_priv().get())->get_count() ==
+	1 + rounds * per_round;
+    });
+  }
+  ASSERT_TRUE(conn->is_connected());
+  ASSERT_TRUE(srv_conn->is_connected());
+  ASSERT_EQ(1u + rounds * per_round,
+	    static_cast<Session*>(srv_conn->get_priv().get())->get_count());
+
+  srv_dispatcher.last_accept_con_ptr = nullptr;
+  srv_conn.reset();
+  client_msgr->shutdown();
+  client_msgr->wait();
+  server_msgr->shutdown();
+  server_msgr->wait();
+}
+
 TEST_P(MessengerTest, SimpleMsgr2Test) {
   FakeDispatcher cli_dispatcher(false), srv_dispatcher(true);
   entity_addr_t legacy_addr;
@@ -1583,6 +1660,96 @@ TEST_P(MessengerTest, MessageTest) {
   client_msgr->wait();
 }
 
+// keeps the data of every ping it receives, in arrival order
+class DataDispatcher : public Dispatcher {
+ public:
+  ceph::mutex lock = ceph::make_mutex("DataDispatcher::lock");
+  ceph::condition_variable cond;
+  std::vector<bufferlist> received;
+
+  DataDispatcher() : Dispatcher(g_ceph_context) {}
+  bool ms_can_fast_dispatch_any() const override { return true; }
+  bool ms_can_fast_dispatch(const Message *m) const override {
+    return m->get_type() == CEPH_MSG_PING;
+  }
+  void ms_fast_dispatch(Message *m) override {
+    std::lock_guard l{lock};
+    received.push_back(m->get_data());
+    m->put();
+    cond.notify_all();
+  }
+  bool ms_dispatch(Message *m) override {
+    m->put();
+    return true;
+  }
+  bool ms_handle_reset(Connection *con) override { return true; }
+  void ms_handle_remote_reset(Connection *con) override {}
+  bool ms_handle_refused(Connection *con) override { return false; }
+};
+
+static bufferlist make_batch_payload(unsigned seq)
+{
+  // sizes straddle ms_async_zerocopy_min_bytes, so a batch mixes copied
+  // and MSG_ZEROCOPY chunks
+  bufferptr bp(1 + (seq * 7919) % (128 << 10));
+  for (unsigned i = 0; i < bp.length(); i++) {
+    bp.c_str()[i] = static_cast<char>(seq * 31 + i);
+  }
+  bufferlist bl;
+  bl.append(std::move(bp));
+  return bl;
+}
+
+TEST_P(MessengerTest, SendBatchZeroCopyTest) {
+  if (string(GetParam()) != "async+posix") {
+    GTEST_SKIP() << "MSG_ZEROCOPY is only used by the posix stack";
+  }
+  g_ceph_context->_conf.set_val("ms_async_zerocopy_min_bytes", "4096");
+  g_ceph_context->_conf.set_val("ms_async_send_batch_bytes", "1048576");
+  g_ceph_context->_conf.set_val("ms_async_send_batch_max_us", "1000");
+  FakeDispatcher cli_dispatcher(false);
+  DataDispatcher srv_dispatcher;
+  entity_addr_t bind_addr;
+  bind_addr.parse("v2:127.0.0.1");
+  server_msgr->bind(bind_addr);
+  server_msgr->add_dispatcher_head(&srv_dispatcher);
+  server_msgr->start();
+  client_msgr->add_dispatcher_head(&cli_dispatcher);
+  client_msgr->start();
+
+  // queue everything back to back so that write_event() coalesces the
+  // frames; the senders drop their references right away, so only the
+  // zerocopy pinning keeps the payload alive until the kernel is done
+  constexpr unsigned count = 1000;
+  ConnectionRef conn = client_msgr->connect_to(server_msgr->get_mytype(),
+					       server_msgr->get_myaddrs());
+  for (unsigned i = 0; i < count; i++) {
+    MPing *m = new MPing();
+    m->set_data(make_batch_payload(i));
+    ASSERT_EQ(conn->send_message(m), 0);
+  }
+  {
+    std::unique_lock l{srv_dispatcher.lock};
+    srv_dispatcher.cond.wait_for(l, 60s, [&] {
+      return srv_dispatcher.received.size() >= count;
+    });
+    ASSERT_EQ(count, srv_dispatcher.received.size());
+    for (unsigned i = 0; i < count; i++) {
+      ASSERT_TRUE(srv_dispatcher.received[i].contents_equal(
+		    make_batch_payload(i))) << "message " << i;
+    }
+  }
+  ASSERT_TRUE(conn->is_connected());
+
+  client_msgr->shutdown();
+  client_msgr->wait();
+  server_msgr->shutdown();
+  server_msgr->wait();
+  g_ceph_context->_conf.set_val("ms_async_zerocopy_min_bytes", "0");
+  g_ceph_context->_conf.set_val("ms_async_send_batch_bytes", "262144");
+  g_ceph_context->_conf.set_val("ms_async_send_batch_max_us", "50");
+}
+
 
 class SyntheticWorkload;
 
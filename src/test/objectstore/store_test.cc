@@ -2132,6 +2132,79 @@ TEST_P(StoreTestSpecificAUSize, BluestoreStatFSTest) {
   }
 }
 
+TEST_P(StoreTestSpecificAUSize, BluestoreKVSyncLanes) {
+  if (string(GetParam()) != "bluestore")
+    return;
+  SetVal(g_conf(), "bluestore_kv_sync_lanes", "4");
+  // small preallocations so that lanes race on {nid,blobid}_max updates
+  SetVal(g_conf(), "bluestore_nid_prealloc", "8");
+  SetVal(g_conf(), "bluestore_blobid_prealloc", "8");
+  StartDeferred(4096);
+
+  const int num_colls = 8, num_objs = 32;
+  vector<coll_t> cids;
+  vector<ObjectStore::CollectionHandle> chs;
+  for (int i = 0; i < num_colls; ++i) {
+    coll_t cid(spg_t(pg_t(i, 1), shard_id_t::NO_SHARD));
+    auto ch = store->create_new_collection(cid);
+    ObjectStore::Transaction t;
+    t.create_collection(cid, 0);
+    ASSERT_EQ(0, queue_transaction(store, ch, std::move(t)));
+    cids.push_back(cid);
+    chs.push_back(ch);
+  }
+  auto make_obj = [](int i, int j) {
+    return ghobject_t(hobject_t(sobject_t("obj." + stringify(i) + "." +
+					  stringify(j), CEPH_NOSNAP)));
+  };
+  auto make_data = [](int i, int j) {
+    bufferlist bl;
+    bl.append(string(1000 + j * 100, 'a' + (i + j) % 26));
+    return bl;
+  };
+  // interleave collections so every lane is busy at once
+  for (int j = 0; j < num_objs; ++j) {
+    for (int i = 0; i < num_colls; ++i) {
+      ObjectStore::Transaction t;
+      bufferlist bl = make_data(i, j);
+      t.write(cids[i], make_obj(i, j), 0, bl.length(), bl);
+      store->queue_transaction(chs[i], std::move(t));
+    }
+  }
+  // overwrite in place (deferred) and check ordering within a collection
+  for (int i = 0; i < num_colls; ++i) {
+    ObjectStore::Transaction t;
+    bufferlist bl;
+    bl.append(string(100, 'Z'));
+    t.write(cids[i], make_obj(i, 0), 0, bl.length(), bl);
+    ASSERT_EQ(0, queue_transaction(store, chs[i], std::move(t)));
+  }
+
+  chs.clear();
+  ASSERT_EQ(0, store->umount());
+  ASSERT_EQ(0, store->mount());
+
+  for (int i = 0; i < num_colls; ++i) {
+    auto ch = store->open_collection(cids[i]);
+    for (int j = 0; j < num_objs; ++j) {
+      bufferlist expected = make_data(i, j);
+      if (j == 0) {
+	bufferlist head;
+	head.append(string(100, 'Z'));
+	bufferlist rest;
+	rest.substr_of(expected, 100, expected.length() - 100);
+	expected.clear();
+	expected.append(head);
+	expected.append(rest);
+      }
+      bufferlist actual;
+      ASSERT_EQ((int)expected.length(),
+		store->read(ch, make_obj(i, j), 0, expected.length(), actual));
+      ASSERT_TRUE(bl_eq(expected, actual));
+    }
+  }
+}
+
 TEST_P(StoreTestSpecificAUSize, BluestoreFragmentedBlobTest) {
   if(string(GetParam()) != "bluestore")
     return;
@@ -172,6 +172,55 @@ TEST(BlueFS, small_appends) {
   fs.umount();
 }
 
+#if defined(HAVE_BLUESTORE_PMEM)
+TEST(BlueFS, pmem_direct_write) {
+  ConfSaver conf(g_ceph_context->_conf);
+  conf.SetVal("bluefs_pmem_direct_write", "true");
+  conf.ApplyChanges();
+  // bdev_type has no valid value to restore, so ConfSaver can't handle it
+  g_ceph_context->_conf.set_val_or_die("bdev_type", "pmem");
+  auto reset_bdev_type = make_scope_guard([] {
+    g_ceph_context->_conf.rm_val("bdev_type");
+  });
+
+  uint64_t size = 1048576 * 128;
+  TempBdev bdev{size};
+  uuid_d fsid;
+  string expected;
+  {
+    BlueFS fs(g_ceph_context);
+    ASSERT_EQ(0, fs.add_block_device(BlueFS::BDEV_DB, bdev.path, false, 1048576));
+    ASSERT_EQ(0, fs.mkfs(fsid, { BlueFS::BDEV_DB, false, false }));
+    ASSERT_EQ(0, fs.mount());
+    BlueFS::FileWriter *h;
+    ASSERT_EQ(0, fs.mkdir("dir"));
+    ASSERT_EQ(0, fs.open_for_write("dir", "file", &h, false));
+    // appends of odd sizes land at offsets that are not block aligned
+    for (unsigned i = 0; i < 1000; ++i) {
+      string s = "record " + stringify(i) + string(i % 37, 'x') + "\n";
+      h->append(s.c_str(), s.length());
+      ASSERT_EQ(0, fs.fsync(h));
+      expected += s;
+    }
+    fs.close_writer(h);
+    fs.umount();
+  }
+  {
+    BlueFS fs(g_ceph_context);
+    ASSERT_EQ(0, fs.add_block_device(BlueFS::BDEV_DB, bdev.path, false, 1048576));
+    ASSERT_EQ(0, fs.mount());
+    BlueFS::FileReader *h;
+    ASSERT_EQ(0, fs.open_for_read("dir", "file", &h));
+    bufferlist bl;
+    ASSERT_EQ((int)expected.length(),
+	      fs.read(h, 0, expected.length() * 2, &bl, NULL));
+    ASSERT_EQ(expected, bl.to_str());
+    delete h;
+    fs.umount();
+  }
+}
+#endif
+
 TEST(BlueFS, very_large_write) {
   // we'll write a ~5G file, so allocate more than that for the whole fs
   uint64_t size = 1048576 * 1024 * 6ull;
@@ -0,0 +1,171 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <gtest/gtest.h>
+#include "global/global_init.h"
+#include "global/global_context.h"
+#include "common/ceph_argparse.h"
+#include "include/stringify.h"
+
+#include "os/bluestore/PMEMDeferredRing.h"
+
+using namespace std;
+
+class PMEMDeferredRingTest : public ::testing::Test {
+public:
+  static constexpr uint64_t size = 1 << 20;
+  string path;
+  uuid_d fsid;
+
+  void SetUp() override {
+    path = "ceph_test_pmem_deferred_ring.tmp." + stringify(getpid());
+    int fd = ::open(path.c_str(), O_CREAT|O_RDWR|O_TRUNC, 0644);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(0, ::ftruncate(fd, size));
+    ::close(fd);
+    fsid.generate_random();
+  }
+  void TearDown() override {
+    ::unlink(path.c_str());
+  }
+
+  static bufferlist make_payload(uint32_t len, char c) {
+    bufferlist bl;
+    bl.append(string(len, c));
+    return bl;
+  }
+};
+
+TEST_F(PMEMDeferredRingTest, append_read_release)
+{
+  PMEMDeferredRing ring(g_ceph_context);
+  ASSERT_EQ(0, ring.open(path, fsid, true));
+
+  uint64_t off1, off2;
+  uint32_t len1, len2;
+  ASSERT_TRUE(ring.append(1, make_payload(4096, 'a'), &off1, &len1));
+  ASSERT_TRUE(ring.append(2, make_payload(8192, 'b'), &off2, &len2));
+  ASSERT_NE(off1, off2);
+  ASSERT_EQ(4096u, len1);
+  ASSERT_GT(ring.get_used(), 0u);
+
+  bufferlist bl;
+  ASSERT_EQ(0, ring.read(2, off2, len2, &bl));
+  ASSERT_TRUE(bl.contents_equal(make_payload(8192, 'b')));
+  // wrong seq: the record must not be accepted
+  ASSERT_EQ(-EIO, ring.read(1, off2, len2, &bl));
+
+  // out of order release only frees space once the head is released
+  ring.release(off2);
+  ASSERT_GT(ring.get_used(), 0u);
+  ring.release(off1);
+  ASSERT_EQ(0u, ring.get_used());
+  ring.close();
+}
+
+TEST_F(PMEMDeferredRingTest, full_and_wrap)
+{
+  PMEMDeferredRing ring(g_ceph_context);
+  ASSERT_EQ(0, ring.open(path, fsid, true));
+
+  // larger than a quarter of the ring: never staged
+  uint64_t off;
+  uint32_t len;
+  ASSERT_FALSE(ring.append(1, make_payload(ring.get_size() / 2, 'x'),
+			   &off, &len));
+
+  const uint32_t chunk = ring.get_size() / 5;
+  deque<uint64_t> live;
+  uint64_t seq = 1;
+  while (ring.append(seq, make_payload(chunk, 'a' + seq % 26), &off, &len)) {
+    live.push_back(off);
+    ++seq;
+  }
+  ASSERT_GT(live.size(), 1u);
+
+  // wrap around a few times, always releasing the oldest record
+  for (int i = 0; i < 20; ++i) {
+    ring.release(live.front());
+    live.pop_front();
+    ASSERT_TRUE(ring.append(seq, make_payload(chunk, 'a' + seq % 26),
+			    &off, &len));
+    bufferlist bl;
+    ASSERT_EQ(0, ring.read(seq, off, len, &bl));
+    ASSERT_TRUE(bl.contents_equal(make_payload(chunk, 'a' + seq % 26)));
+    live.push_back(off);
+    ++seq;
+  }
+  ring.close();
+}
+
+TEST_F(PMEMDeferredRingTest, reopen)
+{
+  uint64_t off;
+  uint32_t len;
+  {
+    PMEMDeferredRing ring(g_ceph_context);
+    ASSERT_EQ(0, ring.open(path, fsid, true));
+    ASSERT_TRUE(ring.append(7, make_payload(1000, 'z'), &off, &len));
+    ring.close();
+  }
+  {
+    // records survive a restart
+    PMEMDeferredRing ring(g_ceph_context);
+    ASSERT_EQ(0, ring.open(path, fsid, false));
+    bufferlist bl;
+    ASSERT_EQ(0, ring.read(7, off, len, &bl));
+    ASSERT_TRUE(bl.contents_equal(make_payload(1000, 'z')));
+    ring.close();
+  }
+  {
+    // but not for another store
+    uuid_d other;
+    other.generate_random();
+    PMEMDeferredRing ring(g_ceph_context);
+    ASSERT_EQ(-EINVAL, ring.open(path, other, false));
+  }
+}
+
+#if defined(HAVE_BLUESTORE_PMEM)
+TEST_F(PMEMDeferredRingTest, pmem_device)
+{
+  // records are cache line aligned on pmem, not block aligned
+  g_ceph_context->_conf.set_val_or_die("bdev_type", "pmem");
+  PMEMDeferredRing ring(g_ceph_context);
+  ASSERT_EQ(0, ring.open(path, fsid, true));
+  vector<pair<uint64_t, uint32_t>> recs;
+  for (uint64_t seq = 1; seq <= 10; ++seq) {
+    uint64_t off;
+    uint32_t len;
+    ASSERT_TRUE(ring.append(seq, make_payload(100 * seq + 1, 'a' + seq),
+			    &off, &len));
+    recs.emplace_back(off, len);
+  }
+  for (uint64_t seq = 1; seq <= 10; ++seq) {
+    bufferlist bl;
+    auto [off, len] = recs[seq - 1];
+    ASSERT_EQ(0, ring.read(seq, off, len, &bl));
+    ASSERT_TRUE(bl.contents_equal(make_payload(100 * seq + 1, 'a' + seq)));
+  }
+  ring.close();
+  g_ceph_context->_conf.rm_val("bdev_type");
+}
+#endif
+
+int main(int argc, char **argv) {
+  auto args = argv_to_vec(argc, argv);
+  map<string,string> defaults = {
+    { "debug_bluestore", "1/20" },
+    { "debug_bdev", "1/20" }
+  };
+
+  auto cct = global_init(&defaults, args, CEPH_ENTITY_TYPE_CLIENT,
+			 CODE_ENVIRONMENT_UTILITY,
+			 CINIT_FLAG_NO_DEFAULT_CONFIG_FILE);
+  common_init_finish(g_ceph_context);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
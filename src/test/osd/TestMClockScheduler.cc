@@ -171,3 +171,71 @@ TEST_F(mClockSchedulerTest, TestMultiClientOrderedEnqueueDequeue) {
   }
   ASSERT_TRUE(q.empty());
 }
+
+TEST(mClockCalibrationTest, Buckets) {
+  ASSERT_EQ(0u, mClockCalibration::size_bucket(0));
+  ASSERT_EQ(0u, mClockCalibration::size_bucket(4096));
+  ASSERT_EQ(1u, mClockCalibration::size_bucket(4097));
+  ASSERT_EQ(1u, mClockCalibration::size_bucket(8192));
+  ASSERT_EQ(mClockCalibration::NUM_SIZE_BUCKETS - 1,
+	    mClockCalibration::size_bucket(1ull << 40));
+
+  for (uint64_t us : {0ull, 1ull, 3ull, 4ull, 5ull, 7ull, 8ull, 100ull,
+		      999ull, 12345ull, 1000000ull}) {
+    unsigned b = mClockCalibration::latency_bucket(us);
+    ASSERT_LT(b, mClockCalibration::NUM_LATENCY_BUCKETS);
+    ASSERT_LT(us, mClockCalibration::latency_bucket_max(b));
+    if (b > 0) {
+      ASSERT_GE(us, mClockCalibration::latency_bucket_max(b - 1));
+    }
+  }
+}
+
+TEST(mClockCalibrationTest, FitAndBoost) {
+  auto& conf = g_ceph_context->_conf;
+  conf.set_val_or_die("osd_mclock_cost_calibration", "true");
+  conf.set_val_or_die("osd_mclock_scheduler_client_latency_target", "1");
+  conf.apply_changes(nullptr);
+
+  mClockCalibration cal(g_ceph_context);
+  auto t = ceph::mono_time{} + std::chrono::seconds(1);
+  cal.maybe_update(t);
+  ASSERT_EQ(0, cal.get_cost_per_io(op_scheduler_class::client));
+  ASSERT_EQ(1.0, cal.get_reservation_boost(op_scheduler_class::client));
+
+  // 100us per io plus 1us per 1000 bytes: a 100000 byte cost per io,
+  // and a p99 latency well over the 1ms target
+  for (uint64_t size = 4000; size <= 1024000; size *= 2) {
+    for (unsigned i = 0; i < 200; ++i) {
+      cal.record(op_scheduler_class::client, size,
+		 std::chrono::microseconds(100 + size / 1000),
+		 std::chrono::milliseconds(5));
+    }
+  }
+  uint64_t gen = cal.get_generation();
+  // not due yet
+  ASSERT_FALSE(cal.maybe_update(t + std::chrono::seconds(1)));
+  ASSERT_TRUE(cal.maybe_update(t + std::chrono::seconds(10)));
+  ASSERT_NE(gen, cal.get_generation());
+  ASSERT_NEAR(100000, cal.get_cost_per_io(op_scheduler_class::client), 1);
+  ASSERT_GT(cal.get_reservation_boost(op_scheduler_class::client), 1.0);
+  // classes without samples or targets are left alone
+  ASSERT_EQ(0, cal.get_cost_per_io(op_scheduler_class::background_recovery));
+  ASSERT_EQ(1.0, cal.get_reservation_boost(
+	      op_scheduler_class::background_recovery));
+
+  // the scheduler prices client ops with the estimate, kept within 4x of
+  // the configured cost
+  mClockScheduler q(g_ceph_context, 0, 1, 0, false, nullptr, &cal);
+  q.enqueue(create_item(100, 1001, op_scheduler_class::client));
+  get_item(q.dequeue());
+  double base = q.calc_scaled_cost(1);
+  ASSERT_EQ(base, q.calc_scaled_cost(
+	      1, op_scheduler_class::background_recovery));
+  ASSERT_NEAR(std::clamp(100000.0, base / 4, base * 4),
+	      q.calc_scaled_cost(1, op_scheduler_class::client), 4);
+
+  conf.set_val_or_die("osd_mclock_cost_calibration", "false");
+  conf.set_val_or_die("osd_mclock_scheduler_client_latency_target", "0");
+  conf.apply_changes(nullptr);
+}
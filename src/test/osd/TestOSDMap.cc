@@ -255,6 +255,19 @@ TEST_F(OSDMapTest, Features) {
   ASSERT_TRUE(features & CEPH_FEATURE_OSDHASHPSPOOL);
   ASSERT_TRUE(features & CEPH_FEATURE_OSD_PRIMARY_AFFINITY);
 
+  // cuckoo hit sets are required of everyone, since the pool won't decode
+  ASSERT_FALSE(HAVE_FEATURE(features, OSD_HITSET_CUCKOO));
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    auto& pool = inc.new_pools[my_rep_pool] = *osdmap.get_pg_pool(my_rep_pool);
+    pool.hit_set_params = HitSet::Params(new CuckooHitSet::Params);
+    osdmap.apply_incremental(inc);
+  }
+  features = osdmap.get_features(CEPH_ENTITY_TYPE_OSD, NULL);
+  ASSERT_TRUE(HAVE_FEATURE(features, OSD_HITSET_CUCKOO));
+  features = osdmap.get_features(CEPH_ENTITY_TYPE_CLIENT, NULL);
+  ASSERT_TRUE(HAVE_FEATURE(features, OSD_HITSET_CUCKOO));
+
   // FIXME: test tiering feature bits
 }
 
@@ -306,6 +319,41 @@ TEST_F(OSDMapTest, MapFunctionsMatch) {
 
 /** This test must be removed or modified appropriately when we allow
  * other ways to specify a primary. */
+TEST_F(OSDMapTest, MapPGRange) {
+  set_up_map();
+
+  // a pg_temp and a marked-out osd, so every stage of the mapping matters
+  pg_t temp_pgid = osdmap.raw_pg_to_pg(pg_t(3, my_rep_pool));
+  vector<int> temp_acting;
+  osdmap.pg_to_acting_osds(temp_pgid, temp_acting);
+  std::reverse(temp_acting.begin(), temp_acting.end());
+  OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+  inc.new_pg_temp[temp_pgid] = mempool::osdmap::vector<int>(
+    temp_acting.begin(), temp_acting.end());
+  inc.new_weight[1] = CEPH_OSD_OUT;
+  osdmap.apply_incremental(inc);
+
+  for (int64_t pool : { my_ec_pool, my_rep_pool }) {
+    unsigned pg_num = osdmap.get_pg_pool(pool)->get_pg_num();
+    vector<vector<int>> up, acting;
+    vector<int> up_primary, acting_primary;
+    osdmap.pg_range_to_up_acting_osds(pool, 0, pg_num,
+				      &up, &up_primary,
+				      &acting, &acting_primary);
+    ASSERT_EQ(pg_num, up.size());
+    for (unsigned ps = 0; ps < pg_num; ++ps) {
+      vector<int> one_up, one_acting;
+      int one_up_primary, one_acting_primary;
+      osdmap.pg_to_up_acting_osds(pg_t(ps, pool), &one_up, &one_up_primary,
+				  &one_acting, &one_acting_primary);
+      EXPECT_EQ(one_up, up[ps]);
+      EXPECT_EQ(one_up_primary, up_primary[ps]);
+      EXPECT_EQ(one_acting, acting[ps]);
+      EXPECT_EQ(one_acting_primary, acting_primary[ps]);
+    }
+  }
+}
+
 TEST_F(OSDMapTest, PrimaryIsFirst) {
   set_up_map();
 
@@ -370,6 +418,169 @@ TEST_F(OSDMapTest, PrimaryTempRespected) {
   EXPECT_EQ(acting_primary, acting_osds[1]);
 }
 
+TEST_F(OSDMapTest, MappingChanges) {
+  set_up_map();
+
+  pg_t pgid = osdmap.raw_pg_to_pg(pg_t(0, my_rep_pool));
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_pg_temp[pgid] = mempool::osdmap::vector<int>({2, 1, 0});
+    osdmap.apply_incremental(inc);
+    auto& changes = osdmap.get_mapping_changes();
+    ASSERT_FALSE(changes.all);
+    ASSERT_TRUE(changes.pools.empty());
+    ASSERT_EQ(set<pg_t>{pgid}, changes.pgs);
+  }
+  {
+    // a pool update that does not move anything
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    pg_pool_t *p = inc.get_new_pool(my_rep_pool,
+				    osdmap.get_pg_pool(my_rep_pool));
+    p->snap_seq = snapid_t(10);
+    osdmap.apply_incremental(inc);
+    ASSERT_TRUE(osdmap.get_mapping_changes().empty());
+  }
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    pg_pool_t *p = inc.get_new_pool(my_rep_pool,
+				    osdmap.get_pg_pool(my_rep_pool));
+    p->set_pgp_num(32);
+    osdmap.apply_incremental(inc);
+    ASSERT_EQ(set<int64_t>{my_rep_pool}, osdmap.get_mapping_changes().pools);
+  }
+  {
+    // every pool's rule can reach osd.1
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_weight[1] = CEPH_OSD_OUT;
+    osdmap.apply_incremental(inc);
+    auto& changes = osdmap.get_mapping_changes();
+    ASSERT_FALSE(changes.all);
+    ASSERT_EQ(osdmap.get_pools().size(), changes.pools.size());
+    ASSERT_TRUE(changes.pgs.empty());
+  }
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_max_osd = osdmap.get_max_osd() + 1;
+    osdmap.apply_incremental(inc);
+    ASSERT_TRUE(osdmap.get_mapping_changes().all);
+  }
+}
+
+TEST_F(OSDMapTest, IncrementalMapping) {
+  set_up_map();
+
+  ThreadPool tp(g_ceph_context, "IncrementalMapping::tp", "mapping_tp", 4);
+  ParallelPGMapper mapper(g_ceph_context, &tp);
+  tp.start();
+  auto check = [&]() {
+    for (auto& [poolid, pool] : osdmap.get_pools()) {
+      for (unsigned ps = 0; ps < pool.get_pg_num(); ++ps) {
+	pg_t pgid(ps, poolid);
+	vector<int> up, acting, up2, acting2;
+	int up_primary, acting_primary, up_primary2, acting_primary2;
+	osdmap.pg_to_up_acting_osds(pgid, &up, &up_primary,
+				    &acting, &acting_primary);
+	mapping.get(pgid, &up2, &up_primary2, &acting2, &acting_primary2);
+	ASSERT_EQ(up, up2) << pgid;
+	ASSERT_EQ(up_primary, up_primary2) << pgid;
+	ASSERT_EQ(acting, acting2) << pgid;
+	ASSERT_EQ(acting_primary, acting_primary2) << pgid;
+      }
+    }
+  };
+  auto remap = [&]() {
+    auto job = mapping.start_update(osdmap, mapper, 16,
+				    osdmap.get_mapping_changes());
+    job->wait();
+    ASSERT_EQ(osdmap.get_epoch(), mapping.get_epoch());
+  };
+  remap();
+  check();
+
+  pg_t pga = osdmap.raw_pg_to_pg(pg_t(3, my_rep_pool));
+  vector<int> up;
+  int up_primary;
+  osdmap.pg_to_raw_up(pga, &up, &up_primary);
+  int spare = 0;
+  while (std::find(up.begin(), up.end(), spare) != up.end()) {
+    ++spare;
+  }
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_pg_upmap_items[pga] =
+      mempool::osdmap::vector<pair<int32_t,int32_t>>({{up[0], spare}});
+    osdmap.apply_incremental(inc);
+  }
+  remap();
+  check();
+  ASSERT_EQ(vector<pg_t>{pga}, mapping.get_changed_pgs());
+
+  {
+    // nothing to do
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    osdmap.apply_incremental(inc);
+  }
+  remap();
+  check();
+  ASSERT_TRUE(mapping.get_changed_pgs().empty());
+
+  {
+    // the upmap target goes out
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_weight[spare] = CEPH_OSD_OUT;
+    pg_t pgb = osdmap.raw_pg_to_pg(pg_t(5, my_ec_pool));
+    inc.new_pg_temp[pgb] = mempool::osdmap::vector<int>({0, 1, 2});
+    inc.new_primary_temp[pgb] = 1;
+    osdmap.apply_incremental(inc);
+  }
+  remap();
+  check();
+  ASSERT_FALSE(mapping.get_changed_pgs().empty());
+
+  {
+    OSDMap::Incremental inc(osdmap.get_epoch() + 1);
+    inc.new_weight[spare] = CEPH_OSD_IN;
+    inc.new_primary_affinity[0] = 0;
+    pg_pool_t *p = inc.get_new_pool(my_rep_pool,
+				    osdmap.get_pg_pool(my_rep_pool));
+    p->set_pg_num(128);
+    p->set_pgp_num(128);
+    osdmap.apply_incremental(inc);
+  }
+  remap();
+  check();
+  tp.stop();
+}
+
+TEST_F(OSDMapTest, PGTempMapCompaction) {
+  PGTempMap m;
+  for (unsigned round = 0; round < 10; ++round) {
+    for (unsigned i = 0; i < 100; ++i) {
+      mempool::osdmap::vector<int32_t> v(1 + (i + round) % 4, round);
+      m.set(pg_t(i, 1), v);
+    }
+    for (unsigned i = 0; i < 100; i += 3) {
+      m.erase(pg_t(i + round % 3, 1));
+    }
+    m.compact();
+    // compaction must leave the contents alone
+    PGTempMap copy(m);
+    copy.rebuild();
+    ASSERT_TRUE(m == copy);
+    ASSERT_TRUE(m.dead == 0 || m.dead * 2 < m.data.length());
+    for (unsigned i = 0; i < 100; ++i) {
+      pg_t pgid(i, 1);
+      if ((i - round % 3) % 3 == 0 && i >= round % 3) {
+	ASSERT_EQ(0u, m.count(pgid));
+      } else {
+	auto p = m.find(pgid);
+	ASSERT_EQ(1 + (i + round) % 4, p->second.size());
+	ASSERT_EQ((int)round, p->second[0]);
+      }
+    }
+  }
+}
+
 TEST_F(OSDMapTest, CleanTemps) {
   set_up_map();
 
@@ -3244,6 +3244,205 @@ TEST_F(PGLogTrimTest, TestCopyAfter2) {
   EXPECT_EQ(7u, copy.dups.size()) << copy;
 }
 
+class PGLogSegmentTest : protected PGLog, public StoreTestFixture,
+			 public PGLogTestBase {
+public:
+  PGLogSegmentTest() : PGLog(g_ceph_context), StoreTestFixture("memstore") {}
+
+  void SetUp() override {
+    StoreTestFixture::SetUp();
+    test_coll = coll_t(spg_t(pg_t(1, 1)));
+    ch = store->create_new_collection(test_coll);
+    ObjectStore::Transaction t;
+    t.create_collection(test_coll, 0);
+    store->queue_transaction(ch, std::move(t));
+    info.pgid = spg_t(pg_t(1, 1));
+    log_oid = info.pgid.make_pgmeta_oid();
+    set_segment_entries(4);
+    g_ceph_context->_conf.set_val_or_die("osd_pg_log_dups_tracked", "6");
+  }
+
+  void TearDown() override {
+    set_segment_entries(0);
+    g_ceph_context->_conf.rm_val("osd_pg_log_dups_tracked");
+    clear();
+    ch.reset();
+    StoreTestFixture::TearDown();
+  }
+
+  void set_segment_entries(unsigned n) {
+    g_ceph_context->_conf.set_val_or_die("osd_pg_log_segment_entries",
+					 std::to_string(n));
+  }
+
+  void append(unsigned n, epoch_t epoch = 1) {
+    entity_name_t client = entity_name_t::CLIENT(777);
+    for (unsigned i = 0; i < n; ++i) {
+      eversion_t v(epoch, log.head.version + 1);
+      add(mk_ple_mod(mk_obj(v.version), v, log.head,
+		     osd_reqid_t(client, 0, v.version)));
+    }
+    log.skip_can_rollback_to_to_head();
+    info.last_update = info.last_complete = log.head;
+  }
+
+  void persist() {
+    ObjectStore::Transaction t;
+    map<string, bufferlist> km;
+    write_log_and_missing(t, &km, test_coll, log_oid, false);
+    if (!km.empty()) {
+      t.omap_setkeys(test_coll, log_oid, km);
+    }
+    ASSERT_EQ(0, store->queue_transaction(ch, std::move(t)));
+  }
+
+  /// number of omap keys with the given prefix
+  size_t count_keys(const string &prefix) {
+    size_t n = 0;
+    auto p = store->get_omap_iterator(ch, log_oid);
+    for (p->seek_to_first(); p->valid(); p->next()) {
+      if (p->key().compare(0, prefix.size(), prefix) == 0) {
+	++n;
+      }
+    }
+    return n;
+  }
+
+  /// read the log back and compare it with the in-memory one
+  void verify(unsigned expected_format) {
+    IndexedLog read;
+    pg_missing_tracker_t read_missing;
+    ostringstream err;
+    std::optional<uint32_t> format;
+    PGLog::read_log_and_missing(
+      g_ceph_context, store.get(), ch, log_oid, info, read, read_missing,
+      err, false, nullptr, nullptr, nullptr, false, &format);
+    ASSERT_TRUE(format);
+    EXPECT_EQ(expected_format, *format);
+    ASSERT_EQ(log.log.size(), read.log.size());
+    auto p = read.log.begin();
+    for (auto& e : log.log) {
+      EXPECT_EQ(e.version, p->version);
+      EXPECT_EQ(e.reqid, p->reqid);
+      ++p;
+    }
+    // a partially trimmed dup segment may bring back older dups
+    ASSERT_LE(log.dups.size(), read.dups.size());
+    auto q = read.dups.rbegin();
+    for (auto d = log.dups.rbegin(); d != log.dups.rend(); ++d, ++q) {
+      EXPECT_EQ(*d, *q);
+    }
+  }
+
+  coll_t test_coll;
+  ObjectStore::CollectionHandle ch;
+  ghobject_t log_oid;
+  pg_info_t info;
+};
+
+TEST_F(PGLogSegmentTest, AppendAndTrim) {
+  append(10);
+  persist();
+  verify(4);
+  // versions 1..10 fill segments 0, 4 and 8
+  EXPECT_EQ(3u, count_keys("seg_log_"));
+
+  trim(mk_evt(1, 5), info, true, false);
+  persist();
+  verify(4);
+  // segment 4 still holds 6 and 7; only 5 is recent enough for a dup
+  EXPECT_EQ(2u, count_keys("seg_log_"));
+  EXPECT_EQ(1u, count_keys("seg_dup_"));
+
+  for (unsigned i = 0; i < 7; ++i) {
+    append(1);
+    persist();
+    verify(4);
+  }
+  trim(mk_evt(1, 13), info, true, false);
+  persist();
+  verify(4);
+  EXPECT_EQ(2u, count_keys("seg_log_"));
+  EXPECT_EQ(0u, count_keys("0"));
+  EXPECT_EQ(0u, count_keys("dup_"));
+
+  // a new epoch starts a new segment
+  append(2, 2);
+  persist();
+  verify(4);
+  EXPECT_EQ(3u, count_keys("seg_log_"));
+}
+
+TEST_F(PGLogSegmentTest, Convert) {
+  set_segment_entries(0);
+  append(10);
+  trim(mk_evt(1, 6), info, true, false);
+  persist();
+  verify(0);
+  EXPECT_EQ(4u, count_keys("0"));
+  EXPECT_EQ(2u, count_keys("dup_"));
+
+  set_segment_entries(4);
+  append(1);
+  persist();
+  verify(4);
+  EXPECT_EQ(0u, count_keys("0"));
+  EXPECT_EQ(0u, count_keys("dup_"));
+  EXPECT_EQ(2u, count_keys("seg_log_"));
+
+  set_segment_entries(0);
+  append(1);
+  persist();
+  verify(0);
+  EXPECT_EQ(0u, count_keys("seg_"));
+  EXPECT_EQ(6u, count_keys("0"));
+  EXPECT_EQ(2u, count_keys("dup_"));
+}
+
+TEST(reqid_index_t, set_find_erase) {
+  std::list<pg_log_dup_t> dups;
+  reqid_index_t<pg_log_dup_t> idx;
+  entity_name_t client = entity_name_t::CLIENT(777);
+  const unsigned n = 1000;
+  for (unsigned i = 0; i < n; ++i) {
+    dups.emplace_back(eversion_t(1, i + 1), i + 1,
+		      osd_reqid_t(client, i % 7, i), 0);
+    idx.set(&dups.back());
+  }
+  EXPECT_EQ(n, idx.size());
+  for (auto& d : dups) {
+    EXPECT_EQ(&d, idx.find(d.reqid));
+  }
+  EXPECT_EQ(nullptr, idx.find(osd_reqid_t(client, 0, n + 1)));
+
+  // re-indexing a reqid replaces the old entry
+  dups.emplace_back(eversion_t(2, n + 1), n + 1,
+		    dups.front().reqid, 0);
+  idx.set(&dups.back());
+  EXPECT_EQ(n, idx.size());
+  EXPECT_EQ(&dups.back(), idx.find(dups.front().reqid));
+  // ... and only the indexed entry may remove it
+  EXPECT_FALSE(idx.erase(dups.front().reqid, &dups.front()));
+  EXPECT_TRUE(idx.erase(dups.back().reqid, &dups.back()));
+  dups.pop_back();
+  dups.pop_front();
+
+  // trim from the front; everything left must still be found
+  size_t bytes = idx.get_bytes();
+  while (dups.size() > 10) {
+    EXPECT_TRUE(idx.erase(dups.front().reqid));
+    dups.pop_front();
+    for (auto& d : dups) {
+      ASSERT_EQ(&d, idx.find(d.reqid));
+    }
+  }
+  EXPECT_EQ(10u, idx.size());
+  EXPECT_LT(idx.get_bytes(), bytes);
+  idx.clear();
+  EXPECT_TRUE(idx.empty());
+  EXPECT_EQ(0u, idx.get_bytes());
+}
+
 // Local Variables:
 // compile-command: "cd ../.. ; make unittest_pglog ; ./unittest_pglog --log-to-stderr=true  --debug-osd=20 # --gtest_filter=*.* "
 // End:
@@ -195,3 +195,145 @@ TEST_F(ExplicitObjectHitSetTest, RejectsNoMatch) {
   }
   EXPECT_EQ(matches, 0);
 }
+
+class CuckooHitSetTest : public testing::Test, public HitSetTestStrap {
+public:
+
+  CuckooHitSetTest() : HitSetTestStrap(new HitSet(new CuckooHitSet)) {}
+
+  void rebuild(uint64_t target, uint64_t seed) {
+    HitSet::Params param(new CuckooHitSet::Params(target, seed));
+    HitSet new_set(param);
+    *hitset = new_set;
+  }
+
+  CuckooHitSet *get_hitset() { return static_cast<CuckooHitSet*>(hitset->impl.get()); }
+};
+
+TEST_F(CuckooHitSetTest, Construct) {
+  ASSERT_EQ(hitset->impl->get_type(), HitSet::TYPE_CUCKOO);
+  // success!
+}
+
+TEST_F(CuckooHitSetTest, InsertsMatch) {
+  rebuild(100, 1);
+  fill(100);
+  verify_fill(100);
+  EXPECT_EQ((unsigned)100, hitset->approx_unique_insert_count());
+  EXPECT_FALSE(hitset->is_full());
+}
+
+TEST_F(CuckooHitSetTest, CountsHits) {
+  rebuild(100, 1);
+  hobject_t a(object_t("a"), "", 0, 1, 0, "");
+  hobject_t b(object_t("b"), "", 0, 2, 0, "");
+  for (int i = 0; i < 20; ++i) {
+    hitset->insert(a);
+  }
+  hitset->insert(b);
+  EXPECT_EQ(15u, get_hitset()->hit_count(a));  // saturates
+  EXPECT_EQ(1u, get_hitset()->hit_count(b));
+  EXPECT_EQ(21u, hitset->insert_count());
+  EXPECT_EQ(2u, hitset->approx_unique_insert_count());
+}
+
+TEST_F(CuckooHitSetTest, FillsUp) {
+  rebuild(20, 1);
+  fill(20);
+  verify_fill(20);
+  EXPECT_FALSE(hitset->is_full());
+
+  char buf[50];
+  for (unsigned i = 20; i < 100 && !hitset->is_full(); ++i) {
+    sprintf(buf, "hitsettest_%u", i);
+    hitset->insert(hobject_t(object_t(buf), "", 0, i, 0, ""));
+  }
+  EXPECT_TRUE(hitset->is_full());
+}
+
+TEST_F(CuckooHitSetTest, RejectsNoMatch) {
+  rebuild(100, 1);
+  fill(100);
+  verify_fill(100);
+
+  char buf[50];
+  int matches = 0;
+  for (int i = 100; i < 1100; ++i) {
+    sprintf(buf, "hitsettest_%d", i);
+    hobject_t obj(object_t(buf), "", 0, i, 0, "");
+    if (hitset->contains(obj))
+      ++matches;
+  }
+  // 8 slots probed per lookup with 12 bit fingerprints: ~0.2%
+  EXPECT_LT(matches, 10);
+}
+
+TEST_F(CuckooHitSetTest, EncodeDecode) {
+  rebuild(100, 1);
+  fill(50);
+  hitset->seal();
+
+  bufferlist bl;
+  encode(*hitset, bl);
+  bufferlist orig;
+  orig.append(bl.c_str(), bl.length());
+
+  HitSet decoded;
+  auto p = bl.cbegin();
+  decode(decoded, p);
+  ASSERT_EQ(HitSet::TYPE_CUCKOO, decoded.impl->get_type());
+  EXPECT_EQ(50u, decoded.insert_count());
+  EXPECT_EQ(50u, decoded.approx_unique_insert_count());
+  HitSetTestStrap(&decoded).verify_fill(50);
+
+  // neither the original nor the decoded copy may scribble on the table
+  // they share with the encoded buffer
+  decoded.impl->insert(hobject_t(object_t("x"), "", 0, 1000, 0, ""));
+  hitset->impl->insert(hobject_t(object_t("y"), "", 0, 1001, 0, ""));
+  EXPECT_TRUE(bl.contents_equal(orig));
+}
+
+TEST(HitSetTemperatureSketch, Periods) {
+  HitSetTemperatureSketch sketch;
+  hobject_t a(object_t("a"), "", 0, 1, 0, "");
+  hobject_t b(object_t("b"), "", 0, 2, 0, "");
+
+  // nothing is tracked until the first period is archived
+  sketch.insert(a);
+  EXPECT_EQ(0u, sketch.lookup(a));
+  sketch.roll(10);
+  EXPECT_EQ(HitSetTemperatureSketch::MIN_WIDTH, sketch.get_width());
+  EXPECT_EQ(0u, sketch.get_complete_periods());
+
+  sketch.insert(a);
+  sketch.roll(10);
+  sketch.insert(b);
+  sketch.roll(10);
+  sketch.insert(a);
+  EXPECT_EQ(2u, sketch.get_complete_periods());
+  EXPECT_EQ(0b101u, sketch.lookup(a));
+  EXPECT_EQ(0b010u, sketch.lookup(b));
+
+  bufferlist bl;
+  encode(sketch, bl);
+  HitSetTemperatureSketch decoded;
+  auto p = bl.cbegin();
+  decode(decoded, p);
+  EXPECT_EQ(0b101u, decoded.lookup(a));
+  EXPECT_EQ(2u, decoded.get_complete_periods());
+
+  // history older than a cell holds is shifted out
+  for (unsigned i = 0; i < HitSetTemperatureSketch::MAX_PERIODS; ++i) {
+    sketch.roll(10);
+  }
+  EXPECT_EQ(0u, sketch.lookup(a));
+  EXPECT_EQ(HitSetTemperatureSketch::MAX_PERIODS - 1,
+	    sketch.get_complete_periods());
+
+  // outgrowing the sketch starts it over
+  sketch.insert(a);
+  sketch.roll(HitSetTemperatureSketch::MIN_WIDTH);
+  EXPECT_EQ(2 * HitSetTemperatureSketch::MIN_WIDTH, sketch.get_width());
+  EXPECT_EQ(0u, sketch.get_complete_periods());
+  EXPECT_EQ(0u, sketch.lookup(a));
+}
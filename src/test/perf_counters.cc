@@ -255,3 +255,70 @@ TEST(PerfCounters, read_avg) {
   t2.join();
   t1.join();
 }
+
+enum {
+  TEST_PERFCOUNTERS4_ELEMENT_FIRST = 500,
+  TEST_PERFCOUNTERS4_ELEMENT_GAUGE,
+  TEST_PERFCOUNTERS4_ELEMENT_COUNTER,
+  TEST_PERFCOUNTERS4_ELEMENT_AVG,
+  TEST_PERFCOUNTERS4_ELEMENT_LAST,
+};
+
+static PerfCounters* setup_test_perfcounter4(CephContext* cct) {
+  PerfCountersBuilder bld(cct, "test_perfcounter_4",
+      TEST_PERFCOUNTERS4_ELEMENT_FIRST, TEST_PERFCOUNTERS4_ELEMENT_LAST);
+  bld.set_sharded();
+  bld.add_u64(TEST_PERFCOUNTERS4_ELEMENT_GAUGE, "gauge");
+  bld.add_u64_counter(TEST_PERFCOUNTERS4_ELEMENT_COUNTER, "counter");
+  bld.add_time_avg(TEST_PERFCOUNTERS4_ELEMENT_AVG, "avg");
+  return bld.create_perf_counters();
+}
+
+TEST(PerfCounters, Sharded) {
+  g_ceph_context->_conf.set_val_or_die("perf_counters_shards", "4");
+  PerfCountersCollection *coll = g_ceph_context->get_perfcounters_collection();
+  coll->clear();
+  PerfCounters* fake_pf = setup_test_perfcounter4(g_ceph_context);
+  coll->add(fake_pf);
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([fake_pf] {
+      utime_t ns;
+      ns.set_from_double(0.000000001);
+      for (int i = 0; i < 10000; ++i) {
+	fake_pf->inc(TEST_PERFCOUNTERS4_ELEMENT_GAUGE);
+	fake_pf->inc(TEST_PERFCOUNTERS4_ELEMENT_COUNTER, 2);
+	fake_pf->tinc(TEST_PERFCOUNTERS4_ELEMENT_AVG, ns);
+	auto [count, sum] = fake_pf->get_tavg_ns(TEST_PERFCOUNTERS4_ELEMENT_AVG);
+	ASSERT_EQ(count, sum);
+      }
+      fake_pf->dec(TEST_PERFCOUNTERS4_ELEMENT_COUNTER, 5000);
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(80000u, fake_pf->get(TEST_PERFCOUNTERS4_ELEMENT_GAUGE));
+  ASSERT_EQ(120000u, fake_pf->get(TEST_PERFCOUNTERS4_ELEMENT_COUNTER));
+  ASSERT_EQ(std::make_pair(80000ul, 80000ul),
+	    fake_pf->get_tavg_ns(TEST_PERFCOUNTERS4_ELEMENT_AVG));
+
+  AdminSocketClient client(get_rand_socket_path());
+  std::string msg;
+  ASSERT_EQ("", client.do_request("{ \"prefix\": \"perf dump\", \"format\": \"json\" }", &msg));
+  ASSERT_EQ(sd("{\"test_perfcounter_4\":{\"gauge\":80000,\"counter\":120000,"
+	    "\"avg\":{\"avgcount\":80000,\"sum\":0.000080000,\"avgtime\":0.000000001}}}"), msg);
+
+  // set replaces the sum of all shards
+  fake_pf->set(TEST_PERFCOUNTERS4_ELEMENT_COUNTER, 7);
+  ASSERT_EQ(7u, fake_pf->get(TEST_PERFCOUNTERS4_ELEMENT_COUNTER));
+
+  fake_pf->reset();
+  ASSERT_EQ(80000u, fake_pf->get(TEST_PERFCOUNTERS4_ELEMENT_GAUGE));
+  ASSERT_EQ(0u, fake_pf->get(TEST_PERFCOUNTERS4_ELEMENT_COUNTER));
+  ASSERT_EQ(std::make_pair(0ul, 0ul),
+	    fake_pf->get_tavg_ns(TEST_PERFCOUNTERS4_ELEMENT_AVG));
+  coll->clear();
+  g_ceph_context->_conf.set_val_or_die("perf_counters_shards", "0");
+}
@@ -15,6 +15,7 @@
  */
 
 #include <stdio.h>
+#include <thread>
 
 #include "global/global_init.h"
 #include "common/ceph_argparse.h"
@@ -368,6 +369,26 @@ TEST(mempool, bufferlist_reassign)
   ASSERT_EQ(bytes_before, mempool::osd::allocated_bytes());
 }
 
+TEST(mempool, bufferlist_other_thread)
+{
+  bufferlist bl;
+  size_t items_before = mempool::buffer_anon::allocated_items();
+  size_t bytes_before = mempool::buffer_anon::allocated_bytes();
+  // the counts buffered by a thread show up once it exits
+  std::thread t([&bl] {
+    for (unsigned i = 0; i < 10; ++i) {
+      bl.append(buffer::create(1000));
+    }
+  });
+  t.join();
+  ASSERT_EQ(items_before + 10, mempool::buffer_anon::allocated_items());
+  // at least the payload; slab buffers are charged their whole block
+  ASSERT_LE(bytes_before + 10000, mempool::buffer_anon::allocated_bytes());
+  bl.clear();
+  ASSERT_EQ(items_before, mempool::buffer_anon::allocated_items());
+  ASSERT_EQ(bytes_before, mempool::buffer_anon::allocated_bytes());
+}
+
 TEST(mempool, bufferlist_c_str)
 {
   bufferlist bl;
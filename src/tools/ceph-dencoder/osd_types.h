@@ -69,6 +69,8 @@ TYPE(ECSubReadReply)
 TYPE_NONDETERMINISTIC(ExplicitHashHitSet)
 TYPE_NONDETERMINISTIC(ExplicitObjectHitSet)
 TYPE(BloomHitSet)
+TYPE(CuckooHitSet)
+TYPE(HitSetTemperatureSketch)
 TYPE_NONDETERMINISTIC(HitSet)   // because some subclasses are
 TYPE(HitSet::Params)
 
@@ -684,6 +684,11 @@ int do_trim_pg_log(ObjectStore *store, const coll_t &coll,
 	continue;
       if (p->key().substr(0, 4) == string("dup_"))
 	continue;
+      // osd_pg_log_segment_entries records hold many entries and are only
+      // ever trimmed whole by the OSD
+      if (PGLog::is_log_segment_key(p->key()) ||
+	  PGLog::is_dup_segment_key(p->key()))
+	continue;
 
       bufferlist bl = p->value();
       auto bp = bl.cbegin();
@@ -658,6 +658,13 @@ skip_upmap:
       
       cout << "pool " << p->first
 	   << " pg_num " << p->second.get_pg_num() << std::endl;
+      vector<vector<int>> pool_up, pool_acting;
+      vector<int> pool_up_primary, pool_acting_primary;
+      if (!test_random && !test_map_pgs_dump_all) {
+	osdmap.pg_range_to_up_acting_osds(
+	  p->first, 0, p->second.get_pg_num(),
+	  &pool_up, &pool_up_primary, &pool_acting, &pool_acting_primary);
+      }
       for (unsigned i = 0; i < p->second.get_pg_num(); ++i) {
 	pg_t pgid = pg_t(i, p->first);
 
@@ -676,7 +683,8 @@ skip_upmap:
 	  osds = acting;
 	  primary = acting_primary;
         } else {
-	  osdmap.pg_to_acting_osds(pgid, &osds, &primary);
+	  osds.swap(pool_acting[i]);
+	  primary = pool_acting_primary[i];
 	}
 	size[osds.size()]++;
 	if ((unsigned)max_size < osds.size())